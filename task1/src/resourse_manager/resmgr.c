@@ -18,14 +18,20 @@
 #include <stdlib.h>
 #include <string.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <sys/un.h>
 #include <unistd.h>
 
+#include "frame.h"
+
 #define EXAMPLE_SOCK_PATH "/tmp/example_resmgr.sock"
 #define BUFFER_SIZE 1024
+#define FRAMED_BUF (64 * 1024)   // приёмный буфер клиента в режиме -f
+#define FRAMED_BATCH 64          // кадров, разбираемых за один проход
 
 static const char *progname = "example";
 static int optv = 0;
+static int optf = 0;   // -f: двоичные кадры (frame.h) вместо "одна recv() = одна команда"
 static int listen_fd = -1;
 static char device_buffer[BUFFER_SIZE];
 static size_t device_size = 0;
@@ -34,6 +40,7 @@ static void options(int argc, char *argv[]);
 static void install_signals(void);
 static void on_signal(int signo);
 static void *client_thread(void *arg);  // ИСПРАВЛЕНО: добавлена точка с запятой
+static void *client_thread_framed(void *arg);
 
 int main(int argc, char *argv[])
 {
@@ -70,7 +77,7 @@ int main(int argc, char *argv[])
     return EXIT_FAILURE;
   }
 
-  printf("%s: listening on %s\n", progname, EXAMPLE_SOCK_PATH);
+  printf("%s: listening on %s%s\n", progname, EXAMPLE_SOCK_PATH, optf ? " (framed)" : "");
   printf("Подключитесь клиентом (например: `nc -U %s`) и отправьте данные.\n", EXAMPLE_SOCK_PATH);
 
   // Основной цикл accept: аналог io_open
@@ -88,7 +95,8 @@ int main(int argc, char *argv[])
 
     pthread_t th;
     // Запускаем поток для клиента; поток сам закроет fd
-    if (pthread_create(&th, NULL, client_thread, (void *)(long)client_fd) != 0) {
+    if (pthread_create(&th, NULL, optf ? client_thread_framed : client_thread,
+                       (void *)(long)client_fd) != 0) {
       perror("pthread_create");
       close(client_fd);
       continue;
@@ -111,7 +119,7 @@ static void *client_thread(void *arg)
   // (контекст операции), вести учёт "позиции файла", симулировать флаги и пр.
 
   for (;;) {
-    ssize_t n = recv(fd, buf, sizeof(buf), 0);
+    ssize_t n = recv(fd, buf, sizeof(buf) - 1, 0); // место под '\0'
     if (n == 0) {
       if (optv) printf("%s: клиент закрыл соединение (fd=%d)\n", progname, fd);
       break;
@@ -174,15 +182,144 @@ static void *client_thread(void *arg)
   return NULL;
 }
 
+// Отправить все iov целиком (sendmsg может записать часть)
+static int send_all(int fd, struct iovec *iov, int cnt)
+{
+  while (cnt > 0) {
+    struct msghdr msg = { .msg_iov = iov, .msg_iovlen = (size_t)cnt };
+    ssize_t m = sendmsg(fd, &msg, MSG_NOSIGNAL);
+    if (m < 0) {
+      if (errno == EINTR) continue;
+      if (errno != EPIPE && errno != ECONNRESET) perror("sendmsg");
+      return -1;
+    }
+    while (cnt > 0 && (size_t)m >= iov->iov_len) {
+      m -= (ssize_t)iov->iov_len;
+      iov++;
+      cnt--;
+    }
+    if (cnt > 0) {
+      iov->iov_base = (char *)iov->iov_base + m;
+      iov->iov_len -= (size_t)m;
+    }
+  }
+  return 0;
+}
+
+/*
+ * Обработчик клиента в режиме -f. Одна recv() может принести несколько
+ * кадров и начало следующего: разбираем все полные кадры прямо в
+ * приёмном буфере, ответы на всю пачку уходят одним sendmsg() — заголовки
+ * из локального массива, нагрузка эха указывает в приёмный буфер (без
+ * копирования). В начало буфера переносится только неполный хвост.
+ */
+static void *client_thread_framed(void *arg)
+{
+  int fd = (int)(long)arg;
+  char *buf = malloc(FRAMED_BUF);
+  if (!buf) {
+    perror("malloc");
+    close(fd);
+    return NULL;
+  }
+  size_t have = 0;
+  frame_view_t frames[FRAMED_BATCH];
+  char hdrs[FRAMED_BATCH][FRAME_HDR_SIZE];
+  char status[FRAMED_BATCH][32];
+  struct iovec iov[FRAMED_BATCH * 2];
+
+  for (;;) {
+    ssize_t n = recv(fd, buf + have, FRAMED_BUF - have, 0);
+    if (n == 0) {
+      if (optv) printf("%s: клиент закрыл соединение (fd=%d)\n", progname, fd);
+      break;
+    }
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      if (errno != ECONNRESET) perror("recv"); // клиент ушёл, не дочитав ответы
+      break;
+    }
+    have += (size_t)n;
+
+    size_t off = 0;
+    int nf;
+    do {
+      size_t used;
+      nf = frame_parse(buf + off, have - off, FRAMED_BUF - FRAME_HDR_SIZE,
+                       frames, FRAMED_BATCH, &used);
+      if (nf < 0) {
+        fprintf(stderr, "%s: bad frame from fd=%d, closing\n", progname, fd);
+        goto out;
+      }
+      if (optv && nf > 0) printf("%s: io_read — %d кадров\n", progname, nf);
+
+      int cnt = 0;
+      for (int i = 0; i < nf; i++) {
+        const frame_view_t *f = &frames[i];
+        const char *data = f->payload;
+        uint32_t len = f->len;
+        uint16_t flags = FRAME_F_REPLY;
+
+        switch (f->type) {
+          case FRAME_ECHO:
+            break;
+          case FRAME_READ:
+            data = device_buffer;
+            len = (uint32_t)device_size;
+            break;
+          case FRAME_WRITE:
+            if (device_size + f->len < BUFFER_SIZE) {
+              memcpy(device_buffer + device_size, f->payload, f->len);
+              device_size += f->len;
+              len = 0;
+            } else {
+              data = "Buffer full";
+              len = 11;
+              flags |= FRAME_F_ERROR;
+            }
+            break;
+          case FRAME_STATUS:
+            len = (uint32_t)snprintf(status[i], sizeof(status[i]), "size=%zu", device_size);
+            data = status[i];
+            break;
+          default:
+            data = "Unknown type";
+            len = 12;
+            flags |= FRAME_F_ERROR;
+            break;
+        }
+
+        frame_put_header(hdrs[i], f->type, flags, len);
+        iov[cnt++] = (struct iovec){ hdrs[i], FRAME_HDR_SIZE };
+        if (len > 0) iov[cnt++] = (struct iovec){ (void *)data, len };
+      }
+      if (cnt > 0 && send_all(fd, iov, cnt) < 0) goto out;
+      off += used;
+    } while (nf == FRAMED_BATCH);
+
+    // Неполный кадр — в начало буфера, остальное дочитаем следующей recv()
+    have -= off;
+    if (have > 0 && off > 0) memmove(buf, buf + off, have);
+  }
+
+out:
+  free(buf);
+  close(fd);
+  return NULL;
+}
+
 static void options(int argc, char *argv[])
 {
   int opt;
   optv = 0;
-  while ((opt = getopt(argc, argv, "v")) != -1) {
+  while ((opt = getopt(argc, argv, "vf")) != -1) {
     switch (opt) {
       case 'v':
         optv++;
         break;
+      case 'f':
+        optf = 1;
+        break;
     }
   }
 }
@@ -6,21 +6,29 @@
  *  - Реализовать периодическую выборку с шагом 2 мс через
  *    абсолютный clock_nanosleep(TIMER_ABSTIME)
  *  - Измерить фактические дельты между сэмплами и вывести статистику
+ *
+ *  Дельты не хранятся: они идут в гистограмму lat_hist из task3
+ *  (фиксированная память, среднее и ско на лету), поэтому длина прогона
+ *  (-n) ограничена только временем.
+ *
+ *  Запуск: ./bin/calctime2 [-n сэмплов] [-j гистограмма.json]
  */
 
 #define _POSIX_C_SOURCE 200809L
 #include <errno.h>
 #include <stdint.h>
 #include <inttypes.h>
-#include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#include <unistd.h>
+#include "lat_hist.h"
 
 #define BILLION 1000000000LL
 #define MILLION 1000000LL
 #define NUM_SAMPLES 5000 /* 5000 * 2 ms ≈ 10 секунд эксперимента */
+#define NUM_SHOWN 10     /* первые дельты печатаются как есть */
 
 static inline int64_t timespec_to_ns(const struct timespec *ts) {
     return (int64_t)ts->tv_sec * BILLION + (int64_t)ts->tv_nsec;
@@ -32,13 +40,29 @@ static inline void ns_to_timespec(int64_t ns, struct timespec *ts) {
 }
 
 #ifdef __linux__
-int main(void) {
+int main(int argc, char *argv[]) {
     struct timespec res_rt = {0}, res_mono = {0};
     struct timespec t_next = {0}, now = {0};
     const int64_t period_ns = 2 * MILLION; /* 2 ms */
-    int64_t deltas_ns[NUM_SAMPLES];
-    int samples = 0;
-
+    long num_samples = NUM_SAMPLES;
+    const char *json_path = NULL;
+    int64_t shown_ns[NUM_SHOWN];
+    static lat_hist_t hist;
+    long samples = 0;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "n:j:")) != -1) {
+        switch (opt) {
+        case 'n': num_samples = atol(optarg); break;
+        case 'j': json_path = optarg; break;
+        default:
+            fprintf(stderr, "usage: %s [-n samples] [-j histogram.json]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (num_samples < 1) num_samples = 1;
+    /* Дельты ~2 мс: самая мелкая сетка, корзины по 32 мкс на этой октаве. */
+    lat_hist_init_precision(&hist, LAT_HIST_MAX_SUB_BITS);
     setvbuf(stdout, NULL, _IOLBF, 0);
 
     if (clock_getres(CLOCK_REALTIME, &res_rt) != 0) {
@@ -59,7 +83,7 @@ int main(void) {
     }
 
     int64_t next_ns = timespec_to_ns(&t_next) + period_ns; /* стартуем через один период */
-    for (samples = 0; samples < NUM_SAMPLES; ++samples) {
+    for (samples = 0; samples < num_samples; ++samples) {
         ns_to_timespec(next_ns, &t_next);
 
         /* Абсолютный сон до t_next: устойчив к дрейфу */
@@ -82,38 +106,36 @@ int main(void) {
         }
         //сщбираем статистику реальных интервалов между пробуждениями
         int64_t now_ns = timespec_to_ns(&now);
-        deltas_ns[samples] = now_ns - (next_ns - period_ns); /* фактическая дельта */
+        int64_t delta_ns = now_ns - (next_ns - period_ns); /* фактическая дельта */
+        if (samples < NUM_SHOWN) shown_ns[samples] = delta_ns;
+        lat_hist_record(&hist, delta_ns > 0 ? (uint64_t)delta_ns : 0);
 
         next_ns += period_ns;
     }
 
-    /* Статистика */
-    int64_t min_ns = INT64_MAX, max_ns = INT64_MIN, sum_ns = 0;
-    for (int i = 0; i < NUM_SAMPLES; ++i) {
-        if (deltas_ns[i] < min_ns) min_ns = deltas_ns[i];
-        if (deltas_ns[i] > max_ns) max_ns = deltas_ns[i];
-        sum_ns += deltas_ns[i];
-    }
-    double avg_ns = (double)sum_ns / (double)NUM_SAMPLES;
-
-    // --- (Новое) Расчет стандартного отклонения ---
-    // Это показывает, насколько значения разбросаны вокруг среднего.
-    // Маленькое значение => стабильный период.
-    // Расчет стандартного отклонения (по формуле ско)
-    double sum_sq_diff = 0;
-    for (int i = 0; i < NUM_SAMPLES; ++i) {
-        sum_sq_diff += pow((double)deltas_ns[i] - avg_ns, 2);
-    }
-    double std_dev_ns = sqrt(sum_sq_diff / NUM_SAMPLES);
-
-    printf("Period stats over %d samples (target: %" PRId64 " ns):\n", NUM_SAMPLES, period_ns);
-    printf("  min=%" PRId64 " ns, avg=%.1f ns, max=%" PRId64 " ns, std_dev=%.1f ns\n",
-           min_ns, avg_ns, max_ns, std_dev_ns);
+    /* Статистика: min/max/avg и стандартное отклонение (показывает, насколько
+       значения разбросаны вокруг среднего; маленькое значение => стабильный
+       период) считает гистограмма по ходу записи, по Уэлфорду. */
+    printf("Period stats over %ld samples (target: %" PRId64 " ns):\n", samples, period_ns);
+    printf("  min=%" PRIu64 " ns, avg=%.1f ns, max=%" PRIu64 " ns, std_dev=%.1f ns\n",
+           hist.min, lat_hist_mean(&hist), hist.max, lat_hist_stddev(&hist));
+    printf("  p50=%" PRIu64 " ns, p99=%" PRIu64 " ns, p99.9=%" PRIu64 " ns\n",
+           lat_hist_percentile(&hist, 50), lat_hist_percentile(&hist, 99), lat_hist_percentile(&hist, 99.9));
 
     /* Вывести первые несколько измерений для наглядности */
-    printf("\nFirst 10 samples (delta from previous actual wakeup, ns):\n");
-    for (int i = 0; i < 10 && i < NUM_SAMPLES; ++i) {
-        printf("  sample %d: %" PRId64 "\n", i, deltas_ns[i]);
+    printf("\nFirst %d samples (delta from previous actual wakeup, ns):\n", NUM_SHOWN);
+    for (int i = 0; i < NUM_SHOWN && i < samples; ++i) {
+        printf("  sample %d: %" PRId64 "\n", i, shown_ns[i]);
+    }
+
+    if (json_path) {
+        FILE *out = fopen(json_path, "w");
+        if (!out) {
+            perror(json_path);
+            return EXIT_FAILURE;
+        }
+        lat_hist_write_json(&hist, out, "calctime2");
+        fclose(out);
     }
 
     return EXIT_SUCCESS;
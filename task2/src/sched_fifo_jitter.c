@@ -4,6 +4,12 @@
  * - SCHED_FIFO scheduler policy
  * - Pinning the thread to a specific CPU core (CPU affinity)
  * - Locking memory to prevent page faults (mlockall)
+ *
+ * Wake-up latencies go into a fixed-size log-linear histogram (lat_hist from
+ * task3) instead of an array of samples, so a run of any length (-n samples,
+ * 0 = until Ctrl-C) uses constant memory and the same statistics.
+ *
+ * Usage: ./bin/sched_fifo_jitter [-n samples] [-j histogram.json]
  */
 
 #define _GNU_SOURCE
@@ -12,12 +18,14 @@
 #include <inttypes.h>
 #include <pthread.h>
 #include <sched.h>
+#include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/mman.h>
 #include <time.h>
 #include <unistd.h>
+#include "lat_hist.h"
 
 #ifndef __linux__
 int main(void) {
@@ -26,12 +34,11 @@ int main(void) {
 }
 #else
 
-static int compare_i64(const void *a, const void *b) {
-    int64_t va = *(const int64_t *)a;
-    int64_t vb = *(const int64_t *)b;
-    if (va < vb) return -1;
-    if (va > vb) return 1;
-    return 0;
+static volatile sig_atomic_t stop;
+
+static void on_signal(int sig) {
+    (void)sig;
+    stop = 1;
 }
 
 static inline int64_t ts_to_ns(const struct timespec *ts) {
@@ -42,8 +49,23 @@ static inline void ns_to_ts(int64_t ns, struct timespec *ts) {
     ts->tv_nsec = (long)(ns % 1000000000LL);
 }
 
-int main(void) {
+int main(int argc, char *argv[]) {
+    long samples = 5000;
+    const char *json_path = NULL;
+    int opt;
+    while ((opt = getopt(argc, argv, "n:j:")) != -1) {
+        switch (opt) {
+        case 'n': samples = atol(optarg); break;
+        case 'j': json_path = optarg; break;
+        default:
+            fprintf(stderr, "usage: %s [-n samples (0 = until Ctrl-C)] [-j histogram.json]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (samples < 0) samples = 0;
     setvbuf(stdout, NULL, _IOLBF, 0);
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
 
     // --- 1. Set SCHED_FIFO policy ---
     // This is the most crucial step. It moves the thread to a real-time scheduler
@@ -80,20 +102,22 @@ int main(void) {
     }
 
     const int64_t period = 2 * 1000000LL; /* 2ms */
-    const int samples = 5000;
-    int64_t deltas[samples]; // Store all deltas for percentile calculation
+    // Static: ~30 KiB, locked by mlockall(MCL_FUTURE) like the rest of the image.
+    static lat_hist_t hist;
+    lat_hist_init(&hist);
 
     struct timespec next;
     clock_gettime(CLOCK_MONOTONIC, &next);
     int64_t next_ns = ts_to_ns(&next) + period;
 
-    for (int i = 0; i < samples; ++i) {
+    for (long i = 0; (samples == 0 || i < samples) && !stop; ++i) {
         ns_to_ts(next_ns, &next);
         int rc;
         // Absolute wait is crucial to prevent period drift.
         do {
             rc = clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
-        } while (rc == EINTR);
+        } while (rc == EINTR && !stop);
+        if (rc == EINTR) break;
         if (rc != 0) {
             fprintf(stderr, "clock_nanosleep: %s\n", strerror(rc));
             return EXIT_FAILURE;
@@ -103,27 +127,31 @@ int main(void) {
         clock_gettime(CLOCK_MONOTONIC, &now);
         // The "error" or "jitter" for this cycle.
         // It's the difference between when we woke up and when we *should* have.
-        deltas[i] = ts_to_ns(&now) - next_ns;
+        // An absolute sleep never returns early, so the delta is not negative.
+        int64_t delta = ts_to_ns(&now) - next_ns;
+        lat_hist_record(&hist, delta > 0 ? (uint64_t)delta : 0);
         next_ns += period;
     }
 
     // --- Statistics ---
-    qsort(deltas, samples, sizeof(int64_t), compare_i64);
-    int64_t min = deltas[0];
-    int64_t max = deltas[samples - 1];
-    int64_t p99 = deltas[(samples * 99) / 100];
-    int64_t sum = 0;
-    for (int i = 0; i < samples; ++i) {
-        sum += deltas[i];
+    if (hist.total == 0) return 0;
+    printf("\nJitter statistics over %" PRIu64 " samples (2ms period):\n", hist.total);
+    printf("  min latency: %" PRIu64 " ns\n", hist.min);
+    printf("  avg latency: %.1f ns (stddev %.1f ns)\n", lat_hist_mean(&hist), lat_hist_stddev(&hist));
+    printf("  50th percentile: %" PRIu64 " ns\n", lat_hist_percentile(&hist, 50));
+    printf("  99th percentile: %" PRIu64 " ns\n", lat_hist_percentile(&hist, 99));
+    printf("  99.9th percentile: %" PRIu64 " ns\n", lat_hist_percentile(&hist, 99.9));
+    printf("  max latency: %" PRIu64 " ns\n", hist.max);
+
+    if (json_path) {
+        FILE *out = fopen(json_path, "w");
+        if (!out) {
+            perror(json_path);
+            return EXIT_FAILURE;
+        }
+        lat_hist_write_json(&hist, out, "sched_fifo_jitter");
+        fclose(out);
     }
-    double avg = (double)sum / (double)samples;
-
-    printf("\nJitter statistics over %d samples (2ms period):\n", samples);
-    printf("  min latency: %" PRId64 " ns\n", min);
-    printf("  avg latency: %.1f ns\n", avg);
-    printf("  99th percentile: %" PRId64 " ns\n", p99);
-    printf("  max latency: %" PRId64 " ns\n", max);
-
     return 0;
 }
 #endif
@@ -0,0 +1,325 @@
+/*
+ * Векторные операции над ASCII-текстом (см. ascii.h)
+ *
+ * Смена регистра без ветвлений: байт в диапазоне [first, last] получает
+ * маску 0xFF из двух знаковых сравнений (байты >= 0x80 отрицательны и в
+ * диапазон не попадают), к нему применяется XOR 0x20. Поиск и проверка —
+ * movemask по сравнению и ctz первого бита.
+ *
+ * Повторная обработка хвоста перекрывающимся вектором безопасна: смена
+ * регистра идемпотентна, а в поиске уже просмотренные позиции
+ * отбрасываются сдвигом маски.
+ */
+#include "ascii.h"
+
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define ASCII_X86 1
+#include <immintrin.h>
+#endif
+
+#define MAX_VEC_DELIMS 8        // больше разделителей — побайтовый поиск
+
+// ---- scalar ----
+
+static void scalar_case(char *dst, const char *src, size_t n, char first, char last) {
+    for (size_t i = 0; i < n; i++) {
+        unsigned char c = (unsigned char)src[i];
+        dst[i] = (char)((unsigned char)(c - first) <= (unsigned char)(last - first) ? c ^ 0x20 : c);
+    }
+}
+
+static void scalar_upper(char *dst, const char *src, size_t n) {
+    scalar_case(dst, src, n, 'a', 'z');
+}
+
+static void scalar_lower(char *dst, const char *src, size_t n) {
+    scalar_case(dst, src, n, 'A', 'Z');
+}
+
+static size_t scalar_find(const char *p, size_t n, char c) {
+    for (size_t i = 0; i < n; i++) {
+        if (p[i] == c) return i;
+    }
+    return n;
+}
+
+static size_t scalar_find_any(const char *p, size_t n, const char *delims, size_t ndelims) {
+    for (size_t i = 0; i < n; i++) {
+        for (size_t k = 0; k < ndelims; k++) {
+            if (p[i] == delims[k]) return i;
+        }
+    }
+    return n;
+}
+
+static size_t scalar_valid(const char *p, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        if ((unsigned char)p[i] & 0x80) return i;
+    }
+    return n;
+}
+
+static const ascii_impl_t impl_scalar = {
+    "scalar", scalar_upper, scalar_lower, scalar_find, scalar_find_any, scalar_valid,
+};
+
+#ifdef ASCII_X86
+
+// ---- SSE2, 16 байт ----
+
+__attribute__((target("sse2")))
+static inline __m128i sse2_case16(__m128i v, __m128i lo, __m128i hi) {
+    __m128i in = _mm_and_si128(_mm_cmpgt_epi8(v, lo), _mm_cmplt_epi8(v, hi));
+    return _mm_xor_si128(v, _mm_and_si128(in, _mm_set1_epi8(0x20)));
+}
+
+__attribute__((target("sse2")))
+static void sse2_case(char *dst, const char *src, size_t n, char first, char last) {
+    if (n < 16) {
+        scalar_case(dst, src, n, first, last);
+        return;
+    }
+    __m128i lo = _mm_set1_epi8((char)(first - 1)), hi = _mm_set1_epi8((char)(last + 1));
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(src + i));
+        _mm_storeu_si128((__m128i *)(dst + i), sse2_case16(v, lo, hi));
+    }
+    if (i < n) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(src + n - 16));
+        _mm_storeu_si128((__m128i *)(dst + n - 16), sse2_case16(v, lo, hi));
+    }
+}
+
+static void sse2_upper(char *dst, const char *src, size_t n) {
+    sse2_case(dst, src, n, 'a', 'z');
+}
+
+static void sse2_lower(char *dst, const char *src, size_t n) {
+    sse2_case(dst, src, n, 'A', 'Z');
+}
+
+// Общий цикл поиска: mask_expr — биты найденных позиций вектора v.
+// Основной цикл берёт 4 вектора за проход и проверяет их маски вместе.
+#define SSE2_SCAN(p, n, mask_expr)                                                  \
+    do {                                                                            \
+        size_t i_ = 0;                                                              \
+        for (; i_ + 64 <= (n); i_ += 64) {                                          \
+            uint64_t m_ = 0;                                                        \
+            for (int j_ = 0; j_ < 4; j_++) {                                        \
+                __m128i v = _mm_loadu_si128((const __m128i *)((p) + i_ + 16 * j_)); \
+                m_ |= (uint64_t)(mask_expr) << (16 * j_);                           \
+            }                                                                       \
+            if (m_) return i_ + (size_t)__builtin_ctzll(m_);                        \
+        }                                                                           \
+        for (; i_ + 16 <= (n); i_ += 16) {                                          \
+            __m128i v = _mm_loadu_si128((const __m128i *)((p) + i_));               \
+            unsigned m_ = (unsigned)(mask_expr);                                    \
+            if (m_) return i_ + (size_t)__builtin_ctz(m_);                          \
+        }                                                                           \
+        if (i_ < (n)) {                                                             \
+            __m128i v = _mm_loadu_si128((const __m128i *)((p) + (n) - 16));         \
+            unsigned m_ = (unsigned)(mask_expr) >> (i_ - ((n) - 16));               \
+            if (m_) return i_ + (size_t)__builtin_ctz(m_);                          \
+        }                                                                           \
+        return (n);                                                                 \
+    } while (0)
+
+__attribute__((target("sse2")))
+static size_t sse2_find(const char *p, size_t n, char c) {
+    if (n < 16) return scalar_find(p, n, c);
+    __m128i vc = _mm_set1_epi8(c);
+    SSE2_SCAN(p, n, _mm_movemask_epi8(_mm_cmpeq_epi8(v, vc)));
+}
+
+__attribute__((target("sse2")))
+static inline unsigned sse2_any16(__m128i v, const __m128i *vd, size_t nd) {
+    __m128i hit = _mm_cmpeq_epi8(v, vd[0]);
+    for (size_t k = 1; k < nd; k++) hit = _mm_or_si128(hit, _mm_cmpeq_epi8(v, vd[k]));
+    return (unsigned)_mm_movemask_epi8(hit);
+}
+
+__attribute__((target("sse2")))
+static size_t sse2_find_any(const char *p, size_t n, const char *delims, size_t ndelims) {
+    if (n < 16 || ndelims == 0 || ndelims > MAX_VEC_DELIMS) return scalar_find_any(p, n, delims, ndelims);
+    __m128i vd[MAX_VEC_DELIMS];
+    for (size_t k = 0; k < ndelims; k++) vd[k] = _mm_set1_epi8(delims[k]);
+    SSE2_SCAN(p, n, sse2_any16(v, vd, ndelims));
+}
+
+__attribute__((target("sse2")))
+static size_t sse2_valid(const char *p, size_t n) {
+    if (n < 16) return scalar_valid(p, n);
+    SSE2_SCAN(p, n, _mm_movemask_epi8(v));
+}
+
+static const ascii_impl_t impl_sse2 = {
+    "sse2", sse2_upper, sse2_lower, sse2_find, sse2_find_any, sse2_valid,
+};
+
+// ---- AVX2, 32 байта ----
+
+__attribute__((target("avx2")))
+static inline __m256i avx2_case32(__m256i v, __m256i lo, __m256i hi) {
+    __m256i in = _mm256_and_si256(_mm256_cmpgt_epi8(v, lo), _mm256_cmpgt_epi8(hi, v));
+    return _mm256_xor_si256(v, _mm256_and_si256(in, _mm256_set1_epi8(0x20)));
+}
+
+// Ядра AVX2 вызываются только для n >= 32: короткий буфер уходит в SSE2
+// из обёртки без target("avx2"), иначе gcc может поднять vpbroadcast над
+// проверкой длины и прыгнуть в SSE-код без vzeroupper (штраф за смену
+// состояния AVX-SSE — на порядок медленнее на 16 байтах).
+__attribute__((target("avx2")))
+static void avx2_case_long(char *dst, const char *src, size_t n, char first, char last) {
+    __m256i lo = _mm256_set1_epi8((char)(first - 1)), hi = _mm256_set1_epi8((char)(last + 1));
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(src + i));
+        _mm256_storeu_si256((__m256i *)(dst + i), avx2_case32(v, lo, hi));
+    }
+    if (i < n) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(src + n - 32));
+        _mm256_storeu_si256((__m256i *)(dst + n - 32), avx2_case32(v, lo, hi));
+    }
+}
+
+static void avx2_upper(char *dst, const char *src, size_t n) {
+    if (n < 32) sse2_case(dst, src, n, 'a', 'z');
+    else avx2_case_long(dst, src, n, 'a', 'z');
+}
+
+static void avx2_lower(char *dst, const char *src, size_t n) {
+    if (n < 32) sse2_case(dst, src, n, 'A', 'Z');
+    else avx2_case_long(dst, src, n, 'A', 'Z');
+}
+
+#define AVX2_SCAN(p, n, mask_expr)                                                  \
+    do {                                                                            \
+        size_t i_ = 0;                                                              \
+        for (; i_ + 64 <= (n); i_ += 64) {                                          \
+            uint64_t m_ = 0;                                                        \
+            for (int j_ = 0; j_ < 2; j_++) {                                        \
+                __m256i v = _mm256_loadu_si256((const __m256i *)((p) + i_ + 32 * j_)); \
+                m_ |= (uint64_t)(uint32_t)(mask_expr) << (32 * j_);                 \
+            }                                                                       \
+            if (m_) return i_ + (size_t)__builtin_ctzll(m_);                        \
+        }                                                                           \
+        for (; i_ + 32 <= (n); i_ += 32) {                                          \
+            __m256i v = _mm256_loadu_si256((const __m256i *)((p) + i_));            \
+            uint32_t m_ = (uint32_t)(mask_expr);                                    \
+            if (m_) return i_ + (size_t)__builtin_ctz(m_);                          \
+        }                                                                           \
+        if (i_ < (n)) {                                                             \
+            __m256i v = _mm256_loadu_si256((const __m256i *)((p) + (n) - 32));      \
+            uint32_t m_ = (uint32_t)(mask_expr) >> (i_ - ((n) - 32));               \
+            if (m_) return i_ + (size_t)__builtin_ctz(m_);                          \
+        }                                                                           \
+        return (n);                                                                 \
+    } while (0)
+
+__attribute__((target("avx2")))
+static size_t avx2_find_long(const char *p, size_t n, char c) {
+    __m256i vc = _mm256_set1_epi8(c);
+    AVX2_SCAN(p, n, _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, vc)));
+}
+
+__attribute__((target("avx2")))
+static inline uint32_t avx2_any32(__m256i v, const __m256i *vd, size_t nd) {
+    __m256i hit = _mm256_cmpeq_epi8(v, vd[0]);
+    for (size_t k = 1; k < nd; k++) hit = _mm256_or_si256(hit, _mm256_cmpeq_epi8(v, vd[k]));
+    return (uint32_t)_mm256_movemask_epi8(hit);
+}
+
+__attribute__((target("avx2")))
+static size_t avx2_find_any_long(const char *p, size_t n, const char *delims, size_t ndelims) {
+    __m256i vd[MAX_VEC_DELIMS];
+    for (size_t k = 0; k < ndelims; k++) vd[k] = _mm256_set1_epi8(delims[k]);
+    AVX2_SCAN(p, n, avx2_any32(v, vd, ndelims));
+}
+
+__attribute__((target("avx2")))
+static size_t avx2_valid_long(const char *p, size_t n) {
+    AVX2_SCAN(p, n, _mm256_movemask_epi8(v));
+}
+
+static size_t avx2_find(const char *p, size_t n, char c) {
+    return n < 32 ? sse2_find(p, n, c) : avx2_find_long(p, n, c);
+}
+
+static size_t avx2_find_any(const char *p, size_t n, const char *delims, size_t ndelims) {
+    if (n < 32 || ndelims == 0 || ndelims > MAX_VEC_DELIMS) return sse2_find_any(p, n, delims, ndelims);
+    return avx2_find_any_long(p, n, delims, ndelims);
+}
+
+static size_t avx2_valid(const char *p, size_t n) {
+    return n < 32 ? sse2_valid(p, n) : avx2_valid_long(p, n);
+}
+
+static const ascii_impl_t impl_avx2 = {
+    "avx2", avx2_upper, avx2_lower, avx2_find, avx2_find_any, avx2_valid,
+};
+
+#endif // ASCII_X86
+
+// ---- выбор реализации ----
+
+static const ascii_impl_t *supported[3];
+static int num_supported;
+static const ascii_impl_t *active = &impl_scalar;
+
+// Конструктор: к первому вызову ascii_* реализация уже выбрана.
+__attribute__((constructor))
+static void ascii_init(void) {
+    num_supported = 0;
+    supported[num_supported++] = &impl_scalar;
+#ifdef ASCII_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse2")) supported[num_supported++] = &impl_sse2;
+    if (__builtin_cpu_supports("sse2") && __builtin_cpu_supports("avx2")) supported[num_supported++] = &impl_avx2;
+#endif
+    active = supported[num_supported - 1];
+}
+
+const ascii_impl_t *const *ascii_impls(int *count) {
+    *count = num_supported;
+    return supported;
+}
+
+const ascii_impl_t *ascii_active(void) {
+    return active;
+}
+
+int ascii_use(const char *name) {
+    for (int i = 0; i < num_supported; i++) {
+        if (strcmp(supported[i]->name, name) == 0) {
+            active = supported[i];
+            return 0;
+        }
+    }
+    errno = ENOTSUP;
+    return -1;
+}
+
+void ascii_upper(char *dst, const char *src, size_t n) {
+    active->upper(dst, src, n);
+}
+
+void ascii_lower(char *dst, const char *src, size_t n) {
+    active->lower(dst, src, n);
+}
+
+size_t ascii_find(const char *p, size_t n, char c) {
+    return active->find(p, n, c);
+}
+
+size_t ascii_find_any(const char *p, size_t n, const char *delims, size_t ndelims) {
+    return active->find_any(p, n, delims, ndelims);
+}
+
+size_t ascii_valid(const char *p, size_t n) {
+    return active->valid(p, n);
+}
@@ -0,0 +1,45 @@
+#ifndef ASCII_H
+#define ASCII_H
+
+/*
+ * Векторные операции над ASCII-текстом с выбором реализации при запуске.
+ *
+ * Каждая операция есть в трёх вариантах: побайтовый (scalar), SSE2 по 16
+ * байт и AVX2 по 32 байта. При первой загрузке библиотеки по CPUID
+ * (__builtin_cpu_supports) выбирается самый широкий доступный вариант,
+ * вызов идёт через указатель без проверок на каждом обращении. Хвост
+ * короче вектора обрабатывается перекрывающимся последним вектором, а
+ * буфер короче вектора — побайтово.
+ *
+ * Локаль не учитывается: регистр меняется только у 'a'..'z' / 'A'..'Z',
+ * байты >= 0x80 не трогаются (как toupper/tolower в локали "C").
+ * dst и src либо совпадают (на месте), либо не пересекаются.
+ */
+
+#include <stddef.h>
+
+void ascii_upper(char *dst, const char *src, size_t n);
+void ascii_lower(char *dst, const char *src, size_t n);
+// Смещение первого байта c (или любого из delims[0..ndelims)); n, если нет.
+size_t ascii_find(const char *p, size_t n, char c);
+size_t ascii_find_any(const char *p, size_t n, const char *delims, size_t ndelims);
+// Длина префикса из 7-битных байтов: n — весь буфер ASCII.
+size_t ascii_valid(const char *p, size_t n);
+
+typedef struct {
+    const char *name;
+    void (*upper)(char *dst, const char *src, size_t n);
+    void (*lower)(char *dst, const char *src, size_t n);
+    size_t (*find)(const char *p, size_t n, char c);
+    size_t (*find_any)(const char *p, size_t n, const char *delims, size_t ndelims);
+    size_t (*valid)(const char *p, size_t n);
+} ascii_impl_t;
+
+// Реализации, поддерживаемые этим процессором (от простой к широкой).
+const ascii_impl_t *const *ascii_impls(int *count);
+// Текущая реализация ascii_* и её принудительная смена по имени
+// ("scalar", "sse2", "avx2"); -1 и errno = ENOTSUP, если её нет.
+const ascii_impl_t *ascii_active(void);
+int ascii_use(const char *name);
+
+#endif // ASCII_H
@@ -0,0 +1,221 @@
+/*
+ * Скорость операций ascii.h по реализациям и размерам буфера
+ *
+ * Сначала сверка: на случайных данных (в том числе с байтами >= 0x80)
+ * всех длин до 300 и при смещениях 0..3 от выравнивания каждая
+ * реализация должна совпасть с побайтовой, а побайтовая — с libc
+ * (toupper/tolower/memchr). Затем для каждой операции и каждого размера
+ * из -s — ГБ/с каждой реализации за -d секунд:
+ *  - upper, lower: src -> dst;
+ *  - find: искомый байт только в последней позиции (просмотр всего буфера);
+ *  - find_any: то же для четырёх разделителей " \t\r\n" (текст без пробелов);
+ *  - valid: весь буфер ASCII.
+ * Столбец libc — ориентир: цикл toupper/tolower, memchr, strcspn.
+ *
+ * Код возврата ненулевой, если сверка не прошла.
+ *
+ * Запуск: ./bin/ascii_bench [-s 16,64,256,4K,64K,1M] [-d секунд]
+ */
+#define _GNU_SOURCE
+#include <ctype.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "ascii.h"
+
+#define MAX_SIZES 16
+#define CHECK_MAX_LEN 300
+#define DELIMS " \t\r\n"
+#define BATCH_BYTES (256 << 10)         // между проверками времени
+
+typedef struct {
+    size_t sizes[MAX_SIZES];
+    int num_sizes;
+    double duration;
+} bench_config_t;
+
+typedef enum { OP_UPPER, OP_LOWER, OP_FIND, OP_FIND_ANY, OP_VALID, NUM_OPS } op_t;
+
+static const char *op_names[NUM_OPS] = {"upper", "lower", "find", "find_any", "valid"};
+
+static volatile size_t sink;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// ---- сверка ----
+
+static int check_impl(const ascii_impl_t *impl, const char *src, size_t n) {
+    char got[CHECK_MAX_LEN], want[CHECK_MAX_LEN];
+    int bad = 0;
+    for (size_t i = 0; i < n; i++) want[i] = (char)toupper((unsigned char)src[i]);
+    impl->upper(got, src, n);
+    bad |= memcmp(got, want, n) != 0;
+    for (size_t i = 0; i < n; i++) want[i] = (char)tolower((unsigned char)src[i]);
+    impl->lower(got, src, n);
+    bad |= memcmp(got, want, n) != 0;
+    // На месте: dst == src.
+    memcpy(got, src, n);
+    impl->upper(got, got, n);
+    for (size_t i = 0; i < n; i++) bad |= got[i] != (char)toupper((unsigned char)src[i]);
+
+    const char *hit = memchr(src, '\n', n);
+    bad |= impl->find(src, n, '\n') != (hit ? (size_t)(hit - src) : n);
+    size_t any = n;
+    for (size_t i = 0; i < n && any == n; i++) {
+        if (strchr(DELIMS, src[i]) && src[i]) any = i;
+    }
+    bad |= impl->find_any(src, n, DELIMS, strlen(DELIMS)) != any;
+    size_t valid = 0;
+    while (valid < n && !((unsigned char)src[valid] & 0x80)) valid++;
+    bad |= impl->valid(src, n) != valid;
+    return bad ? -1 : 0;
+}
+
+static int run_check(void) {
+    int count;
+    const ascii_impl_t *const *impls = ascii_impls(&count);
+    char buf[CHECK_MAX_LEN + 4];
+    unsigned seed = 1;
+    int failures = 0;
+    for (int round = 0; round < 64; round++) {
+        // Разреженные разделители и старшие байты: поиск находит их на разных позициях.
+        for (size_t i = 0; i < sizeof(buf); i++) {
+            unsigned r = (unsigned)rand_r(&seed);
+            if (r % 64 == 0) buf[i] = DELIMS[r % 4];
+            else buf[i] = (char)(r % 97 == 0 ? 0x80 | r : ' ' + 1 + r % 94);
+        }
+        for (size_t off = 0; off < 4; off++) {
+            for (size_t n = 0; n <= CHECK_MAX_LEN; n++) {
+                for (int k = 0; k < count; k++) {
+                    if (check_impl(impls[k], buf + off, n) == 0) continue;
+                    if (failures++ < 10) fprintf(stderr, "%s: mismatch at length %zu, offset %zu\n", impls[k]->name, n, off);
+                }
+            }
+        }
+    }
+    return failures;
+}
+
+// ---- замеры ----
+
+static size_t run_op(const ascii_impl_t *impl, op_t op, char *dst, const char *src, size_t n) {
+    switch (op) {
+    case OP_UPPER: impl->upper(dst, src, n); return 0;
+    case OP_LOWER: impl->lower(dst, src, n); return 0;
+    case OP_FIND: return impl->find(src, n, '\n');
+    case OP_FIND_ANY: return impl->find_any(src, n, DELIMS, sizeof(DELIMS) - 1);
+    case OP_VALID: return impl->valid(src, n);
+    default: return 0;
+    }
+}
+
+// Ориентир из libc; -1, если аналога нет.
+static long run_libc(op_t op, char *dst, const char *src, size_t n) {
+    switch (op) {
+    case OP_UPPER:
+        for (size_t i = 0; i < n; i++) dst[i] = (char)toupper((unsigned char)src[i]);
+        return 0;
+    case OP_LOWER:
+        for (size_t i = 0; i < n; i++) dst[i] = (char)tolower((unsigned char)src[i]);
+        return 0;
+    case OP_FIND: return (const char *)memchr(src, '\n', n) - src;
+    case OP_FIND_ANY: return (long)strcspn(src, DELIMS);
+    default: return -1;
+    }
+}
+
+// ГБ/с одной реализации (impl == NULL — libc); 0, если операции нет.
+static double measure(const bench_config_t *cfg, const ascii_impl_t *impl, op_t op, char *dst, const char *src,
+                      size_t n) {
+    if (!impl && run_libc(op, dst, src, n) == -1) return 0;
+    size_t batch = BATCH_BYTES / n + 1;
+    uint64_t bytes = 0, t0 = now_ns(), deadline = t0 + (uint64_t)(cfg->duration * 1e9), t;
+    do {
+        for (size_t i = 0; i < batch; i++) sink += impl ? run_op(impl, op, dst, src, n) : (size_t)run_libc(op, dst, src, n);
+        bytes += batch * n;
+    } while ((t = now_ns()) < deadline);
+    return (double)bytes / (double)(t - t0);
+}
+
+static int parse_sizes(bench_config_t *cfg, char *arg) {
+    cfg->num_sizes = 0;
+    for (char *tok = strtok(arg, ","); tok; tok = strtok(NULL, ",")) {
+        char *end;
+        unsigned long long v = strtoull(tok, &end, 0);
+        if (*end == 'K' || *end == 'k') v <<= 10;
+        else if (*end == 'M' || *end == 'm') v <<= 20;
+        if (v == 0 || cfg->num_sizes == MAX_SIZES) return -1;
+        cfg->sizes[cfg->num_sizes++] = (size_t)v;
+    }
+    return cfg->num_sizes ? 0 : -1;
+}
+
+int main(int argc, char *argv[]) {
+    bench_config_t cfg = {
+        .sizes = {16, 64, 256, 4 << 10, 64 << 10, 1 << 20},
+        .num_sizes = 6,
+        .duration = 0.05,
+    };
+
+    int opt;
+    while ((opt = getopt(argc, argv, "s:d:")) != -1) {
+        switch (opt) {
+        case 's':
+            if (parse_sizes(&cfg, optarg) == -1) goto usage;
+            break;
+        case 'd': cfg.duration = atof(optarg); break;
+        default:
+            goto usage;
+        }
+    }
+    if (cfg.duration <= 0) goto usage;
+    setvbuf(stdout, NULL, _IOLBF, 0);
+
+    int failures = run_check();
+    int count;
+    const ascii_impl_t *const *impls = ascii_impls(&count);
+    printf("check: %s; active implementation: %s\n", failures ? "FAILED" : "ok", ascii_active()->name);
+
+    size_t max_size = 0;
+    for (int i = 0; i < cfg.num_sizes; i++) {
+        if (cfg.sizes[i] > max_size) max_size = cfg.sizes[i];
+    }
+    char *src = malloc(max_size + 1), *dst = malloc(max_size);
+    if (!src || !dst) {
+        perror("malloc");
+        return EXIT_FAILURE;
+    }
+
+    printf("GB/s per implementation\n%-9s %9s", "op", "bytes");
+    for (int k = 0; k < count; k++) printf(" %8s", impls[k]->name);
+    printf(" %8s\n", "libc");
+    for (op_t op = 0; op < NUM_OPS; op++) {
+        for (int s = 0; s < cfg.num_sizes; s++) {
+            size_t n = cfg.sizes[s];
+            // Буквы разного регистра и цифры без разделителей; '\n' — последний байт.
+            for (size_t i = 0; i < n; i++) src[i] = "aBcDeFgHiJkLmNoPqRsTuVwXyZ0123456789"[i % 36];
+            if (op == OP_FIND || op == OP_FIND_ANY) src[n - 1] = '\n';
+            src[n] = '\0';
+            printf("%-9s %9zu", op_names[op], n);
+            for (int k = 0; k < count; k++) printf(" %8.2f", measure(&cfg, impls[k], op, dst, src, n));
+            double libc = measure(&cfg, NULL, op, dst, src, n);
+            if (libc > 0) printf(" %8.2f\n", libc);
+            else printf(" %8s\n", "-");
+        }
+    }
+
+    free(src);
+    free(dst);
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+
+usage:
+    fprintf(stderr, "usage: %s [-s size[K|M][,...]] [-d seconds]\n", argv[0]);
+    return EXIT_FAILURE;
+}
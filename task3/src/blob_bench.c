@@ -0,0 +1,333 @@
+/*
+ * Большие сообщения через POSIX MQ: фрагменты в очереди против данных в
+ * пуле общей памяти и дескриптора в очереди (гибридный режим
+ * posix_mq_server)
+ *
+ * Для каждого размера из -s два режима по -d секунд:
+ *  - mq:   данные режутся на фрагменты по mq_msgsize (предел
+ *          /proc/sys/fs/mqueue/msgsize_max) и идут через пару очередей к
+ *          дочернему процессу, который переводит их в верхний регистр и
+ *          отправляет обратно — по две копии в ядро и из ядра на байт в
+ *          каждую сторону;
+ *  - blob: клиент пишет данные в буфер пула сервера (-x), через очередь
+ *          идёт только дескриптор, сервер переводит данные на месте.
+ *
+ * Один клиент, одно сообщение в полёте; приоритеты запросов чередуются,
+ * приоритет ответа должен совпасть с приоритетом запроса. Данные ответа
+ * проверяются выборочно (каждый 4096-й байт и последний).
+ *
+ * Печатает обменов в секунду, МиБ/с (данные в одну сторону) и перцентили
+ * задержки обмена. Код возврата ненулевой при ошибках.
+ *
+ * Запуск: ./bin/blob_bench -x ./bin/posix_mq_server [-s 256,4K,64K,1M,16M]
+ *                          [-d секунд]
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <mqueue.h>
+#include <signal.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include "ascii.h"
+#include "common.h"
+#include "lat_hist.h"
+#include "shm_blob.h"
+
+#define MAX_SIZES 16
+#define FRAG_QUEUE "/mq_blob_bench_frag"
+#define FRAG_REPLY "/mq_blob_bench_frag_reply"
+#define FRAG_DEPTH 10
+#define MIN_ROUNDS 3
+
+typedef struct {
+    const char *server;
+    size_t sizes[MAX_SIZES];
+    int num_sizes;
+    double duration;
+} bench_config_t;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static long read_sysctl(const char *path, long fallback) {
+    FILE *f = fopen(path, "r");
+    long v = fallback;
+    if (f) {
+        if (fscanf(f, "%ld", &v) != 1) v = fallback;
+        fclose(f);
+    }
+    return v;
+}
+
+// Байт i раунда round — 'a' + (i + round) % 26. Пишется блоками из
+// заготовки, чтобы заполнение не заслоняло передачу.
+static void fill(char *buf, size_t size, unsigned round) {
+    static char pattern[4096 + 26];
+    if (!pattern[0]) {
+        for (size_t i = 0; i < sizeof(pattern); i++) pattern[i] = (char)('a' + i % 26);
+    }
+    for (size_t i = 0; i < size; i += 4096) {
+        size_t n = size - i < 4096 ? size - i : 4096;
+        memcpy(buf + i, pattern + (i + round) % 26, n);
+    }
+}
+
+// Выборочная проверка ответа: каждый 4096-й байт и последний.
+static int check(const char *buf, size_t size, unsigned round) {
+    for (size_t i = 0; i < size; i += 4096) {
+        if (buf[i] != (char)('A' + (i + round) % 26)) return -1;
+    }
+    return buf[size - 1] == (char)('A' + (size - 1 + round) % 26) ? 0 : -1;
+}
+
+static void print_row(const char *mode, size_t size, const lat_hist_t *h, double secs) {
+    printf("%-5s %10zu %9.0f %10.1f %9.1f %9.1f\n", mode, size, (double)h->total / secs,
+           (double)h->total * (double)size / secs / (1 << 20), lat_hist_percentile(h, 50) / 1e3,
+           lat_hist_percentile(h, 99) / 1e3);
+}
+
+// --- mq: фрагменты через пару очередей ---
+
+static void frag_echo_main(mqd_t in, mqd_t out, size_t frag) {
+    char *buf = malloc(frag);
+    if (!buf) _exit(1);
+    for (;;) {
+        unsigned prio;
+        ssize_t n = mq_receive(in, buf, frag, &prio);
+        if (n == 0) break;
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            _exit(1);
+        }
+        ascii_upper(buf, buf, (size_t)n);
+        if (mq_send(out, buf, (size_t)n, prio) == -1) _exit(1);
+    }
+    _exit(0);
+}
+
+static int run_mq(const bench_config_t *cfg, size_t size) {
+    size_t frag = (size_t)read_sysctl("/proc/sys/fs/mqueue/msgsize_max", 8192);
+    struct mq_attr attr = {.mq_maxmsg = FRAG_DEPTH, .mq_msgsize = (long)frag};
+    mq_unlink(FRAG_QUEUE);
+    mq_unlink(FRAG_REPLY);
+    mqd_t to = mq_open(FRAG_QUEUE, O_CREAT | O_RDWR, 0600, &attr);
+    mqd_t from = mq_open(FRAG_REPLY, O_CREAT | O_RDWR, 0600, &attr);
+    char *msg = malloc(size), *reply = malloc(size);
+    if (to == (mqd_t)-1 || from == (mqd_t)-1 || !msg || !reply) {
+        perror("mq: setup");
+        return -1;
+    }
+    pid_t echo = fork();
+    if (echo == 0) frag_echo_main(to, from, frag);
+
+    lat_hist_t h;
+    lat_hist_init(&h);
+    size_t frags = (size + frag - 1) / frag;
+    uint64_t start = now_ns(), end = start + (uint64_t)(cfg->duration * 1e9);
+    int rc = 0;
+    for (unsigned round = 0; rc == 0 && (now_ns() < end || round < MIN_ROUNDS); ++round) {
+        unsigned prio = round % 2 ? MSG_PRIO_HIGH : MSG_PRIO_NORMAL;
+        uint64_t t0 = now_ns();
+        fill(msg, size, round);
+        // Не больше FRAG_DEPTH фрагментов в полёте: ни одна очередь не переполнится.
+        size_t sent = 0, got = 0;
+        while (got < frags) {
+            if (sent < frags && sent - got < FRAG_DEPTH) {
+                size_t len = sent + 1 < frags ? frag : size - sent * frag;
+                if (mq_send(to, msg + sent * frag, len, prio) == -1) {
+                    rc = -1;
+                    break;
+                }
+                sent++;
+                continue;
+            }
+            unsigned got_prio;
+            if (mq_receive(from, reply + got * frag, frag, &got_prio) == -1 || got_prio != prio) {
+                rc = -1;
+                break;
+            }
+            got++;
+        }
+        lat_hist_record(&h, now_ns() - t0);
+        if (rc == 0) rc = check(reply, size, round);
+    }
+    double secs = (double)(now_ns() - start) / 1e9;
+
+    mq_send(to, "", 0, MSG_PRIO_NORMAL);
+    int status;
+    if (waitpid(echo, &status, 0) != echo || !WIFEXITED(status) || WEXITSTATUS(status) != 0) rc = -1;
+    mq_close(to);
+    mq_close(from);
+    mq_unlink(FRAG_QUEUE);
+    mq_unlink(FRAG_REPLY);
+    free(msg);
+    free(reply);
+
+    print_row("mq", size, &h, secs);
+    if (rc == -1) fprintf(stderr, "mq, %zu bytes: bad reply\n", size);
+    return rc;
+}
+
+// --- blob: дескриптор через posix_mq_server ---
+
+static pid_t spawn_server(const bench_config_t *cfg, size_t max_size) {
+    // Очередь от прошлого запуска не должна сойти за готовность сервера.
+    mq_unlink(SERVER_QUEUE_NAME);
+    pid_t pid = fork();
+    if (pid == 0) {
+        char size[32];
+        snprintf(size, sizeof(size), "%zu", max_size);
+        if (!freopen("/dev/null", "w", stdout)) _exit(127);
+        execl(cfg->server, cfg->server, "-q", "-N", "2", "-S", size, (char *)NULL);
+        perror("execl");
+        _exit(127);
+    }
+    for (int i = 0; pid > 0 && i < 200; ++i) {
+        mqd_t q = mq_open(SERVER_QUEUE_NAME, O_WRONLY);
+        if (q != (mqd_t)-1) {
+            mq_close(q);
+            return pid;
+        }
+        usleep(10000);
+    }
+    if (pid > 0) {
+        kill(pid, SIGKILL);
+        waitpid(pid, NULL, 0);
+    }
+    return -1;
+}
+
+static int run_blob(const bench_config_t *cfg, size_t size, mqd_t server, mqd_t reply_q, shm_blob_t *pool,
+                    mq_request_t *req) {
+    lat_hist_t h;
+    lat_hist_init(&h);
+    uint64_t start = now_ns(), end = start + (uint64_t)(cfg->duration * 1e9);
+    int rc = 0;
+    for (unsigned round = 0; rc == 0 && (now_ns() < end || round < MIN_ROUNDS); ++round) {
+        unsigned prio = round % 2 ? MSG_PRIO_HIGH : MSG_PRIO_NORMAL, got_prio;
+        uint64_t t0 = now_ns();
+        shm_blob_desc_t desc, answer;
+        char *data = shm_blob_alloc(pool, &desc, 5000);
+        if (!data) {
+            perror("shm_blob_alloc");
+            rc = -1;
+            break;
+        }
+        fill(data, size, round);
+        desc.len = size;
+        memcpy(req->text, &desc, sizeof(desc));
+        char buf[MAX_MSG_SIZE];
+        const char *out = NULL;
+        if (mq_send(server, (const char *)req, offsetof(mq_request_t, text) + sizeof(desc), prio) == 0 &&
+            mq_receive(reply_q, buf, sizeof(buf), &got_prio) == (ssize_t)sizeof(answer) && got_prio == prio) {
+            memcpy(&answer, buf, sizeof(answer));
+            out = shm_blob_get(pool, &answer);
+        }
+        if (!out || check(out, size, round) == -1) rc = -1;
+        shm_blob_free(pool, &desc);
+        lat_hist_record(&h, now_ns() - t0);
+    }
+    print_row("blob", size, &h, (double)(now_ns() - start) / 1e9);
+    if (rc == -1) fprintf(stderr, "blob, %zu bytes: bad reply\n", size);
+    return rc;
+}
+
+static int run_blobs(const bench_config_t *cfg) {
+    size_t max_size = 0;
+    for (int i = 0; i < cfg->num_sizes; ++i) {
+        if (cfg->sizes[i] > max_size) max_size = cfg->sizes[i];
+    }
+    pid_t pid = spawn_server(cfg, max_size);
+    if (pid == -1) {
+        fprintf(stderr, "blob: server did not start\n");
+        return cfg->num_sizes;
+    }
+
+    struct mq_attr attr = {.mq_maxmsg = 10, .mq_msgsize = MAX_MSG_SIZE};
+    mq_request_t req;
+    memset(&req, 0, sizeof(req));
+    snprintf(req.reply_to, sizeof(req.reply_to), "%s.%d", CLIENT_QUEUE_NAME, (int)getpid());
+    req.session = (uint32_t)now_ns();
+    req.flags = MQ_REQ_BLOB;
+    mq_unlink(req.reply_to);
+    mqd_t reply_q = mq_open(req.reply_to, O_CREAT | O_RDONLY, 0600, &attr);
+    mqd_t server = mq_open(SERVER_QUEUE_NAME, O_WRONLY);
+    shm_blob_t *pool = shm_blob_open(MQ_POOL_NAME);
+
+    int failures = 0;
+    if (reply_q == (mqd_t)-1 || server == (mqd_t)-1 || !pool) {
+        perror("blob: open");
+        failures = cfg->num_sizes;
+    } else {
+        for (int i = 0; i < cfg->num_sizes; ++i) {
+            failures += run_blob(cfg, cfg->sizes[i], server, reply_q, pool, &req) != 0;
+        }
+    }
+    shm_blob_close(pool);
+    if (server != (mqd_t)-1) mq_close(server);
+    if (reply_q != (mqd_t)-1) mq_close(reply_q);
+    mq_unlink(req.reply_to);
+    kill(pid, SIGTERM);
+    waitpid(pid, NULL, 0);
+    return failures;
+}
+
+static int parse_sizes(bench_config_t *cfg, char *arg) {
+    cfg->num_sizes = 0;
+    for (char *tok = strtok(arg, ","); tok; tok = strtok(NULL, ",")) {
+        char *end;
+        unsigned long long v = strtoull(tok, &end, 0);
+        if (*end == 'K' || *end == 'k') v <<= 10;
+        else if (*end == 'M' || *end == 'm') v <<= 20;
+        if (v == 0 || cfg->num_sizes == MAX_SIZES) return -1;
+        cfg->sizes[cfg->num_sizes++] = (size_t)v;
+    }
+    return cfg->num_sizes ? 0 : -1;
+}
+
+int main(int argc, char *argv[]) {
+    bench_config_t cfg = {
+        .server = NULL,
+        .sizes = {256, 4 << 10, 64 << 10, 1 << 20, 16 << 20},
+        .num_sizes = 5,
+        .duration = 0.5,
+    };
+
+    int opt;
+    while ((opt = getopt(argc, argv, "x:s:d:")) != -1) {
+        switch (opt) {
+        case 'x': cfg.server = optarg; break;
+        case 's':
+            if (parse_sizes(&cfg, optarg) == -1) goto usage;
+            break;
+        case 'd': cfg.duration = atof(optarg); break;
+        default:
+            goto usage;
+        }
+    }
+    if (!cfg.server || cfg.duration <= 0) goto usage;
+    setvbuf(stdout, NULL, _IOLBF, 0);
+
+    printf("1 client, 1 message in flight; mq fragments of %ld bytes\n",
+           read_sysctl("/proc/sys/fs/mqueue/msgsize_max", 8192));
+    printf("%-5s %10s %9s %10s %9s %9s\n", "mode", "bytes", "rtt/s", "MiB/s", "p50_us", "p99_us");
+    int failures = 0;
+    for (int i = 0; i < cfg.num_sizes; ++i) failures += run_mq(&cfg, cfg.sizes[i]) != 0;
+    failures += run_blobs(&cfg);
+
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+
+usage:
+    fprintf(stderr, "usage: %s -x server_binary [-s size[K|M][,...]] [-d seconds]\n", argv[0]);
+    return EXIT_FAILURE;
+}
@@ -1,6 +1,8 @@
 #ifndef COMMON_H
 #define COMMON_H
 
+#include <stdint.h>
+
 #define SERVER_QUEUE_NAME   "/mq_server_ex"
 #define CLIENT_QUEUE_NAME   "/mq_client_ex"
 #define MAX_MSG_SIZE        256
@@ -8,4 +10,21 @@
 #define MSG_PRIO_NORMAL     1
 #define MSG_PRIO_HIGH       10
 
+// Очередь ответа у каждого клиента своя: CLIENT_QUEUE_NAME "." pid.
+#define MQ_REPLY_NAME_MAX   32
+
+// Большие сообщения: данные в пуле буферов сервера (shm_blob.h), в
+// запросе с MQ_REQ_BLOB вместо текста лежит shm_blob_desc_t.
+#define MQ_POOL_NAME        "/mq_server_ex.pool"
+#define MQ_REQ_BLOB         1u
+
+// Запрос клиента. Ответ сервера — текст (строка с '\0'), а на запрос с
+// MQ_REQ_BLOB — тот же дескриптор: данные переведены прямо в буфере.
+typedef struct {
+    char reply_to[MQ_REPLY_NAME_MAX];   // имя очереди ответа
+    uint32_t session;                   // сеанс клиента: очередь могли создать заново
+    uint32_t flags;                     // MQ_REQ_*
+    char text[MAX_MSG_SIZE - MQ_REPLY_NAME_MAX - 2 * sizeof(uint32_t)];
+} mq_request_t;
+
 #endif // COMMON_H
@@ -0,0 +1,447 @@
+/*
+ * Нагрузочный клиент для epoll_server: подключения/с и сообщения/с
+ *
+ * Два теста, каждый длится -d секунд и выполняется в -T потоках:
+ *  - conn: подключиться, отправить одно сообщение, дождаться эха, закрыть;
+ *  - msg:  -c постоянных подключений, на каждом -P сообщений «в полёте»
+ *          (отправили пачку -> ждём полный эхо-ответ -> отправляем следующую).
+ *          При -P > 1 это конвейер (pipelining): сервер получает несколько
+ *          сообщений одним куском и должен вычитать их все по одному фронту
+ *          EPOLLIN.
+ *
+ * С -F сообщения — двоичные кадры с префиксом длины (frame.h, размер -s
+ * включает заголовок), а запущенному серверу передаётся -f. Для мелких
+ * сообщений конвейером это сравнение «до/после»: сервер без -f видит
+ * поток байт и отвечает на каждое чтение, с -f — на каждый полный кадр.
+ *
+ * С ключом -x бенчмарк сам запускает сервер для каждого сочетания
+ * бэкенда (-b epoll,uring), числа рабочих циклов (-t 1,2,4) и числа
+ * подключений (-c 1,100,10000) и печатает таблицу. Для запущенного им
+ * сервера дополнительно выводятся процессорное время сервера (rusage
+ * дочернего процесса) и число его системных вызовов (сервер считает их
+ * сам и печатает при завершении) в пересчёте на одну операцию.
+ *
+ * Запуск: ./bin/epoll_bench [-p сокет] [-T потоков] [-c подключений]
+ *                           [-d секунд] [-s размер] [-P глубина]
+ *                           [-m conn|msg|both] [-F]
+ *                           [-x сервер [-b epoll,uring] [-t 1,2,4]]
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include "frame.h"
+
+#define DEFAULT_SOCKET_PATH "/tmp/epoll_server.sock"
+
+typedef struct {
+    const char *path;
+    int threads;
+    int connections;
+    double duration;
+    size_t size;
+    int depth;                  // сообщений в полёте на подключение
+    int tests;                  // TEST_CONN | TEST_MSG
+    int framed;                 // -F: кадры frame.h
+} bench_config_t;
+
+#define TEST_CONN 0x1
+#define TEST_MSG  0x2
+
+// Итог одного прогона: операций каждого теста и ресурсы сервера.
+typedef struct {
+    double conns_per_s;
+    double msgs_per_s;
+    uint64_t ops;
+    uint64_t errors;
+    double server_cpu_s;        // < 0: сервер запущен не нами
+    uint64_t server_syscalls;
+} run_result_t;
+
+typedef struct {
+    const bench_config_t *cfg;
+    int conns;                  // подключений у этого потока (тест msg)
+    uint64_t done;
+    uint64_t errors;
+} worker_t;
+
+static atomic_int running;
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static int connect_unix(const char *path) {
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd == -1) return -1;
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == -1) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static int send_full(int fd, const char *buf, size_t len) {
+    while (len > 0) {
+        ssize_t n = send(fd, buf, len, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        buf += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+static int recv_full(int fd, char *buf, size_t len) {
+    while (len > 0) {
+        ssize_t n = recv(fd, buf, len, 0);
+        if (n <= 0) {
+            if (n < 0 && errno == EINTR) continue;
+            return -1;
+        }
+        buf += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+// count сообщений по cfg->size байт подряд: строки или кадры FRAME_ECHO.
+static char *make_messages(const bench_config_t *cfg, int count) {
+    size_t size = cfg->size;
+    char *msg = malloc(size * (size_t)count);
+    if (!msg) return NULL;
+    memset(msg, 'x', size * (size_t)count);
+    for (int i = 0; i < count; ++i) {
+        char *m = msg + (size_t)i * size;
+        if (cfg->framed) {
+            frame_put_header(m, FRAME_ECHO, 0, (uint32_t)(size - FRAME_HDR_SIZE));
+        } else {
+            m[size - 1] = '\n';
+        }
+    }
+    return msg;
+}
+
+// --- Тест conn ---
+
+static void *conn_worker(void *arg) {
+    worker_t *w = arg;
+    char *msg = make_messages(w->cfg, 1);
+    char *reply = malloc(w->cfg->size);
+    while (atomic_load(&running)) {
+        int fd = connect_unix(w->cfg->path);
+        if (fd == -1 || send_full(fd, msg, w->cfg->size) == -1 ||
+            recv_full(fd, reply, w->cfg->size) == -1) {
+            w->errors++;
+        } else {
+            w->done++;
+        }
+        if (fd != -1) close(fd);
+    }
+    free(msg);
+    free(reply);
+    return NULL;
+}
+
+// --- Тест msg ---
+
+static void *msg_worker(void *arg) {
+    worker_t *w = arg;
+    size_t size = w->cfg->size;
+    size_t batch = size * (size_t)w->cfg->depth;
+    char *msg = make_messages(w->cfg, w->cfg->depth);
+    char *reply = malloc(batch);
+    struct pollfd *pfds = calloc((size_t)w->conns, sizeof(*pfds));
+    size_t *unsent = calloc((size_t)w->conns, sizeof(*unsent));
+    size_t *pending = calloc((size_t)w->conns, sizeof(*pending));
+    if (!msg || !reply || !pfds || !unsent || !pending) {
+        w->errors++;
+        return NULL;
+    }
+
+    int open_conns = 0;
+    for (int i = 0; i < w->conns; ++i) {
+        pfds[i].fd = connect_unix(w->cfg->path);
+        if (pfds[i].fd == -1) {
+            w->errors++;
+            continue;
+        }
+        unsent[i] = pending[i] = batch;
+        pfds[i].events = POLLIN | POLLOUT;
+        open_conns++;
+    }
+
+    // Отправка неблокирующая: пока сервер не читает (backpressure), мы
+    // продолжаем читать ответы, иначе обе стороны заблокировались бы на записи.
+    while (atomic_load(&running) && open_conns > 0) {
+        int n = poll(pfds, (nfds_t)w->conns, 100);
+        if (n <= 0) continue;
+        for (int i = 0; i < w->conns; ++i) {
+            if (pfds[i].fd == -1 || pfds[i].revents == 0) continue;
+            int failed = (pfds[i].revents & (POLLERR | POLLNVAL)) != 0;
+
+            if (!failed && unsent[i] > 0 && (pfds[i].revents & POLLOUT)) {
+                ssize_t sent = send(pfds[i].fd, msg + (batch - unsent[i]), unsent[i],
+                                    MSG_DONTWAIT | MSG_NOSIGNAL);
+                if (sent > 0) {
+                    unsent[i] -= (size_t)sent;
+                } else if (errno != EAGAIN && errno != EINTR) {
+                    failed = 1;
+                }
+            }
+            if (!failed && (pfds[i].revents & (POLLIN | POLLHUP))) {
+                ssize_t got = recv(pfds[i].fd, reply, pending[i], MSG_DONTWAIT);
+                if (got > 0) {
+                    pending[i] -= (size_t)got;
+                } else if (got == 0 || (errno != EAGAIN && errno != EINTR)) {
+                    failed = 1;
+                }
+            }
+            if (failed) {
+                w->errors++;
+                close(pfds[i].fd);
+                pfds[i].fd = -1;
+                open_conns--;
+                continue;
+            }
+
+            if (pending[i] == 0) {
+                w->done += (uint64_t)w->cfg->depth;
+                unsent[i] = pending[i] = batch;
+            }
+            pfds[i].events = POLLIN | (unsent[i] > 0 ? POLLOUT : 0);
+        }
+    }
+
+    for (int i = 0; i < w->conns; ++i) {
+        if (pfds[i].fd != -1) close(pfds[i].fd);
+    }
+    free(pfds);
+    free(unsent);
+    free(pending);
+    free(msg);
+    free(reply);
+    return NULL;
+}
+
+// Запустить потоки теста и вернуть число операций в секунду.
+static double run_test(const bench_config_t *cfg, void *(*fn)(void *), uint64_t *ops,
+                       uint64_t *errors) {
+    int threads = cfg->threads < cfg->connections ? cfg->threads : cfg->connections;
+    pthread_t *tids = calloc((size_t)threads, sizeof(*tids));
+    worker_t *workers = calloc((size_t)threads, sizeof(*workers));
+    if (!tids || !workers) {
+        perror("calloc");
+        exit(EXIT_FAILURE);
+    }
+
+    atomic_store(&running, 1);
+    double start = now_sec();
+    for (int i = 0; i < threads; ++i) {
+        workers[i].cfg = cfg;
+        workers[i].conns = cfg->connections / threads + (i < cfg->connections % threads ? 1 : 0);
+        pthread_create(&tids[i], NULL, fn, &workers[i]);
+    }
+    struct timespec ts = {(time_t)cfg->duration,
+                          (long)((cfg->duration - (double)(time_t)cfg->duration) * 1e9)};
+    nanosleep(&ts, NULL);
+    atomic_store(&running, 0);
+
+    uint64_t done = 0;
+    for (int i = 0; i < threads; ++i) {
+        pthread_join(tids[i], NULL);
+        done += workers[i].done;
+        *errors += workers[i].errors;
+    }
+    double elapsed = now_sec() - start;
+    free(tids);
+    free(workers);
+    *ops += done;
+    return (double)done / elapsed;
+}
+
+static void run_tests(const bench_config_t *cfg, run_result_t *res) {
+    memset(res, 0, sizeof(*res));
+    res->server_cpu_s = -1;
+    if (cfg->tests & TEST_CONN) res->conns_per_s = run_test(cfg, conn_worker, &res->ops, &res->errors);
+    if (cfg->tests & TEST_MSG) res->msgs_per_s = run_test(cfg, msg_worker, &res->ops, &res->errors);
+}
+
+// Печать строки таблицы. Возвращает 0, если прогон прошёл без ошибок.
+static int print_result(const char *backend, const char *loops, int conns, const run_result_t *res,
+                        int tests) {
+    char cpu[32] = "-", sys[32] = "-";
+    if (res->server_cpu_s >= 0 && res->ops > 0) {
+        snprintf(cpu, sizeof(cpu), "%.2f", res->server_cpu_s * 1e6 / (double)res->ops);
+        snprintf(sys, sizeof(sys), "%.2f", (double)res->server_syscalls / (double)res->ops);
+    }
+    printf("%-8s %6s %7d %12.0f %12.0f %10s %10s %8llu\n", backend, loops, conns,
+           res->conns_per_s, res->msgs_per_s, cpu, sys, (unsigned long long)res->errors);
+    if (res->errors) return -1;
+    if ((tests & TEST_CONN) && res->conns_per_s <= 0) return -1;
+    if ((tests & TEST_MSG) && res->msgs_per_s <= 0) return -1;
+    return 0;
+}
+
+// Запустить сервер и дождаться его сокета. Вывод сервера (в нём итоговая
+// статистика с числом системных вызовов) пишется во временный файл out.
+static pid_t spawn_server(const char *server, const char *path, const char *backend,
+                          int threads, int framed, FILE *out) {
+    pid_t pid = fork();
+    if (pid == 0) {
+        char arg[16];
+        snprintf(arg, sizeof(arg), "%d", threads);
+        dup2(fileno(out), STDOUT_FILENO);
+        execl(server, server, "-q", "-b", backend, "-t", arg, framed ? "-f" : (char *)NULL,
+              (char *)NULL);
+        perror("execl");
+        _exit(127);
+    }
+    for (int i = 0; i < 200; ++i) {
+        int fd = connect_unix(path);
+        if (fd != -1) {
+            close(fd);
+            return pid;
+        }
+        usleep(10000);
+    }
+    kill(pid, SIGKILL);
+    waitpid(pid, NULL, 0);
+    return -1;
+}
+
+// Остановить сервер и забрать его процессорное время и системные вызовы.
+static void stop_server(pid_t pid, FILE *out, run_result_t *res) {
+    struct rusage ru;
+    kill(pid, SIGTERM);
+    if (wait4(pid, NULL, 0, &ru) == pid) {
+        res->server_cpu_s = (double)ru.ru_utime.tv_sec + (double)ru.ru_utime.tv_usec / 1e6 +
+                            (double)ru.ru_stime.tv_sec + (double)ru.ru_stime.tv_usec / 1e6;
+    }
+
+    char line[512];
+    rewind(out);
+    while (fgets(line, sizeof(line), out)) {
+        const char *p = strstr(line, "syscalls=");
+        if (p) res->server_syscalls += strtoull(p + strlen("syscalls="), NULL, 10);
+    }
+}
+
+// Поднять мягкий предел открытых файлов до жёсткого (тысячи подключений).
+static void raise_nofile_limit(void) {
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max) {
+        rl.rlim_cur = rl.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &rl);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    bench_config_t cfg = {
+        .path = DEFAULT_SOCKET_PATH,
+        .threads = 4,
+        .connections = 64,
+        .duration = 2.0,
+        .size = 64,
+        .depth = 1,
+        .tests = TEST_CONN | TEST_MSG,
+    };
+    const char *server = NULL;
+    const char *backend_list = "epoll";
+    const char *thread_list = "1,2,4";
+    const char *conn_list = "64";
+
+    int opt;
+    while ((opt = getopt(argc, argv, "p:T:c:d:s:P:m:x:b:t:F")) != -1) {
+        switch (opt) {
+        case 'p': cfg.path = optarg; break;
+        case 'T': cfg.threads = atoi(optarg); break;
+        case 'c': conn_list = optarg; break;
+        case 'd': cfg.duration = atof(optarg); break;
+        case 's': cfg.size = strtoull(optarg, NULL, 0); break;
+        case 'P': cfg.depth = atoi(optarg); break;
+        case 'm':
+            cfg.tests = strcmp(optarg, "conn") == 0  ? TEST_CONN
+                        : strcmp(optarg, "msg") == 0 ? TEST_MSG
+                                                     : TEST_CONN | TEST_MSG;
+            break;
+        case 'x': server = optarg; break;
+        case 'b': backend_list = optarg; break;
+        case 't': thread_list = optarg; break;
+        case 'F': cfg.framed = 1; break;
+        default:
+            fprintf(stderr, "usage: %s [-p socket] [-T threads] [-c connections[,...]] [-d seconds] "
+                            "[-s size] [-P depth] [-m conn|msg|both] [-F] "
+                            "[-x server_binary [-b epoll,uring] [-t 1,2,4]]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (cfg.threads < 1) cfg.threads = 1;
+    if (cfg.size < 1) cfg.size = 1;
+    if (cfg.framed && cfg.size < FRAME_HDR_SIZE) cfg.size = FRAME_HDR_SIZE;
+    if (cfg.depth < 1) cfg.depth = 1;
+    raise_nofile_limit();
+
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    printf("client threads=%d size=%zu depth=%d duration=%.1fs%s\n",
+           cfg.threads, cfg.size, cfg.depth, cfg.duration, cfg.framed ? " framed" : "");
+    printf("%-8s %6s %7s %12s %12s %10s %10s %8s\n", "backend", "loops", "conns",
+           "conns/s", "msgs/s", "cpu_us/op", "sys/op", "errors");
+
+    int failures = 0;
+    char *conns = strdup(conn_list);
+    for (char *ctok, *csave = NULL, *cp = conns; (ctok = strtok_r(cp, ",", &csave)); cp = NULL) {
+        cfg.connections = atoi(ctok) > 0 ? atoi(ctok) : 1;
+        run_result_t res;
+
+        if (!server) {
+            run_tests(&cfg, &res);
+            if (print_result("running", "-", cfg.connections, &res, cfg.tests) != 0) failures++;
+            continue;
+        }
+
+        char *backends = strdup(backend_list);
+        for (char *btok, *bsave = NULL, *bp = backends; (btok = strtok_r(bp, ",", &bsave)); bp = NULL) {
+            char *loops = strdup(thread_list);
+            for (char *ltok, *lsave = NULL, *lp = loops; (ltok = strtok_r(lp, ",", &lsave)); lp = NULL) {
+                FILE *out = tmpfile();
+                pid_t pid = out ? spawn_server(server, cfg.path, btok, atoi(ltok), cfg.framed, out) : -1;
+                if (pid == -1) {
+                    fprintf(stderr, "%s server with %s loops did not start\n", btok, ltok);
+                    failures++;
+                    if (out) fclose(out);
+                    continue;
+                }
+                run_tests(&cfg, &res);
+                stop_server(pid, out, &res);
+                fclose(out);
+                if (print_result(btok, ltok, cfg.connections, &res, cfg.tests) != 0) failures++;
+            }
+            free(loops);
+        }
+        free(backends);
+    }
+    free(conns);
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,327 @@
+/*
+ * Память сервера на простаивающее подключение и задержка активных
+ *
+ * 1. Запускает epoll_server (-x, бэкенд -b, циклов -t) и замеряет его RSS.
+ * 2. Открывает -n подключений (по умолчанию 100 000), которые дальше
+ *    ничего не делают, и снова замеряет RSS сервера и Slab ядра:
+ *    разница на подключение — цена простаивающего клиента. Блоки
+ *    ввода-вывода сервер выдаёт подключению только на время обмена,
+ *    поэтому в RSS остаётся лишь заголовок подключения.
+ * 3. На -a подключениях, равномерно выбранных среди открытых, -d секунд
+ *    крутит ping-pong по одному сообщению и печатает перцентили RTT.
+ * 4. С -I мс сервер запускается с тем же тайм-аутом простоя. Активные
+ *    подключения не должны закрыться (ошибок ping нет), а после активной
+ *    фазы сервер должен закрыть все подключения; для активных печатается,
+ *    через сколько после последнего сообщения это произошло.
+ *
+ * Число подключений ограничено RLIMIT_NOFILE (у клиента и у сервера по
+ * одному дескриптору на подключение); если жёсткий предел меньше, тест
+ * уменьшает -n и сообщает об этом.
+ *
+ * Запуск: ./bin/epoll_idle_bench [-x сервер] [-b epoll|uring] [-t циклов]
+ *                                [-n подключений] [-a активных]
+ *                                [-d секунд] [-s размер] [-I мс]
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <poll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include "lat_hist.h"
+
+#define SOCKET_PATH "/tmp/epoll_server.sock"
+#define FD_RESERVE 64   // дескрипторы сверх подключений (stdio, epoll, ...)
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static int connect_unix(const char *path) {
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd == -1) return -1;
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == -1) {
+        int saved = errno;
+        close(fd);
+        errno = saved;
+        return -1;
+    }
+    return fd;
+}
+
+static int ping(int fd, const char *msg, char *reply, size_t size) {
+    size_t off = 0;
+    while (off < size) {
+        ssize_t n = send(fd, msg + off, size - off, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        off += (size_t)n;
+    }
+    off = 0;
+    while (off < size) {
+        ssize_t n = recv(fd, reply + off, size - off, 0);
+        if (n <= 0) {
+            if (n < 0 && errno == EINTR) continue;
+            return -1;
+        }
+        off += (size_t)n;
+    }
+    return 0;
+}
+
+// Значение поля (в КиБ) из файла вида /proc/.../status или /proc/meminfo.
+static long proc_kb(const char *path, const char *key) {
+    FILE *f = fopen(path, "r");
+    if (!f) return -1;
+    char line[256];
+    long kb = -1;
+    size_t len = strlen(key);
+    while (fgets(line, sizeof(line), f)) {
+        if (strncmp(line, key, len) == 0 && line[len] == ':') {
+            kb = strtol(line + len + 1, NULL, 10);
+            break;
+        }
+    }
+    fclose(f);
+    return kb;
+}
+
+static long server_rss_kb(pid_t pid) {
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/status", (int)pid);
+    return proc_kb(path, "VmRSS");
+}
+
+static pid_t spawn_server(const char *server, const char *backend, const char *loops,
+                          const char *idle_ms) {
+    pid_t pid = fork();
+    if (pid == 0) {
+        int devnull = open("/dev/null", O_WRONLY);
+        if (devnull != -1) dup2(devnull, STDOUT_FILENO);
+        execl(server, server, "-q", "-b", backend, "-t", loops, "-I", idle_ms, (char *)NULL);
+        perror("execl");
+        _exit(127);
+    }
+    for (int i = 0; i < 200; ++i) {
+        int fd = connect_unix(SOCKET_PATH);
+        if (fd != -1) {
+            close(fd);
+            return pid;
+        }
+        usleep(10000);
+    }
+    kill(pid, SIGKILL);
+    waitpid(pid, NULL, 0);
+    return -1;
+}
+
+// Ждать до deadline, пока сервер закроет подключения (recv вернёт 0).
+// В closed_ns[i] — момент, когда закрытие замечено, или 0.
+static long wait_closed(const int *fds, long n, uint64_t deadline, uint64_t *closed_ns) {
+    struct pollfd *pfd = calloc((size_t)n, sizeof(*pfd));
+    if (!pfd) {
+        perror("calloc");
+        return 0;
+    }
+    for (long i = 0; i < n; ++i) {
+        pfd[i].fd = fds[i];
+        pfd[i].events = POLLIN;
+        closed_ns[i] = 0;
+    }
+    long closed = 0;
+    char buf[256];
+    while (closed < n && now_ns() < deadline) {
+        int ready = poll(pfd, (nfds_t)n, 10);
+        if (ready <= 0) continue;
+        uint64_t t = now_ns();
+        for (long i = 0; i < n; ++i) {
+            if (pfd[i].fd < 0 || !pfd[i].revents) continue;
+            ssize_t r = recv(pfd[i].fd, buf, sizeof(buf), MSG_DONTWAIT);
+            if (r > 0 || (r < 0 && (errno == EAGAIN || errno == EINTR))) continue;
+            closed_ns[i] = t;
+            pfd[i].fd = -1;
+            closed++;
+        }
+    }
+    free(pfd);
+    return closed;
+}
+
+int main(int argc, char *argv[]) {
+    const char *server = "./bin/epoll_server";
+    const char *backend = "epoll";
+    const char *loops = "0";
+    long requested = 100000;
+    int active = 100;
+    double duration = 2.0;
+    size_t size = 64;
+    const char *idle_arg = "0";
+
+    int opt;
+    while ((opt = getopt(argc, argv, "x:b:t:n:a:d:s:I:")) != -1) {
+        switch (opt) {
+        case 'x': server = optarg; break;
+        case 'b': backend = optarg; break;
+        case 't': loops = optarg; break;
+        case 'n': requested = strtol(optarg, NULL, 0); break;
+        case 'a': active = atoi(optarg); break;
+        case 'd': duration = atof(optarg); break;
+        case 's': size = strtoull(optarg, NULL, 0); break;
+        case 'I': idle_arg = optarg; break;
+        default:
+            fprintf(stderr, "usage: %s [-x server] [-b epoll|uring] [-t loops] [-n connections] "
+                            "[-a active] [-d seconds] [-s size] [-I idle-timeout-ms]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (requested < 1 || active < 1 || size < 1) {
+        fprintf(stderr, "connections, active and size must be positive\n");
+        return EXIT_FAILURE;
+    }
+
+    // Сервер поднимает мягкий предел до жёсткого сам, клиент — здесь.
+    struct rlimit rl;
+    getrlimit(RLIMIT_NOFILE, &rl);
+    rl.rlim_cur = rl.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &rl);
+    long n = requested;
+    if (rl.rlim_max != RLIM_INFINITY && (rlim_t)n + FD_RESERVE > rl.rlim_max) {
+        n = (long)rl.rlim_max - FD_RESERVE;
+        fprintf(stderr, "RLIMIT_NOFILE hard limit is %llu: opening %ld connections instead of %ld\n",
+                (unsigned long long)rl.rlim_max, n, requested);
+    }
+
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    long idle_ms = atol(idle_arg);
+    pid_t pid = spawn_server(server, backend, loops, idle_arg);
+    if (pid == -1) {
+        fprintf(stderr, "server %s did not start\n", server);
+        return EXIT_FAILURE;
+    }
+
+    int *fds = malloc((size_t)n * sizeof(*fds));
+    uint64_t *last_ns = malloc((size_t)n * sizeof(*last_ns)); // последний ответ сервера
+    char *msg = malloc(size);
+    char *reply = malloc(size);
+    if (!fds || !last_ns || !msg || !reply) {
+        perror("malloc");
+        kill(pid, SIGTERM);
+        return EXIT_FAILURE;
+    }
+    memset(msg, 'x', size);
+    msg[size - 1] = '\n';
+
+    long rss0 = server_rss_kb(pid);
+    long slab0 = proc_kb("/proc/meminfo", "Slab");
+
+    // --- Простаивающие подключения ---
+    uint64_t t0 = now_ns();
+    long opened = 0;
+    while (opened < n) {
+        int fd = connect_unix(SOCKET_PATH);
+        if (fd == -1) {
+            perror("connect");
+            break;
+        }
+        fds[opened++] = fd;
+    }
+    double connect_s = (double)(now_ns() - t0) / 1e9;
+
+    // Эхо на последнем подключении означает, что сервер принял все
+    // предыдущие; небольшая пауза — для раздачи по рабочим циклам.
+    int failures = opened < n;
+    if (opened > 0 && ping(fds[opened - 1], msg, reply, size) == -1) failures++;
+    // С тайм-аутом пауза короче него, иначе активные закроются до начала.
+    usleep(idle_ms > 0 && idle_ms < 800 ? (useconds_t)idle_ms * 250 : 200000);
+    long rss1 = server_rss_kb(pid);
+    long slab1 = proc_kb("/proc/meminfo", "Slab");
+
+    // --- Активные подключения ---
+    lat_hist_t hist;
+    lat_hist_init(&hist);
+    if (active > opened) active = (int)opened;
+    uint64_t errors = 0;
+    uint64_t end = now_ns() + (uint64_t)(duration * 1e9);
+    while (active > 0 && now_ns() < end) {
+        for (int i = 0; i < active; ++i) {
+            int fd = fds[(long)i * opened / active];
+            uint64_t start = now_ns();
+            if (ping(fd, msg, reply, size) == -1) {
+                errors++;
+                continue;
+            }
+            last_ns[(long)i * opened / active] = now_ns();
+            lat_hist_record(&hist, last_ns[(long)i * opened / active] - start);
+        }
+    }
+    long rss2 = server_rss_kb(pid);
+
+    printf("backend=%s loops=%s connections=%ld (requested %ld), opened in %.2f s\n",
+           backend, loops, opened, requested, connect_s);
+    if (opened > 0) {
+        printf("server RSS: %ld KiB before, %ld KiB with idle connections (%.0f bytes/conn), "
+               "%ld KiB after active phase\n",
+               rss0, rss1, (double)(rss1 - rss0) * 1024.0 / (double)opened, rss2);
+        printf("kernel Slab: +%ld KiB (%.0f bytes/conn, both socket ends)\n",
+               slab1 - slab0, (double)(slab1 - slab0) * 1024.0 / (double)opened);
+    }
+    printf("active RTT over %d connections, %llu msgs of %zu B: "
+           "p50=%.1f us p99=%.1f us p99.9=%.1f us max=%.1f us errors=%llu\n",
+           active, (unsigned long long)hist.total, size,
+           (double)lat_hist_percentile(&hist, 50) / 1e3, (double)lat_hist_percentile(&hist, 99) / 1e3,
+           (double)lat_hist_percentile(&hist, 99.9) / 1e3, (double)hist.max / 1e3,
+           (unsigned long long)errors);
+
+    // --- Тайм-ауты ---
+    if (idle_ms > 0 && opened > 0) {
+        uint64_t *closed_ns = malloc((size_t)opened * sizeof(*closed_ns));
+        uint64_t wait_ns = (uint64_t)idle_ms * 1000000ull + 2000000000ull;
+        long closed = closed_ns ? wait_closed(fds, opened, now_ns() + wait_ns, closed_ns) : 0;
+
+        // Сервер обязан выждать полный тайм-аут после последнего ответа.
+        lat_hist_t after;
+        lat_hist_init(&after);
+        long early = 0;
+        for (int i = 0; closed_ns && i < active; ++i) {
+            long k = (long)i * opened / active;
+            if (!closed_ns[k]) continue;
+            uint64_t idle_ns = closed_ns[k] - last_ns[k];
+            if (idle_ns < (uint64_t)idle_ms * 1000000ull) early++;
+            lat_hist_record(&after, idle_ns);
+        }
+        printf("idle timeout %ld ms: %ld/%ld connections closed by server; active ones closed "
+               "p50=%.1f ms max=%.1f ms after their last reply, %ld too early\n",
+               idle_ms, closed, opened, (double)lat_hist_percentile(&after, 50) / 1e6,
+               (double)after.max / 1e6, early);
+        if (closed < opened || early) failures++;
+        free(closed_ns);
+    }
+
+    for (long i = 0; i < opened; ++i) close(fds[i]);
+    kill(pid, SIGTERM);
+    waitpid(pid, NULL, 0);
+    free(fds);
+    free(last_ns);
+    free(msg);
+    free(reply);
+
+    if (errors || hist.total == 0) failures++;
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -6,25 +6,322 @@
  *  - Сокеты подключенных клиентов для чтения данных.
  *  - eventfd для внутренних уведомлений (например, от других потоков).
  *  - Корректная обработка отключения клиента.
+ *
+ * Многопоточный режим (-t N): N рабочих потоков, у каждого свой экземпляр
+ * epoll и свой eventfd, поток привязан к ядру CPU. Главный поток только
+ * принимает подключения и раздаёт их рабочим (по кругу или наименее
+ * загруженному): ставит задачу «принять fd» в очередь задач цикла.
+ * Клиентский сокет затем обслуживается одним и тем же потоком до
+ * закрытия, поэтому никакой синхронизации на пути данных нет.
+ *
+ * Очередь задач цикла — неблокирующая MPSC (mpsc_queue.h) в паре с
+ * eventfd: любой поток ставит в неё замыкание, а eventfd пишется только
+ * когда очередь была пуста; цикл на каждое пробуждение забирает очередь
+ * целиком. Так передаются подключения и запрос статистики (SIGUSR1).
+ *
+ * Путь данных клиента (edge-triggered):
+ *  - по EPOLLIN читаем до EAGAIN, иначе остаток конвейера (pipelining)
+ *    «застрянет» до прихода следующих данных — нового фронта не будет;
+ *  - эхо не пишется сразу, а ставится в очередь вывода подключения;
+ *    накопленные ответы уходят одним writev, короткая запись оставляет
+ *    хвост в очереди;
+ *  - EPOLLOUT включается только пока очередь не пуста;
+ *  - если в очереди больше OUTPUT_HIGH_WATER байт, чтение приостанавливается
+ *    (клиент не читает ответы — не копим их бесконечно) и возобновляется,
+ *    когда очередь опустеет ниже порога;
+ *  - «до EAGAIN» — не за один раз: за проход цикла подключение читает не
+ *    больше -B байт (бюджет), иначе один клиент-«пожарный шланг» держит
+ *    цикл, пока остальные ждут. Подключение, исчерпавшее бюджет, ставится
+ *    в список готовых цикла и дочитывается после следующего epoll_wait
+ *    (с нулевым тайм-аутом) — фронт EPOLLIN не повторится, поэтому без
+ *    списка его данные застряли бы;
+ *  - -L ограничивает скорость чтения каждого клиента корзиной жетонов
+ *    (байт/с, с запасом на всплеск): клиент без жетонов тоже ждёт в
+ *    списке готовых, цикл проверяет его раз в миллисекунду.
+ *
+ * Память: блоки ввода-вывода не принадлежат подключению постоянно, а
+ * берутся из общего пула цикла только на время, пока у подключения есть
+ * данные «в полёте», и возвращаются, как только очередь отправлена.
+ * Простаивающее подключение — это только заголовок conn_t (104 байта),
+ * поэтому 100k простаивающих клиентов почти не занимают памяти сервера.
+ * Если пул блоков исчерпан, чтение подключения откладывается до их
+ * возврата (глобальный предел памяти на буферы).
+ *
+ * Кадры (-f): поток байт не хранит границ сообщений — одно чтение может
+ * принести несколько сообщений конвейера и начало следующего. В режиме
+ * -f клиенты шлют двоичные кадры с префиксом длины (frame.h), сервер
+ * разбирает их прямо в блоках очереди по мере чтения (frame_scan помнит
+ * только позицию внутри кадра — неполный кадр на стыке чтений не
+ * копируется) и отправляет эхом только до конца последнего полного кадра:
+ * ответы на все кадры, пришедшие одним чтением, уходят одним writev, а
+ * клиент никогда не получает половину ответа. Сообщения считаются по
+ * кадрам, а не по вызовам read.
+ *
+ * Большие сообщения (-z): эхо через read/writev копирует каждый байт
+ * дважды (ядро -> блок -> ядро). С -z данные идут splice'ом сокет ->
+ * канал (pipe) -> сокет и в пространство пользователя не попадают. Канал,
+ * как и блоки, выдаётся подключению из пула цикла только пока у него есть
+ * данные в полёте; его ёмкость (ZPIPE_SIZE) играет роль OUTPUT_HIGH_WATER.
+ * Альтернатива для передачи между процессами — запечатанный memfd через
+ * SCM_RIGHTS (shm_seg.h): сравнение всех путей — zcopy_bench.
+ *
+ * Классы приоритета (-P gid): в общей очереди событий управляющий
+ * клиент ждёт за массовыми. С -P акцептор при подключении определяет
+ * класс клиента по учётным данным сокета (SO_PEERCRED): клиенты с
+ * указанным gid — control, остальные — bulk. У класса control свой цикл
+ * (свой epoll, свой поток) с политикой SCHED_FIFO: когда у него есть
+ * события, он вытесняет циклы bulk на том же ядре. Циклы bulk остаются
+ * SCHED_OTHER — насыщенный цикл реального времени не дал бы работать
+ * акцептору. Демонстрация — prio_bench.
+ *
+ * Тайм-ауты (-I, -W): мёртвый или зависший клиент иначе держал бы fd
+ * вечно. У каждого подключения один таймер в иерархическом колесе цикла
+ * (timer_wheel.h), а всё колесо обслуживает единственный timerfd в том же
+ * epoll — ни дескрипторов, ни системных вызовов на подключение. -I
+ * закрывает подключение без чтения и записи дольше заданного, -W —
+ * подключение, чьи ответы столько не уходят (клиент не читает). Таймер
+ * обновляется лениво: активность только запоминает тик, а при
+ * срабатывании таймер переставляется на новый срок, если он не истёк.
+ *
+ * Обновление без простоя (-U): сервер с -U слушает ещё и сокет
+ * обновления UPGRADE_PATH. Новый экземпляр с -U при старте подключается к нему и
+ * забирает у работающего слушающий сокет (SCM_RIGHTS) — тот же объект
+ * ядра, поэтому подключения в очереди accept не теряются, а новые
+ * никогда не получают ECONNREFUSED. Затем каждый цикл старого сервера
+ * передаёт свои подключения: дескриптор клиента, состояние (разбор
+ * кадров, признак закрытия) и неотправленную очередь вывода (при -z —
+ * сам канал). Старый сервер завершается, новый продолжает с того же
+ * байта; непрочитанное остаётся в сокете и достаётся новому. Режимы -f
+ * и -z обоих экземпляров должны совпадать. Демонстрация — restart_bench.
+ *
+ * Бэкенд io_uring (-b uring): вместо epoll_wait + read + write на каждое
+ * сообщение — многоразовые (multishot) accept и recv, буферы для recv ядро
+ * берёт из кольца предоставленных буферов, эхо уходит sendmsg прямо из
+ * этого буфера, а все заявки цикла отдаются ядру одним io_uring_enter,
+ * который заодно ждёт следующих завершений. Каждый рабочий цикл держит
+ * свой multishot accept на общем слушающем сокете (акцептора нет,
+ * -d не действует).
+ *
+ * Запуск: ./bin/epoll_server [-b epoll|uring] [-t потоков] [-d rr|least]
+ *                            [-I мс] [-W мс] [-f | -z] [-P gid]
+ *                            [-B байт] [-L байт/с[:всплеск]] [-U] [-q]
+ * Статистика циклов без остановки: kill -USR1 <pid>
  */
 #define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+#include <semaphore.h>
+#include <signal.h>
+#include <stdatomic.h>
 #include <sys/epoll.h>
+#include <sys/resource.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <sys/un.h>
 #include <sys/eventfd.h>
+#include <sys/timerfd.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <stddef.h>
+#include <time.h>
+#include "frame.h"
+#include "mempool.h"
+#include "mpsc_queue.h"
+#include "timer_wheel.h"
+#include "uring.h"
 
-#define MAX_EVENTS 10
+#define MAX_EVENTS 64
 #define SOCKET_PATH "/tmp/epoll_server.sock"
-#define READ_BUFFER_SIZE 256
+#define UPGRADE_PATH "/tmp/epoll_server.handoff.sock" // -U
+#define READ_BUFFER_SIZE 4096      // размер блока очереди вывода
+#define OUTPUT_HIGH_WATER (256 * 1024) // порог приостановки чтения
+#define WRITEV_MAX_IOV 64
+#define READ_BUDGET (64 * 1024)    // бюджет чтения подключения за проход (-B)
+#define BUF_POOL_BLOCKS 1024       // блоков в общем пуле цикла (4 МиБ)
+#define CONN_POOL_CHUNK 1024       // объектов подключений в куске пула (~100 КиБ)
+#define TIMER_TICK_NS (10 * 1000000ull) // тик колеса тайм-аутов
+#define ZPIPE_MAX 256              // каналов splice в пуле цикла (-z)
+#define ZPIPE_SIZE (1024 * 1024)   // желаемая ёмкость канала (F_SETPIPE_SZ)
+// Предел нагрузки кадра при -f. Неполный кадр в очереди меньше половины
+// OUTPUT_HIGH_WATER, поэтому при достижении порога в очереди всегда есть
+// готовые к отправке кадры и чтение не может встать навсегда.
+#define FRAME_MAX_PAYLOAD (OUTPUT_HIGH_WATER / 2 - FRAME_HDR_SIZE)
+
+// Блок очереди вывода. Прочитанные данные кладутся прямо сюда и
+// отправляются эхом без копирования.
+typedef struct out_buf {
+    struct out_buf *next;
+    uint32_t start;             // отправлено байт с начала блока
+    uint32_t end;               // заполнено байт
+    char data[READ_BUFFER_SIZE];
+} out_buf_t;
+
+// -z: канал для splice. Данные в нём — очередь вывода подключения.
+typedef struct zpipe {
+    struct zpipe *next;         // список свободных каналов цикла
+    int rd, wr;
+    uint32_t size;              // фактическая ёмкость
+} zpipe_t;
+
+// Состояние подключения. Объекты берутся из пула цикла (MemoryPool из
+// task5) и передаются epoll в data.u64 вместе с 16-битным поколением
+// (см. conn_tag): событие, пришедшее для уже закрытого подключения, чей
+// объект освобождён или выдан заново, отбрасывается по несовпадению
+// поколения. Пока объект свободен, его первое слово занято списком
+// свободных блоков пула, поэтому поколение лежит дальше и переживает
+// pool_free.
+typedef struct conn {
+    struct conn *next;          // список живых подключений цикла
+    uint16_t gen;
+    uint8_t want_read;          // после EPOLLIN ещё не встретили EAGAIN
+    uint8_t peer_closed;        // клиент закрыл свою сторону (read == 0)
+    uint8_t out_armed;          // EPOLLOUT сейчас включён
+    uint8_t starved;            // ждёт свободного блока из пула
+    uint8_t deferred;           // в списке готовых цикла (бюджет или жетоны)
+    int fd;
+    uint32_t out_bytes;         // байт в очереди вывода
+    struct conn *prev;
+    out_buf_t *out_head;        // блоки есть только пока есть данные
+    union {
+        out_buf_t *out_tail;
+        zpipe_t *pipe;          // -z: вместо блоков, тоже только пока есть данные
+    };
+    uint32_t out_ready;         // из них готовы к отправке (полные кадры при -f)
+    frame_scanner_t scan;       // разбор кадров при -f
+    tw_timer_t timer;           // тайм-аут (только при -I/-W)
+    uint32_t active_tick;       // тик последнего чтения или отправки
+    uint32_t out_tick;          // тик последнего прогресса очереди вывода
+    uint32_t tokens;            // -L: жетоны (байт) на чтение
+    uint32_t tokens_ms;         // -L: когда жетоны пополнялись
+} conn_t;
+
+typedef enum { DIST_ROUND_ROBIN, DIST_LEAST_LOADED } dist_mode_t;
+
+// Классы приоритета (-P): у каждого свои циклы и политика их потоков.
+typedef enum { CLASS_BULK, CLASS_CONTROL } conn_class_t;
+static const struct {
+    const char *name;
+    int rt_prio;                // SCHED_FIFO, 0 — SCHED_OTHER
+} class_info[] = {
+    [CLASS_BULK] = {"bulk", 0},
+    [CLASS_CONTROL] = {"control", 50},
+};
+
+// Один цикл событий: epoll + eventfd + очередь задач от других потоков.
+typedef struct event_loop {
+    int id;
+    int cpu;                    // -1: без привязки
+    conn_class_t cls;
+    int epoll_fd;
+    int event_fd;
+    pthread_t thread;
+
+    mpsc_queue_t tasks;         // см. loop_submit
+    _Atomic uint64_t wakeups;   // записей в eventfd от loop_submit
+    uint64_t tasks_run;
+
+    _Atomic int connections;    // открытые клиенты (для least-loaded)
+    _Atomic uint64_t accepted;
+    _Atomic uint64_t messages;  // успешных read
+    _Atomic uint64_t frames;    // полных кадров (-f)
+    _Atomic uint64_t bytes;     // байт эха
+    _Atomic uint64_t writevs;
+    _Atomic uint64_t splices;   // splice из канала в сокет (-z)
+    _Atomic uint64_t paused;    // приостановок чтения по переполнению вывода
+    uint64_t syscalls;          // системных вызовов цикла (только этот поток)
+
+    MemoryPool *buf_pool;       // общие блоки ввода-вывода (только этот поток)
+    uint64_t *starved;          // метки подключений, ждущих блока
+    int starved_count;
+    int starved_cap;
+    uint64_t starvations;
+
+    uint64_t *ready;            // метки подключений с непрочитанными данными
+    int ready_count;
+    int ready_cap;
+    int ready_hot;              // из них отложены бюджетом (не жетонами)
+    uint64_t defers;            // отложено по бюджету прохода
+    uint64_t throttles;         // отложено по жетонам
+
+    zpipe_t *pipes_free;        // пул каналов splice (-z, только этот поток)
+    int pipes_open;
+
+    MemoryPool **conn_pools;    // куски пула объектов подключений (только этот поток)
+    int conn_npools;
+    conn_t *live;               // открытые подключения цикла
+
+    int timer_fd;               // один на колесо, -1 без тайм-аутов
+    timer_wheel_t wheel;
+    uint64_t timer_next;        // на когда взведён timer_fd (0 — не взведён)
+    uint64_t now_ns;            // время текущей пачки событий
+    uint32_t tick;              // тот же момент в тиках колеса
+    uint32_t now_ms;            // и в миллисекундах (жетоны -L)
+    uint64_t timeouts;          // закрыто по тайм-ауту
+} event_loop_t;
+
+// Задача для цикла от другого потока. run выполняется в потоке цикла и
+// сам распоряжается памятью задачи.
+typedef struct loop_task {
+    mpsc_node_t node;           // первое поле: узел очереди и есть задача
+    void (*run)(event_loop_t *loop, struct loop_task *task);
+    int fd;
+} loop_task_t;
+
+static int server_fd = -1;
+static int upgrade_fd = -1;     // -U: слушающий сокет передачи
+static int upgradable = 0;      // -U
+static event_loop_t *loops;
+static int num_loops = 1;
+static int bulk_loops = 1;      // циклы [0, bulk_loops) — bulk, за ними control
+static long control_gid = -1;   // -P: gid клиентов класса control
+static size_t read_budget = READ_BUDGET; // -B, 0 — читать до EAGAIN
+static uint64_t rate_limit;     // -L: байт/с на клиента, 0 — без ограничения
+static uint32_t rate_burst;     // -L: ёмкость корзины жетонов
+static int verbose = 1;
+static int framed = 0;          // -f: двоичные кадры вместо сырого эха
+static int zero_copy = 0;       // -z: эхо через splice
+static volatile sig_atomic_t stop = 0;
+static volatile sig_atomic_t stats_requested = 0;
+static uint64_t acceptor_syscalls;
+static uint32_t idle_ticks;     // -I в тиках колеса, 0 — выключен
+static uint32_t write_ticks;    // -W в тиках колеса, 0 — выключен
+
+typedef enum { BACKEND_EPOLL, BACKEND_URING } backend_t;
+static backend_t backend = BACKEND_EPOLL;
+
+// Предел номера дескриптора (RLIMIT_NOFILE): предел роста пула
+// подключений цикла и размер таблицы бэкенда io_uring.
+static int conn_table_size;
+
+// Метки epoll_event.data.u64 для служебных дескрипторов. Объекты
+// подключений выровнены, поэтому их метки с этими не совпадают.
+#define TAG_LISTEN  1
+#define TAG_EVENTFD 2
+#define TAG_TIMERFD 3
+#define TAG_UPGRADE 4
+
+#define CONN_PTR_BITS 48
+_Static_assert(offsetof(conn_t, gen) >= sizeof(void *), "pool free list overwrites the generation");
+_Static_assert(sizeof(conn_t) <= 104, "idle connection header should stay small");
+
+static uint64_t conn_tag(const conn_t *conn) {
+    return ((uint64_t)conn->gen << CONN_PTR_BITS) | (uint64_t)(uintptr_t)conn;
+}
 
-void add_to_epoll(int epoll_fd, int fd, uint32_t events) {
+// Подключение по метке события или NULL, если объект уже освобождён
+// или принадлежит другому подключению.
+static conn_t *conn_from_tag(uint64_t tag) {
+    conn_t *conn = (conn_t *)(uintptr_t)(tag & ((1ull << CONN_PTR_BITS) - 1));
+    return conn->gen == (uint16_t)(tag >> CONN_PTR_BITS) ? conn : NULL;
+}
+
+void add_to_epoll(int epoll_fd, int fd, uint64_t tag, uint32_t events) {
     struct epoll_event event;
-    event.data.fd = fd;
+    event.data.u64 = tag;
     event.events = events;
     if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) == -1) {
         perror("epoll_ctl ADD");
@@ -32,104 +329,1950 @@ void add_to_epoll(int epoll_fd, int fd, uint32_t events) {
     }
 }
 
-int main() {
-    int server_fd, epoll_fd, event_fd;
-    struct sockaddr_un addr;
-    struct epoll_event events[MAX_EVENTS];
+static uint64_t monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
 
-    unlink(SOCKET_PATH); 
-    if ((server_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0)) == -1) {
-        perror("socket");
+static void on_signal(int signo) {
+    if (signo == SIGUSR1) {
+        stats_requested = 1;
+    } else {
+        stop = 1;
+    }
+}
+
+static void loop_init(event_loop_t *loop, int id, int cpu) {
+    memset(loop, 0, sizeof(*loop));
+    loop->id = id;
+    loop->cpu = cpu;
+    mpsc_init(&loop->tasks);
+
+    if ((loop->epoll_fd = epoll_create1(0)) == -1) {
+        perror("epoll_create1");
+        exit(EXIT_FAILURE);
+    }
+    if ((loop->event_fd = eventfd(0, EFD_NONBLOCK)) == -1) {
+        perror("eventfd");
         exit(EXIT_FAILURE);
     }
+    add_to_epoll(loop->epoll_fd, loop->event_fd, TAG_EVENTFD, EPOLLIN);
+    loop->timer_fd = -1;
+    if (backend != BACKEND_EPOLL) return; // у io_uring свои буферы
 
-    memset(&addr, 0, sizeof(addr));
-    addr.sun_family = AF_UNIX;
-    strncpy(addr.sun_path, SOCKET_PATH, sizeof(addr.sun_path) - 1);
+    if (idle_ticks || write_ticks) {
+        if ((loop->timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK)) == -1) {
+            perror("timerfd_create");
+            exit(EXIT_FAILURE);
+        }
+        add_to_epoll(loop->epoll_fd, loop->timer_fd, TAG_TIMERFD, EPOLLIN);
+        tw_init(&loop->wheel, TIMER_TICK_NS, monotonic_ns());
+    }
 
-    if (bind(server_fd, (struct sockaddr*)&addr, sizeof(addr)) == -1) {
-        perror("bind");
+    // В любом цикле может оказаться любое число подключений, но пул на всё
+    // пространство дескрипторов сразу занял бы (и закрепил mlock) ~100 МиБ
+    // на цикл: он растёт кусками по мере прихода клиентов (conn_alloc).
+    loop->conn_pools = calloc((size_t)conn_table_size / CONN_POOL_CHUNK + 1, sizeof(*loop->conn_pools));
+    if (!loop->conn_pools) {
+        perror("calloc");
+        exit(EXIT_FAILURE);
+    }
+    loop->conn_pools[0] = pool_create(sizeof(conn_t), CONN_POOL_CHUNK);
+    loop->conn_npools = 1;
+    loop->buf_pool = pool_create(sizeof(out_buf_t), BUF_POOL_BLOCKS);
+    if (!loop->conn_pools[0] || !loop->buf_pool) {
+        perror("pool_create");
         exit(EXIT_FAILURE);
     }
+}
+
+// --- Блоки очереди вывода ---
+
+static out_buf_t *buf_get(event_loop_t *loop) {
+    out_buf_t *b = pool_alloc(loop->buf_pool);
+    if (!b) return NULL;
+    b->next = NULL;
+    b->start = b->end = 0;
+    return b;
+}
+
+static void buf_put(event_loop_t *loop, out_buf_t *b) {
+    pool_free(loop->buf_pool, b);
+}
+
+// Добавить метку подключения в растущий список цикла.
+static void tag_list_push(uint64_t **list, int *count, int *cap, uint64_t tag) {
+    if (*count == *cap) {
+        int new_cap = *cap ? *cap * 2 : 64;
+        uint64_t *l = realloc(*list, (size_t)new_cap * sizeof(*l));
+        if (!l) {
+            perror("realloc");
+            exit(EXIT_FAILURE);
+        }
+        *list = l;
+        *cap = new_cap;
+    }
+    (*list)[(*count)++] = tag;
+}
+
+// Пул блоков пуст: отложить чтение подключения до возврата блоков.
+static void conn_starve(event_loop_t *loop, conn_t *conn) {
+    if (conn->starved) return;
+    tag_list_push(&loop->starved, &loop->starved_count, &loop->starved_cap, conn_tag(conn));
+    conn->starved = 1;
+    loop->starvations++;
+}
+
+// --- Бюджеты чтения и жетоны (-B, -L) ---
+
+// Пополнить жетоны подключения по времени пачки событий.
+static void conn_refill(event_loop_t *loop, conn_t *conn) {
+    uint32_t elapsed = loop->now_ms - conn->tokens_ms;
+    uint64_t add = (uint64_t)elapsed * rate_limit / 1000;
+    if (!add) return; // меньше жетона — время копится дальше
+    uint64_t tokens = conn->tokens + add;
+    conn->tokens = tokens > rate_burst ? rate_burst : (uint32_t)tokens;
+    conn->tokens_ms = loop->now_ms;
+}
+
+// Сколько подключение может прочитать сейчас: остаток бюджета прохода,
+// но не больше жетонов.
+static size_t read_allowance(const conn_t *conn, size_t budget) {
+    if (rate_limit && conn->tokens < budget) return conn->tokens;
+    return budget;
+}
+
+static void conn_consume(conn_t *conn, size_t *budget, size_t n) {
+    *budget -= n;
+    if (rate_limit) conn->tokens -= (uint32_t)n;
+}
+
+// Бюджет или жетоны кончились, а в сокете, возможно, ещё есть данные.
+// Нового фронта EPOLLIN не будет, поэтому подключение дочитывается из
+// списка готовых после следующего epoll_wait.
+static void conn_defer(event_loop_t *loop, conn_t *conn) {
+    if (rate_limit && conn->tokens == 0) {
+        loop->throttles++;
+    } else {
+        loop->defers++;
+        loop->ready_hot++;
+    }
+    if (conn->deferred) return;
+    tag_list_push(&loop->ready, &loop->ready_count, &loop->ready_cap, conn_tag(conn));
+    conn->deferred = 1;
+}
+
+// --- Каналы splice (-z) ---
+
+// Взять канал из пула или создать новый. NULL с errno == 0 — пул
+// исчерпан (подключение подождёт, как при нехватке блоков).
+static zpipe_t *pipe_get(event_loop_t *loop) {
+    zpipe_t *p = loop->pipes_free;
+    if (p) {
+        loop->pipes_free = p->next;
+        return p;
+    }
+    errno = 0;
+    if (loop->pipes_open == ZPIPE_MAX) return NULL;
+
+    int fds[2];
+    if (!(p = malloc(sizeof(*p)))) return NULL;
+    if (pipe2(fds, O_NONBLOCK | O_CLOEXEC) == -1) {
+        free(p);
+        return NULL;
+    }
+    p->rd = fds[0];
+    p->wr = fds[1];
+    // Больше канал — меньше переключений между чтением и отправкой. Без
+    // прав выше /proc/sys/fs/pipe-max-size не поднять — берём сколько дали.
+    int size = fcntl(p->wr, F_SETPIPE_SZ, ZPIPE_SIZE);
+    if (size == -1) size = fcntl(p->wr, F_GETPIPE_SZ);
+    p->size = size > 0 ? (uint32_t)size : 65536;
+    loop->syscalls += 2;
+    loop->pipes_open++;
+    return p;
+}
+
+static void pipe_put(event_loop_t *loop, zpipe_t *p) {
+    p->next = loop->pipes_free;
+    loop->pipes_free = p;
+}
+
+// Канал с неотправленными данными в пул не вернуть — только закрыть.
+static void pipe_drop(event_loop_t *loop, zpipe_t *p) {
+    close(p->rd);
+    close(p->wr);
+    free(p);
+    loop->pipes_open--;
+}
+
+// --- Тайм-ауты ---
+
+// Запомнить время пачки событий: активность подключений отмечается тиком
+// пачки, а не отдельным clock_gettime на каждое чтение.
+static void loop_clock(event_loop_t *loop) {
+    loop->now_ns = monotonic_ns();
+    loop->tick = (uint32_t)((loop->now_ns - loop->wheel.origin_ns) / TIMER_TICK_NS);
+    loop->now_ms = (uint32_t)(loop->now_ns / 1000000);
+}
+
+// Тик, на котором подключение истекает, или UINT64_MAX. +1: активность
+// могла прийтись на конец своего тика, а срок не должен выйти короче.
+static uint64_t conn_deadline(const conn_t *conn) {
+    uint64_t deadline = UINT64_MAX;
+    if (idle_ticks) deadline = (uint64_t)conn->active_tick + idle_ticks + 1;
+    if (write_ticks && conn->out_ready) {
+        uint64_t w = (uint64_t)conn->out_tick + write_ticks + 1;
+        if (w < deadline) deadline = w;
+    }
+    return deadline;
+}
+
+// Поставить таймер, если срок стал раньше поставленного. Более поздние
+// сроки (обычная активность) догоняются в conn_timer_fired.
+static void conn_timer_update(event_loop_t *loop, conn_t *conn) {
+    uint64_t deadline = conn_deadline(conn);
+    if (deadline == UINT64_MAX) return;
+    if (!tw_timer_pending(&conn->timer) || conn->timer.expires > deadline) {
+        tw_add(&loop->wheel, &conn->timer, deadline);
+    }
+}
 
-    if (listen(server_fd, SOMAXCONN) == -1) {
-        perror("listen");
+static void close_client(event_loop_t *loop, conn_t *conn);
+
+static void conn_timer_fired(tw_timer_t *timer, void *arg) {
+    event_loop_t *loop = arg;
+    conn_t *conn = (conn_t *)(void *)((char *)timer - offsetof(conn_t, timer));
+
+    // Ожидание блока из пула — задержка сервера, а не простой клиента.
+    if (conn->starved) conn->active_tick = loop->tick;
+    uint64_t deadline = conn_deadline(conn);
+    if (deadline == UINT64_MAX) return;
+    if (deadline > loop->wheel.now) {
+        tw_add(&loop->wheel, timer, deadline);
+        return;
+    }
+
+    if (verbose) printf("[loop %d] Client (fd=%d) timed out.\n", loop->id, conn->fd);
+    loop->timeouts++;
+    close_client(loop, conn);
+}
+
+static void handle_timer_event(event_loop_t *loop) {
+    uint64_t expirations;
+    loop->syscalls++;
+    if (read(loop->timer_fd, &expirations, sizeof(expirations)) == -1 && errno != EAGAIN) {
+        perror("read timerfd");
+    }
+    loop->timer_next = 0; // одноразовый таймер отработал
+    tw_advance(&loop->wheel, loop->now_ns, conn_timer_fired, loop);
+}
+
+// Взвести timer_fd на ближайший срок колеса, если тот изменился.
+// Вызывается раз на пачку событий.
+static void timer_rearm(event_loop_t *loop) {
+    uint64_t next = tw_next_expiry(&loop->wheel);
+    if (next == loop->timer_next) return;
+
+    struct itimerspec its;
+    memset(&its, 0, sizeof(its)); // next == 0 снимает таймер
+    its.it_value.tv_sec = (time_t)(next / 1000000000ull);
+    its.it_value.tv_nsec = (long)(next % 1000000000ull);
+    loop->syscalls++;
+    if (timerfd_settime(loop->timer_fd, TFD_TIMER_ABSTIME, &its, NULL) == -1) {
+        perror("timerfd_settime");
         exit(EXIT_FAILURE);
     }
-    printf("Server is listening on socket: %s\n", SOCKET_PATH);
+    loop->timer_next = next;
+}
 
-    if ((epoll_fd = epoll_create1(0)) == -1) {
-        perror("epoll_create1");
+// Объект подключения из пула цикла. Новый кусок создаётся, только когда
+// исчерпаны оба списка свободных: первого куска и последнего, ещё не
+// розданного до конца. Блоки всех кусков одного размера, а pool_free лишь
+// кладёт блок в список, поэтому закрытые подключения возвращаются в
+// список первого куска, из какого бы куска ни были (conn_free).
+static conn_t *conn_alloc(event_loop_t *loop) {
+    conn_t *conn = pool_alloc(loop->conn_pools[0]);
+    if (conn) return conn;
+    if ((conn = pool_alloc(loop->conn_pools[loop->conn_npools - 1]))) return conn;
+    if ((long)loop->conn_npools * CONN_POOL_CHUNK >= conn_table_size) return NULL;
+    MemoryPool *chunk = pool_create(sizeof(conn_t), CONN_POOL_CHUNK);
+    if (!chunk) return NULL;
+    loop->conn_pools[loop->conn_npools++] = chunk;
+    return pool_alloc(chunk);
+}
+
+static void conn_free(event_loop_t *loop, conn_t *conn) {
+    pool_free(loop->conn_pools[0], conn);
+}
+
+static conn_t *register_client(event_loop_t *loop, int client_fd) {
+    conn_t *conn = conn_alloc(loop);
+    if (!conn) {
+        fprintf(stderr, "[loop %d] connection pool exhausted, dropping fd=%d\n", loop->id, client_fd);
+        close(client_fd);
+        atomic_fetch_sub(&loop->connections, 1);
+        return NULL;
+    }
+    uint16_t gen = (uint16_t)(conn->gen + 1);
+    memset(conn, 0, sizeof(*conn));
+    conn->gen = gen;
+    conn->fd = client_fd;
+    conn->tokens = rate_burst;
+    conn->tokens_ms = loop->now_ms;
+    conn->next = loop->live;
+    if (loop->live) loop->live->prev = conn;
+    loop->live = conn;
+    add_to_epoll(loop->epoll_fd, client_fd, conn_tag(conn), EPOLLIN | EPOLLRDHUP | EPOLLET);
+    loop->syscalls++;
+    if (loop->timer_fd != -1) {
+        conn->active_tick = conn->out_tick = loop->tick;
+        conn_timer_update(loop, conn);
+    }
+    atomic_fetch_add(&loop->accepted, 1);
+    if (verbose) printf("[loop %d] New client (fd=%d) connected.\n", loop->id, client_fd);
+    return conn;
+}
+
+static void close_client(event_loop_t *loop, conn_t *conn) {
+    while (conn->out_head) {
+        out_buf_t *b = conn->out_head;
+        conn->out_head = b->next;
+        buf_put(loop, b);
+    }
+    if (zero_copy && conn->pipe) pipe_drop(loop, conn->pipe);
+    tw_cancel(&loop->wheel, &conn->timer);
+    close(conn->fd); // epoll_ctl(EPOLL_CTL_DEL) не нужен для close
+    loop->syscalls++;
+
+    if (conn->prev) {
+        conn->prev->next = conn->next;
+    } else {
+        loop->live = conn->next;
+    }
+    if (conn->next) conn->next->prev = conn->prev;
+    // Новое поколение: события этого подключения, уже лежащие в массиве
+    // текущего epoll_wait, будут отброшены.
+    conn->gen++;
+    conn_free(loop, conn);
+    atomic_fetch_sub(&loop->connections, 1);
+}
+
+// --- Задачи от других потоков ---
+
+// Поставить задачу в очередь цикла. eventfd пишется, только если очередь
+// была пуста: остальные задачи заберёт тот же разбор.
+// Возвращает 1, если цикл пришлось будить (системный вызов).
+static int loop_submit(event_loop_t *loop, loop_task_t *task) {
+    if (!mpsc_push(&loop->tasks, &task->node)) return 0;
+    uint64_t one = 1;
+    atomic_fetch_add_explicit(&loop->wakeups, 1, memory_order_relaxed);
+    if (write(loop->event_fd, &one, sizeof(one)) != sizeof(one)) perror("write eventfd");
+    return 1;
+}
+
+// Выполнить все накопившиеся задачи. Возвращает их число.
+static int loop_run_tasks(event_loop_t *loop) {
+    int n = 0;
+    mpsc_node_t *node = mpsc_take_all(&loop->tasks);
+    while (node) {
+        loop_task_t *task = (loop_task_t *)node;
+        node = node->next;
+        task->run(loop, task);
+        n++;
+    }
+    loop->tasks_run += (uint64_t)n;
+    return n;
+}
+
+// Задачи передачи подключений не освобождаются, а возвращаются акцептору
+// через такую же очередь: после разгона приём подключения обходится без
+// malloc. Забирает их только акцептор.
+static mpsc_queue_t handoff_free;
+static mpsc_node_t *handoff_cache;
+
+static void task_register_client(event_loop_t *loop, loop_task_t *task) {
+    register_client(loop, task->fd);
+    mpsc_push(&handoff_free, &task->node);
+}
+
+// Передать принятое подключение циклу. -1 — нет памяти под задачу.
+static int handoff_push(event_loop_t *loop, int fd) {
+    if (!handoff_cache) handoff_cache = mpsc_take_all(&handoff_free);
+    loop_task_t *task = (loop_task_t *)handoff_cache;
+    if (task) {
+        handoff_cache = handoff_cache->next;
+    } else if (!(task = malloc(sizeof(*task)))) {
+        return -1;
+    }
+    task->run = task_register_client;
+    task->fd = fd;
+    if (loop_submit(loop, task)) acceptor_syscalls++;
+    return 0;
+}
+
+static void handoff_free_all(void) {
+    mpsc_node_t *lists[2] = {handoff_cache, mpsc_take_all(&handoff_free)};
+    for (int i = 0; i < 2; ++i) {
+        while (lists[i]) {
+            mpsc_node_t *next = lists[i]->next;
+            free(lists[i]);
+            lists[i] = next;
+        }
+    }
+    handoff_cache = NULL;
+}
+
+static void print_loop_stats(const event_loop_t *loop, const char *prefix) {
+    printf("%sloop %d%s: accepted=%llu reads=%llu frames=%llu bytes=%llu writevs=%llu splices=%llu "
+           "read_pauses=%llu buf_waits=%llu defers=%llu throttles=%llu timeouts=%llu tasks=%llu wakeups=%llu syscalls=%llu\n",
+           prefix, loop->id, loop->cls == CLASS_CONTROL ? " (control)" : "",
+           (unsigned long long)atomic_load(&loop->accepted),
+           (unsigned long long)atomic_load(&loop->messages),
+           (unsigned long long)atomic_load(&loop->frames),
+           (unsigned long long)atomic_load(&loop->bytes),
+           (unsigned long long)atomic_load(&loop->writevs),
+           (unsigned long long)atomic_load(&loop->splices),
+           (unsigned long long)atomic_load(&loop->paused),
+           (unsigned long long)loop->starvations,
+           (unsigned long long)loop->defers,
+           (unsigned long long)loop->throttles,
+           (unsigned long long)loop->timeouts,
+           (unsigned long long)loop->tasks_run,
+           (unsigned long long)atomic_load(&loop->wakeups),
+           (unsigned long long)loop->syscalls);
+}
+
+// Статистику печатает сам цикл: часть счётчиков принадлежит только ему.
+static void task_print_stats(event_loop_t *loop, loop_task_t *task) {
+    print_loop_stats(loop, "[stats] ");
+    free(task);
+}
+
+// SIGUSR1: попросить каждый цикл напечатать свою статистику.
+static void request_stats(void) {
+    stats_requested = 0;
+    for (int i = 0; i < num_loops; ++i) {
+        loop_task_t *task = malloc(sizeof(*task));
+        if (!task) {
+            perror("malloc");
+            return;
+        }
+        task->run = task_print_stats;
+        loop_submit(&loops[i], task);
+    }
+}
+
+static event_loop_t *pick_loop(dist_mode_t mode) {
+    static unsigned next = 0;
+    if (mode == DIST_ROUND_ROBIN) return &loops[next++ % (unsigned)bulk_loops];
+
+    event_loop_t *best = &loops[0];
+    for (int i = 1; i < bulk_loops; ++i) {
+        if (atomic_load(&loops[i].connections) < atomic_load(&best->connections)) best = &loops[i];
+    }
+    return best;
+}
+
+// --- Обработка событий ---
+
+static void handle_internal_event(event_loop_t *loop) {
+    uint64_t counter;
+    loop->syscalls++;
+    if (read(loop->event_fd, &counter, sizeof(counter)) != sizeof(counter)) return; // Сбрасываем счетчик
+    if (stop) return;
+
+    // Тот же eventfd будит цикл для очереди задач. Если задач не
+    // оказалось, событие внешнее (echo 1 > /proc/.../fd/N).
+    if (loop_run_tasks(loop) == 0) {
+        printf("!!! [loop %d] Received internal event (counter=%llu) !!!\n",
+               loop->id, (unsigned long long)counter);
+    }
+}
+
+// Отправить готовую часть очереди вывода одним writev (до WRITEV_MAX_IOV
+// блоков за раз). Неполный кадр в хвосте остаётся в очереди.
+// Возвращает -1 при ошибке сокета, иначе 0 (в том числе при EAGAIN).
+static int conn_flush(event_loop_t *loop, conn_t *conn) {
+    while (conn->out_ready) {
+        struct iovec iov[WRITEV_MAX_IOV];
+        int cnt = 0;
+        uint32_t budget = conn->out_ready;
+        for (out_buf_t *b = conn->out_head; budget && cnt < WRITEV_MAX_IOV; b = b->next) {
+            uint32_t len = b->end - b->start;
+            if (len > budget) len = budget;
+            iov[cnt].iov_base = b->data + b->start;
+            iov[cnt].iov_len = len;
+            budget -= len;
+            cnt++;
+        }
+        ssize_t n = writev(conn->fd, iov, cnt);
+        loop->syscalls++;
+        if (n == -1) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return 0;
+            // Клиент мог уже закрыть сокет — это не ошибка сервера.
+            if (errno != EPIPE && errno != ECONNRESET) perror("writev");
+            return -1;
+        }
+        atomic_fetch_add_explicit(&loop->writevs, 1, memory_order_relaxed);
+        conn->out_bytes -= (uint32_t)n;
+        conn->out_ready -= (uint32_t)n;
+        conn->active_tick = conn->out_tick = loop->tick;
+
+        // Освобождаем полностью отправленные блоки, в последнем сдвигаем start.
+        while (n > 0) {
+            out_buf_t *b = conn->out_head;
+            size_t left = b->end - b->start;
+            if ((size_t)n < left) {
+                b->start += (uint32_t)n;
+                break;
+            }
+            n -= (ssize_t)left;
+            conn->out_head = b->next;
+            buf_put(loop, b);
+        }
+        if (!conn->out_head) conn->out_tail = NULL;
+    }
+    return 0;
+}
+
+// Читать до EAGAIN, до порога очереди вывода или до конца бюджета прохода.
+// Данные читаются прямо в хвостовой блок очереди — это и есть эхо-ответ.
+// Возвращает -1 при ошибке сокета.
+static int conn_read(event_loop_t *loop, conn_t *conn, size_t *budget) {
+    while (conn->want_read && conn->out_bytes < OUTPUT_HIGH_WATER) {
+        size_t allow = read_allowance(conn, *budget);
+        if (allow == 0) {
+            conn_defer(loop, conn);
+            return 0;
+        }
+        out_buf_t *b = conn->out_tail;
+        if (!b || b->end == READ_BUFFER_SIZE) {
+            if (!(b = buf_get(loop))) {
+                conn_starve(loop, conn);
+                return 0;
+            }
+        }
+
+        size_t space = READ_BUFFER_SIZE - b->end;
+        ssize_t n = read(conn->fd, b->data + b->end, space < allow ? space : allow);
+        loop->syscalls++;
+        if (n <= 0) {
+            if (b != conn->out_tail) buf_put(loop, b);
+            if (n == 0) {
+                // --- Обрыв соединения ---
+                // Клиент закрыл сокет; закроем свой, когда отправим очередь.
+                if (verbose) printf("[loop %d] Client (fd=%d) disconnected.\n", loop->id, conn->fd);
+                conn->peer_closed = 1;
+                conn->want_read = 0;
+                return 0;
+            }
+            if (errno == EINTR) continue;
+            // EWOULDBLOCK означает, что мы прочитали все данные (в режиме ET)
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                conn->want_read = 0;
+                return 0;
+            }
+            // Сброс соединения клиентом — обычное закрытие, не ошибка сервера.
+            if (errno != ECONNRESET) perror("read");
+            return -1;
+        }
+
+        unsigned frames = 0;
+        if (framed) {
+            ssize_t end = frame_scan(&conn->scan, b->data + b->end, (size_t)n, FRAME_MAX_PAYLOAD, &frames);
+            if (end < 0) {
+                fprintf(stderr, "[loop %d] Client (fd=%d) sent a bad frame, closing.\n", loop->id, conn->fd);
+                if (b != conn->out_tail) buf_put(loop, b);
+                return -1;
+            }
+            // Готово всё до конца последнего полного кадра этого чтения.
+            if (end > 0) conn->out_ready = conn->out_bytes + (uint32_t)end;
+            if (verbose) {
+                printf("[loop %d] Received %u frame(s) from client (fd=%d).\n", loop->id, frames, conn->fd);
+            }
+        } else {
+            conn->out_ready = conn->out_bytes + (uint32_t)n;
+            if (verbose) {
+                printf("[loop %d] Received from client (fd=%d): %.*s", loop->id, conn->fd,
+                       (int)n, b->data + b->end);
+            }
+        }
+        if (b != conn->out_tail) {
+            if (conn->out_tail) {
+                conn->out_tail->next = b;
+            } else {
+                conn->out_head = b;
+            }
+            conn->out_tail = b;
+        }
+        b->end += (uint32_t)n;
+        conn->out_bytes += (uint32_t)n;
+        conn->active_tick = loop->tick;
+        conn_consume(conn, budget, (size_t)n);
+        atomic_fetch_add_explicit(&loop->messages, 1, memory_order_relaxed);
+        if (frames) atomic_fetch_add_explicit(&loop->frames, frames, memory_order_relaxed);
+        atomic_fetch_add_explicit(&loop->bytes, (uint64_t)n, memory_order_relaxed);
+    }
+    if (conn->want_read && !conn->starved) {
+        atomic_fetch_add_explicit(&loop->paused, 1, memory_order_relaxed);
+    }
+    return 0;
+}
+
+// -z: эхо splice'ом сокет -> канал -> сокет, данные не покидают ядро.
+// Чередуем отправку из канала и чтение в него, пока есть прогресс.
+// Возвращает -1 при ошибке сокета.
+static int conn_splice_io(event_loop_t *loop, conn_t *conn, size_t *budget) {
+    for (;;) {
+        int progress = 0;
+        while (conn->out_bytes) {
+            ssize_t n = splice(conn->pipe->rd, NULL, conn->fd, NULL, conn->out_bytes,
+                               SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+            loop->syscalls++;
+            if (n == -1) {
+                if (errno == EINTR) continue;
+                if (errno == EAGAIN) break;
+                if (errno != EPIPE && errno != ECONNRESET) perror("splice to socket");
+                return -1;
+            }
+            atomic_fetch_add_explicit(&loop->splices, 1, memory_order_relaxed);
+            conn->out_bytes -= (uint32_t)n;
+            conn->out_ready = conn->out_bytes;
+            conn->active_tick = conn->out_tick = loop->tick;
+            progress = 1;
+        }
+        if (!conn->out_bytes && conn->pipe) {
+            pipe_put(loop, conn->pipe);
+            conn->pipe = NULL;
+        }
+        if (!conn->want_read || conn->deferred) return 0;
+        size_t allow = read_allowance(conn, *budget);
+        if (allow == 0) {
+            conn_defer(loop, conn);
+            return 0;
+        }
+
+        if (!conn->pipe && !(conn->pipe = pipe_get(loop))) {
+            if (errno) {
+                perror("pipe2");
+                return -1;
+            }
+            conn_starve(loop, conn);
+            return 0;
+        }
+        uint32_t room = conn->pipe->size - conn->out_bytes;
+        if (room == 0) {
+            if (progress) continue;
+            atomic_fetch_add_explicit(&loop->paused, 1, memory_order_relaxed);
+            return 0; // канал полон, сокет не принимает — ждём EPOLLOUT
+        }
+
+        ssize_t n = splice(conn->fd, NULL, conn->pipe->wr, NULL, room < allow ? room : allow,
+                           SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+        loop->syscalls++;
+        if (n > 0) {
+            conn->out_bytes += (uint32_t)n;
+            conn->out_ready = conn->out_bytes;
+            conn->active_tick = loop->tick;
+            conn_consume(conn, budget, (size_t)n);
+            atomic_fetch_add_explicit(&loop->messages, 1, memory_order_relaxed);
+            atomic_fetch_add_explicit(&loop->bytes, (uint64_t)n, memory_order_relaxed);
+            continue;
+        }
+        if (n == 0) {
+            if (verbose) printf("[loop %d] Client (fd=%d) disconnected.\n", loop->id, conn->fd);
+            conn->peer_closed = 1;
+            conn->want_read = 0;
+            continue;
+        }
+        if (errno == EINTR) continue;
+        if (errno != EAGAIN) {
+            if (errno != ECONNRESET) perror("splice from socket");
+            return -1;
+        }
+        if (!conn->out_bytes) {
+            conn->want_read = 0; // сокет вычитан
+            pipe_put(loop, conn->pipe);
+            conn->pipe = NULL;
+            return 0;
+        }
+        // EAGAIN при непустом канале: либо сокет вычитан, либо канал
+        // заполнен (ёмкость считается и в страницах, не только в байтах).
+        // Не гадаем: после отправки из канала чтение повторится.
+        if (!progress) return 0;
+    }
+}
+
+static void handle_client(event_loop_t *loop, uint64_t tag, uint32_t events) {
+    conn_t *conn = conn_from_tag(tag);
+    if (!conn) return;
+
+    // Новый фронт EPOLLIN: в сокете есть непрочитанные данные.
+    if (events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) conn->want_read = 1;
+
+    // Бюджет на этот вызов; отложенное подключение читает только в свою
+    // очередь из списка готовых.
+    size_t budget = read_budget ? read_budget : SIZE_MAX;
+    if (rate_limit) conn_refill(loop, conn);
+
+    if (zero_copy) {
+        if (conn_splice_io(loop, conn, &budget) == -1) {
+            close_client(loop, conn);
+            return;
+        }
+    }
+
+    // Чередуем отправку и чтение, пока есть прогресс: отправка освобождает
+    // место под чтение, приостановленное порогом OUTPUT_HIGH_WATER.
+    while (!zero_copy) {
+        if (conn_flush(loop, conn) == -1) {
+            close_client(loop, conn);
+            return;
+        }
+        if (!conn->want_read || conn->starved || conn->deferred || conn->out_bytes >= OUTPUT_HIGH_WATER) break;
+        if (conn_read(loop, conn, &budget) == -1) {
+            close_client(loop, conn);
+            return;
+        }
+    }
+
+    // Неполный кадр после закрытия клиентом уже не дополнится.
+    if (conn->peer_closed && conn->out_ready == 0) {
+        close_client(loop, conn);
+        return;
+    }
+
+    // EPOLLOUT нужен, только пока в очереди есть что отправить.
+    int want_out = conn->out_ready > 0;
+    if (want_out != conn->out_armed) {
+        struct epoll_event ev;
+        ev.data.u64 = conn_tag(conn);
+        ev.events = EPOLLIN | EPOLLRDHUP | EPOLLET | (want_out ? EPOLLOUT : 0);
+        loop->syscalls++;
+        if (epoll_ctl(loop->epoll_fd, EPOLL_CTL_MOD, conn->fd, &ev) == -1) {
+            perror("epoll_ctl MOD");
+            close_client(loop, conn);
+            return;
+        }
+        conn->out_armed = want_out;
+        // Очередь вывода только что стала непустой: пошёл срок -W.
+        if (want_out && write_ticks && loop->timer_fd != -1) {
+            conn->out_tick = loop->tick;
+            conn_timer_update(loop, conn);
+        }
+    }
+}
+
+// Класс клиента по gid процесса на другом конце сокета.
+static conn_class_t classify_peer(int fd) {
+    struct ucred cred;
+    socklen_t len = sizeof(cred);
+    acceptor_syscalls++;
+    if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &len) == -1) {
+        perror("getsockopt SO_PEERCRED");
+        return CLASS_BULK;
+    }
+    return (long)cred.gid == control_gid ? CLASS_CONTROL : CLASS_BULK;
+}
+
+// Цикл для нового клиента многопоточного режима: по классу, затем по mode.
+static event_loop_t *route_client(int fd, dist_mode_t mode) {
+    if (control_gid >= 0 && classify_peer(fd) == CLASS_CONTROL) return &loops[bulk_loops];
+    return pick_loop(mode);
+}
+
+static int accept_clients(event_loop_t *self, dist_mode_t mode) {
+    int accepted = 0;
+    for (;;) {
+        int client_fd = accept4(server_fd, NULL, NULL, SOCK_NONBLOCK);
+        if (self) {
+            self->syscalls++;
+        } else {
+            acceptor_syscalls++;
+        }
+        if (client_fd == -1) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) perror("accept4");
+            return accepted;
+        }
+        accepted++;
+
+        // Однопоточный режим: клиент остаётся в цикле акцептора.
+        if (self) {
+            atomic_fetch_add(&self->connections, 1);
+            register_client(self, client_fd);
+            continue;
+        }
+
+        event_loop_t *loop = route_client(client_fd, mode);
+        atomic_fetch_add(&loop->connections, 1);
+        if (handoff_push(loop, client_fd) == -1) {
+            perror("malloc");
+            atomic_fetch_sub(&loop->connections, 1);
+            close(client_fd);
+        }
+    }
+}
+
+// --- Обновление без простоя (-U) ---
+
+#define UPGRADE_MAGIC 0x45504f55u  // "UOPE"
+#define UPGRADE_MODE_FRAMED 0x1
+#define UPGRADE_MODE_ZCOPY 0x2
+
+enum { UPGRADE_HELLO = 1, UPGRADE_LISTEN, UPGRADE_CONN, UPGRADE_END };
+
+// Сообщение протокола обновления. Дескрипторы идут в SCM_RIGHTS того же
+// sendmsg; за UPGRADE_CONN без -z следуют out_bytes байт очереди вывода.
+typedef struct {
+    uint32_t magic;
+    uint32_t kind;
+    uint32_t modes;             // HELLO: HANDOFF_MODE_* нового экземпляра
+    uint32_t out_bytes;
+    uint32_t out_ready;
+    uint32_t peer_closed;
+    frame_scanner_t scan;
+} upgrade_msg_t;
+
+static pthread_mutex_t upgrade_lock = PTHREAD_MUTEX_INITIALIZER;
+static sem_t upgrade_done;      // циклы, отдавшие свои подключения
+
+static uint32_t upgrade_modes(void) {
+    return (framed ? UPGRADE_MODE_FRAMED : 0) | (zero_copy ? UPGRADE_MODE_ZCOPY : 0);
+}
+
+static int write_all(int fd, const char *p, size_t n) {
+    while (n) {
+        ssize_t w = write(fd, p, n);
+        if (w == -1) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        p += w;
+        n -= (size_t)w;
+    }
+    return 0;
+}
+
+static int read_all(int fd, char *p, size_t n) {
+    while (n) {
+        ssize_t r = read(fd, p, n);
+        if (r <= 0) {
+            if (r == -1 && errno == EINTR) continue;
+            if (r == 0) errno = ECONNRESET;
+            return -1;
+        }
+        p += r;
+        n -= (size_t)r;
+    }
+    return 0;
+}
+
+static int upgrade_send(int sock, const upgrade_msg_t *msg, const int *fds, int nfds) {
+    union {
+        struct cmsghdr align;
+        char buf[CMSG_SPACE(3 * sizeof(int))];
+    } ctl;
+    struct iovec iov = {.iov_base = (void *)msg, .iov_len = sizeof(*msg)};
+    struct msghdr mh = {.msg_iov = &iov, .msg_iovlen = 1};
+    if (nfds > 0) {
+        memset(&ctl, 0, sizeof(ctl));
+        mh.msg_control = ctl.buf;
+        mh.msg_controllen = CMSG_SPACE((size_t)nfds * sizeof(int));
+        struct cmsghdr *cmsg = CMSG_FIRSTHDR(&mh);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN((size_t)nfds * sizeof(int));
+        memcpy(CMSG_DATA(cmsg), fds, (size_t)nfds * sizeof(int));
+    }
+    for (;;) {
+        ssize_t n = sendmsg(sock, &mh, MSG_NOSIGNAL);
+        if (n == (ssize_t)sizeof(*msg)) return 0;
+        if (n == -1 && errno == EINTR) continue;
+        if (n >= 0) errno = EMSGSIZE;
+        return -1;
+    }
+}
+
+// Принять сообщение и до 3 дескрипторов. В *nfds — сколько пришло.
+static int upgrade_recv(int sock, upgrade_msg_t *msg, int *fds, int *nfds) {
+    union {
+        struct cmsghdr align;
+        char buf[CMSG_SPACE(3 * sizeof(int))];
+    } ctl;
+    struct iovec iov = {.iov_base = msg, .iov_len = sizeof(*msg)};
+    struct msghdr mh = {.msg_iov = &iov, .msg_iovlen = 1, .msg_control = ctl.buf,
+                        .msg_controllen = sizeof(ctl.buf)};
+    ssize_t n;
+    while ((n = recvmsg(sock, &mh, MSG_WAITALL | MSG_CMSG_CLOEXEC)) == -1 && errno == EINTR) {}
+    *nfds = 0;
+    for (struct cmsghdr *c = CMSG_FIRSTHDR(&mh); c; c = CMSG_NXTHDR(&mh, c)) {
+        if (c->cmsg_level != SOL_SOCKET || c->cmsg_type != SCM_RIGHTS) continue;
+        *nfds = (int)((c->cmsg_len - CMSG_LEN(0)) / sizeof(int));
+        memcpy(fds, CMSG_DATA(c), (size_t)*nfds * sizeof(int));
+    }
+    if (n != (ssize_t)sizeof(*msg) || msg->magic != UPGRADE_MAGIC) {
+        for (int i = 0; i < *nfds; ++i) close(fds[i]);
+        *nfds = 0;
+        if (n >= 0) errno = EPROTO;
+        return -1;
+    }
+    return 0;
+}
+
+// Старый экземпляр: отдать подключение и закрыть свою копию. Очередь
+// вывода уходит как есть, вместе с неполным кадром в хвосте.
+static int upgrade_conn(event_loop_t *loop, conn_t *conn, int sock) {
+    upgrade_msg_t m = {
+        .magic = UPGRADE_MAGIC,
+        .kind = UPGRADE_CONN,
+        .out_bytes = conn->out_bytes,
+        .out_ready = conn->out_ready,
+        .peer_closed = conn->peer_closed,
+        .scan = conn->scan,
+    };
+    int fds[3] = {conn->fd};
+    int nfds = 1;
+    if (zero_copy && conn->pipe) {
+        fds[nfds++] = conn->pipe->rd;
+        fds[nfds++] = conn->pipe->wr;
+    }
+
+    pthread_mutex_lock(&upgrade_lock);
+    int rc = upgrade_send(sock, &m, fds, nfds);
+    for (out_buf_t *b = conn->out_head; !zero_copy && b && rc == 0; b = b->next) {
+        rc = write_all(sock, b->data + b->start, b->end - b->start);
+    }
+    pthread_mutex_unlock(&upgrade_lock);
+    close_client(loop, conn);
+    return rc;
+}
+
+static void upgrade_loop(event_loop_t *loop, int sock) {
+    int sent = 0;
+    while (loop->live) {
+        if (upgrade_conn(loop, loop->live, sock) == -1) {
+            perror("upgrade: send connection");
+            while (loop->live) close_client(loop, loop->live);
+            break;
+        }
+        sent++;
+    }
+    printf("[loop %d] Handed off %d connection(s).\n", loop->id, sent);
+}
+
+static void task_upgrade(event_loop_t *loop, loop_task_t *task) {
+    upgrade_loop(loop, task->fd);
+    sem_post(&upgrade_done);
+    free(task);
+}
+
+// Старый экземпляр: новый подключился к UPGRADE_PATH. epoll_fd — epoll,
+// где зарегистрированы слушающие сокеты; self — цикл однопоточного режима.
+static void upgrade_serve(int epoll_fd, event_loop_t *self) {
+    int sock = accept4(upgrade_fd, NULL, NULL, SOCK_CLOEXEC);
+    if (sock == -1) {
+        if (errno != EAGAIN && errno != EINTR) perror("accept4 upgrade");
+        return;
+    }
+    upgrade_msg_t m;
+    int fds[3], nfds;
+    if (upgrade_recv(sock, &m, fds, &nfds) == -1 || m.kind != UPGRADE_HELLO) {
+        perror("upgrade: hello");
+        close(sock);
+        return;
+    }
+    if (m.modes != upgrade_modes()) {
+        fprintf(stderr, "upgrade: refused, -f/-z of the new server differ\n");
+        close(sock);
+        return;
+    }
+
+    m = (upgrade_msg_t){.magic = UPGRADE_MAGIC, .kind = UPGRADE_LISTEN};
+    if (upgrade_send(sock, &m, &server_fd, 1) == -1) {
+        perror("upgrade: send listening socket");
+        close(sock);
+        return;
+    }
+    // С этого момента подключения принимает новый экземпляр: очередь
+    // accept общая, ничего не теряется. Пути сокетов теперь его.
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, server_fd, NULL);
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, upgrade_fd, NULL);
+    close(server_fd);
+    close(upgrade_fd);
+    server_fd = upgrade_fd = -1;
+
+    if (self) {
+        upgrade_loop(self, sock);
+    } else {
+        for (int i = 0; i < num_loops; ++i) {
+            loop_task_t *task = malloc(sizeof(*task));
+            if (!task) {
+                perror("malloc");
+                exit(EXIT_FAILURE);
+            }
+            task->run = task_upgrade;
+            task->fd = sock;
+            loop_submit(&loops[i], task);
+        }
+        for (int i = 0; i < num_loops; ++i) {
+            while (sem_wait(&upgrade_done) == -1 && errno == EINTR) {}
+        }
+    }
+    m = (upgrade_msg_t){.magic = UPGRADE_MAGIC, .kind = UPGRADE_END};
+    if (upgrade_send(sock, &m, NULL, 0) == -1) perror("upgrade: end");
+    close(sock);
+    printf("Handed the server off to the new instance, exiting.\n");
+    stop = 1;
+}
+
+// Новый экземпляр: принять подключение со стороны старого. Очередь
+// вывода собирается заново из блоков пула (при -z — переданный канал).
+static int upgrade_restore(int sock, const upgrade_msg_t *m, const int *fds, int nfds, dist_mode_t mode) {
+    event_loop_t *loop = route_client(fds[0], mode);
+    atomic_fetch_add(&loop->connections, 1);
+    conn_t *conn = register_client(loop, fds[0]);
+    uint32_t left = zero_copy ? 0 : m->out_bytes;
+    while (left) {
+        char scratch[READ_BUFFER_SIZE];
+        uint32_t n = left < READ_BUFFER_SIZE ? left : READ_BUFFER_SIZE;
+        out_buf_t *b = conn ? buf_get(loop) : NULL;
+        if (read_all(sock, b ? b->data : scratch, n) == -1) {
+            if (b) buf_put(loop, b);
+            return -1;
+        }
+        left -= n;
+        if (!b) {
+            // Нет объекта или блоков: подключение потеряно, но поток
+            // передачи надо дочитать.
+            if (conn) {
+                fprintf(stderr, "upgrade: buffer pool exhausted, dropping fd=%d\n", conn->fd);
+                close_client(loop, conn);
+                conn = NULL;
+            }
+            continue;
+        }
+        b->end = n;
+        if (conn->out_tail) {
+            conn->out_tail->next = b;
+        } else {
+            conn->out_head = b;
+        }
+        conn->out_tail = b;
+    }
+    if (!conn) {
+        for (int i = 1; i < nfds; ++i) close(fds[i]);
+        return 0;
+    }
+    if (zero_copy && nfds == 3) {
+        zpipe_t *p = malloc(sizeof(*p));
+        if (!p) {
+            perror("malloc");
+            exit(EXIT_FAILURE);
+        }
+        p->rd = fds[1];
+        p->wr = fds[2];
+        int size = fcntl(p->wr, F_GETPIPE_SZ);
+        p->size = size > 0 ? (uint32_t)size : 65536;
+        loop->pipes_open++;
+        conn->pipe = p;
+    }
+    conn->out_bytes = m->out_bytes;
+    conn->out_ready = m->out_ready;
+    conn->peer_closed = (uint8_t)m->peer_closed;
+    conn->scan = m->scan;
+    // Отправить унаследованную очередь и дочитать то, что уже в сокете:
+    // фронта EPOLLIN для этих данных у нашего epoll могло и не быть.
+    handle_client(loop, conn_tag(conn), EPOLLIN);
+    return 0;
+}
+
+// Новый экземпляр (-U): забрать слушающий сокет и подключения у
+// работающего сервера. 0 — работающего нет, 1 — передача завершена.
+// Вызывается до запуска рабочих потоков.
+static int upgrade_take(dist_mode_t mode) {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, UPGRADE_PATH, sizeof(addr.sun_path) - 1);
+    int sock = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (sock == -1) {
+        perror("socket");
         exit(EXIT_FAILURE);
     }
+    if (connect(sock, (struct sockaddr *)&addr, sizeof(addr)) == -1) {
+        if (errno != ENOENT && errno != ECONNREFUSED) perror("connect upgrade");
+        close(sock);
+        return 0;
+    }
 
-    if ((event_fd = eventfd(0, EFD_NONBLOCK)) == -1) {
-        perror("eventfd");
+    upgrade_msg_t m = {.magic = UPGRADE_MAGIC, .kind = UPGRADE_HELLO, .modes = upgrade_modes()};
+    int fds[3], nfds;
+    if (upgrade_send(sock, &m, NULL, 0) == -1 || upgrade_recv(sock, &m, fds, &nfds) == -1 ||
+        m.kind != UPGRADE_LISTEN || nfds != 1) {
+        fprintf(stderr, "upgrade: the running server refused the upgrade (-f/-z must match)\n");
         exit(EXIT_FAILURE);
     }
-    printf("Created eventfd, to emulate internal event execute:\n");
-    printf("echo 1 > /proc/%d/fd/%d\n\n", getpid(), event_fd);
+    server_fd = fds[0];
+
+    int conns = 0;
+    for (;;) {
+        if (upgrade_recv(sock, &m, fds, &nfds) == -1) {
+            perror("upgrade: receive");
+            break;
+        }
+        if (m.kind == UPGRADE_END) break;
+        if (m.kind != UPGRADE_CONN || nfds < 1) {
+            for (int i = 0; i < nfds; ++i) close(fds[i]);
+            continue;
+        }
+        if (upgrade_restore(sock, &m, fds, nfds, mode) == -1) {
+            perror("upgrade: receive output queue");
+            break;
+        }
+        conns++;
+    }
+    close(sock);
+    printf("Took over %s and %d connection(s) from the running server\n", SOCKET_PATH, conns);
+    return 1;
+}
+
+// Слушать UPGRADE_PATH, чтобы следующий экземпляр мог забрать сервер.
+static void upgrade_listen(void) {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, UPGRADE_PATH, sizeof(addr.sun_path) - 1);
+    unlink(UPGRADE_PATH);
+    if ((upgrade_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0)) == -1 ||
+        bind(upgrade_fd, (struct sockaddr *)&addr, sizeof(addr)) == -1 || listen(upgrade_fd, 1) == -1) {
+        perror("upgrade socket");
+        exit(EXIT_FAILURE);
+    }
+}
+
+// Возобновить чтение подключений, ждавших блоков. Вызывается после
+// каждой пачки событий: блоки возвращаются только при их обработке.
+static void resume_starved(event_loop_t *loop) {
+    int n = loop->starved_count;
+    int i = 0;
+    loop->starved_count = 0;
+    // Повторно отложенное подключение записывается на позицию <= i,
+    // то есть поверх уже обработанных меток.
+    while (i < n) {
+        uint64_t tag = loop->starved[i++];
+        conn_t *conn = conn_from_tag(tag);
+        if (!conn) continue;
+        conn->starved = 0;
+        handle_client(loop, tag, 0);
+        conn = conn_from_tag(tag);
+        if (conn && conn->starved) break; // блоки снова кончились
+    }
+    while (i < n) loop->starved[loop->starved_count++] = loop->starved[i++];
+}
 
+// Дать следующий бюджет подключениям из списка готовых. Снова отложенные
+// дописываются в конец списка и ждут следующего прохода.
+static void run_ready(event_loop_t *loop) {
+    int n = loop->ready_count;
+    loop->ready_hot = 0;
+    for (int i = 0; i < n; ++i) {
+        uint64_t tag = loop->ready[i]; // список может вырасти (realloc)
+        conn_t *conn = conn_from_tag(tag);
+        if (!conn) continue;
+        conn->deferred = 0;
+        handle_client(loop, tag, 0);
+    }
+    loop->ready_count -= n;
+    memmove(loop->ready, loop->ready + n, (size_t)loop->ready_count * sizeof(*loop->ready));
+}
 
-    add_to_epoll(epoll_fd, server_fd, EPOLLIN);
-    add_to_epoll(epoll_fd, event_fd, EPOLLIN);
+// Цикл событий. В однопоточном режиме в его epoll есть и слушающий сокет.
+static void run_loop(event_loop_t *loop) {
+    struct epoll_event events[MAX_EVENTS];
 
-    while (1) {
-        int n_events = epoll_wait(epoll_fd, events, MAX_EVENTS, -1);
+    while (!stop) {
+        // Есть отложенные по бюджету — только опросить новые события;
+        // остались только ждущие жетонов — проверить их через 1 мс.
+        int timeout = loop->ready_count == 0 ? -1 : loop->ready_hot ? 0 : 1;
+        int n_events = epoll_wait(loop->epoll_fd, events, MAX_EVENTS, timeout);
+        loop->syscalls++;
         if (n_events == -1) {
+            if (errno == EINTR) {
+                // Однопоточный режим: SIGUSR1 приходит в этот же поток.
+                if (stats_requested) {
+                    stats_requested = 0;
+                    print_loop_stats(loop, "[stats] ");
+                }
+                continue;
+            }
             perror("epoll_wait");
             exit(EXIT_FAILURE);
         }
+        if (loop->timer_fd != -1 || rate_limit) loop_clock(loop);
 
         for (int i = 0; i < n_events; i++) {
-            if (events[i].data.fd == server_fd) {
+            uint64_t tag = events[i].data.u64;
+            if (tag == TAG_LISTEN) {
                 // --- Новое подключение ---
-                int client_fd = accept4(server_fd, NULL, NULL, SOCK_NONBLOCK);
-                if (client_fd == -1) {
-                    perror("accept4");
-                    continue;
-                }
-                add_to_epoll(epoll_fd, client_fd, EPOLLIN | EPOLLET); // ET для примера
-                printf("New client (fd=%d) connected.\n", client_fd);
-
-            } else if (events[i].data.fd == event_fd) {
+                accept_clients(loop, DIST_ROUND_ROBIN);
+            } else if (tag == TAG_EVENTFD) {
                 // --- Внутреннее событие ---
-                uint64_t counter;
-                read(event_fd, &counter, sizeof(counter)); // Сбрасываем счетчик
-                printf("!!! Received internal event (counter=%llu) !!!\n", (unsigned long long)counter);
-
+                handle_internal_event(loop);
+            } else if (tag == TAG_TIMERFD) {
+                // --- Тайм-ауты подключений ---
+                handle_timer_event(loop);
+            } else if (tag == TAG_UPGRADE) {
+                // --- Новый экземпляр забирает сервер ---
+                upgrade_serve(loop->epoll_fd, loop);
+                break; // остальные события пачки — уже не наши подключения
             } else {
-                int client_fd = events[i].data.fd;
-                char buffer[READ_BUFFER_SIZE];
-
-                ssize_t bytes_read = read(client_fd, buffer, READ_BUFFER_SIZE);
-
-                if (bytes_read == -1) {
-                    // EWOULDBLOCK означает, что мы прочитали все данные (в режиме ET)
-                    if (errno != EWOULDBLOCK && errno != EAGAIN) {
-                        perror("read");
-                        close(client_fd);
-                    }
-                } else if (bytes_read == 0) {
-                    // --- Обрыв соединения ---
-                    // Клиент закрыл сокет. epoll автоматически удаляет fd,
-                    // но мы должны его закрыть сами.
-                    printf("Client (fd=%d) disconnected.\n", client_fd);
-                    close(client_fd); // epoll_ctl(EPOLL_CTL_DEL) не нужен для close
-                } else {
-                    buffer[bytes_read] = '\0';
-                    printf("Received from client (fd=%d): %s", client_fd, buffer);
-                    // Эхо-ответ
-                    write(client_fd, buffer, bytes_read);
+                handle_client(loop, tag, events[i].events);
+            }
+        }
+        if (loop->starved_count) resume_starved(loop);
+        if (loop->ready_count) run_ready(loop);
+        if (loop->timer_fd != -1) timer_rearm(loop);
+    }
+}
+
+// --- Бэкенд io_uring ---
+
+#define URING_ENTRIES 1024
+#define URING_CQ_FACTOR 8
+#define URING_BUF_COUNT 1024        // 4 МиБ, как BUF_POOL_BLOCKS у epoll
+#define URING_BUF_SIZE 4096
+#define URING_BGID 0
+
+// Тип заявки и подключение кодируются в user_data:
+// тип (8 бит) | поколение подключения (24 бита) | fd (32 бита).
+enum { UD_ACCEPT = 1, UD_EVENTFD, UD_RECV, UD_SEND, UD_CANCEL };
+#define UD_MAKE(type, gen, fd) \
+    (((uint64_t)(type) << 56) | ((uint64_t)((gen) & 0xffffff) << 32) | (uint32_t)(fd))
+#define UD_TYPE(ud) ((int)((ud) >> 56))
+#define UD_GEN(ud) ((uint32_t)((ud) >> 32) & 0xffffff)
+#define UD_FD(ud) ((int)(uint32_t)(ud))
+
+// Принятые, но ещё не отправленные данные: кусок буфера из кольца.
+typedef struct {
+    uint16_t bid;
+    uint32_t off;
+    uint32_t len;
+} useg_t;
+
+// Контекст вывода: очередь кусков и sendmsg в полёте. Выдаётся
+// подключению только пока у него есть данные (см. ul_io_get/ul_io_put).
+typedef struct uio {
+    struct uio *next_free;
+    useg_t *segs;
+    unsigned seg_head;
+    unsigned seg_count;
+    unsigned seg_cap;
+    struct msghdr msg;
+    struct iovec iov[WRITEV_MAX_IOV];
+} uio_t;
+
+typedef struct {
+    int fd;
+    int loop_id;
+    uint32_t gen;
+    uint8_t recv_active;        // multishot recv ещё выдаёт завершения
+    uint8_t cancel_sent;
+    uint8_t send_inflight;      // не больше одного sendmsg: порядок байт
+    uint8_t peer_closed;
+    uint8_t closing;
+    uint8_t starved;            // recv остановился из-за нехватки буферов
+    uio_t *io;                  // NULL у простаивающего подключения
+    size_t out_bytes;
+} uconn_t;
+
+typedef struct {
+    event_loop_t *loop;
+    uring_t ring;
+    uring_buf_ring_t br;
+    uint64_t ev_counter;
+    uint32_t next_gen;
+    int recycled;               // буферов возвращено с последней публикации
+    uint64_t *starved;          // user_data подключений, ждущих буферов
+    int starved_count;
+    int starved_cap;
+    uio_t *io_free;             // свободные контексты вывода
+} uloop_t;
+
+static uconn_t **uconn_table;
+
+static struct io_uring_sqe *ul_sqe(uloop_t *ul) {
+    struct io_uring_sqe *sqe = uring_get_sqe(&ul->ring);
+    if (!sqe) {
+        // SQ заполнено: отдаём накопленное ядру, не дожидаясь завершений.
+        if (uring_submit(&ul->ring, 0) == -1 && errno != EINTR) perror("io_uring_enter");
+        sqe = uring_get_sqe(&ul->ring);
+    }
+    if (!sqe) {
+        fprintf(stderr, "[loop %d] io_uring submission queue is stuck\n", ul->loop->id);
+        exit(EXIT_FAILURE);
+    }
+    return sqe;
+}
+
+static void ul_arm_accept(uloop_t *ul) {
+    struct io_uring_sqe *sqe = ul_sqe(ul);
+    uring_prep(sqe, IORING_OP_ACCEPT, server_fd, NULL, 0, UD_MAKE(UD_ACCEPT, 0, 0));
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->accept_flags = SOCK_CLOEXEC;
+}
+
+static void ul_arm_eventfd(uloop_t *ul) {
+    struct io_uring_sqe *sqe = ul_sqe(ul);
+    uring_prep(sqe, IORING_OP_READ, ul->loop->event_fd, &ul->ev_counter, sizeof(ul->ev_counter),
+               UD_MAKE(UD_EVENTFD, 0, 0));
+}
+
+static void ul_arm_recv(uloop_t *ul, uconn_t *c) {
+    struct io_uring_sqe *sqe = ul_sqe(ul);
+    uring_prep(sqe, IORING_OP_RECV, c->fd, NULL, 0, UD_MAKE(UD_RECV, c->gen, c->fd));
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = URING_BGID;
+    c->recv_active = 1;
+    c->cancel_sent = 0;
+}
+
+static void ul_cancel_recv(uloop_t *ul, uconn_t *c) {
+    struct io_uring_sqe *sqe = ul_sqe(ul);
+    uring_prep(sqe, IORING_OP_ASYNC_CANCEL, -1, NULL, 0, UD_MAKE(UD_CANCEL, c->gen, c->fd));
+    sqe->addr = UD_MAKE(UD_RECV, c->gen, c->fd);
+    c->cancel_sent = 1;
+}
+
+// Отправить накопленные куски одним sendmsg (аналог writev в epoll-пути).
+static void ul_send_next(uloop_t *ul, uconn_t *c) {
+    uio_t *io = c->io;
+    if (c->send_inflight || !io || io->seg_count == 0 || c->closing) return;
+    int cnt = 0;
+    for (unsigned i = 0; i < io->seg_count && cnt < WRITEV_MAX_IOV; ++i) {
+        useg_t *sg = &io->segs[io->seg_head + i];
+        io->iov[cnt].iov_base = uring_buf(&ul->br, sg->bid) + sg->off;
+        io->iov[cnt].iov_len = sg->len;
+        cnt++;
+    }
+    memset(&io->msg, 0, sizeof(io->msg));
+    io->msg.msg_iov = io->iov;
+    io->msg.msg_iovlen = (size_t)cnt;
+
+    struct io_uring_sqe *sqe = ul_sqe(ul);
+    uring_prep(sqe, IORING_OP_SENDMSG, c->fd, &io->msg, 1, UD_MAKE(UD_SEND, c->gen, c->fd));
+    sqe->msg_flags = MSG_NOSIGNAL;
+    c->send_inflight = 1;
+    atomic_fetch_add_explicit(&ul->loop->writevs, 1, memory_order_relaxed);
+}
+
+static void ul_recycle(uloop_t *ul, unsigned bid) {
+    uring_buf_ring_add(&ul->br, bid);
+    ul->recycled++;
+}
+
+// Контексты вывода переиспользуются через список свободных, так что
+// память под них пропорциональна числу одновременно активных
+// подключений, а не всех открытых.
+static uio_t *ul_io_get(uloop_t *ul) {
+    uio_t *io = ul->io_free;
+    if (io) {
+        ul->io_free = io->next_free;
+    } else if (!(io = calloc(1, sizeof(*io)))) {
+        return NULL;
+    }
+    io->next_free = NULL;
+    io->seg_head = io->seg_count = 0;
+    return io;
+}
+
+// Вернуть контекст, если очередь пуста и sendmsg не в полёте.
+static void ul_io_release(uloop_t *ul, uconn_t *c) {
+    if (!c->io || c->io->seg_count != 0 || c->send_inflight) return;
+    c->io->next_free = ul->io_free;
+    ul->io_free = c->io;
+    c->io = NULL;
+}
+
+static int ul_push_seg(uloop_t *ul, uconn_t *c, unsigned bid, unsigned len) {
+    if (!c->io && !(c->io = ul_io_get(ul))) return -1;
+    uio_t *io = c->io;
+    if (io->seg_head + io->seg_count == io->seg_cap) {
+        if (io->seg_head > 0) {
+            memmove(io->segs, io->segs + io->seg_head, io->seg_count * sizeof(*io->segs));
+            io->seg_head = 0;
+        } else {
+            unsigned cap = io->seg_cap ? io->seg_cap * 2 : 16;
+            useg_t *segs = realloc(io->segs, cap * sizeof(*segs));
+            if (!segs) return -1;
+            io->segs = segs;
+            io->seg_cap = cap;
+        }
+    }
+    io->segs[io->seg_head + io->seg_count++] = (useg_t){(uint16_t)bid, 0, len};
+    c->out_bytes += len;
+    return 0;
+}
+
+static void ul_close_conn(uloop_t *ul, uconn_t *c) {
+    if (c->io) {
+        for (unsigned i = 0; i < c->io->seg_count; ++i) {
+            ul_recycle(ul, c->io->segs[c->io->seg_head + i].bid);
+        }
+        c->io->seg_count = 0;
+        ul_io_release(ul, c);
+    }
+    uconn_table[c->fd] = NULL;
+    close(c->fd);
+    ul->loop->syscalls++;
+    free(c);
+    atomic_fetch_sub(&ul->loop->connections, 1);
+}
+
+// Привести заявки подключения в соответствие с его состоянием.
+// Возвращает 0, если подключение закрыто и освобождено.
+static int ul_update(uloop_t *ul, uconn_t *c) {
+    if (c->peer_closed && c->out_bytes == 0) c->closing = 1;
+
+    if (c->closing) {
+        if (c->recv_active) {
+            if (!c->cancel_sent) ul_cancel_recv(ul, c);
+            return 1;
+        }
+        if (c->send_inflight) return 1;
+        ul_close_conn(ul, c);
+        return 0;
+    }
+
+    ul_send_next(ul, c);
+    ul_io_release(ul, c);
+    if (c->recv_active) {
+        // Клиент не читает ответы — останавливаем приём (backpressure).
+        if (c->out_bytes >= OUTPUT_HIGH_WATER && !c->cancel_sent) {
+            ul_cancel_recv(ul, c);
+            atomic_fetch_add_explicit(&ul->loop->paused, 1, memory_order_relaxed);
+        }
+    } else if (!c->peer_closed && !c->starved && c->out_bytes < OUTPUT_HIGH_WATER) {
+        ul_arm_recv(ul, c);
+    }
+    return 1;
+}
+
+static uconn_t *ul_lookup(uint64_t ud) {
+    int fd = UD_FD(ud);
+    uconn_t *c = fd >= 0 && fd < conn_table_size ? uconn_table[fd] : NULL;
+    return c && c->gen == UD_GEN(ud) ? c : NULL;
+}
+
+static void ul_on_accept(uloop_t *ul, struct io_uring_cqe *cqe) {
+    event_loop_t *loop = ul->loop;
+    if (cqe->res >= 0) {
+        int fd = cqe->res;
+        uconn_t *c = fd < conn_table_size ? calloc(1, sizeof(*c)) : NULL;
+        if (!c) {
+            fprintf(stderr, "[loop %d] cannot track client fd=%d, dropping\n", loop->id, fd);
+            close(fd);
+        } else {
+            c->fd = fd;
+            c->loop_id = loop->id;
+            c->gen = ++ul->next_gen & 0xffffff;
+            uconn_table[fd] = c;
+            atomic_fetch_add(&loop->connections, 1);
+            atomic_fetch_add(&loop->accepted, 1);
+            if (verbose) printf("[loop %d] New client (fd=%d) connected.\n", loop->id, fd);
+            ul_arm_recv(ul, c);
+        }
+    } else if (cqe->res != -ECANCELED) {
+        fprintf(stderr, "accept: %s\n", strerror(-cqe->res));
+    }
+    if (!(cqe->flags & IORING_CQE_F_MORE) && !stop) ul_arm_accept(ul);
+}
+
+static void ul_on_recv(uloop_t *ul, struct io_uring_cqe *cqe) {
+    event_loop_t *loop = ul->loop;
+    uconn_t *c = ul_lookup(cqe->user_data);
+    unsigned bid = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+    if (!c) {
+        if (cqe->res > 0) ul_recycle(ul, bid);
+        return;
+    }
+
+    if (cqe->res > 0) {
+        if (c->closing || ul_push_seg(ul, c, bid, (unsigned)cqe->res) == -1) {
+            ul_recycle(ul, bid);
+        } else {
+            if (verbose) {
+                printf("[loop %d] Received from client (fd=%d): %.*s", loop->id, c->fd,
+                       cqe->res, uring_buf(&ul->br, bid));
+            }
+            atomic_fetch_add_explicit(&loop->messages, 1, memory_order_relaxed);
+            atomic_fetch_add_explicit(&loop->bytes, (uint64_t)cqe->res, memory_order_relaxed);
+        }
+    }
+
+    if (!(cqe->flags & IORING_CQE_F_MORE)) {
+        c->recv_active = 0;
+        if (cqe->res == 0) {
+            // --- Обрыв соединения ---
+            if (verbose) printf("[loop %d] Client (fd=%d) disconnected.\n", loop->id, c->fd);
+            c->peer_closed = 1;
+        } else if (cqe->res == -ENOBUFS) {
+            // Кольцо буферов опустело: перезапустим recv, когда буферы вернутся.
+            if (ul->starved_count == ul->starved_cap) {
+                int cap = ul->starved_cap ? ul->starved_cap * 2 : 64;
+                uint64_t *st = realloc(ul->starved, (size_t)cap * sizeof(*st));
+                if (!st) {
+                    perror("realloc");
+                    exit(EXIT_FAILURE);
                 }
+                ul->starved = st;
+                ul->starved_cap = cap;
             }
+            ul->starved[ul->starved_count++] = cqe->user_data;
+            c->starved = 1;
+            loop->starvations++;
+        } else if (cqe->res < 0 && cqe->res != -ECANCELED) {
+            // Сброс соединения клиентом — обычное закрытие, не ошибка сервера.
+            if (cqe->res != -ECONNRESET) fprintf(stderr, "recv: %s\n", strerror(-cqe->res));
+            c->closing = 1;
         }
     }
+    ul_update(ul, c);
+}
 
-    close(server_fd);
+static void ul_on_send(uloop_t *ul, struct io_uring_cqe *cqe) {
+    uconn_t *c = ul_lookup(cqe->user_data);
+    if (!c) return;
+    c->send_inflight = 0;
+
+    if (cqe->res < 0) {
+        // Клиент мог уже закрыть сокет — это не ошибка сервера.
+        if (cqe->res != -EPIPE && cqe->res != -ECONNRESET) {
+            fprintf(stderr, "sendmsg: %s\n", strerror(-cqe->res));
+        }
+        c->closing = 1;
+    } else {
+        // Освобождаем полностью отправленные куски, в последнем сдвигаем off.
+        uio_t *io = c->io;
+        size_t n = (size_t)cqe->res;
+        c->out_bytes -= n;
+        while (n > 0) {
+            useg_t *sg = &io->segs[io->seg_head];
+            if (n < sg->len) {
+                sg->off += (uint32_t)n;
+                sg->len -= (uint32_t)n;
+                break;
+            }
+            n -= sg->len;
+            ul_recycle(ul, sg->bid);
+            io->seg_head++;
+            io->seg_count--;
+        }
+        if (io->seg_count == 0) io->seg_head = 0;
+    }
+    ul_update(ul, c);
+}
+
+static void ul_on_eventfd(uloop_t *ul, struct io_uring_cqe *cqe) {
+    if (stop) return;
+    if (loop_run_tasks(ul->loop) == 0 && cqe->res == (int)sizeof(ul->ev_counter)) {
+        printf("!!! [loop %d] Received internal event (counter=%llu) !!!\n",
+               ul->loop->id, (unsigned long long)ul->ev_counter);
+    }
+    ul_arm_eventfd(ul);
+}
+
+// Опубликовать возвращённые буферы и перезапустить recv у ждавших их.
+static void ul_publish_buffers(uloop_t *ul) {
+    if (!ul->recycled) return;
+    uring_buf_ring_commit(&ul->br);
+    ul->recycled = 0;
+
+    int n = ul->starved_count;
+    ul->starved_count = 0;
+    for (int i = 0; i < n; ++i) {
+        uconn_t *c = ul_lookup(ul->starved[i]);
+        if (!c) continue;
+        c->starved = 0;
+        ul_update(ul, c);
+    }
+}
+
+static void uring_run_loop(event_loop_t *loop) {
+    uloop_t ul;
+    memset(&ul, 0, sizeof(ul));
+    ul.loop = loop;
+    if (uring_init(&ul.ring, URING_ENTRIES, URING_CQ_FACTOR) == -1) {
+        perror("io_uring_setup");
+        exit(EXIT_FAILURE);
+    }
+    if (uring_buf_ring_setup(&ul.ring, &ul.br, URING_BGID, URING_BUF_COUNT, URING_BUF_SIZE) == -1) {
+        perror("io_uring_register(PBUF_RING)");
+        exit(EXIT_FAILURE);
+    }
+
+    ul_arm_accept(&ul);
+    ul_arm_eventfd(&ul);
+
+    while (!stop) {
+        ul_publish_buffers(&ul);
+        // Одним вызовом: отдать все накопленные заявки и ждать завершений.
+        if (uring_submit(&ul.ring, 1) == -1) {
+            if (errno == EINTR && stats_requested) {
+                stats_requested = 0;
+                print_loop_stats(loop, "[stats] ");
+            } else if (errno != EINTR && errno != EBUSY) {
+                perror("io_uring_enter");
+                exit(EXIT_FAILURE);
+            }
+        }
+
+        struct io_uring_cqe *cqe;
+        while ((cqe = uring_peek_cqe(&ul.ring)) != NULL) {
+            switch (UD_TYPE(cqe->user_data)) {
+            case UD_ACCEPT:  ul_on_accept(&ul, cqe); break;
+            case UD_EVENTFD: ul_on_eventfd(&ul, cqe); break;
+            case UD_RECV:    ul_on_recv(&ul, cqe); break;
+            case UD_SEND:    ul_on_send(&ul, cqe); break;
+            default: break; // UD_CANCEL: итог отмены виден по завершению recv
+            }
+            uring_cqe_seen(&ul.ring);
+        }
+    }
+
+    loop->syscalls += ul.ring.enters;
+    for (int fd = 0; fd < conn_table_size; ++fd) {
+        uconn_t *c = uconn_table[fd];
+        if (!c || c->loop_id != loop->id) continue;
+        uconn_table[fd] = NULL;
+        close(fd);
+        if (c->io) {
+            free(c->io->segs);
+            free(c->io);
+        }
+        free(c);
+    }
+    while (ul.io_free) {
+        uio_t *io = ul.io_free;
+        ul.io_free = io->next_free;
+        free(io->segs);
+        free(io);
+    }
+    // Закрытие кольца отменяет оставшиеся заявки.
+    uring_buf_ring_free(&ul.ring, &ul.br);
+    uring_exit(&ul.ring);
+    free(ul.starved);
+}
+
+static void *worker_main(void *arg) {
+    event_loop_t *loop = arg;
+    if (loop->cpu >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(loop->cpu, &set);
+        if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0) {
+            fprintf(stderr, "WARNING: cannot pin loop %d to CPU %d\n", loop->id, loop->cpu);
+        }
+    }
+    int prio = class_info[loop->cls].rt_prio;
+    if (prio > 0) {
+        struct sched_param sp = {.sched_priority = prio};
+        int err = pthread_setschedparam(pthread_self(), SCHED_FIFO, &sp);
+        if (err != 0) {
+            fprintf(stderr, "WARNING: loop %d: SCHED_FIFO %d: %s\n", loop->id, prio, strerror(err));
+        }
+    }
+    if (backend == BACKEND_URING) {
+        uring_run_loop(loop);
+    } else {
+        run_loop(loop);
+    }
+    return NULL;
+}
+
+// Акцептор многопоточного режима: свой epoll только со слушающим сокетом.
+static void run_acceptor(dist_mode_t mode) {
+    int epoll_fd = epoll_create1(0);
+    if (epoll_fd == -1) {
+        perror("epoll_create1");
+        exit(EXIT_FAILURE);
+    }
+    add_to_epoll(epoll_fd, server_fd, TAG_LISTEN, EPOLLIN);
+    if (upgrade_fd != -1) add_to_epoll(epoll_fd, upgrade_fd, TAG_UPGRADE, EPOLLIN);
+
+    struct epoll_event ev;
+    while (!stop) {
+        int n = epoll_wait(epoll_fd, &ev, 1, -1);
+        acceptor_syscalls++;
+        if (n == -1) {
+            if (errno == EINTR) {
+                if (stats_requested) request_stats();
+                continue;
+            }
+            perror("epoll_wait");
+            exit(EXIT_FAILURE);
+        }
+        if (ev.data.u64 == TAG_UPGRADE) {
+            upgrade_serve(epoll_fd, NULL);
+        } else {
+            accept_clients(NULL, mode);
+        }
+    }
     close(epoll_fd);
-    close(event_fd);
-    unlink(SOCKET_PATH);
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "usage: %s [-b epoll|uring] [-t threads] [-d rr|least] [-I ms] [-W ms] [-f | -z] "
+                    "[-P gid] [-B bytes] [-L rate[:burst]] [-U] [-q]\n", prog);
+    fprintf(stderr, "  -b     event loop backend (default: epoll)\n");
+    fprintf(stderr, "  -t N   N worker event loops pinned to CPUs (0: single-threaded, default)\n");
+    fprintf(stderr, "  -d     connection distribution: round-robin or least-loaded\n");
+    fprintf(stderr, "  -I ms  close connections idle for longer than ms (epoll backend)\n");
+    fprintf(stderr, "  -W ms  close connections whose replies stay unsent for ms (epoll backend)\n");
+    fprintf(stderr, "  -f     length-prefixed binary frames (frame.h), echo whole frames (epoll backend)\n");
+    fprintf(stderr, "  -z     echo with splice through a pipe, no user-space copies (epoll backend)\n");
+    fprintf(stderr, "  -P gid clients with this gid (SO_PEERCRED) get their own SCHED_FIFO loop (epoll backend)\n");
+    fprintf(stderr, "  -B n   read at most n bytes per connection per loop pass (default %d, 0: until EAGAIN)\n",
+            READ_BUDGET);
+    fprintf(stderr, "  -L r[:b] limit each client to r bytes/s with bursts of b bytes (epoll backend)\n");
+    fprintf(stderr, "  -U     take over from a running -U server (listening socket and clients), "
+                    "accept such upgrades (epoll backend)\n");
+    fprintf(stderr, "  -q     do not print per-message logs\n");
+}
+
+int main(int argc, char *argv[]) {
+    struct sockaddr_un addr;
+    int threads = 0;
+    dist_mode_t mode = DIST_ROUND_ROBIN;
+    long idle_ms = 0, write_ms = 0;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "b:t:d:I:W:fzP:B:L:Uq")) != -1) {
+        switch (opt) {
+        case 't': threads = atoi(optarg); break;
+        case 'I': idle_ms = atol(optarg); break;
+        case 'W': write_ms = atol(optarg); break;
+        case 'd': mode = strcmp(optarg, "least") == 0 ? DIST_LEAST_LOADED : DIST_ROUND_ROBIN; break;
+        case 'f': framed = 1; break;
+        case 'U': upgradable = 1; break;
+        case 'z': zero_copy = 1; break;
+        case 'P': control_gid = atol(optarg); break;
+        case 'B': read_budget = strtoull(optarg, NULL, 0); break;
+        case 'L': {
+            char *end;
+            rate_limit = strtoull(optarg, &end, 0);
+            uint64_t burst = *end == ':' ? strtoull(end + 1, NULL, 0) : rate_limit / 10;
+            if (burst < READ_BUFFER_SIZE) burst = READ_BUFFER_SIZE;
+            rate_burst = burst > UINT32_MAX ? UINT32_MAX : (uint32_t)burst;
+            break;
+        }
+        case 'q': verbose = 0; break;
+        case 'b':
+            if (strcmp(optarg, "uring") == 0) {
+                backend = BACKEND_URING;
+            } else if (strcmp(optarg, "epoll") != 0) {
+                usage(argv[0]);
+                exit(EXIT_FAILURE);
+            }
+            break;
+        default:
+            usage(argv[0]);
+            exit(EXIT_FAILURE);
+        }
+    }
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    if (idle_ms < 0 || write_ms < 0) {
+        usage(argv[0]);
+        exit(EXIT_FAILURE);
+    }
+    if ((idle_ms || write_ms) && backend != BACKEND_EPOLL) {
+        fprintf(stderr, "WARNING: -I/-W are supported by the epoll backend only, ignoring\n");
+        idle_ms = write_ms = 0;
+    }
+    if (framed && zero_copy) {
+        fprintf(stderr, "-f and -z are mutually exclusive: splice never sees the frames\n");
+        exit(EXIT_FAILURE);
+    }
+    if ((framed || zero_copy) && backend != BACKEND_EPOLL) {
+        fprintf(stderr, "WARNING: -f/-z are supported by the epoll backend only, ignoring\n");
+        framed = zero_copy = 0;
+    }
+    if ((rate_limit || read_budget != READ_BUDGET) && backend != BACKEND_EPOLL) {
+        fprintf(stderr, "WARNING: -B/-L are supported by the epoll backend only, ignoring\n");
+        rate_limit = 0;
+    }
+    if (upgradable && backend != BACKEND_EPOLL) {
+        fprintf(stderr, "WARNING: -U is supported by the epoll backend only, ignoring\n");
+        upgradable = 0;
+    }
+    if (control_gid >= 0 && backend != BACKEND_EPOLL) {
+        fprintf(stderr, "WARNING: -P is supported by the epoll backend only, ignoring\n");
+        control_gid = -1;
+    }
+    // Классам нужны отдельные потоки: минимум один цикл bulk и акцептор.
+    if (control_gid >= 0 && threads < 1) threads = 1;
+    idle_ticks = (uint32_t)(((uint64_t)idle_ms * 1000000ull + TIMER_TICK_NS - 1) / TIMER_TICK_NS);
+    write_ticks = (uint32_t)(((uint64_t)write_ms * 1000000ull + TIMER_TICK_NS - 1) / TIMER_TICK_NS);
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_signal;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    sigaction(SIGUSR1, &sa, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    // Мягкий предел открытых файлов поднимаем до жёсткого: по нему же
+    // считается размер таблицы подключений.
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl) == -1) {
+        perror("getrlimit");
+        exit(EXIT_FAILURE);
+    }
+    if (rl.rlim_cur < rl.rlim_max) {
+        rl.rlim_cur = rl.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &rl);
+    }
+    conn_table_size = rl.rlim_cur == RLIM_INFINITY || rl.rlim_cur > (1u << 20) ? (1 << 20) : (int)rl.rlim_cur;
+    if (backend == BACKEND_URING &&
+        !(uconn_table = calloc((size_t)conn_table_size, sizeof(*uconn_table)))) {
+        perror("calloc");
+        exit(EXIT_FAILURE);
+    }
+
+    bulk_loops = threads > 0 ? threads : 1;
+    num_loops = bulk_loops + (control_gid >= 0);
+    loops = calloc((size_t)num_loops, sizeof(*loops));
+    if (!loops) {
+        perror("calloc");
+        exit(EXIT_FAILURE);
+    }
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    for (int i = 0; i < num_loops; ++i) {
+        loop_init(&loops[i], i, threads > 0 ? (int)(i % cpus) : -1);
+        if (i >= bulk_loops) loops[i].cls = CLASS_CONTROL;
+    }
+
+    // -U: если сервер уже работает, слушающий сокет и клиенты — от него.
+    if (!upgradable || !upgrade_take(mode)) {
+        unlink(SOCKET_PATH);
+        if ((server_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0)) == -1) {
+            perror("socket");
+            exit(EXIT_FAILURE);
+        }
+
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        strncpy(addr.sun_path, SOCKET_PATH, sizeof(addr.sun_path) - 1);
+
+        if (bind(server_fd, (struct sockaddr*)&addr, sizeof(addr)) == -1) {
+            perror("bind");
+            exit(EXIT_FAILURE);
+        }
+
+        if (listen(server_fd, SOMAXCONN) == -1) {
+            perror("listen");
+            exit(EXIT_FAILURE);
+        }
+        printf("Server is listening on socket: %s\n", SOCKET_PATH);
+    }
+    if (upgradable) {
+        sem_init(&upgrade_done, 0, 0);
+        upgrade_listen();
+        printf("Accepting upgrades on %s\n", UPGRADE_PATH);
+    }
+
+    printf("Created eventfd, to emulate internal event execute:\n");
+    for (int i = 0; i < num_loops; ++i) {
+        printf("echo 1 > /proc/%d/fd/%d\n", getpid(), loops[i].event_fd);
+    }
+    printf("\n");
+
+    if (threads > 0) {
+        // Сигналы обрабатывает только главный поток.
+        sigset_t set, old;
+        sigemptyset(&set);
+        sigaddset(&set, SIGINT);
+        sigaddset(&set, SIGTERM);
+        sigaddset(&set, SIGUSR1);
+        pthread_sigmask(SIG_BLOCK, &set, &old);
+        for (int i = 0; i < num_loops; ++i) {
+            if (pthread_create(&loops[i].thread, NULL, worker_main, &loops[i]) != 0) {
+                perror("pthread_create");
+                exit(EXIT_FAILURE);
+            }
+        }
+        pthread_sigmask(SIG_SETMASK, &old, NULL);
+        if (backend == BACKEND_URING) {
+            // Каждый цикл сам принимает подключения (multishot accept).
+            printf("Started %d io_uring worker loops\n", num_loops);
+            while (!stop) {
+                pause();
+                if (stats_requested) request_stats();
+            }
+        } else {
+            printf("Started %d worker loops (%s distribution)\n", bulk_loops,
+                   mode == DIST_ROUND_ROBIN ? "round-robin" : "least-loaded");
+            if (control_gid >= 0) {
+                printf("Control loop %d: clients with gid %ld, SCHED_FIFO %d\n", bulk_loops, control_gid,
+                       class_info[CLASS_CONTROL].rt_prio);
+            }
+            run_acceptor(mode);
+        }
+
+        // Будим рабочие циклы, чтобы они увидели флаг stop.
+        for (int i = 0; i < num_loops; ++i) {
+            uint64_t one = 1;
+            if (write(loops[i].event_fd, &one, sizeof(one)) < 0) perror("write eventfd");
+            pthread_join(loops[i].thread, NULL);
+        }
+    } else if (backend == BACKEND_URING) {
+        uring_run_loop(&loops[0]);
+    } else {
+        add_to_epoll(loops[0].epoll_fd, server_fd, TAG_LISTEN, EPOLLIN);
+        if (upgrade_fd != -1) add_to_epoll(loops[0].epoll_fd, upgrade_fd, TAG_UPGRADE, EPOLLIN);
+        run_loop(&loops[0]);
+    }
+
+    printf("\nShutting down. Per-loop statistics:\n");
+    for (int i = 0; i < num_loops; ++i) print_loop_stats(&loops[i], "  ");
+    if (acceptor_syscalls) printf("  acceptor: syscalls=%llu\n", (unsigned long long)acceptor_syscalls);
+
+    // Рабочие потоки остановлены: закрываем оставшиеся подключения
+    // (подключения io_uring закрывает сам uring_run_loop).
+    for (int i = 0; i < num_loops; ++i) {
+        loop_run_tasks(&loops[i]); // переданные, но не принятые подключения
+        while (loops[i].live) close_client(&loops[i], loops[i].live);
+        for (int c = 0; c < loops[i].conn_npools; ++c) pool_destroy(loops[i].conn_pools[c]);
+        free(loops[i].conn_pools);
+        pool_destroy(loops[i].buf_pool);
+        while (loops[i].pipes_free) {
+            zpipe_t *p = loops[i].pipes_free;
+            loops[i].pipes_free = p->next;
+            pipe_drop(&loops[i], p);
+        }
+        free(loops[i].starved);
+        free(loops[i].ready);
+        close(loops[i].epoll_fd);
+        close(loops[i].event_fd);
+        if (loops[i].timer_fd != -1) close(loops[i].timer_fd);
+    }
+    free(loops);
+    free(uconn_table);
+    handoff_free_all();
+
+    // После передачи пути сокетов принадлежат новому экземпляру.
+    if (server_fd != -1) {
+        close(server_fd);
+        unlink(SOCKET_PATH);
+    }
+    if (upgrade_fd != -1) {
+        close(upgrade_fd);
+        unlink(UPGRADE_PATH);
+    }
 
     return 0;
 }
@@ -143,4 +2286,32 @@ int main() {
  * 3. В третьем терминале, чтобы проверить eventfd, выполните команду,
  *    которую сервер вывел при старте (echo 1 > /proc/...).
  *    Сервер должен сообщить о внутреннем событии.
+ * 4. Масштабирование по ядрам: ./bin/epoll_bench -x ./bin/epoll_server -t 1,2,4
+ *    запускает сервер с разным числом рабочих циклов и измеряет
+ *    подключений/с и сообщений/с; -P 16 — конвейер из 16 сообщений на
+ *    подключение, -s 65536 -P 16 — проверка приостановки чтения.
+ * 5. Сравнение бэкендов: ./bin/epoll_bench -x ./bin/epoll_server -b epoll,uring
+ *    -t 0 -m msg -c 1,100,10000 — сообщений/с, процессорное время сервера
+ *    и системные вызовы на сообщение.
+ * 6. Тайм-ауты: ./bin/epoll_server -I 5000, подключитесь socat и ничего не
+ *    вводите — через 5 секунд сервер сообщит "timed out" и закроет
+ *    подключение. ./bin/epoll_idle_bench -I 500 проверяет, что активные
+ *    подключения живут, а простаивающие закрываются вовремя.
+ * 7. Кадры: ./bin/epoll_bench -x ./bin/epoll_server -t 0 -m msg -s 16 -P 32
+ *    с -F и без — мелкие сообщения конвейером: сырое эхо считает вызовы
+ *    read, а -f — каждый кадр и отвечает пачкой.
+ * 8. Большие сообщения: ./bin/zcopy_bench -x ./bin/epoll_server — эхо
+ *    копированием и с -z (splice), ГБ/с и процессорное время сервера на
+ *    ГБ для сообщений 64 КиБ–64 МиБ.
+ * 9. Классы приоритета: ./bin/prio_bench -x ./bin/epoll_server — задержка
+ *    управляющего клиента без нагрузки, под массовой нагрузкой в общем
+ *    цикле и в своём цикле SCHED_FIFO (-P).
+ * 10. Справедливость: ./bin/fair_bench -x ./bin/epoll_server — задержка
+ *    лёгких клиентов рядом с тяжёлыми при чтении до EAGAIN (-B 0), с
+ *    бюджетом прохода и с жетонами -L; defers/throttles в статистике.
+ * 11. Обновление без простоя: ./bin/epoll_server -U, затем в другом
+ *    терминале ещё раз ./bin/epoll_server -U — первый отдаст подключения
+ *    и завершится, клиенты socat продолжат работать. ./bin/restart_bench
+ *    -x ./bin/epoll_server сравнивает обрывы, отказы подключений и
+ *    всплеск задержки при обычном перезапуске и с -U.
  */
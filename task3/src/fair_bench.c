@@ -0,0 +1,326 @@
+/*
+ * Задержка лёгких клиентов рядом с «пожарным шлангом» (бюджеты чтения
+ * -B и жетоны -L у epoll_server)
+ *
+ * Три фазы по -d секунд, в каждой сервер запускается заново:
+ *  - drain:  -B 0 — подключение читается до EAGAIN (или до порога
+ *            очереди вывода) за раз, как раньше;
+ *  - budget: -B байт за проход, остаток — из списка готовых после
+ *            следующего epoll_wait;
+ *  - rate:   тот же бюджет и -L байт/с на клиента.
+ *
+ * Тяжёлые клиенты — дочерний процесс с -H подключениями, на каждом
+ * -P сообщений по -s байт в полёте (замкнутый цикл). Лёгкие — дочерний
+ * процесс с -l подключениями: раз в -i мкс каждое отправляет 64 байта
+ * и ждёт эха. Все в одном цикле сервера (-t 0), так что задержка лёгкого
+ * клиента — это в основном время, пока цикл занят чужими байтами.
+ *
+ * Печатает перцентили задержки лёгких клиентов и пропускную способность
+ * тяжёлых. Код возврата ненулевой при ошибках.
+ *
+ * Запуск: ./bin/fair_bench -x ./bin/epoll_server [-H тяжёлых] [-l лёгких]
+ *                          [-P глубина] [-s размер] [-B байт] [-L байт/с]
+ *                          [-d секунд] [-i мкс]
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include "lat_hist.h"
+
+#define SOCKET_PATH "/tmp/epoll_server.sock"
+#define LIGHT_SIZE 64
+#define MAX_LIGHT 256
+
+typedef struct {
+    const char *server;
+    int heavy;
+    int light;
+    int depth;
+    size_t size;
+    long budget;
+    long rate;
+    double duration;
+    long interval_us;
+} bench_config_t;
+
+// Результаты дочерних процессов — в разделяемой памяти.
+typedef struct {
+    lat_hist_t light;           // нс
+    uint64_t light_errors;
+    _Atomic uint64_t heavy_bytes;
+    uint64_t heavy_errors;
+} shared_result_t;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static int connect_server(void) {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, SOCKET_PATH, sizeof(addr.sun_path) - 1);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd == -1) return -1;
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == -1) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// rate 0 — без -L.
+static pid_t spawn_server(const bench_config_t *cfg, long budget, long rate) {
+    pid_t pid = fork();
+    if (pid == 0) {
+        char b[32], r[32];
+        char *argv[10];
+        int argc = 0;
+        argv[argc++] = (char *)cfg->server;
+        argv[argc++] = "-q";
+        snprintf(b, sizeof(b), "%ld", budget);
+        argv[argc++] = "-B";
+        argv[argc++] = b;
+        if (rate > 0) {
+            snprintf(r, sizeof(r), "%ld", rate);
+            argv[argc++] = "-L";
+            argv[argc++] = r;
+        }
+        argv[argc] = NULL;
+        if (!freopen("/dev/null", "w", stdout)) _exit(127);
+        execv(cfg->server, argv);
+        perror("execv");
+        _exit(127);
+    }
+    for (int i = 0; pid > 0 && i < 200; ++i) {
+        int fd = connect_server();
+        if (fd != -1) {
+            close(fd);
+            return pid;
+        }
+        usleep(10000);
+    }
+    if (pid > 0) {
+        kill(pid, SIGKILL);
+        waitpid(pid, NULL, 0);
+    }
+    return -1;
+}
+
+// Тяжёлые клиенты: на каждом подключении пачка из depth сообщений,
+// следующая — после полного эха.
+static void heavy_main(const bench_config_t *cfg, shared_result_t *res, uint64_t end) {
+    size_t batch = cfg->size * (size_t)cfg->depth;
+    char *msg = malloc(batch), *reply = malloc(batch);
+    struct pollfd *pfds = calloc((size_t)cfg->heavy, sizeof(*pfds));
+    size_t *unsent = calloc((size_t)cfg->heavy, sizeof(*unsent));
+    size_t *pending = calloc((size_t)cfg->heavy, sizeof(*pending));
+    if (!msg || !reply || !pfds || !unsent || !pending) _exit(1);
+    memset(msg, 'h', batch);
+
+    for (int i = 0; i < cfg->heavy; ++i) {
+        if ((pfds[i].fd = connect_server()) == -1) {
+            res->heavy_errors++;
+            _exit(1);
+        }
+        unsent[i] = pending[i] = batch;
+        pfds[i].events = POLLIN | POLLOUT;
+    }
+    while (now_ns() < end) {
+        if (poll(pfds, (nfds_t)cfg->heavy, 100) <= 0) continue;
+        for (int i = 0; i < cfg->heavy; ++i) {
+            if ((pfds[i].revents & POLLOUT) && unsent[i]) {
+                ssize_t n = send(pfds[i].fd, msg + batch - unsent[i], unsent[i], MSG_DONTWAIT | MSG_NOSIGNAL);
+                if (n > 0) unsent[i] -= (size_t)n;
+            }
+            if (pfds[i].revents & POLLIN) {
+                ssize_t n = recv(pfds[i].fd, reply, pending[i], MSG_DONTWAIT);
+                if (n <= 0 && !(n == -1 && errno == EAGAIN)) {
+                    res->heavy_errors++;
+                    _exit(1);
+                }
+                if (n > 0) {
+                    atomic_fetch_add(&res->heavy_bytes, (uint64_t)n);
+                    if ((pending[i] -= (size_t)n) == 0) unsent[i] = pending[i] = batch;
+                }
+            }
+            pfds[i].events = POLLIN | (unsent[i] ? POLLOUT : 0);
+        }
+    }
+    _exit(0);
+}
+
+// Лёгкие клиенты: раз в interval_us каждое подключение отправляет
+// сообщение; задержка — от отправки до полного эха на этом подключении.
+static void light_main(const bench_config_t *cfg, shared_result_t *res, uint64_t start, uint64_t end) {
+    struct pollfd pfds[MAX_LIGHT];
+    size_t got[MAX_LIGHT];
+    uint64_t sent_at[MAX_LIGHT];
+    char msg[LIGHT_SIZE], reply[LIGHT_SIZE];
+    memset(msg, 'l', sizeof(msg));
+    msg[sizeof(msg) - 1] = '\n';
+
+    for (int i = 0; i < cfg->light; ++i) {
+        if ((pfds[i].fd = connect_server()) == -1) {
+            res->light_errors++;
+            _exit(1);
+        }
+        pfds[i].events = POLLIN;
+    }
+
+    uint64_t interval = (uint64_t)cfg->interval_us * 1000;
+    for (uint64_t due = start; due < end; due += interval) {
+        struct timespec ts = {.tv_sec = (time_t)(due / 1000000000ull), .tv_nsec = (long)(due % 1000000000ull)};
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {}
+
+        for (int i = 0; i < cfg->light; ++i) {
+            got[i] = 0;
+            sent_at[i] = now_ns();
+            if (send(pfds[i].fd, msg, sizeof(msg), MSG_NOSIGNAL) != (ssize_t)sizeof(msg)) {
+                res->light_errors++;
+                _exit(1);
+            }
+        }
+        int waiting = cfg->light;
+        while (waiting > 0) {
+            if (poll(pfds, (nfds_t)cfg->light, 1000) <= 0) {
+                res->light_errors++;
+                _exit(1);
+            }
+            for (int i = 0; i < cfg->light; ++i) {
+                if (!(pfds[i].revents & POLLIN) || got[i] == sizeof(reply)) continue;
+                ssize_t n = recv(pfds[i].fd, reply, sizeof(reply) - got[i], MSG_DONTWAIT);
+                if (n <= 0) {
+                    if (n == -1 && errno == EAGAIN) continue;
+                    res->light_errors++;
+                    _exit(1);
+                }
+                if ((got[i] += (size_t)n) == sizeof(reply)) {
+                    lat_hist_record(&res->light, now_ns() - sent_at[i]);
+                    waiting--;
+                }
+            }
+        }
+    }
+    _exit(0);
+}
+
+static int wait_child(pid_t pid) {
+    int status;
+    if (pid <= 0 || waitpid(pid, &status, 0) != pid) return -1;
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0 ? 0 : -1;
+}
+
+static int run_phase(const bench_config_t *cfg, const char *name, long budget, long rate,
+                     shared_result_t *res) {
+    memset(res, 0, sizeof(*res));
+    lat_hist_init(&res->light);
+
+    pid_t server = spawn_server(cfg, budget, rate);
+    if (server == -1) {
+        fprintf(stderr, "%s: server did not start\n", name);
+        return -1;
+    }
+    uint64_t start = now_ns();
+    uint64_t end = start + (uint64_t)(cfg->duration * 1e9);
+    pid_t heavy_pid = fork();
+    if (heavy_pid == 0) heavy_main(cfg, res, end);
+    // Замер начинается, когда тяжёлые клиенты уже разогнались.
+    uint64_t light_start = start + (end - start) / 5;
+    pid_t light_pid = fork();
+    if (light_pid == 0) light_main(cfg, res, light_start, end);
+
+    int rc = wait_child(light_pid);
+    if (wait_child(heavy_pid) == -1) rc = -1;
+    kill(server, SIGTERM);
+    waitpid(server, NULL, 0);
+
+    const lat_hist_t *h = &res->light;
+    double secs = (double)(end - start) / 1e9;
+    char budget_str[24];
+    snprintf(budget_str, sizeof(budget_str), "%ld", budget);
+    printf("%-7s %8s %10ld %8llu %8.1f %8.1f %8.1f %9.1f %10.1f\n", name, budget > 0 ? budget_str : "-",
+           rate, (unsigned long long)h->total, lat_hist_percentile(h, 50) / 1e3,
+           lat_hist_percentile(h, 99) / 1e3, lat_hist_percentile(h, 99.9) / 1e3, (double)h->max / 1e3,
+           (double)atomic_load(&res->heavy_bytes) / secs / (1024 * 1024));
+    if (rc == -1 || res->light_errors || res->heavy_errors || h->total == 0) {
+        fprintf(stderr, "%s: client errors (light=%llu heavy=%llu)\n", name,
+                (unsigned long long)res->light_errors, (unsigned long long)res->heavy_errors);
+        return -1;
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    bench_config_t cfg = {
+        .server = NULL,
+        .heavy = 4,
+        .light = 8,
+        .depth = 16,
+        .size = 64 * 1024,
+        .budget = 16 * 1024,
+        .rate = 32 * 1024 * 1024,
+        .duration = 2.0,
+        .interval_us = 1000,
+    };
+
+    int opt;
+    while ((opt = getopt(argc, argv, "x:H:l:P:s:B:L:d:i:")) != -1) {
+        switch (opt) {
+        case 'x': cfg.server = optarg; break;
+        case 'H': cfg.heavy = atoi(optarg); break;
+        case 'l': cfg.light = atoi(optarg); break;
+        case 'P': cfg.depth = atoi(optarg); break;
+        case 's': cfg.size = strtoull(optarg, NULL, 0); break;
+        case 'B': cfg.budget = atol(optarg); break;
+        case 'L': cfg.rate = atol(optarg); break;
+        case 'd': cfg.duration = atof(optarg); break;
+        case 'i': cfg.interval_us = atol(optarg); break;
+        default:
+            goto usage;
+        }
+    }
+    if (!cfg.server || cfg.heavy < 1 || cfg.light < 1 || cfg.light > MAX_LIGHT || cfg.depth < 1 ||
+        cfg.size < 1 || cfg.budget < 1 || cfg.rate < 1 || cfg.duration <= 0 || cfg.interval_us < 1) {
+        goto usage;
+    }
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    signal(SIGPIPE, SIG_IGN);
+
+    shared_result_t *res = mmap(NULL, sizeof(*res), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (res == MAP_FAILED) {
+        perror("mmap");
+        return EXIT_FAILURE;
+    }
+
+    printf("heavy: %d connections x %d msgs x %zu bytes; light: %d connections, %d bytes every %ld us\n",
+           cfg.heavy, cfg.depth, cfg.size, cfg.light, LIGHT_SIZE, cfg.interval_us);
+    printf("%-7s %8s %10s %8s %8s %8s %8s %9s %10s\n", "phase", "budget", "rate_B/s", "pings", "p50_us",
+           "p99_us", "p99.9_us", "max_us", "heavy_MB/s");
+    int failures = 0;
+    failures += run_phase(&cfg, "drain", 0, 0, res) != 0;
+    failures += run_phase(&cfg, "budget", cfg.budget, 0, res) != 0;
+    failures += run_phase(&cfg, "rate", cfg.budget, cfg.rate, res) != 0;
+
+    munmap(res, sizeof(*res));
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+
+usage:
+    fprintf(stderr, "usage: %s -x server_binary [-H heavy] [-l light] [-P depth] [-s size] "
+                    "[-B budget] [-L rate] [-d seconds] [-i interval_us]\n", argv[0]);
+    return EXIT_FAILURE;
+}
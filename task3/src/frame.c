@@ -0,0 +1,73 @@
+/*
+ * Двоичные кадры с префиксом длины (см. frame.h)
+ */
+#include "frame.h"
+
+int frame_parse(const char *buf, size_t len, uint32_t max_payload,
+                frame_view_t *frames, int max, size_t *used) {
+    size_t off = 0;
+    int n = 0;
+    while (n < max && len - off >= FRAME_HDR_SIZE) {
+        frame_view_t f;
+        frame_get_header(buf + off, &f);
+        if (f.len > max_payload) {
+            *used = off;
+            return -1;
+        }
+        if (len - off - FRAME_HDR_SIZE < f.len) break; // нагрузка ещё не пришла
+        frames[n++] = f;
+        off += FRAME_HDR_SIZE + f.len;
+    }
+    *used = off;
+    return n;
+}
+
+ssize_t frame_scan(frame_scanner_t *s, const char *data, size_t n, uint32_t max_payload,
+                   unsigned *frames) {
+    const uint8_t *p = (const uint8_t *)data;
+    size_t off = 0;
+    size_t last_end = 0;
+
+    while (off < n) {
+        if (s->left > 0) {
+            // Нагрузку не разбираем — только пропускаем.
+            size_t skip = n - off < s->left ? n - off : s->left;
+            off += skip;
+            s->left -= (uint32_t)skip;
+            if (s->left == 0) {
+                (*frames)++;
+                last_end = off;
+            }
+            continue;
+        }
+
+        // Заголовок целиком в куске — обычный случай, без побайтового разбора.
+        if (s->have == 0 && n - off >= FRAME_HDR_SIZE) {
+            uint32_t len = (uint32_t)p[off] | (uint32_t)p[off + 1] << 8 |
+                           (uint32_t)p[off + 2] << 16 | (uint32_t)p[off + 3] << 24;
+            if (len > max_payload) return -1;
+            off += FRAME_HDR_SIZE;
+            s->left = len;
+            if (len == 0) {
+                (*frames)++;
+                last_end = off;
+            }
+            continue;
+        }
+
+        // Заголовок на стыке кусков: нужна только длина (первые 4 байта).
+        if (s->have < 4) s->len |= (uint32_t)p[off] << (8 * s->have);
+        off++;
+        if (++s->have < FRAME_HDR_SIZE) continue;
+
+        if (s->len > max_payload) return -1;
+        s->have = 0;
+        s->left = s->len;
+        s->len = 0;
+        if (s->left == 0) {
+            (*frames)++;
+            last_end = off;
+        }
+    }
+    return (ssize_t)last_end;
+}
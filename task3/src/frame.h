@@ -0,0 +1,91 @@
+#ifndef FRAME_H
+#define FRAME_H
+
+/*
+ * Двоичные кадры с префиксом длины для серверов на потоковых сокетах
+ * (epoll_server -f, resmgr -f из task1).
+ *
+ * Кадр: заголовок FRAME_HDR_SIZE байт, затем len байт полезной нагрузки.
+ *   uint32 len    длина нагрузки (little-endian)
+ *   uint16 type   FRAME_ECHO, FRAME_READ, ...
+ *   uint16 flags  FRAME_F_REPLY / FRAME_F_ERROR в ответах
+ *
+ * Потоковый сокет не сохраняет границы сообщений: одно чтение может
+ * принести несколько кадров и кусок следующего. Разбор идёт на месте,
+ * без копирования нагрузки:
+ *  - frame_parse — по непрерывному буферу: все полные кадры сразу
+ *    (указатели внутрь буфера), хвост — начало неполного кадра;
+ *  - frame_scan — по кускам в несмежных буферах (очередь блоков
+ *    epoll_server): помнит только позицию внутри текущего кадра
+ *    (frame_scanner_t, 12 байт) и сообщает, где кончился последний
+ *    полный кадр.
+ * Кадр с len больше предела вызывающего — ошибка протокола (-1).
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#define FRAME_HDR_SIZE 8
+
+enum {
+    FRAME_ECHO = 1,     // ответ — та же нагрузка
+    FRAME_READ,         // resmgr: прочитать буфер устройства
+    FRAME_WRITE,        // resmgr: дописать нагрузку в буфер устройства
+    FRAME_STATUS,       // resmgr: размер буфера устройства
+};
+
+#define FRAME_F_REPLY 0x1
+#define FRAME_F_ERROR 0x2
+
+typedef struct {
+    uint16_t type;
+    uint16_t flags;
+    uint32_t len;
+    const char *payload;    // внутри разобранного буфера
+} frame_view_t;
+
+typedef struct {
+    uint32_t left;          // байт нагрузки текущего кадра до конца
+    uint32_t len;           // накапливаемая длина из заголовка
+    uint8_t have;           // байт заголовка уже пройдено (0 — между кадрами)
+} frame_scanner_t;
+
+static inline void frame_put_header(void *dst, uint16_t type, uint16_t flags, uint32_t len) {
+    uint8_t *p = dst;
+    p[0] = (uint8_t)len;
+    p[1] = (uint8_t)(len >> 8);
+    p[2] = (uint8_t)(len >> 16);
+    p[3] = (uint8_t)(len >> 24);
+    p[4] = (uint8_t)type;
+    p[5] = (uint8_t)(type >> 8);
+    p[6] = (uint8_t)flags;
+    p[7] = (uint8_t)(flags >> 8);
+}
+
+static inline void frame_get_header(const void *src, frame_view_t *f) {
+    const uint8_t *p = src;
+    f->len = (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+    f->type = (uint16_t)(p[4] | p[5] << 8);
+    f->flags = (uint16_t)(p[6] | p[7] << 8);
+    f->payload = (const char *)p + FRAME_HDR_SIZE;
+}
+
+// Разобрать до max полных кадров из buf[0..len). В *used — байт, занятых
+// ими; остаток буфера — начало следующего, неполного кадра. Возвращает
+// число кадров или -1, если у кадра len > max_payload.
+int frame_parse(const char *buf, size_t len, uint32_t max_payload,
+                frame_view_t *frames, int max, size_t *used);
+
+static inline void frame_scanner_init(frame_scanner_t *s) {
+    s->left = s->len = 0;
+    s->have = 0;
+}
+
+// Продвинуть разбор на кусок data[0..n). Возвращает смещение сразу за
+// последним кадром, закончившимся в этом куске (0 — ни один не
+// закончился), и прибавляет их число к *frames; -1 — ошибка протокола.
+ssize_t frame_scan(frame_scanner_t *s, const char *data, size_t n, uint32_t max_payload,
+                   unsigned *frames);
+
+#endif // FRAME_H
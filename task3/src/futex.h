@@ -0,0 +1,41 @@
+#ifndef FUTEX_H
+#define FUTEX_H
+
+/*
+ * Минимальные обёртки над futex(2) для синхронизации между процессами
+ * через общую память. Используются без FUTEX_PRIVATE_FLAG, поэтому
+ * работают и для слов, отображённых в разные процессы.
+ */
+
+#include <linux/futex.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+// Ждать, пока *addr == val. deadline — абсолютное время CLOCK_MONOTONIC
+// или NULL (бесконечно). Возвращает 0 или -1 (EAGAIN, ETIMEDOUT, EINTR).
+static inline int futex_wait(_Atomic uint32_t *addr, uint32_t val,
+                             const struct timespec *deadline) {
+    return (int)syscall(SYS_futex, (uint32_t *)addr, FUTEX_WAIT_BITSET, val,
+                        deadline, NULL, FUTEX_BITSET_MATCH_ANY);
+}
+
+static inline int futex_wake(_Atomic uint32_t *addr, int count) {
+    return (int)syscall(SYS_futex, (uint32_t *)addr, FUTEX_WAKE, count,
+                        NULL, NULL, 0);
+}
+
+// Абсолютный дедлайн через timeout_ms от текущего момента.
+static inline void futex_deadline(struct timespec *ts, int timeout_ms) {
+    clock_gettime(CLOCK_MONOTONIC, ts);
+    ts->tv_sec += timeout_ms / 1000;
+    ts->tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+    if (ts->tv_nsec >= 1000000000L) {
+        ts->tv_sec++;
+        ts->tv_nsec -= 1000000000L;
+    }
+}
+
+#endif // FUTEX_H
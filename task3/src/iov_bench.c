@@ -0,0 +1,297 @@
+/*
+ * Пачки сообщений через writev против сборки memcpy в один буфер и
+ * против write на каждое сообщение (iov_msg.h)
+ *
+ * Сообщение — структура {id, type, payload_len, payload[]}: id и type
+ * соседние и уходят одним iovec, payload — BYTES-поле длиной -s байт.
+ * Отправитель пишет в UNIX-сокет (socketpair) -d секунд, читатель в
+ * дочернем процессе во всех режимах один и тот же — iov_msg_reader,
+ * readv пачки прямо в массив структур, — и проверяет id и края payload:
+ *  - write:  каждое сообщение собирается memcpy в буфер (пачка из одного)
+ *            и уходит своим write;
+ *  - memcpy: пачка из -b сообщений собирается memcpy в один буфер, один
+ *            write на пачку;
+ *  - writev: iov_msg_writer без копирования (copy_max = 0), один writev
+ *            на пачку, все поля — указатели в структуры;
+ *  - hybrid: iov_msg_writer с copy_max = -c (по умолчанию
+ *            IOV_MSG_COPY_MAX): короткие куски копируются, длинные идут
+ *            указателями.
+ *
+ * Печатает сообщений в секунду, МиБ/с полезной нагрузки и системных
+ * вызовов на сообщение у отправителя и у читателя. Код возврата
+ * ненулевой, если читатель нашёл ошибку.
+ *
+ * Запуск: ./bin/iov_bench [-s 16,256,4K] [-b сообщений в пачке] [-c copy_max]
+ *                         [-d секунд]
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <signal.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include "iov_msg.h"
+
+#define MAX_SIZES 16
+#define PAYLOAD_MAX (64 << 10)
+
+typedef struct {
+    uint64_t id;
+    uint32_t type;
+    uint32_t payload_len;
+    char payload[PAYLOAD_MAX];
+} bench_msg_t;
+
+typedef enum { MODE_WRITE, MODE_MEMCPY, MODE_WRITEV, MODE_HYBRID, NUM_MODES } bench_mode_t;
+
+static const char *mode_names[NUM_MODES] = {"write", "memcpy", "writev", "hybrid"};
+
+typedef struct {
+    size_t sizes[MAX_SIZES];
+    int num_sizes;
+    int batch;
+    size_t copy_max;
+    double duration;
+} bench_config_t;
+
+// Итог читателя, уходит отправителю через pipe.
+typedef struct {
+    uint64_t messages;
+    uint64_t syscalls;
+    uint64_t errors;
+} reader_result_t;
+
+static const iov_msg_field_t fields[] = {
+    IOV_MSG_FIXED(bench_msg_t, id),
+    IOV_MSG_FIXED(bench_msg_t, type),
+    IOV_MSG_BYTES(bench_msg_t, payload, payload_len),
+};
+
+static iov_msg_schema_t schema;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static char edge_of(uint64_t id) {
+    return (char)('a' + id % 26);
+}
+
+static void reader_main(int sock, int result_fd, int batch) {
+    bench_msg_t *slots = malloc((size_t)batch * sizeof(*slots));
+    iov_msg_reader_t r;
+    reader_result_t res = {0, 0, 0};
+    if (!slots || iov_msg_reader_init(&r, &schema, sock, slots, sizeof(*slots), batch) == -1) _exit(1);
+    uint64_t expect = 0;
+    int n;
+    while ((n = iov_msg_reader_next(&r)) > 0) {
+        for (int i = 0; i < n; ++i) {
+            const bench_msg_t *m = &slots[i];
+            size_t len = m->payload_len;
+            res.errors += m->id != expect || m->type != 1 || len == 0 || m->payload[0] != edge_of(m->id) ||
+                          m->payload[len - 1] != edge_of(m->id);
+            expect++;
+        }
+    }
+    if (n == -1) {
+        perror("iov_msg_reader_next");
+        res.errors++;
+    }
+    res.messages = r.stats.messages;
+    res.syscalls = r.stats.syscalls;
+    if (write(result_fd, &res, sizeof(res)) != (ssize_t)sizeof(res)) _exit(1);
+    _exit(0);
+}
+
+static int write_all(int fd, const char *buf, size_t len, uint64_t *syscalls) {
+    while (len > 0) {
+        ssize_t n = write(fd, buf, len);
+        (*syscalls)++;
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        buf += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+// Формат iov_msg, собранный копированием: count, длины, поля сообщений.
+static size_t encode(char *buf, const bench_msg_t *msgs, int count) {
+    char *p = buf;
+    uint32_t n = (uint32_t)count;
+    memcpy(p, &n, sizeof(n));
+    p += sizeof(n);
+    for (int i = 0; i < count; ++i) {
+        memcpy(p, &msgs[i].payload_len, sizeof(uint32_t));
+        p += sizeof(uint32_t);
+    }
+    for (int i = 0; i < count; ++i) {
+        memcpy(p, &msgs[i].id, offsetof(bench_msg_t, payload_len));
+        p += offsetof(bench_msg_t, payload_len);
+        memcpy(p, msgs[i].payload, msgs[i].payload_len);
+        p += msgs[i].payload_len;
+    }
+    return (size_t)(p - buf);
+}
+
+static int run_case(const bench_config_t *cfg, bench_mode_t mode, size_t size, bench_msg_t *msgs, char *buf) {
+    int sv[2], res_pipe[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) == -1 || pipe(res_pipe) == -1) {
+        perror("socketpair");
+        return -1;
+    }
+    pid_t pid = fork();
+    if (pid == -1) {
+        perror("fork");
+        return -1;
+    }
+    if (pid == 0) {
+        close(sv[0]);
+        close(res_pipe[0]);
+        reader_main(sv[1], res_pipe[1], cfg->batch);
+    }
+    close(sv[1]);
+    close(res_pipe[1]);
+
+    iov_msg_writer_t w;
+    if (iov_msg_writer_init(&w, &schema, sv[0], cfg->batch) == -1) {
+        perror("iov_msg_writer_init");
+        return -1;
+    }
+    w.copy_max = mode == MODE_HYBRID ? cfg->copy_max : 0;
+    int batch = mode == MODE_WRITE ? 1 : cfg->batch;
+    uint64_t id = 0, tx_calls = 0;
+    int rc = 0;
+    uint64_t t0 = now_ns(), deadline = t0 + (uint64_t)(cfg->duration * 1e9);
+    while (rc == 0 && now_ns() < deadline) {
+        for (int i = 0; i < batch; ++i) {
+            bench_msg_t *m = &msgs[i];
+            m->id = id;
+            m->payload[0] = m->payload[size - 1] = edge_of(id);
+            id++;
+        }
+        switch (mode) {
+        case MODE_WRITE:
+        case MODE_MEMCPY:
+            rc = write_all(sv[0], buf, encode(buf, msgs, batch), &tx_calls);
+            break;
+        case MODE_WRITEV:
+        case MODE_HYBRID:
+            // Пачку режет и IOV_MAX: полный writer сбрасывается досрочно.
+            for (int i = 0; i < batch && rc == 0; ++i) {
+                rc = iov_msg_writer_add(&w, &msgs[i]);
+                if (rc == -1 && errno == ENOBUFS && (rc = iov_msg_writer_flush(&w)) == 0) {
+                    rc = iov_msg_writer_add(&w, &msgs[i]);
+                }
+            }
+            if (rc == 0) rc = iov_msg_writer_flush(&w);
+            break;
+        default:
+            break;
+        }
+    }
+    if (rc == -1) perror(mode_names[mode]);
+    if (mode >= MODE_WRITEV) tx_calls = w.stats.syscalls;
+    iov_msg_writer_destroy(&w);
+    close(sv[0]);
+
+    reader_result_t res;
+    ssize_t got = read(res_pipe[0], &res, sizeof(res));
+    double secs = (double)(now_ns() - t0) / 1e9;
+    close(res_pipe[0]);
+    int status;
+    waitpid(pid, &status, 0);
+    if (got != (ssize_t)sizeof(res) || res.errors || res.messages != id) {
+        fprintf(stderr, "%s, %zu bytes: reader saw %llu of %llu messages, %llu errors\n", mode_names[mode], size,
+                got == (ssize_t)sizeof(res) ? (unsigned long long)res.messages : 0ull, (unsigned long long)id,
+                got == (ssize_t)sizeof(res) ? (unsigned long long)res.errors : 0ull);
+        return -1;
+    }
+    printf("%-7s %8zu %6d %11.0f %9.1f %10.3f %10.3f\n", mode_names[mode], size, batch, (double)id / secs,
+           (double)id * (double)size / secs / (1 << 20), (double)tx_calls / (double)id,
+           (double)res.syscalls / (double)id);
+    return rc;
+}
+
+static int parse_sizes(bench_config_t *cfg, char *arg) {
+    cfg->num_sizes = 0;
+    for (char *tok = strtok(arg, ","); tok; tok = strtok(NULL, ",")) {
+        char *end;
+        unsigned long long v = strtoull(tok, &end, 0);
+        if (*end == 'K' || *end == 'k') v <<= 10;
+        else if (*end == 'M' || *end == 'm') v <<= 20;
+        if (v == 0 || v > PAYLOAD_MAX || cfg->num_sizes == MAX_SIZES) return -1;
+        cfg->sizes[cfg->num_sizes++] = (size_t)v;
+    }
+    return cfg->num_sizes ? 0 : -1;
+}
+
+int main(int argc, char *argv[]) {
+    bench_config_t cfg = {
+        .sizes = {16, 256, 4 << 10},
+        .num_sizes = 3,
+        .batch = 64,
+        .copy_max = IOV_MSG_COPY_MAX,
+        .duration = 0.5,
+    };
+
+    int opt;
+    while ((opt = getopt(argc, argv, "s:b:c:d:")) != -1) {
+        switch (opt) {
+        case 's':
+            if (parse_sizes(&cfg, optarg) == -1) goto usage;
+            break;
+        case 'b': cfg.batch = atoi(optarg); break;
+        case 'c': cfg.copy_max = strtoull(optarg, NULL, 0); break;
+        case 'd': cfg.duration = atof(optarg); break;
+        default:
+            goto usage;
+        }
+    }
+    if (cfg.batch < 1 || cfg.copy_max > IOV_MSG_COPY_MAX || cfg.duration <= 0) goto usage;
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    signal(SIGPIPE, SIG_IGN);
+
+    if (iov_msg_schema_init(&schema, fields, (int)(sizeof(fields) / sizeof(fields[0]))) == -1) {
+        perror("iov_msg_schema_init");
+        return EXIT_FAILURE;
+    }
+    bench_msg_t *msgs = calloc((size_t)cfg.batch, sizeof(*msgs));
+    char *buf = malloc(sizeof(uint32_t) + (size_t)cfg.batch * (sizeof(uint32_t) + sizeof(bench_msg_t)));
+    if (!msgs || !buf) {
+        perror("malloc");
+        return EXIT_FAILURE;
+    }
+
+    printf("AF_UNIX stream, %d iovecs per message after merging adjacent fields, hybrid copies up to %zu bytes\n",
+           schema.nruns, cfg.copy_max);
+    printf("%-7s %8s %6s %11s %9s %10s %10s\n", "mode", "bytes", "batch", "msgs/s", "MiB/s", "tx_calls", "rx_calls");
+    int failures = 0;
+    for (int s = 0; s < cfg.num_sizes; ++s) {
+        size_t size = cfg.sizes[s];
+        for (int i = 0; i < cfg.batch; ++i) {
+            msgs[i].type = 1;
+            msgs[i].payload_len = (uint32_t)size;
+            memset(msgs[i].payload, 'x', size);
+        }
+        for (bench_mode_t mode = 0; mode < NUM_MODES; ++mode) failures += run_case(&cfg, mode, size, msgs, buf) != 0;
+    }
+
+    free(msgs);
+    free(buf);
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+
+usage:
+    fprintf(stderr, "usage: %s [-s size[K][,...]] [-b batch] [-c copy_max] [-d seconds]\n", argv[0]);
+    return EXIT_FAILURE;
+}
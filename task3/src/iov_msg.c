@@ -0,0 +1,301 @@
+/*
+ * Сообщения по схеме через writev/readv (см. iov_msg.h)
+ */
+#include "iov_msg.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static int iov_max(void) {
+    long v = sysconf(_SC_IOV_MAX);
+    return v > 0 ? (int)v : 1024;
+}
+
+int iov_msg_schema_init(iov_msg_schema_t *s, const iov_msg_field_t *fields, int nfields) {
+    memset(s, 0, sizeof(*s));
+    for (int i = 0; i < nfields; ++i) {
+        const iov_msg_field_t *f = &fields[i];
+        iov_msg_run_t *last = s->nruns ? &s->runs[s->nruns - 1] : NULL;
+        if (f->kind == IOV_MSG_FIELD_FIXED && f->size == 0) goto invalid;
+        // Соседнее поле без дыры — продолжение того же iovec.
+        if (f->kind == IOV_MSG_FIELD_FIXED && last && last->size && last->offset + last->size == f->offset) {
+            last->size += f->size;
+            continue;
+        }
+        if (s->nruns == IOV_MSG_MAX_RUNS) goto invalid;
+        iov_msg_run_t *run = &s->runs[s->nruns++];
+        run->offset = f->offset;
+        if (f->kind == IOV_MSG_FIELD_FIXED) {
+            run->size = f->size;
+            run->var = -1;
+        } else {
+            run->size = 0;
+            run->var = s->nvar;
+            s->var_cap[s->nvar] = f->size;
+            s->var_len_off[s->nvar] = f->len_offset;
+            s->nvar++;
+        }
+    }
+    if (s->nruns == 0) goto invalid;
+    return 0;
+
+invalid:
+    errno = EINVAL;
+    return -1;
+}
+
+// Сдвинуть начало вектора на n байт (после частичной записи/чтения).
+static void iov_advance(struct iovec **iov, int *cnt, size_t n) {
+    while (*cnt > 0 && n >= (*iov)->iov_len) {
+        n -= (*iov)->iov_len;
+        (*iov)++;
+        (*cnt)--;
+    }
+    if (*cnt > 0) {
+        (*iov)->iov_base = (char *)(*iov)->iov_base + n;
+        (*iov)->iov_len -= n;
+    }
+}
+
+// ---- писатель ----
+
+int iov_msg_writer_init(iov_msg_writer_t *w, const iov_msg_schema_t *s, int fd, int max_batch) {
+    memset(w, 0, sizeof(*w));
+    w->max_iov = iov_max();
+    if (max_batch < 1 || 2 + s->nruns > w->max_iov) {
+        errno = EINVAL;
+        return -1;
+    }
+    w->schema = s;
+    w->fd = fd;
+    w->max_batch = max_batch;
+    w->lens = calloc((size_t)max_batch * (size_t)(s->nvar ? s->nvar : 1), sizeof(*w->lens));
+    w->iov = calloc((size_t)w->max_iov, sizeof(*w->iov));
+    // Худший случай: все куски всех сообщений пачки не длиннее copy_max.
+    w->copy_max = IOV_MSG_COPY_MAX;
+    w->stage = malloc((size_t)max_batch * (size_t)s->nruns * IOV_MSG_COPY_MAX);
+    if (!w->lens || !w->iov || !w->stage) {
+        iov_msg_writer_destroy(w);
+        errno = ENOMEM;
+        return -1;
+    }
+    w->niov = 2;                // [0] — count, [1] — оглавление длин
+    return 0;
+}
+
+void iov_msg_writer_destroy(iov_msg_writer_t *w) {
+    free(w->lens);
+    free(w->iov);
+    free(w->stage);
+    w->lens = NULL;
+    w->iov = NULL;
+    w->stage = NULL;
+}
+
+int iov_msg_writer_add(iov_msg_writer_t *w, const void *msg) {
+    const iov_msg_schema_t *s = w->schema;
+    const char *base = msg;
+    if (w->count == w->max_batch || w->niov + s->nruns > w->max_iov) {
+        errno = ENOBUFS;
+        return -1;
+    }
+    uint32_t *lens = w->lens + (size_t)w->count * (size_t)s->nvar;
+    for (int v = 0; v < s->nvar; ++v) {
+        memcpy(&lens[v], base + s->var_len_off[v], sizeof(lens[v]));
+        if (lens[v] > s->var_cap[v]) {
+            errno = EMSGSIZE;
+            return -1;
+        }
+    }
+    for (int i = 0; i < s->nruns; ++i) {
+        const iov_msg_run_t *run = &s->runs[i];
+        size_t len = run->var < 0 ? run->size : lens[run->var];
+        if (len == 0) continue;
+        w->bytes += len;
+        if (len <= w->copy_max && len <= IOV_MSG_COPY_MAX) {
+            // Дописать в буфер; если прошлый iovec кончается там же — продлить его.
+            char *dst = w->stage + w->stage_used;
+            memcpy(dst, base + run->offset, len);
+            w->stage_used += len;
+            struct iovec *last = &w->iov[w->niov - 1];
+            if (w->niov > 2 && (char *)last->iov_base + last->iov_len == dst) {
+                last->iov_len += len;
+                continue;
+            }
+            w->iov[w->niov].iov_base = dst;
+        } else {
+            w->iov[w->niov].iov_base = (void *)(base + run->offset);
+        }
+        w->iov[w->niov].iov_len = len;
+        w->niov++;
+    }
+    w->count++;
+    return 0;
+}
+
+int iov_msg_writer_flush(iov_msg_writer_t *w) {
+    if (w->count == 0) return 0;
+    w->header = (uint32_t)w->count;
+    w->iov[0].iov_base = &w->header;
+    w->iov[0].iov_len = sizeof(w->header);
+    w->iov[1].iov_base = w->lens;
+    w->iov[1].iov_len = (size_t)w->count * (size_t)w->schema->nvar * sizeof(*w->lens);
+
+    struct iovec *iov = w->iov;
+    int cnt = w->niov;
+    size_t left = sizeof(w->header) + w->iov[1].iov_len + w->bytes;
+    int rc = 0;
+    while (left > 0) {
+        ssize_t n = writev(w->fd, iov, cnt);
+        w->stats.syscalls++;
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            rc = -1;
+            break;
+        }
+        left -= (size_t)n;
+        iov_advance(&iov, &cnt, (size_t)n);
+    }
+    if (rc == 0) {
+        w->stats.messages += (uint64_t)w->count;
+        w->stats.batches++;
+    }
+    w->count = 0;
+    w->niov = 2;
+    w->bytes = 0;
+    w->stage_used = 0;
+    return rc;
+}
+
+// ---- читатель ----
+
+int iov_msg_reader_init(iov_msg_reader_t *r, const iov_msg_schema_t *s, int fd, void *slots, size_t slot_size,
+                        int nslots) {
+    memset(r, 0, sizeof(*r));
+    if (nslots < 1) {
+        errno = EINVAL;
+        return -1;
+    }
+    r->schema = s;
+    r->fd = fd;
+    r->slots = slots;
+    r->slot_size = slot_size;
+    r->nslots = nslots;
+    r->max_iov = iov_max();
+    r->lens = calloc((size_t)nslots * (size_t)(s->nvar ? s->nvar : 1), sizeof(*r->lens));
+    // Все поля всех слотов и count следующей пачки; readv берёт по max_iov.
+    r->iov = calloc((size_t)nslots * (size_t)s->nruns + 1, sizeof(*r->iov));
+    if (!r->lens || !r->iov) {
+        iov_msg_reader_destroy(r);
+        errno = ENOMEM;
+        return -1;
+    }
+    return 0;
+}
+
+void iov_msg_reader_destroy(iov_msg_reader_t *r) {
+    free(r->lens);
+    free(r->iov);
+    r->lens = NULL;
+    r->iov = NULL;
+}
+
+// Прочитать ровно len байт; обрыв потока — EPROTO.
+static int read_full(iov_msg_reader_t *r, void *buf, size_t len) {
+    char *p = buf;
+    while (len > 0) {
+        ssize_t n = read(r->fd, p, len);
+        r->stats.syscalls++;
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        if (n == 0) {
+            errno = EPROTO;
+            return -1;
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+int iov_msg_reader_next(iov_msg_reader_t *r) {
+    const iov_msg_schema_t *s = r->schema;
+
+    // count обычно уже пришёл хвостом readv прошлой пачки.
+    while (r->next_have < sizeof(r->next_count)) {
+        ssize_t n = read(r->fd, (char *)&r->next_count + r->next_have, sizeof(r->next_count) - r->next_have);
+        r->stats.syscalls++;
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        if (n == 0) {
+            if (r->next_have == 0) return 0;
+            errno = EPROTO;
+            return -1;
+        }
+        r->next_have += (size_t)n;
+    }
+    uint32_t count = r->next_count;
+    r->next_have = 0;
+    if (count == 0 || count > (uint32_t)r->nslots) {
+        errno = EPROTO;
+        return -1;
+    }
+
+    size_t nlens = (size_t)count * (size_t)s->nvar;
+    if (nlens && read_full(r, r->lens, nlens * sizeof(*r->lens)) == -1) return -1;
+
+    // Разложить пачку по слотам: длины — в поля длин, данные — readv.
+    int niov = 0;
+    size_t total = 0;
+    for (uint32_t m = 0; m < count; ++m) {
+        char *slot = r->slots + (size_t)m * r->slot_size;
+        const uint32_t *lens = r->lens + (size_t)m * (size_t)s->nvar;
+        for (int v = 0; v < s->nvar; ++v) {
+            if (lens[v] > s->var_cap[v]) {
+                errno = EPROTO;
+                return -1;
+            }
+            memcpy(slot + s->var_len_off[v], &lens[v], sizeof(lens[v]));
+        }
+        for (int i = 0; i < s->nruns; ++i) {
+            const iov_msg_run_t *run = &s->runs[i];
+            size_t len = run->var < 0 ? run->size : lens[run->var];
+            if (len == 0) continue;
+            r->iov[niov].iov_base = slot + run->offset;
+            r->iov[niov].iov_len = len;
+            niov++;
+            total += len;
+        }
+    }
+    // Заодно count следующей пачки, если он уже в сокете.
+    r->iov[niov].iov_base = &r->next_count;
+    r->iov[niov].iov_len = sizeof(r->next_count);
+    niov++;
+
+    struct iovec *iov = r->iov;
+    size_t got = 0;
+    while (got < total) {
+        ssize_t n = readv(r->fd, iov, niov < r->max_iov ? niov : r->max_iov);
+        r->stats.syscalls++;
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        if (n == 0) {
+            errno = EPROTO;
+            return -1;
+        }
+        got += (size_t)n;
+        iov_advance(&iov, &niov, (size_t)n);
+    }
+    r->next_have = got - total;
+    r->stats.messages += count;
+    r->stats.batches++;
+    return (int)count;
+}
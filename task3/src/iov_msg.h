@@ -0,0 +1,126 @@
+#ifndef IOV_MSG_H
+#define IOV_MSG_H
+
+/*
+ * Сообщения по схеме через writev/readv без сборки в один буфер.
+ *
+ * Схема один раз описывает поля структуры сообщения: поле фиксированного
+ * размера (IOV_MSG_FIXED) или массив байтов с длиной в отдельном поле
+ * uint32_t (IOV_MSG_BYTES). Писатель кладёт в iovec указатели прямо на
+ * поля структур вызывающего и отправляет пачку сообщений одним writev;
+ * соседние поля без выравнивающих дыр идут одним iovec. Куски не длиннее
+ * copy_max (по умолчанию IOV_MSG_COPY_MAX) дешевле скопировать, чем
+ * описывать отдельным iovec: они копируются в буфер писателя подряд и
+ * идут общим iovec. Пачка ограничена max_batch сообщениями и IOV_MAX
+ * элементами iovec.
+ *
+ * Формат пачки в потоке (порядок байтов — хоста, для локального IPC):
+ *   uint32 count                       сообщений в пачке
+ *   uint32 lens[count * nbytes]        длины всех BYTES-полей
+ *   сообщения: поля в порядке схемы, BYTES — ровно lens байт
+ * Оглавление с длинами впереди позволяет читателю за один readv разложить
+ * всю пачку по заранее выделенным слотам (массив структур того же типа):
+ * чтение оглавления, затем readv пачки вместе с count следующей — два
+ * системных вызова на пачку. Длина больше вместимости поля или count
+ * больше числа слотов — ошибка протокола (EPROTO).
+ *
+ * Сокет или pipe может быть блокирующим; частичные запись и чтение
+ * дочитываются/дописываются внутри.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+typedef enum { IOV_MSG_FIELD_FIXED, IOV_MSG_FIELD_BYTES } iov_msg_kind_t;
+
+typedef struct {
+    iov_msg_kind_t kind;
+    size_t offset;              // поле в структуре
+    size_t size;                // FIXED — размер; BYTES — вместимость массива
+    size_t len_offset;          // BYTES: uint32_t с фактической длиной
+} iov_msg_field_t;
+
+#define IOV_MSG_FIXED(type, member) \
+    {IOV_MSG_FIELD_FIXED, offsetof(type, member), sizeof(((type *)0)->member), 0}
+#define IOV_MSG_BYTES(type, member, len_member) \
+    {IOV_MSG_FIELD_BYTES, offsetof(type, member), sizeof(((type *)0)->member), offsetof(type, len_member)}
+
+// Отрезок структуры, уходящий одним iovec (после слияния соседних полей).
+typedef struct {
+    size_t offset;
+    size_t size;                // FIXED-отрезок; 0 — BYTES-поле
+    int var;                    // индекс BYTES-поля в lens сообщения
+} iov_msg_run_t;
+
+#define IOV_MSG_MAX_RUNS 16
+#define IOV_MSG_COPY_MAX 512    // куски до стольких байт копируются
+
+typedef struct {
+    iov_msg_run_t runs[IOV_MSG_MAX_RUNS];
+    size_t var_cap[IOV_MSG_MAX_RUNS];       // вместимость BYTES-полей
+    size_t var_len_off[IOV_MSG_MAX_RUNS];   // смещение их длин
+    int nruns;
+    int nvar;                   // BYTES-полей в сообщении
+} iov_msg_schema_t;
+
+// Поля в порядке передачи. -1 и EINVAL, если их больше IOV_MSG_MAX_RUNS.
+int iov_msg_schema_init(iov_msg_schema_t *s, const iov_msg_field_t *fields, int nfields);
+
+typedef struct {
+    uint64_t messages;
+    uint64_t batches;
+    uint64_t syscalls;          // writev/read/readv
+} iov_msg_stats_t;
+
+typedef struct {
+    const iov_msg_schema_t *schema;
+    int fd;
+    int max_batch;
+    int max_iov;
+    int count;                  // сообщений в текущей пачке
+    uint32_t header;            // count в потоке
+    uint32_t *lens;             // max_batch * nvar
+    struct iovec *iov;
+    int niov;
+    size_t bytes;               // байт в текущей пачке
+    size_t copy_max;            // 0 — ничего не копировать
+    char *stage;                // скопированные куски пачки
+    size_t stage_used;
+    iov_msg_stats_t stats;
+} iov_msg_writer_t;
+
+int iov_msg_writer_init(iov_msg_writer_t *w, const iov_msg_schema_t *s, int fd, int max_batch);
+void iov_msg_writer_destroy(iov_msg_writer_t *w);
+// copy_max можно поменять между пачками (не больше IOV_MSG_COPY_MAX).
+// Добавить сообщение в пачку. Структура должна жить до iov_msg_writer_flush.
+// -1 и ENOBUFS — пачка полна (сначала flush), EMSGSIZE — длина BYTES-поля
+// больше его вместимости.
+int iov_msg_writer_add(iov_msg_writer_t *w, const void *msg);
+// Отправить пачку одним writev (дописывая хвост при частичной записи).
+int iov_msg_writer_flush(iov_msg_writer_t *w);
+
+typedef struct {
+    const iov_msg_schema_t *schema;
+    int fd;
+    char *slots;
+    size_t slot_size;
+    int nslots;
+    int max_iov;
+    uint32_t next_count;        // count следующей пачки, прочитанный заранее
+    size_t next_have;           // его байт уже прочитано (0..4)
+    uint32_t *lens;
+    struct iovec *iov;
+    iov_msg_stats_t stats;
+} iov_msg_reader_t;
+
+// slots — массив nslots структур по slot_size байт, в них читаются сообщения.
+int iov_msg_reader_init(iov_msg_reader_t *r, const iov_msg_schema_t *s, int fd, void *slots, size_t slot_size,
+                        int nslots);
+void iov_msg_reader_destroy(iov_msg_reader_t *r);
+// Прочитать следующую пачку в slots[0..n). Возвращает n, 0 в конце потока
+// (между пачками), -1 и errno (EPROTO — нарушен формат или обрыв внутри пачки).
+int iov_msg_reader_next(iov_msg_reader_t *r);
+
+#endif // IOV_MSG_H
@@ -0,0 +1,566 @@
+/*
+ * Сравнительный бенчмарк механизмов IPC
+ *
+ * Отвечает на вопрос из README «какой IPC быстрее» измерением, а не догадкой.
+ * Для каждого механизма, размера сообщения и варианта привязки к CPU
+ * запускаются два теста между родительским и дочерним процессом:
+ *  - pingpong: родитель шлёт сообщение, потомок отвечает сообщением того же
+ *              размера; измеряется время полного круга (RTT) каждой итерации;
+ *  - stream:   родитель шлёт поток сообщений, потомок принимает все и
+ *              подтверждает; измеряется пропускная способность.
+ *
+ * Механизмы: POSIX MQ, UNIX stream/seqpacket/dgram (socketpair), pipe,
+ * общая память с семафорами и общая память с futex. Во всех случаях данные
+ * попадают в пользовательский буфер получателя, поэтому варианты с общей
+ * памятью тоже копируют (memcpy в кольцо и из кольца).
+ *
+ * Результат — CSV в stdout; с -H файл дополнительно пишется гистограмма RTT.
+ *
+ * Запуск: ./bin/ipc_bench [-m mq,stream,...] [-s мин:макс] [-n итераций]
+ *                         [-p same|cross|both] [-H hist.csv]
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <mqueue.h>
+#include <sched.h>
+#include <semaphore.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include "futex.h"
+#include "lat_hist.h"
+
+#define SHM_SLOTS       8
+#define DATA_BUDGET     (256u << 20) // объём данных на один тест, байт
+#define MIN_ITERATIONS  50
+
+typedef enum { SIDE_PARENT = 0, SIDE_CHILD = 1 } side_t;
+
+// Кольцо в общей памяти для одного направления.
+typedef struct {
+    sem_t full;
+    sem_t empty;
+    _Atomic uint32_t head;      // для варианта с futex: опубликовано сообщений
+    _Atomic uint32_t tail;      // принято сообщений
+    _Atomic uint32_t waiters;
+    char data[];
+} shm_ring_t;
+
+typedef struct {
+    int fd[2][2];               // [направление][0 - чтение, 1 - запись] или сокеты
+    mqd_t mq[2];
+    shm_ring_t *ring[2];
+    size_t ring_bytes;
+    size_t size;
+} channel_t;
+
+typedef struct {
+    const char *name;
+    int (*open)(channel_t *ch, size_t size);
+    void (*attach)(channel_t *ch, side_t side);
+    int (*send)(channel_t *ch, side_t side, const void *buf, size_t len);
+    int (*recv)(channel_t *ch, side_t side, void *buf, size_t len);
+    void (*close)(channel_t *ch);
+} transport_t;
+
+// Направление 0: родитель -> потомок, 1: потомок -> родитель.
+static int tx_dir(side_t side) { return side == SIDE_PARENT ? 0 : 1; }
+static int rx_dir(side_t side) { return side == SIDE_PARENT ? 1 : 0; }
+
+static int write_full(int fd, const void *buf, size_t len) {
+    const char *p = buf;
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+static int read_full(int fd, void *buf, size_t len) {
+    char *p = buf;
+    while (len > 0) {
+        ssize_t n = read(fd, p, len);
+        if (n <= 0) {
+            if (n < 0 && errno == EINTR) continue;
+            return -1;
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+// --- pipe ---
+
+static int pipe_open(channel_t *ch, size_t size) {
+    for (int d = 0; d < 2; ++d) {
+        if (pipe(ch->fd[d]) == -1) return -1;
+        // Пытаемся вместить сообщение целиком; без прав root ядро ограничит размер.
+        fcntl(ch->fd[d][1], F_SETPIPE_SZ, (int)(size < 4096 ? 4096 : size));
+    }
+    return 0;
+}
+
+static void pipe_attach(channel_t *ch, side_t side) {
+    close(ch->fd[tx_dir(side)][0]);
+    close(ch->fd[rx_dir(side)][1]);
+}
+
+static int pipe_send(channel_t *ch, side_t side, const void *buf, size_t len) {
+    return write_full(ch->fd[tx_dir(side)][1], buf, len);
+}
+
+static int pipe_recv(channel_t *ch, side_t side, void *buf, size_t len) {
+    return read_full(ch->fd[rx_dir(side)][0], buf, len);
+}
+
+static void pipe_close(channel_t *ch) {
+    close(ch->fd[0][1]);
+    close(ch->fd[1][0]);
+}
+
+// --- UNIX-сокеты (socketpair) ---
+
+static int sock_open_type(channel_t *ch, size_t size, int type) {
+    if (socketpair(AF_UNIX, type, 0, ch->fd[0]) == -1) return -1;
+    if (type != SOCK_STREAM) {
+        // Датаграмма должна целиком помещаться в буфер отправки.
+        int buf = (int)(2 * size + 65536);
+        for (int i = 0; i < 2; ++i) {
+            if (setsockopt(ch->fd[0][i], SOL_SOCKET, SO_SNDBUFFORCE, &buf, sizeof(buf)) == -1) {
+                setsockopt(ch->fd[0][i], SOL_SOCKET, SO_SNDBUF, &buf, sizeof(buf));
+            }
+            if (setsockopt(ch->fd[0][i], SOL_SOCKET, SO_RCVBUFFORCE, &buf, sizeof(buf)) == -1) {
+                setsockopt(ch->fd[0][i], SOL_SOCKET, SO_RCVBUF, &buf, sizeof(buf));
+            }
+        }
+    }
+    return 0;
+}
+
+static int stream_open(channel_t *ch, size_t size) { return sock_open_type(ch, size, SOCK_STREAM); }
+static int seqpacket_open(channel_t *ch, size_t size) { return sock_open_type(ch, size, SOCK_SEQPACKET); }
+static int dgram_open(channel_t *ch, size_t size) { return sock_open_type(ch, size, SOCK_DGRAM); }
+
+static void sock_attach(channel_t *ch, side_t side) {
+    close(ch->fd[0][side == SIDE_PARENT ? 1 : 0]);
+}
+
+static int sock_fd(channel_t *ch, side_t side) {
+    return ch->fd[0][side == SIDE_PARENT ? 0 : 1];
+}
+
+static int stream_send(channel_t *ch, side_t side, const void *buf, size_t len) {
+    return write_full(sock_fd(ch, side), buf, len);
+}
+
+static int stream_recv(channel_t *ch, side_t side, void *buf, size_t len) {
+    return read_full(sock_fd(ch, side), buf, len);
+}
+
+static int packet_send(channel_t *ch, side_t side, const void *buf, size_t len) {
+    ssize_t n;
+    do {
+        n = send(sock_fd(ch, side), buf, len, 0);
+    } while (n < 0 && errno == EINTR);
+    return n == (ssize_t)len ? 0 : -1;
+}
+
+static int packet_recv(channel_t *ch, side_t side, void *buf, size_t len) {
+    ssize_t n;
+    do {
+        n = recv(sock_fd(ch, side), buf, len, 0);
+    } while (n < 0 && errno == EINTR);
+    return n == (ssize_t)len ? 0 : -1;
+}
+
+static void sock_close(channel_t *ch) {
+    close(ch->fd[0][0]);
+}
+
+// --- POSIX MQ ---
+
+static int mq_open_pair(channel_t *ch, size_t size) {
+    struct mq_attr attr = {.mq_maxmsg = 10, .mq_msgsize = (long)size};
+    for (int d = 0; d < 2; ++d) {
+        char name[64];
+        snprintf(name, sizeof(name), "/ipc_bench_%d_%d", (int)getpid(), d);
+        ch->mq[d] = mq_open(name, O_CREAT | O_EXCL | O_RDWR, 0600, &attr);
+        if (ch->mq[d] == (mqd_t)-1) {
+            if (d == 1) mq_close(ch->mq[0]);
+            return -1;
+        }
+        // Дескрипторы наследуются потомком, имя больше не нужно.
+        mq_unlink(name);
+    }
+    return 0;
+}
+
+static void mq_attach(channel_t *ch, side_t side) {
+    (void)ch;
+    (void)side;
+}
+
+static int mq_send_msg(channel_t *ch, side_t side, const void *buf, size_t len) {
+    while (mq_send(ch->mq[tx_dir(side)], buf, len, 0) == -1) {
+        if (errno != EINTR) return -1;
+    }
+    return 0;
+}
+
+static int mq_recv_msg(channel_t *ch, side_t side, void *buf, size_t len) {
+    ssize_t n;
+    while ((n = mq_receive(ch->mq[rx_dir(side)], buf, len, NULL)) == -1) {
+        if (errno != EINTR) return -1;
+    }
+    return n == (ssize_t)len ? 0 : -1;
+}
+
+static void mq_close_pair(channel_t *ch) {
+    mq_close(ch->mq[0]);
+    mq_close(ch->mq[1]);
+}
+
+// --- Общая память: кольцо на SHM_SLOTS сообщений в каждую сторону ---
+
+static int shm_open_rings(channel_t *ch, size_t size) {
+    ch->ring_bytes = sizeof(shm_ring_t) + SHM_SLOTS * size;
+    for (int d = 0; d < 2; ++d) {
+        ch->ring[d] = mmap(NULL, ch->ring_bytes, PROT_READ | PROT_WRITE,
+                           MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        if (ch->ring[d] == MAP_FAILED) return -1;
+        sem_init(&ch->ring[d]->full, 1, 0);
+        sem_init(&ch->ring[d]->empty, 1, SHM_SLOTS);
+    }
+    return 0;
+}
+
+static void shm_attach(channel_t *ch, side_t side) {
+    (void)ch;
+    (void)side;
+}
+
+static void sem_wait_intr(sem_t *sem) {
+    while (sem_wait(sem) == -1 && errno == EINTR) {}
+}
+
+static int shm_sem_send(channel_t *ch, side_t side, const void *buf, size_t len) {
+    shm_ring_t *r = ch->ring[tx_dir(side)];
+    sem_wait_intr(&r->empty);
+    uint32_t slot = atomic_load_explicit(&r->head, memory_order_relaxed);
+    memcpy(r->data + (slot % SHM_SLOTS) * ch->size, buf, len);
+    atomic_store_explicit(&r->head, slot + 1, memory_order_relaxed);
+    sem_post(&r->full);
+    return 0;
+}
+
+static int shm_sem_recv(channel_t *ch, side_t side, void *buf, size_t len) {
+    shm_ring_t *r = ch->ring[rx_dir(side)];
+    sem_wait_intr(&r->full);
+    uint32_t slot = atomic_load_explicit(&r->tail, memory_order_relaxed);
+    memcpy(buf, r->data + (slot % SHM_SLOTS) * ch->size, len);
+    atomic_store_explicit(&r->tail, slot + 1, memory_order_relaxed);
+    sem_post(&r->empty);
+    return 0;
+}
+
+// Вариант с futex: head/tail сами служат futex-словами, FUTEX_WAKE
+// вызывается только если другая сторона отметилась в waiters.
+static void ring_wait_change(shm_ring_t *r, _Atomic uint32_t *word, uint32_t seen) {
+    atomic_fetch_add(&r->waiters, 1);
+    if (atomic_load(word) == seen) futex_wait(word, seen, NULL);
+    atomic_fetch_sub(&r->waiters, 1);
+}
+
+static void ring_notify(shm_ring_t *r, _Atomic uint32_t *word) {
+    if (atomic_load(&r->waiters) > 0) futex_wake(word, 1);
+}
+
+static int shm_futex_send(channel_t *ch, side_t side, const void *buf, size_t len) {
+    shm_ring_t *r = ch->ring[tx_dir(side)];
+    uint32_t head = atomic_load_explicit(&r->head, memory_order_relaxed);
+    uint32_t tail;
+    while (head - (tail = atomic_load(&r->tail)) >= SHM_SLOTS) {
+        ring_wait_change(r, &r->tail, tail);
+    }
+    memcpy(r->data + (head % SHM_SLOTS) * ch->size, buf, len);
+    atomic_store(&r->head, head + 1);
+    ring_notify(r, &r->head);
+    return 0;
+}
+
+static int shm_futex_recv(channel_t *ch, side_t side, void *buf, size_t len) {
+    shm_ring_t *r = ch->ring[rx_dir(side)];
+    uint32_t tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+    uint32_t head;
+    while ((head = atomic_load(&r->head)) == tail) {
+        ring_wait_change(r, &r->head, head);
+    }
+    memcpy(buf, r->data + (tail % SHM_SLOTS) * ch->size, len);
+    atomic_store(&r->tail, tail + 1);
+    ring_notify(r, &r->tail);
+    return 0;
+}
+
+static void shm_close_rings(channel_t *ch) {
+    for (int d = 0; d < 2; ++d) {
+        sem_destroy(&ch->ring[d]->full);
+        sem_destroy(&ch->ring[d]->empty);
+        munmap(ch->ring[d], ch->ring_bytes);
+    }
+}
+
+static const transport_t transports[] = {
+    {"mq",        mq_open_pair,   mq_attach,   mq_send_msg,    mq_recv_msg,    mq_close_pair},
+    {"stream",    stream_open,    sock_attach, stream_send,    stream_recv,    sock_close},
+    {"seqpacket", seqpacket_open, sock_attach, packet_send,    packet_recv,    sock_close},
+    {"dgram",     dgram_open,     sock_attach, packet_send,    packet_recv,    sock_close},
+    {"pipe",      pipe_open,      pipe_attach, pipe_send,      pipe_recv,      pipe_close},
+    {"shm_sem",   shm_open_rings, shm_attach,  shm_sem_send,   shm_sem_recv,   shm_close_rings},
+    {"shm_futex", shm_open_rings, shm_attach,  shm_futex_send, shm_futex_recv, shm_close_rings},
+};
+#define NUM_TRANSPORTS (sizeof(transports) / sizeof(transports[0]))
+
+// --- Запуск тестов ---
+
+typedef enum { TEST_PINGPONG, TEST_STREAM } test_kind_t;
+
+static const char *test_names[] = {"pingpong", "stream"};
+
+static inline uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void pin_to_cpu(int cpu) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    if (sched_setaffinity(0, sizeof(set), &set) == -1) {
+        perror("WARNING: sched_setaffinity");
+    }
+}
+
+// Сторона потомка: эхо для pingpong, приём потока и одно подтверждение для stream.
+static void run_child(const transport_t *t, channel_t *ch, test_kind_t kind,
+                      uint64_t total, int cpu) {
+    pin_to_cpu(cpu);
+    t->attach(ch, SIDE_CHILD);
+    char *buf = malloc(ch->size);
+    if (!buf) _exit(1);
+    memset(buf, 0, ch->size);
+    for (uint64_t i = 0; i < total; ++i) {
+        if (t->recv(ch, SIDE_CHILD, buf, ch->size) == -1) _exit(1);
+        if (kind == TEST_PINGPONG && t->send(ch, SIDE_CHILD, buf, ch->size) == -1) _exit(1);
+    }
+    if (kind == TEST_STREAM && t->send(ch, SIDE_CHILD, buf, ch->size) == -1) _exit(1);
+    _exit(0);
+}
+
+typedef struct {
+    uint64_t iterations;
+    uint64_t elapsed_ns;
+    lat_hist_t hist;
+} result_t;
+
+static int run_test(const transport_t *t, size_t size, test_kind_t kind, uint64_t iterations,
+                    int parent_cpu, int child_cpu, result_t *res) {
+    channel_t ch;
+    memset(&ch, 0, sizeof(ch));
+    ch.size = size;
+    if (t->open(&ch, size) == -1) return -1;
+
+    uint64_t warmup = iterations / 10;
+    pid_t pid = fork();
+    if (pid == -1) {
+        t->close(&ch);
+        return -1;
+    }
+    if (pid == 0) run_child(t, &ch, kind, warmup + iterations, child_cpu);
+
+    pin_to_cpu(parent_cpu);
+    t->attach(&ch, SIDE_PARENT);
+    char *buf = malloc(size);
+    int rc = buf ? 0 : -1;
+    if (buf) memset(buf, 0xa5, size);
+
+    lat_hist_init(&res->hist);
+    res->iterations = iterations;
+    uint64_t start = 0;
+    for (uint64_t i = 0; rc == 0 && i < warmup + iterations; ++i) {
+        if (i == warmup) start = now_ns();
+        if (kind == TEST_PINGPONG) {
+            uint64_t t0 = now_ns();
+            if (t->send(&ch, SIDE_PARENT, buf, size) == -1 ||
+                t->recv(&ch, SIDE_PARENT, buf, size) == -1) {
+                rc = -1;
+                break;
+            }
+            if (i >= warmup) lat_hist_record(&res->hist, now_ns() - t0);
+        } else if (t->send(&ch, SIDE_PARENT, buf, size) == -1) {
+            rc = -1;
+        }
+    }
+    if (rc == 0 && kind == TEST_STREAM && t->recv(&ch, SIDE_PARENT, buf, size) == -1) rc = -1;
+    res->elapsed_ns = now_ns() - start;
+
+    int saved = errno;
+    if (rc == -1) kill(pid, SIGKILL);
+    int status;
+    waitpid(pid, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) rc = -1;
+    t->close(&ch);
+    free(buf);
+    errno = saved;
+    return rc;
+}
+
+static void print_result(const char *mech, const char *pin, size_t size, test_kind_t kind,
+                         const result_t *r) {
+    double sec = (double)r->elapsed_ns / 1e9;
+    double rate = (double)r->iterations / sec;
+    double gbps = (double)r->iterations * (double)size / sec / 1e9;
+    if (kind == TEST_PINGPONG) {
+        const lat_hist_t *h = &r->hist;
+        printf("%s,%s,%zu,%s,%llu,%llu,%llu,%llu,%llu,%llu,%.0f,%.0f,%.3f\n",
+               mech, pin, size, test_names[kind], (unsigned long long)r->iterations,
+               (unsigned long long)h->min,
+               (unsigned long long)lat_hist_percentile(h, 50),
+               (unsigned long long)lat_hist_percentile(h, 99),
+               (unsigned long long)lat_hist_percentile(h, 99.9),
+               (unsigned long long)h->max, lat_hist_mean(h), rate, gbps);
+    } else {
+        printf("%s,%s,%zu,%s,%llu,,,,,,,%.0f,%.3f\n", mech, pin, size, test_names[kind],
+               (unsigned long long)r->iterations, rate, gbps);
+    }
+}
+
+static int selected(const char *list, const char *name) {
+    if (!list) return 1;
+    size_t len = strlen(name);
+    for (const char *p = list; (p = strstr(p, name)) != NULL; p += len) {
+        if ((p == list || p[-1] == ',') && (p[len] == '\0' || p[len] == ',')) return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    const char *mechs = NULL;
+    const char *pinning = "both";
+    const char *hist_path = NULL;
+    size_t min_size = 8, max_size = 1u << 20;
+    uint64_t max_iterations = 20000;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "m:s:n:p:H:")) != -1) {
+        switch (opt) {
+        case 'm': mechs = optarg; break;
+        case 's':
+            min_size = strtoull(optarg, NULL, 0);
+            if (strchr(optarg, ':')) max_size = strtoull(strchr(optarg, ':') + 1, NULL, 0);
+            else max_size = min_size;
+            break;
+        case 'n': max_iterations = strtoull(optarg, NULL, 0); break;
+        case 'p': pinning = optarg; break;
+        case 'H': hist_path = optarg; break;
+        default:
+            fprintf(stderr, "usage: %s [-m mech,...] [-s min[:max]] [-n iterations] "
+                            "[-p same|cross|both] [-H hist.csv]\n", argv[0]);
+            fprintf(stderr, "mechanisms: mq stream seqpacket dgram pipe shm_sem shm_futex\n");
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (min_size < 1) min_size = 1;
+
+    FILE *hist_out = NULL;
+    if (hist_path) {
+        hist_out = fopen(hist_path, "w");
+        if (!hist_out) {
+            perror("fopen");
+            return EXIT_FAILURE;
+        }
+        fprintf(hist_out, "mechanism,pinning,size,lo_ns,hi_ns,count\n");
+    }
+
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int do_same = strcmp(pinning, "cross") != 0;
+    int do_cross = strcmp(pinning, "same") != 0;
+    if (do_cross && cpus < 2) {
+        fprintf(stderr, "ipc_bench: only one CPU online, skipping cross-core runs\n");
+        do_cross = 0;
+    }
+
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    printf("mechanism,pinning,size,test,iterations,min_ns,p50_ns,p99_ns,p999_ns,max_ns,"
+           "mean_ns,msgs_per_s,gbps\n");
+
+    int failures = 0;
+    result_t *res = malloc(sizeof(*res));
+    if (!res) return EXIT_FAILURE;
+
+    for (size_t ti = 0; ti < NUM_TRANSPORTS; ++ti) {
+        const transport_t *t = &transports[ti];
+        if (!selected(mechs, t->name)) continue;
+        for (int pin = 0; pin < 2; ++pin) {
+            if ((pin == 0 && !do_same) || (pin == 1 && !do_cross)) continue;
+            const char *pin_name = pin == 0 ? "same" : "cross";
+            int child_cpu = pin == 0 ? 0 : 1;
+
+            // Шаг x4, последним всегда идёт max_size (по умолчанию 1 MiB).
+            for (size_t size = min_size; size <= max_size;
+                 size = (size < max_size && size * 4 > max_size) ? max_size : size * 4) {
+                uint64_t iters = DATA_BUDGET / size;
+                if (iters > max_iterations) iters = max_iterations;
+                if (iters < MIN_ITERATIONS) iters = MIN_ITERATIONS;
+
+                for (int k = TEST_PINGPONG; k <= TEST_STREAM; ++k) {
+                    if (run_test(t, size, (test_kind_t)k, iters, 0, child_cpu, res) == -1) {
+                        // Лимиты механизма (mq_msgsize, размер датаграммы) — не ошибка бенчмарка.
+                        fprintf(stderr, "ipc_bench: %s %s size=%zu skipped: %s\n",
+                                t->name, test_names[k], size, strerror(errno));
+                        if (errno != EMSGSIZE && errno != EINVAL && errno != ENOBUFS) failures++;
+                        break;
+                    }
+                    print_result(t->name, pin_name, size, (test_kind_t)k, res);
+                    if (hist_out && k == TEST_PINGPONG) {
+                        char prefix[64];
+                        snprintf(prefix, sizeof(prefix), "%s,%s,%zu", t->name, pin_name, size);
+                        lat_hist_write_csv(&res->hist, hist_out, prefix);
+                    }
+                }
+            }
+        }
+    }
+
+    free(res);
+    if (hist_out) fclose(hist_out);
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+/*
+ * Как читать результаты:
+ * - pingpong: RTT включает два пробуждения процесса; при pinning=same оба
+ *   процесса делят одно ядро и каждый обмен — переключение контекста,
+ *   при cross — межъядерное пробуждение (IPI) и перенос кэш-линий.
+ * - stream: механизмы с буферизацией в ядре (pipe, stream) выигрывают на
+ *   больших сообщениях за счёт конвейера; MQ ограничена mq_msgsize
+ *   (/proc/sys/fs/mqueue/msgsize_max), датаграммы — размером буфера сокета.
+ * - shm_futex обычно даёт минимальную задержку: в быстром пути нет
+ *   системных вызовов, futex нужен только для сна.
+ */
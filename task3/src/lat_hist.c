@@ -0,0 +1,149 @@
+/*
+ * Логарифмически-линейная гистограмма задержек (см. lat_hist.h)
+ *
+ * Индекс корзины для v >= 2H (H = half = 2^(sub_bits-1)): пусть shift —
+ * сколько младших бит отбрасывается, чтобы мантисса m = v >> shift попала
+ * в [H, 2H). Тогда index = H * shift + m. Для v < 2H index = v. Всего
+ * корзин H * (66 - sub_bits).
+ *
+ * Среднее и дисперсия — по Уэлфорду: на каждое значение сдвигается
+ * среднее и копится m2 = сумма (x - mean)^2, без вычитания больших
+ * близких чисел, как в sum(x^2) - n * mean^2. Слияние — формула Чана для
+ * объединения двух выборок.
+ */
+#include "lat_hist.h"
+
+#include <errno.h>
+#include <math.h>
+#include <string.h>
+
+static unsigned bucket_count(const lat_hist_t *h) {
+    return h->half * (66u - h->sub_bits);
+}
+
+static unsigned bucket_index(const lat_hist_t *h, uint64_t v) {
+    if (v < 2 * h->half) return (unsigned)v;
+    unsigned msb = 63u - (unsigned)__builtin_clzll(v);
+    unsigned shift = msb - h->sub_bits + 1;
+    return h->half * shift + (unsigned)(v >> shift);
+}
+
+static void bucket_bounds(const lat_hist_t *h, unsigned idx, uint64_t *lo, uint64_t *hi) {
+    if (idx < 2 * h->half) {
+        *lo = *hi = idx;
+        return;
+    }
+    unsigned shift = idx / h->half - 1;
+    uint64_t m = idx - (uint64_t)h->half * shift;
+    *lo = m << shift;
+    *hi = ((m + 1) << shift) - 1;
+}
+
+void lat_hist_init(lat_hist_t *h) {
+    lat_hist_init_precision(h, LAT_HIST_SUB_BITS);
+}
+
+int lat_hist_init_precision(lat_hist_t *h, unsigned sub_bits) {
+    if (sub_bits < 1 || sub_bits > LAT_HIST_MAX_SUB_BITS) {
+        errno = EINVAL;
+        return -1;
+    }
+    memset(h, 0, sizeof(*h));
+    h->sub_bits = sub_bits;
+    h->half = 1u << (sub_bits - 1);
+    h->min = UINT64_MAX;
+    return 0;
+}
+
+void lat_hist_record(lat_hist_t *h, uint64_t value) {
+    h->counts[bucket_index(h, value)]++;
+    h->total++;
+    double d = (double)value - h->mean;
+    h->mean += d / (double)h->total;
+    h->m2 += d * ((double)value - h->mean);
+    if (value < h->min) h->min = value;
+    if (value > h->max) h->max = value;
+}
+
+void lat_hist_merge(lat_hist_t *dst, const lat_hist_t *src) {
+    if (src->total == 0) return;
+    unsigned n = bucket_count(src);
+    if (src->sub_bits == dst->sub_bits) {
+        for (unsigned i = 0; i < n; ++i) {
+            dst->counts[i] += src->counts[i];
+        }
+    } else {
+        for (unsigned i = 0; i < n; ++i) {
+            if (!src->counts[i]) continue;
+            uint64_t lo, hi;
+            bucket_bounds(src, i, &lo, &hi);
+            dst->counts[bucket_index(dst, lo)] += src->counts[i];
+        }
+    }
+    double na = (double)dst->total, nb = (double)src->total;
+    double d = src->mean - dst->mean;
+    dst->total += src->total;
+    dst->mean += d * nb / (double)dst->total;
+    dst->m2 += src->m2 + d * d * na * nb / (double)dst->total;
+    if (src->min < dst->min) dst->min = src->min;
+    if (src->max > dst->max) dst->max = src->max;
+}
+
+uint64_t lat_hist_percentile(const lat_hist_t *h, double p) {
+    if (h->total == 0) return 0;
+    uint64_t rank = (uint64_t)(p / 100.0 * (double)h->total + 0.5);
+    if (rank < 1) rank = 1;
+    if (rank > h->total) rank = h->total;
+
+    uint64_t seen = 0;
+    unsigned n = bucket_count(h);
+    for (unsigned i = 0; i < n; ++i) {
+        seen += h->counts[i];
+        if (seen >= rank) {
+            uint64_t lo, hi;
+            bucket_bounds(h, i, &lo, &hi);
+            return hi < h->max ? hi : h->max;
+        }
+    }
+    return h->max;
+}
+
+double lat_hist_mean(const lat_hist_t *h) {
+    return h->mean;
+}
+
+double lat_hist_stddev(const lat_hist_t *h) {
+    return h->total ? sqrt(h->m2 / (double)h->total) : 0.0;
+}
+
+void lat_hist_write_csv(const lat_hist_t *h, FILE *out, const char *prefix) {
+    unsigned n = bucket_count(h);
+    for (unsigned i = 0; i < n; ++i) {
+        if (!h->counts[i]) continue;
+        uint64_t lo, hi;
+        bucket_bounds(h, i, &lo, &hi);
+        fprintf(out, "%s,%llu,%llu,%llu\n", prefix, (unsigned long long)lo,
+                (unsigned long long)hi, (unsigned long long)h->counts[i]);
+    }
+}
+
+void lat_hist_write_json(const lat_hist_t *h, FILE *out, const char *name) {
+    fprintf(out, "{\"name\":\"%s\",\"sub_bits\":%u,\"count\":%llu,\"min\":%llu,\"max\":%llu,"
+                 "\"mean\":%.1f,\"stddev\":%.1f,\"p50\":%llu,\"p90\":%llu,\"p99\":%llu,\"p99_9\":%llu,"
+                 "\"buckets\":[",
+            name, h->sub_bits, (unsigned long long)h->total, (unsigned long long)(h->total ? h->min : 0),
+            (unsigned long long)h->max, lat_hist_mean(h), lat_hist_stddev(h),
+            (unsigned long long)lat_hist_percentile(h, 50), (unsigned long long)lat_hist_percentile(h, 90),
+            (unsigned long long)lat_hist_percentile(h, 99), (unsigned long long)lat_hist_percentile(h, 99.9));
+    unsigned n = bucket_count(h);
+    const char *sep = "";
+    for (unsigned i = 0; i < n; ++i) {
+        if (!h->counts[i]) continue;
+        uint64_t lo, hi;
+        bucket_bounds(h, i, &lo, &hi);
+        fprintf(out, "%s[%llu,%llu,%llu]", sep, (unsigned long long)lo, (unsigned long long)hi,
+                (unsigned long long)h->counts[i]);
+        sep = ",";
+    }
+    fprintf(out, "]}\n");
+}
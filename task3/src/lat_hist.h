@@ -0,0 +1,56 @@
+#ifndef LAT_HIST_H
+#define LAT_HIST_H
+
+/*
+ * Гистограмма задержек с логарифмически-линейными корзинами (в духе HDR).
+ *
+ * Значения меньше 2^sub_bits хранятся точно, дальше каждая октава делится
+ * на 2^(sub_bits-1) корзин: относительная погрешность перцентилей не
+ * больше 2^(1-sub_bits) (~3% при sub_bits = 6 по умолчанию, ~1.6% при 7).
+ * Точность задаётся при инициализации, массив корзин рассчитан на
+ * LAT_HIST_MAX_SUB_BITS. Память фиксирована и не зависит от числа
+ * значений и длительности прогона, указателей внутри нет — гистограмму
+ * можно держать в общей памяти. Запись — O(1); среднее и дисперсия
+ * считаются на лету (Уэлфорд), без хранения выборки. Гистограммы разных
+ * потоков и процессов можно складывать.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+
+#define LAT_HIST_SUB_BITS       6   // точность lat_hist_init
+#define LAT_HIST_MAX_SUB_BITS   7
+#define LAT_HIST_BUCKETS        ((1u << (LAT_HIST_MAX_SUB_BITS - 1)) * (66 - LAT_HIST_MAX_SUB_BITS))
+
+typedef struct {
+    uint64_t counts[LAT_HIST_BUCKETS];
+    unsigned sub_bits;
+    unsigned half;              // 2^(sub_bits-1) корзин на октаву
+    uint64_t total;
+    uint64_t min;
+    uint64_t max;
+    double mean;                // Уэлфорд: среднее
+    double m2;                  // и сумма квадратов отклонений от него
+} lat_hist_t;
+
+void lat_hist_init(lat_hist_t *h);
+// sub_bits от 1 до LAT_HIST_MAX_SUB_BITS; -1 и EINVAL вне диапазона.
+int lat_hist_init_precision(lat_hist_t *h, unsigned sub_bits);
+void lat_hist_record(lat_hist_t *h, uint64_t value);
+// Точность dst сохраняется; корзины src другой точности переносятся по
+// нижней границе.
+void lat_hist_merge(lat_hist_t *dst, const lat_hist_t *src);
+
+// Значение p-го перцентиля (0..100): верхняя граница соответствующей корзины.
+uint64_t lat_hist_percentile(const lat_hist_t *h, double p);
+double lat_hist_mean(const lat_hist_t *h);
+// Стандартное отклонение по генеральной совокупности (делитель n).
+double lat_hist_stddev(const lat_hist_t *h);
+
+// Строки "prefix,lo,hi,count" для всех непустых корзин.
+void lat_hist_write_csv(const lat_hist_t *h, FILE *out, const char *prefix);
+// Один JSON-объект: name, сводка (count, min, max, mean, stddev, p50, p90,
+// p99, p99.9) и непустые корзины [lo, hi, count]. name не экранируется.
+void lat_hist_write_json(const lat_hist_t *h, FILE *out, const char *name);
+
+#endif // LAT_HIST_H
@@ -0,0 +1,211 @@
+/*
+ * Точность и цена записи lat_hist.h при разной точности корзин
+ *
+ * -n значений с широким разбросом (от единиц наносекунд до секунд,
+ * логарифмически равномерно) записываются в гистограмму с sub_bits от 1
+ * до LAT_HIST_MAX_SUB_BITS. Для каждой точности сверяется с точным
+ * ответом по отсортированной копии:
+ *  - p50/p90/p99/p99.9 не меньше точного значения и больше него не
+ *    более чем в 1 + 2^(1-sub_bits) раз;
+ *  - min, max и число значений совпадают, среднее и стандартное
+ *    отклонение (Уэлфорд) — с двухпроходным расчётом;
+ *  - сумма четырёх гистограмм по четвертям данных (как у четырёх
+ *    потоков) совпадает с гистограммой всех данных, а гистограмма точности
+ *    LAT_HIST_MAX_SUB_BITS, слитая в гистограмму меньшей точности, — с
+ *    записанной сразу в меньшей точности.
+ *
+ * Печатает размер гистограммы, нс на запись и наибольшую ошибку
+ * перцентилей; для сравнения — нс на значение у qsort всей выборки.
+ * -j файл — JSON гистограммы точности по умолчанию. Код возврата
+ * ненулевой, если сверка не прошла.
+ *
+ * Запуск: ./bin/lat_hist_bench [-n значений] [-j файл.json]
+ */
+#define _GNU_SOURCE
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "lat_hist.h"
+
+#define NUM_PARTS 4
+
+static const double check_p[] = {50, 90, 99, 99.9};
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static uint64_t xorshift64(uint64_t *s) {
+    uint64_t x = *s;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    return *s = x;
+}
+
+static int compare_u64(const void *a, const void *b) {
+    uint64_t va = *(const uint64_t *)a;
+    uint64_t vb = *(const uint64_t *)b;
+    return va < vb ? -1 : va > vb;
+}
+
+// Тот же ранг, что в lat_hist_percentile, но по отсортированной выборке.
+static uint64_t exact_percentile(const uint64_t *sorted, size_t n, double p) {
+    uint64_t rank = (uint64_t)(p / 100.0 * (double)n + 0.5);
+    if (rank < 1) rank = 1;
+    if (rank > n) rank = n;
+    return sorted[rank - 1];
+}
+
+static int close_enough(double a, double b) {
+    return fabs(a - b) <= 1e-9 * fmax(fabs(a), fabs(b)) + 1e-6;
+}
+
+static int same_hist(const lat_hist_t *a, const lat_hist_t *b) {
+    return a->total == b->total && a->min == b->min && a->max == b->max &&
+           memcmp(a->counts, b->counts, sizeof(a->counts)) == 0 && close_enough(a->mean, b->mean) &&
+           close_enough(lat_hist_stddev(a), lat_hist_stddev(b));
+}
+
+// Проверки одной точности; печатает строку таблицы. 0 — всё сошлось.
+static int check_precision(unsigned sub_bits, const uint64_t *values, const uint64_t *sorted, size_t n, double mean,
+                           double stddev, const lat_hist_t *finest, lat_hist_t *whole, lat_hist_t *part) {
+    int errors = 0;
+    lat_hist_init_precision(whole, sub_bits);
+    uint64_t t0 = now_ns();
+    for (size_t i = 0; i < n; ++i) lat_hist_record(whole, values[i]);
+    double ns_per_record = (double)(now_ns() - t0) / (double)n;
+
+    double bound = 1.0 / (double)(1u << (sub_bits - 1));
+    double max_err = 0;
+    for (size_t i = 0; i < sizeof(check_p) / sizeof(check_p[0]); ++i) {
+        uint64_t exact = exact_percentile(sorted, n, check_p[i]);
+        uint64_t got = lat_hist_percentile(whole, check_p[i]);
+        double err = exact ? (double)(got - exact) / (double)exact : (double)got;
+        if (got < exact || err > bound) {
+            fprintf(stderr, "sub_bits %u: p%g = %llu, exact %llu\n", sub_bits, check_p[i], (unsigned long long)got,
+                    (unsigned long long)exact);
+            errors++;
+        }
+        if (err > max_err) max_err = err;
+    }
+    if (whole->total != n || whole->min != sorted[0] || whole->max != sorted[n - 1] ||
+        !close_enough(lat_hist_mean(whole), mean) || !close_enough(lat_hist_stddev(whole), stddev)) {
+        fprintf(stderr, "sub_bits %u: count/min/max/mean/stddev %llu/%llu/%llu/%.3f/%.3f, exact %zu/%llu/%llu/%.3f/%.3f\n",
+                sub_bits, (unsigned long long)whole->total, (unsigned long long)whole->min,
+                (unsigned long long)whole->max, lat_hist_mean(whole), lat_hist_stddev(whole), n,
+                (unsigned long long)sorted[0], (unsigned long long)sorted[n - 1], mean, stddev);
+        errors++;
+    }
+
+    // Четыре «потока» по четверти данных, сложенные в одну гистограмму.
+    lat_hist_t merged;
+    lat_hist_init_precision(&merged, sub_bits);
+    for (int p = 0; p < NUM_PARTS; ++p) {
+        lat_hist_init_precision(part, sub_bits);
+        for (size_t i = n * (size_t)p / NUM_PARTS; i < n * (size_t)(p + 1) / NUM_PARTS; ++i) {
+            lat_hist_record(part, values[i]);
+        }
+        lat_hist_merge(&merged, part);
+    }
+    if (!same_hist(&merged, whole)) {
+        fprintf(stderr, "sub_bits %u: merged parts differ from the whole\n", sub_bits);
+        errors++;
+    }
+    lat_hist_init_precision(&merged, sub_bits);
+    lat_hist_merge(&merged, finest);
+    if (!same_hist(&merged, whole)) {
+        fprintf(stderr, "sub_bits %u: merged from sub_bits %d differs\n", sub_bits, LAT_HIST_MAX_SUB_BITS);
+        errors++;
+    }
+
+    unsigned buckets = (1u << (sub_bits - 1)) * (66 - sub_bits);
+    printf("%8u %8u %8.1f %10.2f %9.2f %9.2f\n", sub_bits, buckets, (double)buckets * 8 / 1024, ns_per_record,
+           max_err * 100, bound * 100);
+    return errors;
+}
+
+int main(int argc, char *argv[]) {
+    size_t n = 1000000;
+    const char *json_path = NULL;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "n:j:")) != -1) {
+        switch (opt) {
+        case 'n': n = strtoull(optarg, NULL, 0); break;
+        case 'j': json_path = optarg; break;
+        default:
+            goto usage;
+        }
+    }
+    if (n < NUM_PARTS) goto usage;
+    setvbuf(stdout, NULL, _IOLBF, 0);
+
+    uint64_t *values = malloc(n * sizeof(*values));
+    uint64_t *sorted = malloc(n * sizeof(*sorted));
+    // Гистограммы по ~30 КиБ — в куче, не на стеке.
+    lat_hist_t *hists = malloc(3 * sizeof(lat_hist_t));
+    if (!values || !sorted || !hists) {
+        perror("malloc");
+        return EXIT_FAILURE;
+    }
+    lat_hist_t *finest = &hists[0], *whole = &hists[1], *part = &hists[2];
+
+    // Логарифмически равномерно от 1 нс до ~4 с: в каждой октаве поровну.
+    uint64_t seed = 0x9e3779b97f4a7c15ull;
+    double sum = 0;
+    for (size_t i = 0; i < n; ++i) {
+        double u = (double)(xorshift64(&seed) >> 11) / (double)(1ull << 53);
+        values[i] = (uint64_t)exp2(u * 32.0);
+        sum += (double)values[i];
+    }
+    double mean = sum / (double)n, sq = 0;
+    for (size_t i = 0; i < n; ++i) sq += ((double)values[i] - mean) * ((double)values[i] - mean);
+    double stddev = sqrt(sq / (double)n);
+
+    memcpy(sorted, values, n * sizeof(*values));
+    uint64_t t0 = now_ns();
+    qsort(sorted, n, sizeof(*sorted), compare_u64);
+    double sort_ns = (double)(now_ns() - t0) / (double)n;
+
+    lat_hist_init_precision(finest, LAT_HIST_MAX_SUB_BITS);
+    for (size_t i = 0; i < n; ++i) lat_hist_record(finest, values[i]);
+
+    printf("%zu values, 1 ns .. 4 s; qsort: %.2f ns/value, %zu KiB\n", n, sort_ns, n * sizeof(*values) / 1024);
+    printf("%8s %8s %8s %10s %9s %9s\n", "sub_bits", "buckets", "KiB", "ns/record", "max_err%", "bound%");
+    int errors = 0;
+    for (unsigned b = 1; b <= LAT_HIST_MAX_SUB_BITS; ++b) {
+        errors += check_precision(b, values, sorted, n, mean, stddev, finest, whole, part);
+    }
+
+    if (json_path) {
+        FILE *out = fopen(json_path, "w");
+        if (!out) {
+            perror(json_path);
+            return EXIT_FAILURE;
+        }
+        lat_hist_init(whole);
+        for (size_t i = 0; i < n; ++i) lat_hist_record(whole, values[i]);
+        lat_hist_write_json(whole, out, "lat_hist_bench");
+        fclose(out);
+    }
+
+    free(values);
+    free(sorted);
+    free(hists);
+    if (errors) {
+        fprintf(stderr, "%d check(s) failed\n", errors);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+
+usage:
+    fprintf(stderr, "usage: %s [-n values] [-j out.json]\n", argv[0]);
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,405 @@
+/*
+ * Генератор нагрузки для эхо-серверов на UNIX-сокетах
+ * (task3 epoll_server, task1 resmgr)
+ *
+ * -c подключений раскладываются по -T потокам, у каждого потока свой epoll.
+ * Сообщение — -s байт, последний байт '\n' (resmgr отвечает эхом на всё,
+ * что не начинается с READ/WRITE/STATUS). Ответ считается полученным,
+ * когда вернулось столько же байт, поэтому границы чтений не важны.
+ * С -F сообщение — кадр FRAME_ECHO из frame.h (-s включает заголовок) для
+ * серверов в режиме кадров (epoll_server -f, resmgr -f): ответ на него
+ * той же длины.
+ *
+ * Режимы:
+ *  - замкнутый цикл (по умолчанию): на каждом подключении до -P сообщений
+ *    в полёте, следующее уходит сразу после ответа;
+ *  - открытый цикл (-R сообщений/с на всех): сообщения уходят по
+ *    расписанию независимо от ответов (но не больше -P в полёте).
+ *    Задержка считается от момента по расписанию, а не от фактической
+ *    отправки: если сервер притормозил и отправка задержалась, это
+ *    время входит в задержку (поправка на coordinated omission). Для
+ *    сравнения печатается и «сырая» задержка от фактической отправки.
+ *
+ * Печатает сообщения/с, МБ/с и перцентили задержки (lat_hist, в духе HDR);
+ * -H файл — вся гистограмма в CSV. Код возврата ненулевой при ошибках
+ * подключений или если не пришло ни одного ответа.
+ *
+ * Запуск: ./bin/loadgen [-S сокет] [-c подключений] [-T потоков] [-s размер]
+ *                       [-P глубина] [-R сообщений/с] [-d секунд] [-H файл] [-F]
+ *   epoll_server: ./bin/loadgen -S /tmp/epoll_server.sock (по умолчанию)
+ *   resmgr:       ./bin/loadgen -S /tmp/example_resmgr.sock -s 128
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+#include "frame.h"
+#include "lat_hist.h"
+
+#define DEFAULT_SOCKET "/tmp/epoll_server.sock"
+#define MAX_THREADS 64
+#define MAX_DEPTH 1024
+#define RECV_CHUNK 65536
+
+typedef struct {
+    int fd;
+    int out_armed;              // ждём EPOLLOUT
+    size_t send_off;            // отправлено байт текущего сообщения
+    uint64_t next_due;          // открытый цикл: момент следующей отправки
+    uint64_t interval;          // открытый цикл: период на подключение
+    size_t recv_bytes;          // принято байт текущего ответа
+    // Кольцо сообщений в полёте (depth штук): момент по расписанию и
+    // фактической отправки.
+    uint64_t *due;
+    uint64_t *sent;
+    unsigned head, tail;
+} lconn_t;
+
+typedef struct {
+    int id;
+    pthread_t thread;
+    lconn_t *conns;
+    int nconns;
+    lat_hist_t corrected;       // от момента по расписанию
+    lat_hist_t raw;             // от фактической отправки
+    uint64_t msgs;
+    uint64_t errors;
+} worker_t;
+
+static const char *socket_path = DEFAULT_SOCKET;
+static size_t msg_size = 64;
+static unsigned depth = 1;
+static double rate = 0;         // 0 — замкнутый цикл
+static uint64_t end_ns;
+static char *message;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static int connect_unix(const char *path) {
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    if (fd == -1) return -1;
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+    // Неблокирующий connect на UNIX-сокете при полной очереди accept
+    // возвращает EAGAIN — немного подождём.
+    for (int tries = 0; connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == -1; ++tries) {
+        if (errno != EAGAIN || tries == 1000) {
+            int saved = errno;
+            close(fd);
+            errno = saved;
+            return -1;
+        }
+        usleep(1000);
+    }
+    return fd;
+}
+
+static void set_events(int epfd, lconn_t *c, int want_out) {
+    if (c->out_armed == want_out) return;
+    struct epoll_event ev;
+    ev.events = EPOLLIN | (want_out ? EPOLLOUT : 0);
+    ev.data.ptr = c;
+    epoll_ctl(epfd, EPOLL_CTL_MOD, c->fd, &ev);
+    c->out_armed = want_out;
+}
+
+// Отправить всё, что положено к этому моменту. -1 — ошибка сокета.
+static int conn_send(worker_t *w, int epfd, lconn_t *c, uint64_t now) {
+    while (c->tail - c->head < depth || c->send_off > 0) {
+        if (c->send_off == 0) {
+            // Новое сообщение: в замкнутом цикле — сразу, в открытом — по расписанию.
+            uint64_t due = rate > 0 ? c->next_due : now;
+            if (due > now) break;
+            c->due[c->tail % depth] = due;
+            c->sent[c->tail % depth] = now;
+            c->tail++;
+            if (rate > 0) c->next_due += c->interval;
+        }
+        ssize_t n = send(c->fd, message + c->send_off, msg_size - c->send_off, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                set_events(epfd, c, 1);
+                return 0;
+            }
+            w->errors++;
+            return -1;
+        }
+        c->send_off += (size_t)n;
+        if (c->send_off == msg_size) c->send_off = 0;
+    }
+    set_events(epfd, c, 0);
+    return 0;
+}
+
+static int conn_recv(worker_t *w, lconn_t *c, char *buf) {
+    for (;;) {
+        ssize_t n = recv(c->fd, buf, RECV_CHUNK, 0);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return 0;
+            w->errors++;
+            return -1;
+        }
+        if (n == 0) {
+            w->errors++; // сервер закрыл подключение
+            return -1;
+        }
+        uint64_t now = now_ns();
+        c->recv_bytes += (size_t)n;
+        while (c->recv_bytes >= msg_size && c->head != c->tail) {
+            c->recv_bytes -= msg_size;
+            unsigned i = c->head++ % depth;
+            lat_hist_record(&w->corrected, now - c->due[i]);
+            lat_hist_record(&w->raw, now - c->sent[i]);
+            w->msgs++;
+        }
+        if (n < RECV_CHUNK) return 0;
+    }
+}
+
+static void *worker_main(void *arg) {
+    worker_t *w = arg;
+    char *buf = malloc(RECV_CHUNK);
+    int epfd = epoll_create1(0);
+    if (!buf || epfd == -1) {
+        perror("worker setup");
+        w->errors++;
+        free(buf);
+        return NULL;
+    }
+
+    uint64_t start = now_ns();
+    int live = 0;
+    for (int i = 0; i < w->nconns; ++i) {
+        lconn_t *c = &w->conns[i];
+        if (c->fd == -1) continue;
+        struct epoll_event ev;
+        ev.events = EPOLLIN;
+        ev.data.ptr = c;
+        if (epoll_ctl(epfd, EPOLL_CTL_ADD, c->fd, &ev) == -1) {
+            perror("epoll_ctl");
+            w->errors++;
+            continue;
+        }
+        live++;
+        if (rate > 0) {
+            // Расписание подключений сдвинуто, чтобы отправки не шли залпом.
+            c->next_due = start + c->interval * (uint64_t)i / (uint64_t)w->nconns;
+        }
+        if (conn_send(w, epfd, c, start) == -1) live--;
+    }
+
+    struct epoll_event events[64];
+    uint64_t now = start;
+    while (live > 0 && now < end_ns) {
+        // Ждём до ближайшей отправки по расписанию (в открытом цикле).
+        struct timespec timeout = {0, 1000000};
+        if (rate > 0) {
+            uint64_t next = end_ns;
+            for (int i = 0; i < w->nconns; ++i) {
+                lconn_t *c = &w->conns[i];
+                if (c->fd != -1 && c->tail - c->head < depth && c->next_due < next) next = c->next_due;
+            }
+            uint64_t wait = next > now ? next - now : 0;
+            if (wait < 1000000) timeout.tv_nsec = (long)wait;
+        }
+        int n = epoll_pwait2(epfd, events, 64, &timeout, NULL);
+        if (n == -1 && errno != EINTR) {
+            perror("epoll_pwait2");
+            w->errors++;
+            break;
+        }
+        now = now_ns();
+        for (int i = 0; i < n; ++i) {
+            lconn_t *c = events[i].data.ptr;
+            if (c->fd == -1) continue;
+            int err = 0;
+            if (events[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP)) err = conn_recv(w, c, buf);
+            // Замкнутый цикл: отправлять есть смысл только после ответа
+            // или освобождения места в сокете.
+            if (err == 0 && rate == 0) err = conn_send(w, epfd, c, now);
+            if (err == -1) {
+                close(c->fd);
+                c->fd = -1;
+                live--;
+            }
+        }
+        if (rate == 0) continue;
+
+        // Открытый цикл: отправки по расписанию на всех подключениях.
+        now = now_ns();
+        for (int i = 0; i < w->nconns; ++i) {
+            lconn_t *c = &w->conns[i];
+            if (c->fd != -1 && conn_send(w, epfd, c, now) == -1) {
+                close(c->fd);
+                c->fd = -1;
+                live--;
+            }
+        }
+    }
+
+    close(epfd);
+    free(buf);
+    return NULL;
+}
+
+static void print_latency(const char *label, const lat_hist_t *h) {
+    printf("%s p50=%.1f p90=%.1f p99=%.1f p99.9=%.1f p99.99=%.1f max=%.1f us\n", label,
+           (double)lat_hist_percentile(h, 50) / 1e3, (double)lat_hist_percentile(h, 90) / 1e3,
+           (double)lat_hist_percentile(h, 99) / 1e3, (double)lat_hist_percentile(h, 99.9) / 1e3,
+           (double)lat_hist_percentile(h, 99.99) / 1e3, (double)h->max / 1e3);
+}
+
+int main(int argc, char *argv[]) {
+    int nconns = 16;
+    int nthreads = 1;
+    double duration = 2.0;
+    const char *hist_file = NULL;
+    int framed = 0;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "S:c:T:s:P:R:d:H:F")) != -1) {
+        switch (opt) {
+        case 'S': socket_path = optarg; break;
+        case 'c': nconns = atoi(optarg); break;
+        case 'T': nthreads = atoi(optarg); break;
+        case 's': msg_size = strtoull(optarg, NULL, 0); break;
+        case 'P': depth = (unsigned)atoi(optarg); break;
+        case 'R': rate = atof(optarg); break;
+        case 'd': duration = atof(optarg); break;
+        case 'H': hist_file = optarg; break;
+        case 'F': framed = 1; break;
+        default:
+            fprintf(stderr, "usage: %s [-S socket] [-c connections] [-T threads] [-s size] "
+                            "[-P depth] [-R msgs/s] [-d seconds] [-H hist.csv] [-F]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (nconns < 1 || nthreads < 1 || nthreads > MAX_THREADS || msg_size < 1 ||
+        depth < 1 || depth > MAX_DEPTH || rate < 0 || duration <= 0) {
+        fprintf(stderr, "invalid parameters (threads 1..%d, depth 1..%d)\n", MAX_THREADS, MAX_DEPTH);
+        return EXIT_FAILURE;
+    }
+    if (nthreads > nconns) nthreads = nconns;
+    if (framed && msg_size < FRAME_HDR_SIZE) msg_size = FRAME_HDR_SIZE;
+
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    signal(SIGPIPE, SIG_IGN);
+    if (!(message = malloc(msg_size))) {
+        perror("malloc");
+        return EXIT_FAILURE;
+    }
+    memset(message, 'x', msg_size);
+    if (framed) {
+        frame_put_header(message, FRAME_ECHO, 0, (uint32_t)(msg_size - FRAME_HDR_SIZE));
+    } else {
+        message[msg_size - 1] = '\n';
+    }
+
+    worker_t *workers = calloc((size_t)nthreads, sizeof(*workers));
+    lconn_t *conns = calloc((size_t)nconns, sizeof(*conns));
+    if (!workers || !conns) {
+        perror("calloc");
+        return EXIT_FAILURE;
+    }
+
+    uint64_t connect_errors = 0;
+    uint64_t interval = rate > 0 ? (uint64_t)(1e9 * nconns / rate) : 0;
+    for (int i = 0; i < nconns; ++i) {
+        conns[i].interval = interval ? interval : 1;
+        conns[i].due = malloc(depth * sizeof(uint64_t));
+        conns[i].sent = malloc(depth * sizeof(uint64_t));
+        if (!conns[i].due || !conns[i].sent) {
+            perror("malloc");
+            return EXIT_FAILURE;
+        }
+        if ((conns[i].fd = connect_unix(socket_path)) == -1) {
+            if (connect_errors++ == 0) perror("connect");
+        }
+    }
+
+    // Подключения раскладываются по потокам непрерывными кусками.
+    for (int t = 0; t < nthreads; ++t) {
+        worker_t *w = &workers[t];
+        w->id = t;
+        int from = (int)((long)nconns * t / nthreads);
+        int to = (int)((long)nconns * (t + 1) / nthreads);
+        w->conns = conns + from;
+        w->nconns = to - from;
+        lat_hist_init(&w->corrected);
+        lat_hist_init(&w->raw);
+    }
+
+    uint64_t start = now_ns();
+    end_ns = start + (uint64_t)(duration * 1e9);
+    for (int t = 0; t < nthreads; ++t) {
+        if (pthread_create(&workers[t].thread, NULL, worker_main, &workers[t]) != 0) {
+            perror("pthread_create");
+            return EXIT_FAILURE;
+        }
+    }
+
+    lat_hist_t corrected, raw;
+    lat_hist_init(&corrected);
+    lat_hist_init(&raw);
+    uint64_t msgs = 0, errors = connect_errors;
+    for (int t = 0; t < nthreads; ++t) {
+        pthread_join(workers[t].thread, NULL);
+        lat_hist_merge(&corrected, &workers[t].corrected);
+        lat_hist_merge(&raw, &workers[t].raw);
+        msgs += workers[t].msgs;
+        errors += workers[t].errors;
+    }
+    double elapsed = (double)(now_ns() - start) / 1e9;
+
+    printf("target=%s connections=%d threads=%d size=%zu depth=%u mode=%s%s",
+           socket_path, nconns, nthreads, msg_size, depth, rate > 0 ? "open" : "closed",
+           framed ? " framed" : "");
+    if (rate > 0) printf(" rate=%.0f/s", rate);
+    printf("\nmessages=%llu in %.2f s: %.0f msgs/s, %.1f MB/s, errors=%llu\n",
+           (unsigned long long)msgs, elapsed, (double)msgs / elapsed,
+           (double)msgs * (double)msg_size * 2 / elapsed / 1e6, (unsigned long long)errors);
+    if (rate > 0) {
+        print_latency("latency (from schedule):   ", &corrected);
+        print_latency("latency (from actual send):", &raw);
+    } else {
+        print_latency("latency:", &raw);
+    }
+
+    if (hist_file) {
+        FILE *f = fopen(hist_file, "w");
+        if (!f) {
+            perror(hist_file);
+        } else {
+            fprintf(f, "series,lo_ns,hi_ns,count\n");
+            lat_hist_write_csv(rate > 0 ? &corrected : &raw, f, "latency");
+            fclose(f);
+        }
+    }
+
+    for (int i = 0; i < nconns; ++i) {
+        if (conns[i].fd != -1) close(conns[i].fd);
+        free(conns[i].due);
+        free(conns[i].sent);
+    }
+    free(conns);
+    free(workers);
+    free(message);
+    return errors || msgs == 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,158 @@
+/*
+ * Пачки датаграмм через sendmmsg/recvmmsg (см. mmsg.h)
+ */
+#define _GNU_SOURCE
+#include "mmsg.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+int mmsg_init(mmsg_t *m, int fd, int max_batch, size_t slot_size) {
+    memset(m, 0, sizeof(*m));
+    if (max_batch < 1 || slot_size == 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    m->fd = fd;
+    m->max_batch = max_batch;
+    m->slot_size = slot_size;
+    size_t n = (size_t)max_batch;
+    m->out_pool = malloc(n * slot_size);
+    m->in_pool = malloc(n * slot_size);
+    m->out_hdr = calloc(n, sizeof(*m->out_hdr));
+    m->in_hdr = calloc(n, sizeof(*m->in_hdr));
+    m->out_iov = calloc(n, sizeof(*m->out_iov));
+    m->in_iov = calloc(n, sizeof(*m->in_iov));
+    if (!m->out_pool || !m->in_pool || !m->out_hdr || !m->in_hdr || !m->out_iov || !m->in_iov) {
+        mmsg_destroy(m);
+        errno = ENOMEM;
+        return -1;
+    }
+    // Заголовки ссылаются на свои слоты раз и навсегда; меняются только длины.
+    for (size_t i = 0; i < n; ++i) {
+        m->out_iov[i].iov_base = m->out_pool + i * slot_size;
+        m->out_hdr[i].msg_hdr.msg_iov = &m->out_iov[i];
+        m->out_hdr[i].msg_hdr.msg_iovlen = 1;
+        m->in_iov[i].iov_base = m->in_pool + i * slot_size;
+        m->in_iov[i].iov_len = slot_size;
+        m->in_hdr[i].msg_hdr.msg_iov = &m->in_iov[i];
+        m->in_hdr[i].msg_hdr.msg_iovlen = 1;
+    }
+    return 0;
+}
+
+void mmsg_destroy(mmsg_t *m) {
+    free(m->out_pool);
+    free(m->in_pool);
+    free(m->out_hdr);
+    free(m->in_hdr);
+    free(m->out_iov);
+    free(m->in_iov);
+    m->out_pool = m->in_pool = NULL;
+    m->out_hdr = m->in_hdr = NULL;
+    m->out_iov = m->in_iov = NULL;
+}
+
+// Неотправленный хвост [sent, pending) — в начало пула, чтобы следующая
+// попытка (и новые сообщения) продолжили с него. При sent > 0 слоты
+// источника и приёмника разные и не перекрываются; путь редкий — только
+// при ошибке отправки.
+static void keep_unsent(mmsg_t *m, int sent) {
+    // Ничего не ушло (обычный EAGAIN): хвост уже на месте, pending и
+    // pending_bytes верны.
+    if (sent == 0) return;
+    size_t bytes = 0;
+    for (int i = sent; i < m->pending; ++i) {
+        struct iovec *dst = &m->out_iov[i - sent];
+        memcpy(dst->iov_base, m->out_iov[i].iov_base, m->out_iov[i].iov_len);
+        dst->iov_len = m->out_iov[i].iov_len;
+        bytes += dst->iov_len;
+    }
+    m->pending -= sent;
+    m->pending_bytes = bytes;
+}
+
+int mmsg_flush(mmsg_t *m) {
+    int sent = 0;
+    while (sent < m->pending) {
+        int n = sendmmsg(m->fd, m->out_hdr + sent, (unsigned)(m->pending - sent), 0);
+        m->stats.send_calls++;
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            int saved = errno;
+            m->stats.messages_sent += (uint64_t)sent;
+            keep_unsent(m, sent);
+            errno = saved;
+            return -1;
+        }
+        sent += n;
+    }
+    m->stats.messages_sent += (uint64_t)sent;
+    m->pending = 0;
+    m->pending_bytes = 0;
+    return 0;
+}
+
+int mmsg_send(mmsg_t *m, const void *msg, size_t len) {
+    if (len > m->slot_size) {
+        errno = EMSGSIZE;
+        return -1;
+    }
+    uint64_t now = m->flush_ns ? now_ns() : 0;
+    // Срок отсчитывается от первого отложенного: просроченная пачка уходит
+    // до того, как к ней добавится новое сообщение. Пул, оставшийся полным
+    // после неудачной отправки, тоже сначала освобождается.
+    if (m->pending && m->flush_ns && now - m->first_ns >= m->flush_ns) {
+        m->stats.deadline_flushes++;
+        if (mmsg_flush(m) == -1 && m->pending == m->max_batch) return -1;
+    } else if (m->pending == m->max_batch && mmsg_flush(m) == -1) {
+        return -1;
+    }
+    if (m->pending == 0) m->first_ns = now;
+    struct iovec *iov = &m->out_iov[m->pending];
+    memcpy(iov->iov_base, msg, len);
+    iov->iov_len = len;
+    m->pending++;
+    m->pending_bytes += len;
+    // Сообщение уже принято: неудача этой отправки оставляет его в очереди
+    // и проявится при следующем вызове.
+    if (m->pending == m->max_batch || (m->flush_bytes && m->pending_bytes >= m->flush_bytes)) mmsg_flush(m);
+    return 0;
+}
+
+int mmsg_poll(mmsg_t *m) {
+    if (m->pending == 0 || !m->flush_ns || now_ns() - m->first_ns < m->flush_ns) return 0;
+    m->stats.deadline_flushes++;
+    return mmsg_flush(m) == -1 ? -1 : 1;
+}
+
+int mmsg_timeout_ms(const mmsg_t *m) {
+    if (m->pending == 0) return -1;
+    if (!m->flush_ns) return -1;
+    uint64_t elapsed = now_ns() - m->first_ns;
+    if (elapsed >= m->flush_ns) return 0;
+    return (int)((m->flush_ns - elapsed + 999999) / 1000000);
+}
+
+int mmsg_recv(mmsg_t *m, mmsg_msg_t *msgs, int flags) {
+    int n;
+    do {
+        n = recvmmsg(m->fd, m->in_hdr, (unsigned)m->max_batch, flags | MSG_WAITFORONE, NULL);
+        m->stats.recv_calls++;
+    } while (n < 0 && errno == EINTR);
+    if (n <= 0) return n;
+    for (int i = 0; i < n; ++i) {
+        msgs[i].data = m->in_iov[i].iov_base;
+        msgs[i].len = m->in_hdr[i].msg_len;
+    }
+    m->stats.messages_received += (uint64_t)n;
+    return n;
+}
@@ -0,0 +1,87 @@
+#ifndef MMSG_H
+#define MMSG_H
+
+/*
+ * Пачки датаграмм через sendmmsg/recvmmsg на сокетах с границами
+ * сообщений (AF_UNIX SOCK_SEQPACKET или SOCK_DGRAM).
+ *
+ * Отправка: mmsg_send копирует сообщение в слот пула и откладывает его;
+ * пачка уходит одним sendmmsg, когда набралось max_batch сообщений,
+ * flush_bytes байт или с первого отложенного сообщения прошло flush_ns
+ * (адаптивная пачка: под нагрузкой — полные пачки, на тонком потоке —
+ * задержка не больше срока). Срок проверяется в mmsg_send и в
+ * mmsg_poll; mmsg_timeout_ms подсказывает, сколько можно спать в
+ * poll/epoll_wait до него.
+ *
+ * Приём: mmsg_recv забирает до max_batch датаграмм одним recvmmsg
+ * (MSG_WAITFORONE — ждать только первую) в слоты своего пула; указатели
+ * действительны до следующего mmsg_recv.
+ *
+ * Ошибка sendmmsg (EAGAIN на неблокирующем сокете, EPIPE, ...) ничего не
+ * теряет: неотправленные сообщения остаются отложенными (pending > 0) в
+ * прежнем порядке, повторить — mmsg_flush, например по EPOLLOUT.
+ *
+ * Функции возвращают -1 и выставляют errno при ошибке.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/socket.h>
+
+typedef struct {
+    const char *data;           // в слоте пула приёма
+    size_t len;
+} mmsg_msg_t;
+
+typedef struct {
+    uint64_t messages_sent;
+    uint64_t send_calls;        // sendmmsg
+    uint64_t messages_received;
+    uint64_t recv_calls;        // recvmmsg
+    uint64_t deadline_flushes;  // пачек, ушедших по сроку
+} mmsg_stats_t;
+
+typedef struct {
+    int fd;
+    int max_batch;
+    size_t slot_size;           // наибольшее сообщение
+    size_t flush_bytes;         // 0 — только по числу и сроку
+    uint64_t flush_ns;          // 0 — без срока (только flush вручную)
+
+    // Отправка: слоты пула и заголовки отложенных сообщений.
+    char *out_pool;
+    struct mmsghdr *out_hdr;
+    struct iovec *out_iov;
+    int pending;
+    size_t pending_bytes;
+    uint64_t first_ns;          // время первого отложенного
+
+    // Приём.
+    char *in_pool;
+    struct mmsghdr *in_hdr;
+    struct iovec *in_iov;
+
+    mmsg_stats_t stats;
+} mmsg_t;
+
+int mmsg_init(mmsg_t *m, int fd, int max_batch, size_t slot_size);
+void mmsg_destroy(mmsg_t *m);       // fd не закрывает
+
+// Отложить сообщение (копия в пул); может отправить пачку. 0 — сообщение
+// принято (даже если вызванная им отправка не удалась: оно ждёт в пуле).
+// -1 — не принято: EMSGSIZE (len больше slot_size) или пул полон и
+// освободить его не удалось (errno отправки, например EAGAIN).
+int mmsg_send(mmsg_t *m, const void *msg, size_t len);
+// Отправить отложенные сразу (дописывая остаток при частичной отправке).
+// -1 — не всё ушло, остаток по-прежнему отложен.
+int mmsg_flush(mmsg_t *m);
+// Отправить, если срок вышел. Возвращает 1, если пачка ушла, -1 — если
+// не ушла целиком (остаток отложен).
+int mmsg_poll(mmsg_t *m);
+// Миллисекунд до срока (округление вверх), -1 — отложенных нет.
+int mmsg_timeout_ms(const mmsg_t *m);
+
+// Принять до max_batch сообщений в msgs; 0 — сокет закрыт (SEQPACKET).
+int mmsg_recv(mmsg_t *m, mmsg_msg_t *msgs, int flags);
+
+#endif // MMSG_H
@@ -0,0 +1,396 @@
+/*
+ * Пачки датаграмм sendmmsg/recvmmsg против send/recv по одной и против
+ * POSIX MQ (mmsg.h)
+ *
+ * Отправитель — этот процесс, получатель — дочерний. Сообщение несёт
+ * номер и время отправки (CLOCK_MONOTONIC), получатель проверяет порядок
+ * и записывает задержку доставки. Три транспорта:
+ *  - mq:   mq_send/mq_receive, по вызову на сообщение;
+ *  - send: AF_UNIX SOCK_SEQPACKET (-t dgram — SOCK_DGRAM), send/recv по
+ *          одному;
+ *  - mmsg: тот же сокет, mmsg_send с пачкой до -b сообщений и сроком -f
+ *          мкс, приём recvmmsg.
+ * Две фазы по -d секунд:
+ *  - stream: отправитель шлёт без пауз — пропускная способность;
+ *  - paced:  -r сообщений в секунду — задержка на тонком потоке, где пачку
+ *            отправляет срок, а не заполнение.
+ *
+ * Печатает сообщений в секунду, системных вызовов на сообщение у
+ * отправителя и получателя и перцентили задержки доставки.
+ *
+ * Перед фазами — проверка противодавления на неблокирующем сокете:
+ * mmsg_send до отказа с EAGAIN (буфер сокета и пул полны), затем
+ * попеременно вычитывание и mmsg_flush; получено должно быть ровно
+ * принятое, по порядку. Код возврата ненулевой при потерях или нарушении
+ * порядка.
+ *
+ * Запуск: ./bin/mmsg_bench [-s байт] [-b пачка] [-f мкс] [-r сообщений/с]
+ *                          [-t seqpacket|dgram] [-d секунд]
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <mqueue.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include "lat_hist.h"
+#include "mmsg.h"
+
+#define QUEUE_NAME "/mmsg_bench_mq"
+#define END_SEQ UINT64_MAX
+
+typedef enum { T_MQ, T_SEND, T_MMSG, NUM_TRANSPORTS } transport_t;
+
+static const char *transport_names[NUM_TRANSPORTS] = {"mq", "send", "mmsg"};
+
+typedef struct {
+    size_t size;
+    int batch;
+    uint64_t flush_us;
+    double rate;
+    int sock_type;
+    double duration;
+} bench_config_t;
+
+typedef struct {
+    uint64_t seq;
+    uint64_t sent_ns;
+} msg_header_t;
+
+// Итог получателя — в разделяемой памяти.
+typedef struct {
+    lat_hist_t lat;             // нс
+    uint64_t messages;
+    uint64_t recv_calls;
+    uint64_t errors;
+} receiver_result_t;
+
+typedef struct {
+    transport_t t;
+    mqd_t mq;
+    int fd;
+    mmsg_t mm;
+    uint64_t calls;             // send/mq_send у отправителя
+} channel_t;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void sleep_until(uint64_t t) {
+    struct timespec ts = {.tv_sec = (time_t)(t / 1000000000ull), .tv_nsec = (long)(t % 1000000000ull)};
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {
+    }
+}
+
+static long read_sysctl(const char *path, long fallback) {
+    FILE *f = fopen(path, "r");
+    long v = fallback;
+    if (f) {
+        if (fscanf(f, "%ld", &v) != 1) v = fallback;
+        fclose(f);
+    }
+    return v;
+}
+
+// Проверить и учесть одно сообщение; 1 — конец потока.
+static int account(receiver_result_t *res, const char *data, size_t len, size_t size, uint64_t *expect) {
+    msg_header_t h;
+    if (len != size) {
+        res->errors++;
+        return 0;
+    }
+    memcpy(&h, data, sizeof(h));
+    if (h.seq == END_SEQ) return 1;
+    if (h.seq != *expect) res->errors++;
+    *expect = h.seq + 1;
+    lat_hist_record(&res->lat, now_ns() - h.sent_ns);
+    res->messages++;
+    return 0;
+}
+
+static void receiver_main(const bench_config_t *cfg, channel_t *ch, receiver_result_t *res) {
+    char *buf = malloc(cfg->size);
+    mmsg_msg_t *msgs = calloc((size_t)cfg->batch, sizeof(*msgs));
+    if (!buf || !msgs) _exit(1);
+    uint64_t expect = 0;
+    for (int done = 0; !done;) {
+        ssize_t n;
+        switch (ch->t) {
+        case T_MQ:
+            n = mq_receive(ch->mq, buf, cfg->size, NULL);
+            res->recv_calls++;
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0) _exit(1);
+            done = account(res, buf, (size_t)n, cfg->size, &expect);
+            break;
+        case T_SEND:
+            n = recv(ch->fd, buf, cfg->size, 0);
+            res->recv_calls++;
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) _exit(1);
+            done = account(res, buf, (size_t)n, cfg->size, &expect);
+            break;
+        case T_MMSG: {
+            int got = mmsg_recv(&ch->mm, msgs, 0);
+            if (got <= 0) _exit(1);
+            for (int i = 0; i < got && !done; ++i) done = account(res, msgs[i].data, msgs[i].len, cfg->size, &expect);
+            res->recv_calls = ch->mm.stats.recv_calls;
+            break;
+        }
+        default:
+            _exit(1);
+        }
+    }
+    _exit(0);
+}
+
+static int channel_send(channel_t *ch, const char *msg, size_t len) {
+    for (;;) {
+        int rc;
+        switch (ch->t) {
+        case T_MQ:
+            ch->calls++;
+            rc = mq_send(ch->mq, msg, len, 0);
+            break;
+        case T_SEND:
+            ch->calls++;
+            rc = send(ch->fd, msg, len, 0) == (ssize_t)len ? 0 : -1;
+            break;
+        default:
+            return mmsg_send(&ch->mm, msg, len);
+        }
+        if (rc == -1 && errno == EINTR) continue;
+        return rc;
+    }
+}
+
+static int channel_open(const bench_config_t *cfg, channel_t *ch, transport_t t, int sv[2]) {
+    memset(ch, 0, sizeof(*ch));
+    ch->t = t;
+    ch->fd = -1;
+    sv[0] = sv[1] = -1;
+    if (t == T_MQ) {
+        struct mq_attr attr = {.mq_maxmsg = read_sysctl("/proc/sys/fs/mqueue/msg_max", 10),
+                               .mq_msgsize = (long)cfg->size};
+        mq_unlink(QUEUE_NAME);
+        ch->mq = mq_open(QUEUE_NAME, O_CREAT | O_RDWR, 0600, &attr);
+        if (ch->mq == (mqd_t)-1) {
+            perror("mq_open");
+            return -1;
+        }
+        return 0;
+    }
+    if (socketpair(AF_UNIX, cfg->sock_type, 0, sv) == -1) {
+        perror("socketpair");
+        return -1;
+    }
+    if (t == T_MMSG && mmsg_init(&ch->mm, sv[0], cfg->batch, cfg->size) == -1) {
+        perror("mmsg_init");
+        return -1;
+    }
+    ch->mm.flush_ns = cfg->flush_us * 1000;
+    return 0;
+}
+
+static int run_case(const bench_config_t *cfg, transport_t t, int paced, receiver_result_t *res) {
+    channel_t ch;
+    int sv[2];
+    if (channel_open(cfg, &ch, t, sv) == -1) return -1;
+    memset(res, 0, sizeof(*res));
+    lat_hist_init(&res->lat);
+
+    pid_t pid = fork();
+    if (pid == -1) {
+        perror("fork");
+        return -1;
+    }
+    if (pid == 0) {
+        if (t != T_MQ) {
+            close(sv[0]);
+            ch.fd = sv[1];
+            ch.mm.fd = sv[1];
+        }
+        receiver_main(cfg, &ch, res);
+    }
+    if (t != T_MQ) {
+        close(sv[1]);
+        ch.fd = sv[0];
+    }
+
+    char *msg = calloc(1, cfg->size);
+    if (!msg) return -1;
+    uint64_t period = paced ? (uint64_t)(1e9 / cfg->rate) : 0;
+    uint64_t seq = 0, t0 = now_ns(), end = t0 + (uint64_t)(cfg->duration * 1e9);
+    int rc = 0;
+    for (uint64_t now = t0; rc == 0 && now < end; now = now_ns()) {
+        if (paced) {
+            // Спать до следующего сообщения или до срока отложенной пачки.
+            uint64_t next = t0 + seq * period;
+            while (rc == 0 && (now = now_ns()) < next) {
+                int ms = t == T_MMSG ? mmsg_timeout_ms(&ch.mm) : -1;
+                uint64_t wake = next;
+                if (ms >= 0 && ch.mm.first_ns + ch.mm.flush_ns < wake) wake = ch.mm.first_ns + ch.mm.flush_ns;
+                sleep_until(wake);
+                if (t == T_MMSG && mmsg_poll(&ch.mm) == -1) rc = -1;
+            }
+        }
+        msg_header_t h = {seq++, now_ns()};
+        memcpy(msg, &h, sizeof(h));
+        rc = channel_send(&ch, msg, cfg->size);
+    }
+    uint64_t sent = seq;
+    msg_header_t h = {END_SEQ, 0};
+    memcpy(msg, &h, sizeof(h));
+    if (rc == 0) rc = channel_send(&ch, msg, cfg->size);
+    if (rc == 0 && t == T_MMSG) rc = mmsg_flush(&ch.mm);
+    if (rc == -1) perror(transport_names[t]);
+
+    int status;
+    waitpid(pid, &status, 0);
+    double secs = (double)(now_ns() - t0) / 1e9;
+    uint64_t tx_calls = t == T_MMSG ? ch.mm.stats.send_calls : ch.calls;
+    // Маркер конца — тоже сообщение отправителя.
+    sent++;
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0 || res->errors || res->messages + 1 != sent) {
+        fprintf(stderr, "%s %s: received %llu of %llu, %llu errors\n", paced ? "paced" : "stream",
+                transport_names[t], (unsigned long long)res->messages, (unsigned long long)(sent - 1),
+                (unsigned long long)res->errors);
+        rc = -1;
+    } else {
+        printf("%-6s %-5s %5d %11.0f %9.3f %9.3f %9.1f %9.1f %9.1f\n", paced ? "paced" : "stream",
+               transport_names[t], t == T_MMSG ? cfg->batch : 1, (double)res->messages / secs,
+               (double)tx_calls / (double)sent, (double)res->recv_calls / (double)sent,
+               lat_hist_percentile(&res->lat, 50) / 1e3, lat_hist_percentile(&res->lat, 99) / 1e3,
+               (double)res->lat.max / 1e3);
+    }
+
+    free(msg);
+    if (t == T_MQ) {
+        mq_close(ch.mq);
+        mq_unlink(QUEUE_NAME);
+    } else {
+        if (t == T_MMSG) mmsg_destroy(&ch.mm);
+        close(sv[0]);
+    }
+    return rc;
+}
+
+// Неотправленное при EAGAIN остаётся в пуле и уходит следующим flush.
+static int check_backpressure(const bench_config_t *cfg) {
+    int sv[2];
+    if (socketpair(AF_UNIX, cfg->sock_type | SOCK_NONBLOCK, 0, sv) == -1) {
+        perror("socketpair");
+        return -1;
+    }
+    mmsg_t m;
+    char *msg = calloc(1, cfg->size);
+    char *in = malloc(cfg->size);
+    if (!msg || !in || mmsg_init(&m, sv[0], cfg->batch, cfg->size) == -1) {
+        perror("mmsg_init");
+        return -1;
+    }
+    uint64_t accepted = 0, received = 0, errors = 0;
+    int refused = 0;
+    while (accepted < 10000000) {
+        memcpy(msg, &accepted, sizeof(accepted));
+        if (mmsg_send(&m, msg, cfg->size) == -1) {
+            refused = errno == EAGAIN && m.pending == m.max_batch;
+            break;
+        }
+        accepted++;
+    }
+    for (;;) {
+        ssize_t n;
+        while ((n = recv(sv[1], in, cfg->size, 0)) > 0) {
+            uint64_t seq;
+            memcpy(&seq, in, sizeof(seq));
+            errors += seq != received++;
+        }
+        if (m.pending == 0) break;
+        if (mmsg_flush(&m) == -1 && errno != EAGAIN) {
+            perror("mmsg_flush");
+            errors++;
+            break;
+        }
+    }
+    printf("non-blocking backpressure: %llu accepted before EAGAIN, %llu received in order: %s\n",
+           (unsigned long long)accepted, (unsigned long long)(received - errors),
+           refused && received == accepted && !errors ? "ok" : "FAILED");
+    mmsg_destroy(&m);
+    free(msg);
+    free(in);
+    close(sv[0]);
+    close(sv[1]);
+    return refused && received == accepted && !errors ? 0 : -1;
+}
+
+int main(int argc, char *argv[]) {
+    bench_config_t cfg = {
+        .size = 64,
+        .batch = 32,
+        .flush_us = 50,
+        .rate = 10000,
+        .sock_type = SOCK_SEQPACKET,
+        .duration = 0.5,
+    };
+
+    int opt;
+    while ((opt = getopt(argc, argv, "s:b:f:r:t:d:")) != -1) {
+        switch (opt) {
+        case 's': cfg.size = strtoull(optarg, NULL, 0); break;
+        case 'b': cfg.batch = atoi(optarg); break;
+        case 'f': cfg.flush_us = strtoull(optarg, NULL, 0); break;
+        case 'r': cfg.rate = atof(optarg); break;
+        case 't':
+            if (strcmp(optarg, "seqpacket") == 0) cfg.sock_type = SOCK_SEQPACKET;
+            else if (strcmp(optarg, "dgram") == 0) cfg.sock_type = SOCK_DGRAM;
+            else goto usage;
+            break;
+        case 'd': cfg.duration = atof(optarg); break;
+        default:
+            goto usage;
+        }
+    }
+    if (cfg.size < sizeof(msg_header_t) || cfg.batch < 1 || cfg.rate <= 0 || cfg.duration <= 0) goto usage;
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    signal(SIGPIPE, SIG_IGN);
+    // Срок пачки — десятки мкс: стандартный запас таймеров (50 мкс) его бы съел.
+    prctl(PR_SET_TIMERSLACK, 1000UL, 0, 0, 0);
+
+    receiver_result_t *res = mmap(NULL, sizeof(*res), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (res == MAP_FAILED) {
+        perror("mmap");
+        return EXIT_FAILURE;
+    }
+
+    printf("%zu-byte messages, %s, mmsg flush after %d messages or %llu us; paced at %.0f msg/s\n", cfg.size,
+           cfg.sock_type == SOCK_SEQPACKET ? "SOCK_SEQPACKET" : "SOCK_DGRAM", cfg.batch,
+           (unsigned long long)cfg.flush_us, cfg.rate);
+    int failures = check_backpressure(&cfg) != 0;
+    printf("%-6s %-5s %5s %11s %9s %9s %9s %9s %9s\n", "phase", "mode", "batch", "msgs/s", "tx_calls", "rx_calls",
+           "p50_us", "p99_us", "max_us");
+    for (int paced = 0; paced <= 1; ++paced) {
+        for (transport_t t = 0; t < NUM_TRANSPORTS; ++t) failures += run_case(&cfg, t, paced, res) != 0;
+    }
+
+    munmap(res, sizeof(*res));
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+
+usage:
+    fprintf(stderr,
+            "usage: %s [-s bytes] [-b batch] [-f flush_us] [-r msgs_per_sec] [-t seqpacket|dgram] [-d seconds]\n",
+            argv[0]);
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,241 @@
+/*
+ * Передача работы в цикл событий из других потоков: MPSC-очередь против
+ * мьютекса
+ *
+ * Производители (-p, список) отдают по -n элементов одному потребителю,
+ * который спит в read(eventfd), как цикл epoll_server. Две схемы:
+ *  - mpsc:  неблокирующая очередь mpsc_queue.h, eventfd пишется только на
+ *           переходе «пусто → не пусто», потребитель забирает всё сразу;
+ *  - mutex: кольцо под pthread_mutex и запись в eventfd на каждый элемент
+ *           (прежняя передача подключений в epoll_server).
+ * Печатаются элементы/с, записи в eventfd и пробуждения потребителя на
+ * элемент. Потребитель проверяет, что элементы каждого производителя
+ * пришли по порядку и без потерь.
+ *
+ * Запуск: ./bin/mpsc_bench [-p производители,...] [-n элементов]
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <time.h>
+#include <unistd.h>
+#include "mpsc_queue.h"
+
+#define MAX_PRODUCERS 64
+#define RING_CAPACITY 4096
+
+typedef struct {
+    mpsc_node_t node;
+    uint32_t producer;
+    uint32_t seq;
+} item_t;
+
+typedef enum { SCHEME_MPSC, SCHEME_MUTEX } scheme_t;
+
+typedef struct {
+    scheme_t scheme;
+    int producers;
+    long items;                 // на производителя
+    int event_fd;
+
+    mpsc_queue_t queue;
+    item_t **nodes;             // узлы каждого производителя (mpsc)
+
+    pthread_mutex_t lock;       // mutex: кольцо (producer << 32 | seq)
+    uint64_t ring[RING_CAPACITY];
+    unsigned head, tail;
+
+    _Atomic uint64_t signals;   // записей в eventfd
+    uint64_t wakeups;           // пробуждений потребителя
+    uint64_t order_errors;
+    uint32_t next_seq[MAX_PRODUCERS];
+} bench_t;
+
+typedef struct {
+    bench_t *b;
+    int id;
+} producer_arg_t;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void signal_consumer(bench_t *b) {
+    uint64_t one = 1;
+    atomic_fetch_add_explicit(&b->signals, 1, memory_order_relaxed);
+    if (write(b->event_fd, &one, sizeof(one)) != sizeof(one)) perror("write eventfd");
+}
+
+static void *producer_main(void *arg) {
+    producer_arg_t *pa = arg;
+    bench_t *b = pa->b;
+    for (long i = 0; i < b->items; ++i) {
+        if (b->scheme == SCHEME_MPSC) {
+            item_t *it = &b->nodes[pa->id][i];
+            if (mpsc_push(&b->queue, &it->node)) signal_consumer(b);
+            continue;
+        }
+        uint64_t v = ((uint64_t)pa->id << 32) | (uint32_t)i;
+        for (;;) {
+            pthread_mutex_lock(&b->lock);
+            if (b->tail - b->head < RING_CAPACITY) break;
+            pthread_mutex_unlock(&b->lock);
+            sched_yield();
+        }
+        b->ring[b->tail++ % RING_CAPACITY] = v;
+        pthread_mutex_unlock(&b->lock);
+        signal_consumer(b);
+    }
+    return NULL;
+}
+
+static void consume(bench_t *b, uint32_t producer, uint32_t seq) {
+    if (b->next_seq[producer] != seq) b->order_errors++;
+    b->next_seq[producer] = seq + 1;
+}
+
+// Потребитель: ждёт eventfd и разбирает всё накопившееся.
+static void consumer_run(bench_t *b) {
+    uint64_t total = (uint64_t)b->producers * (uint64_t)b->items;
+    uint64_t received = 0;
+    while (received < total) {
+        uint64_t counter;
+        if (read(b->event_fd, &counter, sizeof(counter)) != sizeof(counter)) {
+            if (errno == EINTR) continue;
+            perror("read eventfd");
+            exit(EXIT_FAILURE);
+        }
+        b->wakeups++;
+
+        if (b->scheme == SCHEME_MPSC) {
+            for (mpsc_node_t *n = mpsc_take_all(&b->queue); n; n = n->next) {
+                item_t *it = (item_t *)n;
+                consume(b, it->producer, it->seq);
+                received++;
+            }
+            continue;
+        }
+        pthread_mutex_lock(&b->lock);
+        while (b->head != b->tail) {
+            uint64_t v = b->ring[b->head++ % RING_CAPACITY];
+            consume(b, (uint32_t)(v >> 32), (uint32_t)v);
+            received++;
+        }
+        pthread_mutex_unlock(&b->lock);
+    }
+}
+
+// Один прогон. Возвращает 0 или -1 при потере или перестановке элементов.
+static int run(scheme_t scheme, int producers, long items) {
+    bench_t *b = calloc(1, sizeof(*b));
+    if (!b) {
+        perror("calloc");
+        return -1;
+    }
+    b->scheme = scheme;
+    b->producers = producers;
+    b->items = items;
+    mpsc_init(&b->queue);
+    pthread_mutex_init(&b->lock, NULL);
+    if ((b->event_fd = eventfd(0, 0)) == -1) {
+        perror("eventfd");
+        exit(EXIT_FAILURE);
+    }
+    if (scheme == SCHEME_MPSC) {
+        b->nodes = calloc((size_t)producers, sizeof(*b->nodes));
+        for (int p = 0; b->nodes && p < producers; ++p) {
+            if (!(b->nodes[p] = malloc((size_t)items * sizeof(item_t)))) {
+                perror("malloc");
+                exit(EXIT_FAILURE);
+            }
+            for (long i = 0; i < items; ++i) {
+                b->nodes[p][i].producer = (uint32_t)p;
+                b->nodes[p][i].seq = (uint32_t)i;
+            }
+        }
+    }
+
+    pthread_t threads[MAX_PRODUCERS];
+    producer_arg_t args[MAX_PRODUCERS];
+    uint64_t t0 = now_ns();
+    for (int p = 0; p < producers; ++p) {
+        args[p].b = b;
+        args[p].id = p;
+        if (pthread_create(&threads[p], NULL, producer_main, &args[p]) != 0) {
+            perror("pthread_create");
+            exit(EXIT_FAILURE);
+        }
+    }
+    consumer_run(b);
+    uint64_t ns = now_ns() - t0;
+    for (int p = 0; p < producers; ++p) pthread_join(threads[p], NULL);
+
+    uint64_t total = (uint64_t)producers * (uint64_t)items;
+    for (int p = 0; p < producers; ++p) {
+        if (b->next_seq[p] != (uint32_t)items) b->order_errors++;
+    }
+    uint64_t signals = atomic_load(&b->signals);
+    printf("%-6s %9d %12llu %10.2f %14.4f %14.4f %12.1f %8llu\n",
+           scheme == SCHEME_MPSC ? "mpsc" : "mutex", producers, (unsigned long long)total,
+           (double)total * 1e3 / (double)ns, (double)signals / (double)total,
+           (double)b->wakeups / (double)total, (double)total / (double)b->wakeups,
+           (unsigned long long)b->order_errors);
+
+    int rc = b->order_errors ? -1 : 0;
+    close(b->event_fd);
+    if (b->nodes) {
+        for (int p = 0; p < producers; ++p) free(b->nodes[p]);
+        free(b->nodes);
+    }
+    pthread_mutex_destroy(&b->lock);
+    free(b);
+    return rc;
+}
+
+int main(int argc, char *argv[]) {
+    const char *producer_list = "1,2,4";
+    long items = 1000000;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "p:n:")) != -1) {
+        switch (opt) {
+        case 'p': producer_list = optarg; break;
+        case 'n': items = atol(optarg); break;
+        default:
+            fprintf(stderr, "usage: %s [-p producers,...] [-n items-per-producer]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (items < 1 || items > UINT32_MAX) {
+        fprintf(stderr, "items must be in 1..%u\n", UINT32_MAX);
+        return EXIT_FAILURE;
+    }
+
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    printf("%-6s %9s %12s %10s %14s %14s %12s %8s\n", "scheme", "producers", "items",
+           "Mitems/s", "signals/item", "wakeups/item", "items/wakeup", "errors");
+
+    int failures = 0;
+    char *list = strdup(producer_list);
+    for (char *tok = strtok(list, ","); tok; tok = strtok(NULL, ",")) {
+        int producers = atoi(tok);
+        if (producers < 1 || producers > MAX_PRODUCERS) {
+            fprintf(stderr, "producers must be in 1..%d\n", MAX_PRODUCERS);
+            failures++;
+            continue;
+        }
+        if (run(SCHEME_MPSC, producers, items) == -1) failures++;
+        if (run(SCHEME_MUTEX, producers, items) == -1) failures++;
+    }
+    free(list);
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
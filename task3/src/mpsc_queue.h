@@ -0,0 +1,59 @@
+#ifndef MPSC_QUEUE_H
+#define MPSC_QUEUE_H
+
+/*
+ * Неблокирующая очередь «много производителей — один потребитель» для
+ * передачи работы в цикл событий.
+ *
+ * Узлы интрузивные (mpsc_node_t встраивается в задачу). Производитель
+ * кладёт узел в голову стека одним CAS; потребитель забирает сразу всё
+ * одним atomic_exchange и разворачивает цепочку в порядок постановки.
+ * Поштучного извлечения нет, поэтому нет и проблемы ABA.
+ *
+ * mpsc_push сообщает, была ли очередь пуста: будить потребителя (eventfd)
+ * нужно только на переходе «пусто → не пусто». Узлы, добавленные к
+ * непустой очереди, заберёт уже обещанный разбор; добавленные после
+ * mpsc_take_all снова увидят пустую очередь и разбудят потребителя.
+ */
+
+#include <stdatomic.h>
+#include <stddef.h>
+
+typedef struct mpsc_node {
+    struct mpsc_node *next;
+} mpsc_node_t;
+
+typedef struct {
+    _Atomic(mpsc_node_t *) head;    // последний добавленный узел
+} mpsc_queue_t;
+
+static inline void mpsc_init(mpsc_queue_t *q) {
+    atomic_init(&q->head, NULL);
+}
+
+// Добавить узел. Возвращает 1, если очередь была пуста.
+static inline int mpsc_push(mpsc_queue_t *q, mpsc_node_t *node) {
+    mpsc_node_t *old = atomic_load_explicit(&q->head, memory_order_relaxed);
+    do {
+        node->next = old;
+    } while (!atomic_compare_exchange_weak_explicit(&q->head, &old, node,
+                                                    memory_order_release,
+                                                    memory_order_relaxed));
+    return old == NULL;
+}
+
+// Забрать все узлы (только потребитель). Цепочка по next в порядке
+// постановки, NULL — очередь пуста.
+static inline mpsc_node_t *mpsc_take_all(mpsc_queue_t *q) {
+    mpsc_node_t *node = atomic_exchange_explicit(&q->head, NULL, memory_order_acquire);
+    mpsc_node_t *fifo = NULL;
+    while (node) {
+        mpsc_node_t *next = node->next;
+        node->next = fifo;
+        fifo = node;
+        node = next;
+    }
+    return fifo;
+}
+
+#endif // MPSC_QUEUE_H
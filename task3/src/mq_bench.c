@@ -0,0 +1,228 @@
+/*
+ * Пропускная способность posix_mq_server: кэш очередей ответа против
+ * mq_open/mq_close на каждое сообщение
+ *
+ * Для каждого числа клиентов из -c сервер запускается дважды: с -O
+ * (открыть очередь ответа, отправить, закрыть — прежнее поведение) и с
+ * LRU-кэшем дескрипторов (-C передаётся серверу). Каждый клиент —
+ * отдельный процесс со своей очередью ответа, одно сообщение в полёте
+ * (замкнутый цикл).
+ *
+ * Печатает обменов (round trip) в секунду и перцентили задержки обмена.
+ * Код возврата ненулевой при ошибках.
+ *
+ * Запуск: ./bin/mq_bench -x ./bin/posix_mq_server [-c 1,4,16,64] [-d секунд]
+ *                        [-C очередей в кэше]
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <mqueue.h>
+#include <signal.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include "common.h"
+#include "lat_hist.h"
+
+#define MAX_CLIENTS 128
+#define MAX_COUNTS 16
+
+typedef struct {
+    const char *server;
+    int counts[MAX_COUNTS];
+    int num_counts;
+    double duration;
+    int cache_size;             // 0 — умолчание сервера
+} bench_config_t;
+
+// Результаты клиентов — в разделяемой памяти, у каждого своя гистограмма.
+typedef struct {
+    lat_hist_t rtt;             // нс
+    uint64_t round_trips;
+    uint64_t errors;
+} client_result_t;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static pid_t spawn_server(const bench_config_t *cfg, int open_per_msg) {
+    // Очередь от прошлого запуска не должна сойти за готовность сервера.
+    mq_unlink(SERVER_QUEUE_NAME);
+    pid_t pid = fork();
+    if (pid == 0) {
+        char cache[16];
+        snprintf(cache, sizeof(cache), "%d", cfg->cache_size);
+        if (!freopen("/dev/null", "w", stdout)) _exit(127);
+        if (open_per_msg) {
+            execl(cfg->server, cfg->server, "-q", "-O", (char *)NULL);
+        } else if (cfg->cache_size > 0) {
+            execl(cfg->server, cfg->server, "-q", "-C", cache, (char *)NULL);
+        } else {
+            execl(cfg->server, cfg->server, "-q", (char *)NULL);
+        }
+        perror("execl");
+        _exit(127);
+    }
+    for (int i = 0; pid > 0 && i < 200; ++i) {
+        mqd_t q = mq_open(SERVER_QUEUE_NAME, O_WRONLY);
+        if (q != (mqd_t)-1) {
+            mq_close(q);
+            return pid;
+        }
+        usleep(10000);
+    }
+    if (pid > 0) {
+        kill(pid, SIGKILL);
+        waitpid(pid, NULL, 0);
+    }
+    return -1;
+}
+
+static void client_main(client_result_t *res, uint64_t start, uint64_t end) {
+    struct mq_attr attr = {.mq_maxmsg = 10, .mq_msgsize = MAX_MSG_SIZE};
+    mq_request_t req;
+    memset(&req, 0, sizeof(req));
+    snprintf(req.reply_to, sizeof(req.reply_to), "%s.%d", CLIENT_QUEUE_NAME, (int)getpid());
+    req.session = (uint32_t)now_ns();
+    strcpy(req.text, "round trip");
+    size_t len = offsetof(mq_request_t, text) + strlen(req.text) + 1;
+
+    mq_unlink(req.reply_to);
+    mqd_t reply = mq_open(req.reply_to, O_CREAT | O_RDONLY, 0600, &attr);
+    mqd_t server = mq_open(SERVER_QUEUE_NAME, O_WRONLY);
+    if (reply == (mqd_t)-1 || server == (mqd_t)-1) {
+        perror("mq_open");
+        res->errors++;
+        _exit(1);
+    }
+
+    struct timespec ts = {.tv_sec = (time_t)(start / 1000000000ull), .tv_nsec = (long)(start % 1000000000ull)};
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {}
+    char buf[MAX_MSG_SIZE];
+    uint64_t t = now_ns();
+    while (t < end) {
+        if (mq_send(server, (const char *)&req, len, MSG_PRIO_NORMAL) == -1 ||
+            mq_receive(reply, buf, sizeof(buf), NULL) == -1) {
+            perror("mq_send/mq_receive");
+            res->errors++;
+            break;
+        }
+        uint64_t t1 = now_ns();
+        lat_hist_record(&res->rtt, t1 - t);
+        res->round_trips++;
+        t = t1;
+    }
+    mq_close(server);
+    mq_close(reply);
+    mq_unlink(req.reply_to);
+    _exit(res->errors ? 1 : 0);
+}
+
+static int run_case(const bench_config_t *cfg, int clients, int open_per_msg, client_result_t *res) {
+    const char *name = open_per_msg ? "open" : "cache";
+    pid_t server = spawn_server(cfg, open_per_msg);
+    if (server == -1) {
+        fprintf(stderr, "%s: server did not start\n", name);
+        return -1;
+    }
+    memset(res, 0, sizeof(*res) * (size_t)clients);
+    uint64_t start = now_ns() + 100000000ull; // все клиенты успеют открыть очереди
+    uint64_t end = start + (uint64_t)(cfg->duration * 1e9);
+    pid_t pids[MAX_CLIENTS];
+    for (int i = 0; i < clients; ++i) {
+        lat_hist_init(&res[i].rtt);
+        if ((pids[i] = fork()) == 0) client_main(&res[i], start, end);
+    }
+    int rc = 0;
+    for (int i = 0; i < clients; ++i) {
+        int status;
+        if (pids[i] <= 0 || waitpid(pids[i], &status, 0) != pids[i] || !WIFEXITED(status) ||
+            WEXITSTATUS(status) != 0) {
+            rc = -1;
+        }
+    }
+    kill(server, SIGTERM);
+    waitpid(server, NULL, 0);
+
+    lat_hist_t all;
+    lat_hist_init(&all);
+    uint64_t total = 0;
+    for (int i = 0; i < clients; ++i) {
+        lat_hist_merge(&all, &res[i].rtt);
+        total += res[i].round_trips;
+    }
+    printf("%-6s %8d %12.0f %9.1f %9.1f %9.1f\n", name, clients, (double)total / cfg->duration,
+           lat_hist_percentile(&all, 50) / 1e3, lat_hist_percentile(&all, 99) / 1e3, (double)all.max / 1e3);
+    if (rc == -1 || total == 0) {
+        fprintf(stderr, "%s, %d clients: client errors\n", name, clients);
+        return -1;
+    }
+    return 0;
+}
+
+static int parse_counts(bench_config_t *cfg, char *arg) {
+    cfg->num_counts = 0;
+    for (char *tok = strtok(arg, ","); tok; tok = strtok(NULL, ",")) {
+        int n = atoi(tok);
+        if (n < 1 || n > MAX_CLIENTS || cfg->num_counts == MAX_COUNTS) return -1;
+        cfg->counts[cfg->num_counts++] = n;
+    }
+    return cfg->num_counts ? 0 : -1;
+}
+
+int main(int argc, char *argv[]) {
+    bench_config_t cfg = {
+        .server = NULL,
+        .counts = {1, 4, 16, 64},
+        .num_counts = 4,
+        .duration = 1.0,
+        .cache_size = 0,
+    };
+
+    int opt;
+    while ((opt = getopt(argc, argv, "x:c:d:C:")) != -1) {
+        switch (opt) {
+        case 'x': cfg.server = optarg; break;
+        case 'c':
+            if (parse_counts(&cfg, optarg) == -1) goto usage;
+            break;
+        case 'd': cfg.duration = atof(optarg); break;
+        case 'C': cfg.cache_size = atoi(optarg); break;
+        default:
+            goto usage;
+        }
+    }
+    if (!cfg.server || cfg.duration <= 0 || cfg.cache_size < 0) goto usage;
+    setvbuf(stdout, NULL, _IOLBF, 0);
+
+    client_result_t *res = mmap(NULL, sizeof(*res) * MAX_CLIENTS, PROT_READ | PROT_WRITE,
+                                MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (res == MAP_FAILED) {
+        perror("mmap");
+        return EXIT_FAILURE;
+    }
+
+    printf("%-6s %8s %12s %9s %9s %9s\n", "mode", "clients", "rtt/s", "p50_us", "p99_us", "max_us");
+    int failures = 0;
+    for (int i = 0; i < cfg.num_counts; ++i) {
+        failures += run_case(&cfg, cfg.counts[i], 1, res) != 0;
+        failures += run_case(&cfg, cfg.counts[i], 0, res) != 0;
+    }
+
+    munmap(res, sizeof(*res) * MAX_CLIENTS);
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+
+usage:
+    fprintf(stderr, "usage: %s -x server_binary [-c clients[,...]] [-d seconds] [-C cache_size]\n", argv[0]);
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,136 @@
+/*
+ * Кэш открытых очередей ответа POSIX MQ (см. mq_cache.h)
+ */
+#include "mq_cache.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+
+static unsigned key_hash(const char *name, uint32_t session) {
+    uint32_t h = 2166136261u; // FNV-1a
+    for (const unsigned char *p = (const unsigned char *)name; *p; ++p) h = (h ^ *p) * 16777619u;
+    return (h ^ session) * 16777619u;
+}
+
+static void lru_unlink(mq_cache_t *c, int i) {
+    mq_cache_entry_t *e = &c->entries[i];
+    if (e->prev != -1) {
+        c->entries[e->prev].next = e->next;
+    } else {
+        c->head = e->next;
+    }
+    if (e->next != -1) {
+        c->entries[e->next].prev = e->prev;
+    } else {
+        c->tail = e->prev;
+    }
+}
+
+static void lru_push_front(mq_cache_t *c, int i) {
+    mq_cache_entry_t *e = &c->entries[i];
+    e->prev = -1;
+    e->next = c->head;
+    if (c->head != -1) c->entries[c->head].prev = i;
+    c->head = i;
+    if (c->tail == -1) c->tail = i;
+}
+
+// Найти запись; в *link — ссылка на неё в цепочке (для удаления).
+static int find(mq_cache_t *c, const char *name, uint32_t session, int **link) {
+    int *l = &c->buckets[key_hash(name, session) & c->bucket_mask];
+    while (*l != -1) {
+        mq_cache_entry_t *e = &c->entries[*l];
+        if (e->session == session && strcmp(e->name, name) == 0) break;
+        l = &e->hnext;
+    }
+    if (link) *link = l;
+    return *l;
+}
+
+// Убрать запись из таблицы и списка, закрыть дескриптор.
+static void evict(mq_cache_t *c, int i) {
+    mq_cache_entry_t *e = &c->entries[i];
+    int *link;
+    find(c, e->name, e->session, &link);
+    *link = e->hnext;
+    lru_unlink(c, i);
+    mq_close(e->q);
+    e->next = c->free_list;
+    c->free_list = i;
+    c->used--;
+}
+
+int mq_cache_init(mq_cache_t *c, int capacity) {
+    memset(c, 0, sizeof(*c));
+    if (capacity < 1) {
+        errno = EINVAL;
+        return -1;
+    }
+    unsigned nb = 1;
+    while (nb < 2u * (unsigned)capacity) nb <<= 1;
+    c->entries = calloc((size_t)capacity, sizeof(*c->entries));
+    c->buckets = malloc(nb * sizeof(*c->buckets));
+    if (!c->entries || !c->buckets) {
+        free(c->entries);
+        free(c->buckets);
+        return -1;
+    }
+    for (unsigned i = 0; i < nb; ++i) c->buckets[i] = -1;
+    c->bucket_mask = nb - 1;
+    c->capacity = capacity;
+    c->head = c->tail = -1;
+    for (int i = 0; i < capacity; ++i) c->entries[i].next = i + 1 < capacity ? i + 1 : -1;
+    c->free_list = 0;
+    return 0;
+}
+
+void mq_cache_destroy(mq_cache_t *c) {
+    while (c->head != -1) evict(c, c->head);
+    free(c->entries);
+    free(c->buckets);
+    c->entries = NULL;
+    c->buckets = NULL;
+}
+
+mqd_t mq_cache_get(mq_cache_t *c, const char *name, uint32_t session) {
+    int *link;
+    int i = find(c, name, session, &link);
+    if (i != -1) {
+        c->hits++;
+        if (c->head != i) {
+            lru_unlink(c, i);
+            lru_push_front(c, i);
+        }
+        return c->entries[i].q;
+    }
+
+    c->misses++;
+    if (strlen(name) >= MQ_CACHE_NAME_MAX) {
+        errno = ENAMETOOLONG;
+        return (mqd_t)-1;
+    }
+    mqd_t q = mq_open(name, O_WRONLY);
+    if (q == (mqd_t)-1) return q;
+    if (c->free_list == -1) {
+        evict(c, c->tail);
+        c->evictions++;
+        find(c, name, session, &link); // цепочка могла измениться
+    }
+    i = c->free_list;
+    mq_cache_entry_t *e = &c->entries[i];
+    c->free_list = e->next;
+    strcpy(e->name, name);
+    e->session = session;
+    e->q = q;
+    e->hnext = -1;
+    *link = i;
+    lru_push_front(c, i);
+    c->used++;
+    return q;
+}
+
+void mq_cache_drop(mq_cache_t *c, const char *name, uint32_t session) {
+    int i = find(c, name, session, NULL);
+    if (i != -1) evict(c, i);
+}
@@ -0,0 +1,54 @@
+#ifndef MQ_CACHE_H
+#define MQ_CACHE_H
+
+/*
+ * Кэш открытых очередей ответа клиентов POSIX MQ (LRU).
+ *
+ * mq_open/mq_close на каждое сообщение — два лишних системных вызова и
+ * поиск имени в mqueue-fs. Кэш держит до capacity открытых mqd_t,
+ * ключ — имя очереди ответа и номер сеанса клиента (клиент, заново
+ * создавший очередь с тем же именем, получит новый дескриптор, а старый
+ * вытеснится как давно не использованный). Поиск — хеш-таблица с
+ * цепочками, порядок использования — двусвязный список: попадание,
+ * промах и вытеснение — O(1).
+ *
+ * Кэш однопоточный: у каждого потока-обработчика свой.
+ */
+
+#include <mqueue.h>
+#include <stdint.h>
+
+#define MQ_CACHE_NAME_MAX 32    // имя очереди вместе с '\0'
+
+typedef struct {
+    char name[MQ_CACHE_NAME_MAX];
+    uint32_t session;
+    mqd_t q;
+    int prev, next;             // список LRU, -1 — конец
+    int hnext;                  // цепочка корзины хеш-таблицы
+} mq_cache_entry_t;
+
+typedef struct {
+    mq_cache_entry_t *entries;
+    int *buckets;               // индексы голов цепочек, -1 — пусто
+    unsigned bucket_mask;
+    int capacity;
+    int used;                   // записей в списке LRU
+    int free_list;              // свободные записи (через next)
+    int head, tail;             // самый свежий и самый давний
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+} mq_cache_t;
+
+int mq_cache_init(mq_cache_t *c, int capacity);
+void mq_cache_destroy(mq_cache_t *c); // закрывает все дескрипторы
+
+// Дескриптор очереди name (O_WRONLY), открывает её при промахе.
+// (mqd_t)-1 и errno от mq_open, если очередь открыть нельзя.
+mqd_t mq_cache_get(mq_cache_t *c, const char *name, uint32_t session);
+
+// Забыть и закрыть дескриптор (например, после ошибки mq_send).
+void mq_cache_drop(mq_cache_t *c, const char *name, uint32_t session);
+
+#endif // MQ_CACHE_H
@@ -0,0 +1,248 @@
+/*
+ * Задержка срочных запросов posix_mq_server под потоком обычных
+ * (пул -w с приоритетами планировщика по полосам)
+ *
+ * Две фазы по -d секунд, в каждой сервер запускается заново:
+ *  - single: один поток сервера (-w 0) — приоритет сообщения меняет
+ *            только порядок в очереди;
+ *  - pool:   пул из -w потоков, срочный запрос обслуживается потоком
+ *            SCHED_FIFO полосы high.
+ *
+ * Поток обычных запросов — -f процессов (SCHED_OTHER), у каждого своя
+ * очередь ответа и один запрос MSG_PRIO_NORMAL в полёте (замкнутый
+ * цикл). Срочный клиент — процесс SCHED_FIFO: раз в -i мкс отправляет
+ * запрос MSG_PRIO_HIGH и ждёт ответа. Приоритет ответа проверяется: он
+ * должен совпадать с приоритетом запроса.
+ *
+ * Печатает обменов в секунду и перцентили обычных клиентов и перцентили
+ * срочного. Код возврата ненулевой при ошибках.
+ *
+ * Запуск: ./bin/mq_prio_bench -x ./bin/posix_mq_server [-f клиентов]
+ *                             [-w потоков] [-d секунд] [-i мкс]
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <mqueue.h>
+#include <sched.h>
+#include <signal.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include "common.h"
+#include "lat_hist.h"
+
+#define MAX_FLOODERS 64
+#define PROBE_RT_PRIO 60        // выше потоков сервера (10 и 40)
+
+typedef struct {
+    const char *server;
+    int flooders;
+    int workers;
+    double duration;
+    long interval_us;
+} bench_config_t;
+
+// Результаты дочерних процессов — в разделяемой памяти.
+typedef struct {
+    lat_hist_t rtt;             // нс
+    uint64_t errors;
+} client_result_t;
+
+typedef struct {
+    client_result_t probe;
+    client_result_t flood[MAX_FLOODERS];
+} shared_result_t;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static pid_t spawn_server(const bench_config_t *cfg, int workers) {
+    // Очередь от прошлого запуска не должна сойти за готовность сервера.
+    mq_unlink(SERVER_QUEUE_NAME);
+    pid_t pid = fork();
+    if (pid == 0) {
+        char w[16];
+        snprintf(w, sizeof(w), "%d", workers);
+        if (!freopen("/dev/null", "w", stdout)) _exit(127);
+        execl(cfg->server, cfg->server, "-q", "-w", w, (char *)NULL);
+        perror("execl");
+        _exit(127);
+    }
+    for (int i = 0; pid > 0 && i < 200; ++i) {
+        mqd_t q = mq_open(SERVER_QUEUE_NAME, O_WRONLY);
+        if (q != (mqd_t)-1) {
+            mq_close(q);
+            return pid;
+        }
+        usleep(10000);
+    }
+    if (pid > 0) {
+        kill(pid, SIGKILL);
+        waitpid(pid, NULL, 0);
+    }
+    return -1;
+}
+
+// Клиент: interval_us == 0 — замкнутый цикл, иначе запрос раз в interval_us.
+static void client_main(client_result_t *res, unsigned prio, long interval_us, uint64_t start, uint64_t end) {
+    struct mq_attr attr = {.mq_maxmsg = 10, .mq_msgsize = MAX_MSG_SIZE};
+    mq_request_t req;
+    memset(&req, 0, sizeof(req));
+    snprintf(req.reply_to, sizeof(req.reply_to), "%s.%d", CLIENT_QUEUE_NAME, (int)getpid());
+    req.session = (uint32_t)now_ns();
+    strcpy(req.text, prio >= MSG_PRIO_HIGH ? "urgent" : "normal");
+    size_t len = offsetof(mq_request_t, text) + strlen(req.text) + 1;
+
+    mq_unlink(req.reply_to);
+    mqd_t reply = mq_open(req.reply_to, O_CREAT | O_RDONLY, 0600, &attr);
+    mqd_t server = mq_open(SERVER_QUEUE_NAME, O_WRONLY);
+    if (reply == (mqd_t)-1 || server == (mqd_t)-1) {
+        perror("mq_open");
+        res->errors++;
+        _exit(1);
+    }
+
+    uint64_t interval = (uint64_t)interval_us * 1000;
+    char buf[MAX_MSG_SIZE];
+    for (uint64_t due = start; due < end; due += interval) {
+        if (interval || due == start) {
+            struct timespec ts = {.tv_sec = (time_t)(due / 1000000000ull), .tv_nsec = (long)(due % 1000000000ull)};
+            while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {}
+        }
+        uint64_t t0 = now_ns();
+        unsigned got_prio;
+        if (mq_send(server, (const char *)&req, len, prio) == -1 ||
+            mq_receive(reply, buf, sizeof(buf), &got_prio) == -1) {
+            perror("mq_send/mq_receive");
+            res->errors++;
+            break;
+        }
+        uint64_t t1 = now_ns();
+        if (got_prio != prio) res->errors++;
+        lat_hist_record(&res->rtt, t1 - t0);
+        if (!interval) due = t1;
+    }
+    mq_close(server);
+    mq_close(reply);
+    mq_unlink(req.reply_to);
+    _exit(res->errors ? 1 : 0);
+}
+
+static void probe_main(const bench_config_t *cfg, client_result_t *res, uint64_t start, uint64_t end) {
+    struct sched_param sp = {.sched_priority = PROBE_RT_PRIO};
+    if (sched_setscheduler(0, SCHED_FIFO, &sp) == -1) perror("WARNING: probe SCHED_FIFO");
+    client_main(res, MSG_PRIO_HIGH, cfg->interval_us, start, end);
+}
+
+static int wait_child(pid_t pid) {
+    int status;
+    if (pid <= 0 || waitpid(pid, &status, 0) != pid) return -1;
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0 ? 0 : -1;
+}
+
+static int run_phase(const bench_config_t *cfg, const char *name, int workers, shared_result_t *res) {
+    memset(res, 0, sizeof(*res));
+    lat_hist_init(&res->probe.rtt);
+
+    pid_t server = spawn_server(cfg, workers);
+    if (server == -1) {
+        fprintf(stderr, "%s: server did not start\n", name);
+        return -1;
+    }
+    uint64_t start = now_ns() + 100000000ull; // все клиенты успеют открыть очереди
+    uint64_t end = start + (uint64_t)(cfg->duration * 1e9);
+    pid_t pids[MAX_FLOODERS];
+    for (int i = 0; i < cfg->flooders; ++i) {
+        lat_hist_init(&res->flood[i].rtt);
+        if ((pids[i] = fork()) == 0) client_main(&res->flood[i], MSG_PRIO_NORMAL, 0, start, end);
+    }
+    // Замер начинается, когда поток обычных запросов уже разогнался.
+    pid_t probe_pid = fork();
+    if (probe_pid == 0) probe_main(cfg, &res->probe, start + (end - start) / 5, end);
+
+    int rc = wait_child(probe_pid);
+    for (int i = 0; i < cfg->flooders; ++i) {
+        if (wait_child(pids[i]) == -1) rc = -1;
+    }
+    kill(server, SIGTERM);
+    waitpid(server, NULL, 0);
+
+    lat_hist_t flood;
+    lat_hist_init(&flood);
+    uint64_t errors = res->probe.errors;
+    for (int i = 0; i < cfg->flooders; ++i) {
+        lat_hist_merge(&flood, &res->flood[i].rtt);
+        errors += res->flood[i].errors;
+    }
+    const lat_hist_t *h = &res->probe.rtt;
+    printf("%-6s %7d %10.0f %9.1f %9.1f %7llu %9.1f %9.1f %9.1f\n", name, workers,
+           (double)flood.total / cfg->duration, lat_hist_percentile(&flood, 50) / 1e3,
+           lat_hist_percentile(&flood, 99) / 1e3, (unsigned long long)h->total,
+           lat_hist_percentile(h, 50) / 1e3, lat_hist_percentile(h, 99) / 1e3, (double)h->max / 1e3);
+    if (rc == -1 || errors || h->total == 0 || flood.total == 0) {
+        fprintf(stderr, "%s: client errors (%llu; reply priority mismatches count as errors)\n", name,
+                (unsigned long long)errors);
+        return -1;
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    bench_config_t cfg = {
+        .server = NULL,
+        .flooders = 8,
+        .workers = 4,
+        .duration = 1.0,
+        .interval_us = 1000,
+    };
+
+    int opt;
+    while ((opt = getopt(argc, argv, "x:f:w:d:i:")) != -1) {
+        switch (opt) {
+        case 'x': cfg.server = optarg; break;
+        case 'f': cfg.flooders = atoi(optarg); break;
+        case 'w': cfg.workers = atoi(optarg); break;
+        case 'd': cfg.duration = atof(optarg); break;
+        case 'i': cfg.interval_us = atol(optarg); break;
+        default:
+            goto usage;
+        }
+    }
+    if (!cfg.server || cfg.flooders < 1 || cfg.flooders > MAX_FLOODERS || cfg.workers < 1 ||
+        cfg.duration <= 0 || cfg.interval_us < 1) {
+        goto usage;
+    }
+    setvbuf(stdout, NULL, _IOLBF, 0);
+
+    shared_result_t *res = mmap(NULL, sizeof(*res), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (res == MAP_FAILED) {
+        perror("mmap");
+        return EXIT_FAILURE;
+    }
+
+    printf("flood: %d clients x 1 normal request in flight; urgent: SCHED_FIFO %d, every %ld us\n",
+           cfg.flooders, PROBE_RT_PRIO, cfg.interval_us);
+    printf("%-6s %7s %10s %9s %9s %7s %9s %9s %9s\n", "phase", "workers", "normal/s", "norm_p50", "norm_p99",
+           "urgent", "urg_p50", "urg_p99", "urg_max");
+    int failures = 0;
+    failures += run_phase(&cfg, "single", 0, res) != 0;
+    failures += run_phase(&cfg, "pool", cfg.workers, res) != 0;
+
+    munmap(res, sizeof(*res));
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+
+usage:
+    fprintf(stderr, "usage: %s -x server_binary [-f flooders] [-w workers] [-d seconds] [-i interval_us]\n",
+            argv[0]);
+    return EXIT_FAILURE;
+}
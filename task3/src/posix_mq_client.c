@@ -3,30 +3,114 @@
  *
  * Отправляет сообщения на сервер и ждет ответа.
  * Демонстрирует отправку сообщений с разными приоритетами.
+ *
+ * Очередь ответа у клиента своя (CLIENT_QUEUE_NAME.pid), её имя уходит
+ * в каждом запросе — клиентов можно запускать сколько угодно сразу.
+ *
+ * С -s байт каждое сообщение повторяется до этого размера и уходит через
+ * пул буферов сервера (гибридный режим, см. posix_mq_server.c): в очередь
+ * попадает только дескриптор, ответ читается прямо из буфера.
+ *
+ * Запуск: ./bin/posix_mq_client [-s байт]
  */
+#include <ctype.h>
+#include <errno.h>
 #include <mqueue.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stddef.h>
+#include <time.h>
 #include <unistd.h>
 #include "common.h"
+#include "shm_blob.h"
 
-int main() {
+// Отправить text, повторённый до size байт, через пул и проверить ответ.
+static int send_blob(mqd_t mq_server, mqd_t mq_client, shm_blob_t *pool, mq_request_t *req,
+                     const char *text, size_t size, unsigned priority) {
+    shm_blob_desc_t desc;
+    char *data = shm_blob_alloc(pool, &desc, 5000);
+    if (!data) {
+        perror("shm_blob_alloc");
+        return -1;
+    }
+    size_t n = strlen(text);
+    for (size_t i = 0; i < size; i++) data[i] = text[i % n];
+    desc.len = size;
+
+    req->flags = MQ_REQ_BLOB;
+    memcpy(req->text, &desc, sizeof(desc));
+    int rc = -1;
+    if (mq_send(mq_server, (const char *)req, offsetof(mq_request_t, text) + sizeof(desc), priority) == -1) {
+        perror("mq_send");
+    } else {
+        char buffer[MAX_MSG_SIZE];
+        shm_blob_desc_t answer;
+        const char *reply = NULL;
+        ssize_t got = mq_receive(mq_client, buffer, MAX_MSG_SIZE, NULL);
+        if (got == (ssize_t)sizeof(answer)) {
+            memcpy(&answer, buffer, sizeof(answer));
+            reply = shm_blob_get(pool, &answer);
+        }
+        if (!reply) {
+            perror("mq_receive (blob)");
+        } else {
+            size_t bad = 0;
+            for (size_t i = 0; i < size; i++) bad += reply[i] != toupper((unsigned char)text[i % n]);
+            printf("Received answer: %zu bytes \"%.*s...\" (%zu mismatches)\n\n", size, (int)(n < size ? n : size),
+                   reply, bad);
+            rc = bad ? -1 : 0;
+        }
+    }
+    shm_blob_free(pool, &desc);
+    return rc;
+}
+
+int main(int argc, char *argv[]) {
     mqd_t mq_server, mq_client;
     struct mq_attr attr;
+    mq_request_t req;
+    size_t blob_size = 0;
+    shm_blob_t *pool = NULL;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "s:")) != -1) {
+        switch (opt) {
+        case 's': blob_size = strtoull(optarg, NULL, 0); break;
+        default:
+            fprintf(stderr, "usage: %s [-s blob_bytes]\n", argv[0]);
+            exit(1);
+        }
+    }
 
     attr.mq_flags = 0;
     attr.mq_maxmsg = 10;
     attr.mq_msgsize = MAX_MSG_SIZE;
     attr.mq_curmsgs = 0;
 
+    memset(&req, 0, sizeof(req));
+    snprintf(req.reply_to, sizeof(req.reply_to), "%s.%d", CLIENT_QUEUE_NAME, (int)getpid());
+    req.session = (uint32_t)time(NULL);
+
     mq_server = mq_open(SERVER_QUEUE_NAME, O_WRONLY);
     if (mq_server == (mqd_t)-1) {
         perror("mq_open (server)");
         exit(1);
     }
+    if (blob_size) {
+        pool = shm_blob_open(MQ_POOL_NAME);
+        if (!pool) {
+            perror("shm_blob_open");
+            exit(1);
+        }
+        if (blob_size > shm_blob_buf_size(pool)) {
+            fprintf(stderr, "-s: the server pool holds at most %zu bytes per message\n", shm_blob_buf_size(pool));
+            exit(1);
+        }
+    }
 
-    mq_client = mq_open(CLIENT_QUEUE_NAME, O_CREAT | O_RDONLY, 0644, &attr);
+    mq_unlink(req.reply_to);
+    mq_client = mq_open(req.reply_to, O_CREAT | O_RDONLY, 0644, &attr);
     if (mq_client == (mqd_t)-1) {
         perror("mq_open (client)");
         exit(1);
@@ -34,10 +118,19 @@ int main() {
 
     char *messages[] = {"ordinary message 1", "urgent message!", "ordinary message 2"};
     unsigned int priorities[] = {MSG_PRIO_NORMAL, MSG_PRIO_HIGH, MSG_PRIO_NORMAL};
+    int failures = 0;
 
     for (int i = 0; i < 3; ++i) {
+        if (pool) {
+            printf("Send %zu-byte blob with priority %u: \"%s\"...\n", blob_size, priorities[i], messages[i]);
+            failures += send_blob(mq_server, mq_client, pool, &req, messages[i], blob_size, priorities[i]) != 0;
+            sleep(1);
+            continue;
+        }
         printf("Send message with priority %u: \"%s\"\n", priorities[i], messages[i]);
-        if (mq_send(mq_server, messages[i], strlen(messages[i]) + 1, priorities[i]) == -1) {
+        snprintf(req.text, sizeof(req.text), "%s", messages[i]);
+        size_t len = offsetof(mq_request_t, text) + strlen(req.text) + 1;
+        if (mq_send(mq_server, (const char *)&req, len, priorities[i]) == -1) {
             perror("mq_send");
             continue;
         }
@@ -48,12 +141,13 @@ int main() {
         } else {
             perror("mq_receive");
         }
-        sleep(1); 
+        sleep(1);
     }
 
+    shm_blob_close(pool);
     mq_close(mq_server);
     mq_close(mq_client);
-    mq_unlink(CLIENT_QUEUE_NAME);
+    mq_unlink(req.reply_to);
 
-    return 0;
+    return failures ? 1 : 0;
 }
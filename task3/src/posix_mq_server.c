@@ -3,25 +3,347 @@
  *
  * Ожидает сообщения от клиентов, преобразует их в верхний регистр
  * и отправляет обратно. Демонстрирует работу с приоритетами.
+ *
+ * Клиентов может быть много: в запросе (mq_request_t) клиент указывает
+ * свою очередь ответа. Открытые очереди ответа держит LRU-кэш (mq_cache.h),
+ * поэтому постоянный клиент обходится без mq_open/mq_close на каждое
+ * сообщение; -O — прежнее поведение (открыть, отправить, закрыть) для
+ * сравнения в mq_bench. Ответ уходит с тем же приоритетом, что и запрос.
+ *
+ * Приоритет сообщения влияет только на порядок в очереди: если сервер
+ * сам вытеснен (нагрузкой клиентов на том же ядре), срочный запрос ждёт
+ * вместе с остальными. С -w N запросы обслуживает пул из N потоков, и
+ * поток на время обработки принимает приоритет планировщика по полосе
+ * приоритета сообщения (bands[]): обычные — SCHED_FIFO 10, срочные —
+ * SCHED_FIFO 40, нулевой — SCHED_OTHER. Приоритет меняется только при
+ * смене полосы, ожидающие потоки ядро будит в порядке их приоритета.
+ * При завершении печатаются перцентили времени обслуживания (от приёма
+ * запроса до отправки ответа) по полосам. Демонстрация — mq_prio_bench.
+ *
+ * Большие сообщения (гибридный режим): сервер создаёт пул буферов в общей
+ * памяти (MQ_POOL_NAME, -N буферов по -S байт, shm_blob.h). Клиент пишет
+ * данные прямо в буфер пула и отправляет запрос с MQ_REQ_BLOB, где вместо
+ * текста лежит дескриптор (смещение, длина, поколение). Сервер переводит
+ * данные на месте (векторно, ascii.h) и возвращает тот же дескриптор с тем же приоритетом;
+ * буфер освобождает клиент. Через очередь идут десятки байт при любом
+ * размере данных, а порядок по приоритетам остаётся за очередью.
+ *
+ * Плюсы MQ: границы и приоритеты сообщений, очередь живёт в ядре и
+ * переживает процессы, дескриптор очереди на Linux — обычный fd (poll).
+ * Минусы: сообщение не больше mq_msgsize, в очереди не больше mq_maxmsg
+ * (по умолчанию 10 — /proc/sys/fs/mqueue/msg_max), системный вызов и две
+ * копии на сообщение.
+ *
+ * Главный поток ждёт в цикле событий (reactor.h): сигналы завершения
+ * приходят через signalfd, статистика по -T — через timerfd, а без пула
+ * там же и очередь запросов (mqd_t на Linux — обычный fd), которая
+ * вычитывается без блокировки пачками по MQ_BATCH.
+ *
+ * Запуск: ./bin/posix_mq_server [-C очередей в кэше] [-O] [-w потоков]
+ *                               [-N буферов] [-S размер буфера] [-T секунд] [-q]
  */
+#define _GNU_SOURCE
 #include <mqueue.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <ctype.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sched.h>
+#include <signal.h>
+#include <stddef.h>
+#include <time.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include "ascii.h"
 #include "common.h"
+#include "lat_hist.h"
+#include "mq_cache.h"
+#include "reactor.h"
+#include "shm_blob.h"
+
+#define REPLY_CACHE_SIZE 64
+#define MAX_WORKERS 64
+#define MQ_BATCH 64             // запросов за один разбор готовности очереди
+#define BLOB_BUFFERS 8
+#define BLOB_SIZE (16u << 20)
+
+// Полосы приоритетов сообщений и приоритет потока для каждой (-w).
+static const struct {
+    const char *name;
+    unsigned min_prio;          // приоритеты сообщения от min_prio до следующей полосы
+    int rt_prio;                // SCHED_FIFO, 0 — SCHED_OTHER
+} bands[] = {
+    {"idle", 0, 0},
+    {"normal", MSG_PRIO_NORMAL, 10},
+    {"high", MSG_PRIO_HIGH, 40},
+};
+#define NUM_BANDS ((int)(sizeof(bands) / sizeof(bands[0])))
+
+// Обработчик запросов: в однопоточном режиме один, в пуле — на поток.
+typedef struct {
+    pthread_t thread;
+    mq_cache_t cache;
+    int band;                   // полоса, чей приоритет сейчас у потока (-1 — исходный)
+    _Atomic uint64_t requests;  // читает и таймер статистики главного потока
+    uint64_t blobs;             // из них с данными в пуле
+    uint64_t opens;
+    uint64_t prio_switches;
+    lat_hist_t service[NUM_BANDS]; // нс от приёма до отправки ответа
+} worker_t;
+
+static mqd_t mq_server;
+static shm_blob_t *blobs;       // пул буферов больших сообщений
+static int open_per_msg = 0;
+static int verbose = 1;
+static worker_t *workers;
+static int num_handlers;        // обработчиков в workers (1 без пула)
+static atomic_int stopping;     // пул завершается: пустые сообщения — будильники
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static int band_of(unsigned priority) {
+    int b = 0;
+    while (b + 1 < NUM_BANDS && priority >= bands[b + 1].min_prio) b++;
+    return b;
+}
+
+// Пул: принять приоритет планировщика полосы сообщения.
+static void worker_set_band(worker_t *w, int band) {
+    if (w->band == band) return;
+    struct sched_param sp = {.sched_priority = bands[band].rt_prio};
+    int err = pthread_setschedparam(pthread_self(), sp.sched_priority ? SCHED_FIFO : SCHED_OTHER, &sp);
+    if (err != 0) {
+        static int warned;
+        if (!warned++) fprintf(stderr, "WARNING: SCHED_FIFO %d: %s\n", sp.sched_priority, strerror(err));
+    }
+    w->band = band;
+    w->prio_switches++;
+}
+
+// Обработать один запрос длиной len и ответить с его приоритетом.
+static void serve_request(worker_t *w, mq_request_t *req, ssize_t len, unsigned priority, uint64_t t0) {
+    // Текст может быть короче поля: отрезаем по фактической длине.
+    size_t hdr = offsetof(mq_request_t, text);
+    if ((size_t)len <= hdr || memchr(req->reply_to, '\0', sizeof(req->reply_to)) == NULL ||
+        req->reply_to[0] != '/') {
+        fprintf(stderr, "Dropping malformed request (%zd bytes)\n", len);
+        return;
+    }
+    const char *reply = req->text;
+    size_t reply_len;
+    if (req->flags & MQ_REQ_BLOB) {
+        // Данные в пуле: переводим их на месте и возвращаем тот же дескриптор.
+        shm_blob_desc_t desc;
+        char *data = NULL;
+        if ((size_t)len == hdr + sizeof(desc)) {
+            memcpy(&desc, req->text, sizeof(desc));
+            data = shm_blob_get(blobs, &desc);
+        }
+        if (!data) {
+            fprintf(stderr, "Dropping request with a bad blob descriptor: %s\n", strerror(errno));
+            return;
+        }
+        w->requests++;
+        w->blobs++;
+        if (verbose) {
+            printf("Received %llu-byte blob with priority %u from %s\n", (unsigned long long)desc.len, priority,
+                   req->reply_to);
+        }
+        ascii_upper(data, data, desc.len);
+        reply_len = sizeof(desc);
+    } else {
+        size_t text_len = (size_t)len - hdr;
+        if (text_len == sizeof(req->text)) text_len--;
+        req->text[text_len] = '\0';
+        w->requests++;
+        if (verbose) printf("Received message with priority %u from %s: \"%s\"\n", priority, req->reply_to, req->text);
+
+        reply_len = strlen(req->text);
+        ascii_upper(req->text, req->text, reply_len);
+        reply_len++;
+    }
+
+    mqd_t mq_client;
+    if (open_per_msg) {
+        mq_client = mq_open(req->reply_to, O_WRONLY);
+        w->opens++;
+    } else {
+        uint64_t misses = w->cache.misses;
+        mq_client = mq_cache_get(&w->cache, req->reply_to, req->session);
+        w->opens += w->cache.misses - misses;
+    }
+    if (mq_client == (mqd_t)-1) {
+        perror("mq_open (client)");
+        return;
+    }
+
+    if (mq_send(mq_client, reply, reply_len, priority) == -1) {
+        perror("mq_send");
+        if (!open_per_msg) mq_cache_drop(&w->cache, req->reply_to, req->session);
+    } else {
+        lat_hist_record(&w->service[band_of(priority)], now_ns() - t0);
+        if (verbose && !(req->flags & MQ_REQ_BLOB)) printf("Sent answer: \"%s\"\n", req->text);
+    }
+    if (open_per_msg) mq_close(mq_client);
+}
+
+// Поток пула. Сообщение нулевой длины после выставления stopping —
+// команда завершиться; до того это искажённый запрос клиента, и поток
+// его отбрасывает, как и без пула.
+static void *worker_main(void *arg) {
+    worker_t *w = arg;
+    for (;;) {
+        mq_request_t req;
+        unsigned int priority;
+        ssize_t n = mq_receive(mq_server, (char *)&req, MAX_MSG_SIZE, &priority);
+        uint64_t t0 = now_ns();
+        if (n == 0 && atomic_load(&stopping)) break;
+        if (n < 0) {
+            if (errno != EINTR) perror("mq_receive");
+            continue;
+        }
+        worker_set_band(w, band_of(priority));
+        serve_request(w, &req, n, priority, t0);
+    }
+    return NULL;
+}
+
+// Без пула: очередь в reactor, по готовности вычитываем до EAGAIN
+// (не больше MQ_BATCH, чтобы не задерживать другие источники).
+static void on_mq_ready(reactor_source_t *src, uint64_t events, void *arg) {
+    (void)src;
+    (void)events;
+    worker_t *w = arg;
+    for (int i = 0; i < MQ_BATCH; ++i) {
+        mq_request_t req;
+        unsigned int priority;
+        ssize_t n = mq_receive(mq_server, (char *)&req, MAX_MSG_SIZE, &priority);
+        uint64_t t0 = now_ns();
+        if (n < 0) {
+            if (errno != EAGAIN && errno != EINTR) perror("mq_receive");
+            return;
+        }
+        serve_request(w, &req, n, priority, t0);
+    }
+}
 
-void to_upper(char *str) {
-    for (int i = 0; str[i]; i++) {
-        str[i] = toupper(str[i]);
+static void on_signal(reactor_source_t *src, uint64_t signo, void *arg) {
+    (void)src;
+    (void)signo;
+    reactor_stop(arg);
+}
+
+static void on_stats_timer(reactor_source_t *src, uint64_t expirations, void *arg) {
+    (void)src;
+    (void)expirations;
+    uint64_t *last = arg, requests = 0;
+    for (int i = 0; i < num_handlers; ++i) requests += atomic_load_explicit(&workers[i].requests, memory_order_relaxed);
+    printf("stats: requests=%llu (+%llu)\n", (unsigned long long)requests, (unsigned long long)(requests - *last));
+    *last = requests;
+}
+
+static void print_stats(worker_t *workers, int count) {
+    uint64_t requests = 0, blob_count = 0, opens = 0, hits = 0, misses = 0, evictions = 0, switches = 0;
+    lat_hist_t service[NUM_BANDS];
+    for (int b = 0; b < NUM_BANDS; ++b) lat_hist_init(&service[b]);
+    for (int i = 0; i < count; ++i) {
+        requests += workers[i].requests;
+        blob_count += workers[i].blobs;
+        opens += workers[i].opens;
+        hits += workers[i].cache.hits;
+        misses += workers[i].cache.misses;
+        evictions += workers[i].cache.evictions;
+        switches += workers[i].prio_switches;
+        for (int b = 0; b < NUM_BANDS; ++b) lat_hist_merge(&service[b], &workers[i].service[b]);
+    }
+    printf("\nShutting down: requests=%llu blobs=%llu mq_open=%llu cache hits=%llu misses=%llu evictions=%llu "
+           "prio_switches=%llu\n", (unsigned long long)requests, (unsigned long long)blob_count, (unsigned long long)opens,
+           (unsigned long long)hits, (unsigned long long)misses, (unsigned long long)evictions,
+           (unsigned long long)switches);
+    for (int b = 0; b < NUM_BANDS; ++b) {
+        const lat_hist_t *h = &service[b];
+        if (!h->total) continue;
+        printf("  service %-6s (prio >= %2u): n=%llu p50=%.1fus p99=%.1fus max=%.1fus\n", bands[b].name,
+               bands[b].min_prio, (unsigned long long)h->total, lat_hist_percentile(h, 50) / 1e3,
+               lat_hist_percentile(h, 99) / 1e3, (double)h->max / 1e3);
     }
 }
 
-int main() {
-    mqd_t mq_server, mq_client;
+int main(int argc, char *argv[]) {
     struct mq_attr attr;
+    int cache_size = REPLY_CACHE_SIZE;
+    int num_workers = 0;
+    long blob_buffers = BLOB_BUFFERS;
+    double stats_interval = 0;
+    unsigned long long blob_size = BLOB_SIZE;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "C:Ow:N:S:T:q")) != -1) {
+        switch (opt) {
+        case 'C': cache_size = atoi(optarg); break;
+        case 'O': open_per_msg = 1; break;
+        case 'w': num_workers = atoi(optarg); break;
+        case 'N': blob_buffers = atol(optarg); break;
+        case 'S': blob_size = strtoull(optarg, NULL, 0); break;
+        case 'T': stats_interval = atof(optarg); break;
+        case 'q': verbose = 0; break;
+        default:
+            fprintf(stderr, "usage: %s [-C cached_reply_queues] [-O] [-w workers] [-N blob_buffers] "
+                            "[-S blob_size] [-T stats_seconds] [-q]\n", argv[0]);
+            fprintf(stderr, "  -O  open and close the reply queue for every message (no cache)\n");
+            fprintf(stderr, "  -w  worker pool, each request served at the SCHED_FIFO priority of its band\n");
+            fprintf(stderr, "  -N/-S  shared-memory pool %s for large messages (default %d x %u MiB)\n",
+                    MQ_POOL_NAME, BLOB_BUFFERS, BLOB_SIZE >> 20);
+            fprintf(stderr, "  -T  print the request count every T seconds\n");
+            exit(1);
+        }
+    }
+    if (num_workers < 0 || num_workers > MAX_WORKERS) {
+        fprintf(stderr, "-w: 0..%d workers\n", MAX_WORKERS);
+        exit(1);
+    }
+    if (blob_buffers < 1 || blob_size < 1) {
+        fprintf(stderr, "-N/-S: at least one buffer of at least one byte\n");
+        exit(1);
+    }
+
+    int count = num_handlers = num_workers ? num_workers : 1;
+    workers = calloc((size_t)count, sizeof(*workers));
+    if (!workers) {
+        perror("calloc");
+        exit(1);
+    }
+    for (int i = 0; i < count; ++i) {
+        if (mq_cache_init(&workers[i].cache, cache_size) == -1) {
+            perror("mq_cache_init");
+            exit(1);
+        }
+        workers[i].band = -1;
+        for (int b = 0; b < NUM_BANDS; ++b) lat_hist_init(&workers[i].service[b]);
+    }
+
+    // Главный поток ждёт всё сразу в reactor: сигналы (signalfd), таймер
+    // статистики и без пула — саму очередь. Сигналы блокируются до
+    // создания потоков пула, и те наследуют маску.
+    reactor_t *reactor = reactor_create(16);
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, SIGINT);
+    sigaddset(&set, SIGTERM);
+    uint64_t last_requests = 0;
+    if (!reactor || !reactor_add_signals(reactor, &set, on_signal, reactor) ||
+        (stats_interval > 0 && !reactor_add_timer(reactor, (uint64_t)(stats_interval * 1e9),
+                                                  (uint64_t)(stats_interval * 1e9), on_stats_timer,
+                                                  &last_requests))) {
+        perror("reactor");
+        exit(1);
+    }
 
     attr.mq_flags = 0;
     attr.mq_maxmsg = 10;
@@ -29,7 +351,13 @@ int main() {
     attr.mq_curmsgs = 0;
 
     mq_unlink(SERVER_QUEUE_NAME);
-    mq_unlink(CLIENT_QUEUE_NAME);
+
+    // Пул создаётся до очереди: клиент, открывший очередь, найдёт и пул.
+    blobs = shm_blob_create(MQ_POOL_NAME, (size_t)blob_size, (uint32_t)blob_buffers);
+    if (!blobs) {
+        perror("shm_blob_create");
+        exit(1);
+    }
 
     mq_server = mq_open(SERVER_QUEUE_NAME, O_CREAT | O_RDWR, 0644, &attr);
     if (mq_server == (mqd_t)-1) {
@@ -37,39 +365,42 @@ int main() {
         exit(1);
     }
 
-    printf("Server is running and waiting for messages...\n");
-
-    while (1) {
-        char buffer[MAX_MSG_SIZE];
-        unsigned int priority;
-
-        ssize_t bytes_read = mq_receive(mq_server, buffer, MAX_MSG_SIZE, &priority);
-        if (bytes_read >= 0) {
-            buffer[bytes_read] = '\0';
-            printf("Received message with priority %u: \"%s\"\n", priority, buffer);
-
-            to_upper(buffer);
-
-            mq_client = mq_open(CLIENT_QUEUE_NAME, O_WRONLY);
-            if (mq_client == (mqd_t)-1) {
-                perror("mq_open (client)");
-                continue; 
+    if (num_workers) {
+        for (int i = 0; i < num_workers; ++i) {
+            if (pthread_create(&workers[i].thread, NULL, worker_main, &workers[i]) != 0) {
+                perror("pthread_create");
+                exit(1);
             }
+        }
+        printf("Server is running with %d workers and waiting for messages...\n", num_workers);
 
-            if (mq_send(mq_client, buffer, strlen(buffer) + 1, 0) == -1) {
-                perror("mq_send");
-            } else {
-                printf("Sent answer: \"%s\"\n", buffer);
-            }
-            mq_close(mq_client);
-
-        } else {
-            perror("mq_receive");
+        reactor_run(reactor);
+        // Каждому потоку — пустое сообщение с наивысшим приоритетом; флаг
+        // ставится раньше, чтобы пустое сообщение клиента не остановило поток.
+        atomic_store(&stopping, 1);
+        for (int i = 0; i < num_workers; ++i) {
+            if (mq_send(mq_server, "", 0, (unsigned)sysconf(_SC_MQ_PRIO_MAX) - 1) == -1) perror("mq_send (stop)");
+        }
+        for (int i = 0; i < num_workers; ++i) pthread_join(workers[i].thread, NULL);
+    } else {
+        struct mq_attr nonblock = {.mq_flags = O_NONBLOCK};
+        if (mq_setattr(mq_server, &nonblock, NULL) == -1 ||
+            !reactor_add_mq(reactor, mq_server, on_mq_ready, &workers[0])) {
+            perror("reactor_add_mq");
+            exit(1);
         }
+        printf("Server is running and waiting for messages...\n");
+        reactor_run(reactor);
     }
+    reactor_destroy(reactor);
 
+    print_stats(workers, count);
+    for (int i = 0; i < count; ++i) mq_cache_destroy(&workers[i].cache);
+    free(workers);
     mq_close(mq_server);
     mq_unlink(SERVER_QUEUE_NAME);
+    shm_blob_close(blobs);
+    shm_blob_unlink(MQ_POOL_NAME);
 
     return 0;
 }
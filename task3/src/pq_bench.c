@@ -0,0 +1,376 @@
+/*
+ * Очередь с приоритетами в общей памяти (shm_pq.h) против POSIX MQ
+ *
+ * Протокол тот же, что у пары posix_mq_server/posix_mq_client: запрос
+ * mq_request_t с именем очереди ответа клиента, сервер переводит текст в
+ * верхний регистр и отвечает с приоритетом запроса. Сервер — отдельный
+ * процесс, каждый клиент — процесс со своей очередью ответа и одним
+ * запросом в полёте (каждый восьмой — MSG_PRIO_HIGH). Для каждого числа
+ * клиентов из -c пара работает поверх mq и поверх shm_pq; очереди обоих
+ * видов по -m сообщений (у mq не больше /proc/sys/fs/mqueue/msg_max).
+ *
+ * Перед замером проверяется порядок: в очередь без получателя кладутся
+ * сообщения со случайными приоритетами, извлекаться они должны по
+ * убыванию приоритета, а внутри приоритета — в порядке отправки.
+ *
+ * Печатает обменов в секунду и перцентили задержки обмена. Код возврата
+ * ненулевой при ошибках.
+ *
+ * Запуск: ./bin/pq_bench [-c 1,4,16] [-d секунд] [-m сообщений]
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <mqueue.h>
+#include <signal.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include "ascii.h"
+#include "common.h"
+#include "lat_hist.h"
+#include "mq_cache.h"
+#include "shm_pq.h"
+
+#define SHM_SERVER_NAME "/shm_pq_server_ex"
+#define MAX_CLIENTS 64
+#define MAX_COUNTS 16
+#define PRIOS (MSG_PRIO_HIGH + 1)
+#define TIMEOUT_MS 5000
+
+typedef enum { TRANSPORT_MQ, TRANSPORT_SHM } transport_t;
+
+static const char *transport_names[] = {"mq", "shm_pq"};
+
+typedef struct {
+    int counts[MAX_COUNTS];
+    int num_counts;
+    double duration;
+    int maxmsg;
+} bench_config_t;
+
+// Результаты клиентов — в разделяемой памяти, у каждого своя гистограмма.
+typedef struct {
+    lat_hist_t rtt;             // нс
+    uint64_t round_trips;
+    uint64_t errors;
+} client_result_t;
+
+// Очередь любого из двух видов.
+typedef struct {
+    transport_t t;
+    mqd_t mq;
+    shm_pq_t *pq;
+} queue_t;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// Предел mq_maxmsg для непривилегированного процесса (и для root без
+// CAP_SYS_RESOURCE), по умолчанию 10.
+static int mq_msg_max(void) {
+    FILE *f = fopen("/proc/sys/fs/mqueue/msg_max", "r");
+    int v = 10;
+    if (f) {
+        if (fscanf(f, "%d", &v) != 1) v = 10;
+        fclose(f);
+    }
+    return v;
+}
+
+static int queue_create(queue_t *q, transport_t t, const char *name, int maxmsg, int flags) {
+    q->t = t;
+    if (t == TRANSPORT_MQ) {
+        if (maxmsg > mq_msg_max()) maxmsg = mq_msg_max();
+        struct mq_attr attr = {.mq_maxmsg = maxmsg, .mq_msgsize = MAX_MSG_SIZE};
+        mq_unlink(name);
+        q->mq = mq_open(name, O_CREAT | flags, 0600, &attr);
+        return q->mq == (mqd_t)-1 ? -1 : 0;
+    }
+    shm_pq_attr_t attr = {.maxmsg = (uint32_t)maxmsg, .msgsize = MAX_MSG_SIZE, .prios = PRIOS};
+    q->pq = shm_pq_create(name, &attr);
+    return q->pq ? 0 : -1;
+}
+
+static int queue_open(queue_t *q, transport_t t, const char *name) {
+    q->t = t;
+    if (t == TRANSPORT_MQ) {
+        q->mq = mq_open(name, O_WRONLY);
+        return q->mq == (mqd_t)-1 ? -1 : 0;
+    }
+    q->pq = shm_pq_open(name);
+    return q->pq ? 0 : -1;
+}
+
+static void queue_close(queue_t *q, const char *unlink_name) {
+    if (q->t == TRANSPORT_MQ) {
+        mq_close(q->mq);
+        if (unlink_name) mq_unlink(unlink_name);
+    } else {
+        shm_pq_close(q->pq);
+        if (unlink_name) shm_pq_unlink(unlink_name);
+    }
+}
+
+static int queue_send(queue_t *q, const void *msg, size_t len, unsigned prio) {
+    if (q->t == TRANSPORT_MQ) return mq_send(q->mq, msg, len, prio);
+    return shm_pq_send(q->pq, msg, len, prio, TIMEOUT_MS);
+}
+
+static ssize_t queue_receive(queue_t *q, void *buf, size_t len, unsigned *prio, int timeout_ms) {
+    if (q->t == TRANSPORT_MQ) return mq_receive(q->mq, buf, len, prio);
+    return shm_pq_receive(q->pq, buf, len, prio, timeout_ms);
+}
+
+static const char *server_name(transport_t t) {
+    return t == TRANSPORT_MQ ? SERVER_QUEUE_NAME : SHM_SERVER_NAME;
+}
+
+// Порядок извлечения: по убыванию приоритета, внутри приоритета — FIFO.
+static int check_order(transport_t t, int maxmsg) {
+    queue_t q;
+    const char *name = server_name(t);
+    if (queue_create(&q, t, name, maxmsg, O_RDWR) == -1) {
+        perror("queue_create");
+        return -1;
+    }
+    int depth = t == TRANSPORT_MQ && maxmsg > mq_msg_max() ? mq_msg_max() : maxmsg;
+    int rc = 0;
+    unsigned last_prio = PRIOS;
+    uint32_t last_seq[PRIOS];
+    memset(last_seq, 0, sizeof(last_seq));
+    for (int round = 0; round < 100 && rc == 0; ++round) {
+        for (int i = 0; i < depth; ++i) {
+            uint32_t seq = (uint32_t)(round * depth + i + 1);
+            if (queue_send(&q, &seq, sizeof(seq), (unsigned)rand() % PRIOS) == -1) {
+                perror("send");
+                rc = -1;
+                break;
+            }
+        }
+        last_prio = PRIOS;
+        for (int i = 0; i < depth && rc == 0; ++i) {
+            char buf[MAX_MSG_SIZE];
+            unsigned prio;
+            uint32_t seq;
+            if (queue_receive(&q, buf, sizeof(buf), &prio, 0) != (ssize_t)sizeof(seq)) {
+                perror("receive");
+                rc = -1;
+                break;
+            }
+            memcpy(&seq, buf, sizeof(seq));
+            if (prio > last_prio || seq <= last_seq[prio]) {
+                fprintf(stderr, "%s: out of order: prio %u after %u, seq %u after %u\n",
+                        transport_names[t], prio, last_prio, seq, last_seq[prio]);
+                rc = -1;
+            }
+            last_prio = prio;
+            last_seq[prio] = seq;
+        }
+    }
+    queue_close(&q, name);
+    return rc;
+}
+
+// Сервер пары: как posix_mq_server, очереди ответа открываются один раз.
+static void server_main(transport_t t, queue_t *requests) {
+    mq_cache_t cache;
+    struct {
+        char name[MQ_REPLY_NAME_MAX];
+        queue_t q;
+    } replies[MAX_CLIENTS];
+    int num_replies = 0;
+    if (t == TRANSPORT_MQ && mq_cache_init(&cache, MAX_CLIENTS) == -1) _exit(1);
+
+    for (;;) {
+        mq_request_t req;
+        unsigned prio;
+        ssize_t n = queue_receive(requests, &req, sizeof(req), &prio, -1);
+        if (n == 0) break;
+        if (n <= (ssize_t)offsetof(mq_request_t, text)) {
+            if (n == -1 && errno == EINTR) continue;
+            _exit(1);
+        }
+        req.text[n - offsetof(mq_request_t, text) - 1] = '\0';
+        size_t len = strlen(req.text);
+        ascii_upper(req.text, req.text, len++);
+
+        if (t == TRANSPORT_MQ) {
+            mqd_t reply = mq_cache_get(&cache, req.reply_to, req.session);
+            if (reply == (mqd_t)-1 || mq_send(reply, req.text, len, prio) == -1) _exit(1);
+            continue;
+        }
+        int i = 0;
+        while (i < num_replies && strcmp(replies[i].name, req.reply_to) != 0) i++;
+        if (i == num_replies) {
+            if (num_replies == MAX_CLIENTS || queue_open(&replies[i].q, t, req.reply_to) == -1) _exit(1);
+            strcpy(replies[i].name, req.reply_to);
+            num_replies++;
+        }
+        if (queue_send(&replies[i].q, req.text, len, prio) == -1) _exit(1);
+    }
+    for (int i = 0; i < num_replies; ++i) queue_close(&replies[i].q, NULL);
+    if (t == TRANSPORT_MQ) mq_cache_destroy(&cache);
+    _exit(0);
+}
+
+static void client_main(transport_t t, const bench_config_t *cfg, client_result_t *res, uint64_t start,
+                        uint64_t end) {
+    mq_request_t req;
+    memset(&req, 0, sizeof(req));
+    snprintf(req.reply_to, sizeof(req.reply_to), "%s.%d", CLIENT_QUEUE_NAME, (int)getpid());
+    req.session = (uint32_t)now_ns();
+    strcpy(req.text, "round trip");
+    size_t len = offsetof(mq_request_t, text) + strlen(req.text) + 1;
+
+    queue_t reply, server;
+    if (queue_create(&reply, t, req.reply_to, cfg->maxmsg, O_RDONLY) == -1 ||
+        queue_open(&server, t, server_name(t)) == -1) {
+        perror("queue open");
+        res->errors++;
+        _exit(1);
+    }
+
+    struct timespec ts = {.tv_sec = (time_t)(start / 1000000000ull), .tv_nsec = (long)(start % 1000000000ull)};
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {}
+    char buf[MAX_MSG_SIZE];
+    uint64_t t0 = now_ns();
+    for (uint64_t i = 0; t0 < end; ++i) {
+        unsigned prio = i % 8 == 7 ? MSG_PRIO_HIGH : MSG_PRIO_NORMAL, got;
+        if (queue_send(&server, &req, len, prio) == -1 ||
+            queue_receive(&reply, buf, sizeof(buf), &got, TIMEOUT_MS) == -1) {
+            perror("send/receive");
+            res->errors++;
+            break;
+        }
+        uint64_t t1 = now_ns();
+        if (got != prio || strcmp(buf, "ROUND TRIP") != 0) res->errors++;
+        lat_hist_record(&res->rtt, t1 - t0);
+        res->round_trips++;
+        t0 = t1;
+    }
+    queue_close(&server, NULL);
+    queue_close(&reply, req.reply_to);
+    _exit(res->errors ? 1 : 0);
+}
+
+static int run_case(const bench_config_t *cfg, transport_t t, int clients, client_result_t *res) {
+    const char *name = transport_names[t];
+    queue_t requests;
+    if (queue_create(&requests, t, server_name(t), cfg->maxmsg, O_RDWR) == -1) {
+        perror("queue_create (server)");
+        return -1;
+    }
+    pid_t server = fork();
+    if (server == 0) server_main(t, &requests);
+
+    memset(res, 0, sizeof(*res) * (size_t)clients);
+    uint64_t start = now_ns() + 100000000ull; // все клиенты успеют открыть очереди
+    uint64_t end = start + (uint64_t)(cfg->duration * 1e9);
+    pid_t pids[MAX_CLIENTS];
+    for (int i = 0; i < clients; ++i) {
+        lat_hist_init(&res[i].rtt);
+        if ((pids[i] = fork()) == 0) client_main(t, cfg, &res[i], start, end);
+    }
+    int rc = 0;
+    for (int i = 0; i < clients; ++i) {
+        int status;
+        if (pids[i] <= 0 || waitpid(pids[i], &status, 0) != pids[i] || !WIFEXITED(status) ||
+            WEXITSTATUS(status) != 0) {
+            rc = -1;
+        }
+    }
+    // Пустое сообщение — команда серверу завершиться.
+    int status;
+    if (queue_send(&requests, "", 0, PRIOS - 1) == -1 || waitpid(server, &status, 0) != server ||
+        !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        kill(server, SIGKILL);
+        waitpid(server, NULL, 0);
+        rc = -1;
+    }
+    queue_close(&requests, server_name(t));
+
+    lat_hist_t all;
+    lat_hist_init(&all);
+    uint64_t total = 0;
+    for (int i = 0; i < clients; ++i) {
+        lat_hist_merge(&all, &res[i].rtt);
+        total += res[i].round_trips;
+    }
+    printf("%-6s %8d %12.0f %9.1f %9.1f %9.1f\n", name, clients, (double)total / cfg->duration,
+           lat_hist_percentile(&all, 50) / 1e3, lat_hist_percentile(&all, 99) / 1e3, (double)all.max / 1e3);
+    if (rc == -1 || total == 0) {
+        fprintf(stderr, "%s, %d clients: errors\n", name, clients);
+        return -1;
+    }
+    return 0;
+}
+
+static int parse_counts(bench_config_t *cfg, char *arg) {
+    cfg->num_counts = 0;
+    for (char *tok = strtok(arg, ","); tok; tok = strtok(NULL, ",")) {
+        int n = atoi(tok);
+        if (n < 1 || n > MAX_CLIENTS || cfg->num_counts == MAX_COUNTS) return -1;
+        cfg->counts[cfg->num_counts++] = n;
+    }
+    return cfg->num_counts ? 0 : -1;
+}
+
+int main(int argc, char *argv[]) {
+    bench_config_t cfg = {
+        .counts = {1, 4, 16},
+        .num_counts = 3,
+        .duration = 1.0,
+        .maxmsg = 10,
+    };
+
+    int opt;
+    while ((opt = getopt(argc, argv, "c:d:m:")) != -1) {
+        switch (opt) {
+        case 'c':
+            if (parse_counts(&cfg, optarg) == -1) goto usage;
+            break;
+        case 'd': cfg.duration = atof(optarg); break;
+        case 'm': cfg.maxmsg = atoi(optarg); break;
+        default:
+            goto usage;
+        }
+    }
+    if (cfg.duration <= 0 || cfg.maxmsg < 1) goto usage;
+    setvbuf(stdout, NULL, _IOLBF, 0);
+
+    client_result_t *res = mmap(NULL, sizeof(*res) * MAX_CLIENTS, PROT_READ | PROT_WRITE,
+                                MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (res == MAP_FAILED) {
+        perror("mmap");
+        return EXIT_FAILURE;
+    }
+
+    int failures = 0;
+    for (int t = TRANSPORT_MQ; t <= TRANSPORT_SHM; ++t) {
+        int rc = check_order((transport_t)t, cfg.maxmsg);
+        printf("order %-6s %s\n", transport_names[t], rc == 0 ? "ok" : "FAILED");
+        failures += rc != 0;
+    }
+    printf("%-6s %8s %12s %9s %9s %9s\n", "queue", "clients", "rtt/s", "p50_us", "p99_us", "max_us");
+    for (int i = 0; i < cfg.num_counts; ++i) {
+        failures += run_case(&cfg, TRANSPORT_MQ, cfg.counts[i], res) != 0;
+        failures += run_case(&cfg, TRANSPORT_SHM, cfg.counts[i], res) != 0;
+    }
+
+    munmap(res, sizeof(*res) * MAX_CLIENTS);
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+
+usage:
+    fprintf(stderr, "usage: %s [-c clients[,...]] [-d seconds] [-m max_messages]\n", argv[0]);
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,323 @@
+/*
+ * Задержка управляющего клиента под массовой нагрузкой (классы -P
+ * у epoll_server)
+ *
+ * Три фазы по -d секунд, в каждой сервер запускается заново:
+ *  - idle:   без нагрузки, сервер с -P — базовая задержка;
+ *  - shared: массовые клиенты насыщают сервер, классов нет — управляющий
+ *            клиент стоит в той же очереди событий, что и массовые;
+ *  - classes: та же нагрузка, сервер с -P gid — управляющий клиент
+ *            обслуживается своим циклом SCHED_FIFO.
+ *
+ * Массовая нагрузка — дочерний процесс с -c подключениями, на каждом
+ * -P сообщений по -s байт в полёте (замкнутый цикл). Управляющий
+ * клиент — дочерний процесс с gid -g (так его и классифицирует сервер)
+ * и SCHED_FIFO выше, чем у цикла control: раз в -i мкс отправляет
+ * 64-байтное сообщение и ждёт эха. Его приоритет одинаков во всех фазах,
+ * поэтому разница между фазами — в обслуживании на стороне сервера.
+ *
+ * Печатает перцентили задержки управляющего клиента и пропускную
+ * способность массовых клиентов. Код возврата ненулевой при ошибках;
+ * без права на setgid (не root) бенчмарк пропускается с кодом 0.
+ *
+ * Запуск: ./bin/prio_bench -x ./bin/epoll_server [-t циклов bulk] [-g gid]
+ *                          [-c подключений] [-P глубина] [-s размер]
+ *                          [-d секунд] [-i мкс]
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <poll.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include "lat_hist.h"
+
+#define SOCKET_PATH "/tmp/epoll_server.sock"
+#define PROBE_SIZE 64
+#define PROBE_RT_PRIO 60        // выше цикла control (50)
+
+typedef struct {
+    const char *server;
+    int loops;
+    long gid;
+    int conns;
+    int depth;
+    size_t size;
+    double duration;
+    long interval_us;
+} bench_config_t;
+
+// Результаты дочерних процессов — в разделяемой памяти.
+typedef struct {
+    lat_hist_t probe;           // нс
+    uint64_t probe_errors;
+    _Atomic uint64_t bulk_msgs;
+    uint64_t bulk_errors;
+} shared_result_t;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static int connect_server(void) {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, SOCKET_PATH, sizeof(addr.sun_path) - 1);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd == -1) return -1;
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == -1) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static pid_t spawn_server(const bench_config_t *cfg, int classes) {
+    pid_t pid = fork();
+    if (pid == 0) {
+        char loops[16], gid[32];
+        snprintf(loops, sizeof(loops), "%d", cfg->loops);
+        snprintf(gid, sizeof(gid), "%ld", cfg->gid);
+        if (!freopen("/dev/null", "w", stdout)) _exit(127);
+        execl(cfg->server, cfg->server, "-q", "-t", loops, classes ? "-P" : (char *)NULL, gid,
+              (char *)NULL);
+        perror("execl");
+        _exit(127);
+    }
+    for (int i = 0; pid > 0 && i < 200; ++i) {
+        int fd = connect_server();
+        if (fd != -1) {
+            close(fd);
+            return pid;
+        }
+        usleep(10000);
+    }
+    if (pid > 0) {
+        kill(pid, SIGKILL);
+        waitpid(pid, NULL, 0);
+    }
+    return -1;
+}
+
+// Массовые клиенты: на каждом подключении пачка из depth сообщений,
+// следующая — после полного эха.
+static void bulk_main(const bench_config_t *cfg, shared_result_t *res, uint64_t end) {
+    size_t batch = cfg->size * (size_t)cfg->depth;
+    char *msg = malloc(batch), *reply = malloc(batch);
+    struct pollfd *pfds = calloc((size_t)cfg->conns, sizeof(*pfds));
+    size_t *unsent = calloc((size_t)cfg->conns, sizeof(*unsent));
+    size_t *pending = calloc((size_t)cfg->conns, sizeof(*pending));
+    if (!msg || !reply || !pfds || !unsent || !pending) _exit(1);
+    memset(msg, 'b', batch);
+
+    for (int i = 0; i < cfg->conns; ++i) {
+        if ((pfds[i].fd = connect_server()) == -1) {
+            res->bulk_errors++;
+            _exit(1);
+        }
+        unsent[i] = pending[i] = batch;
+        pfds[i].events = POLLIN | POLLOUT;
+    }
+    while (now_ns() < end) {
+        if (poll(pfds, (nfds_t)cfg->conns, 100) <= 0) continue;
+        for (int i = 0; i < cfg->conns; ++i) {
+            if ((pfds[i].revents & POLLOUT) && unsent[i]) {
+                ssize_t n = send(pfds[i].fd, msg + batch - unsent[i], unsent[i], MSG_DONTWAIT | MSG_NOSIGNAL);
+                if (n > 0) unsent[i] -= (size_t)n;
+            }
+            if (pfds[i].revents & POLLIN) {
+                ssize_t n = recv(pfds[i].fd, reply, pending[i], MSG_DONTWAIT);
+                if (n <= 0 && !(n == -1 && errno == EAGAIN)) {
+                    res->bulk_errors++;
+                    _exit(1);
+                }
+                if (n > 0 && (pending[i] -= (size_t)n) == 0) {
+                    atomic_fetch_add(&res->bulk_msgs, (uint64_t)cfg->depth);
+                    unsent[i] = pending[i] = batch;
+                }
+            }
+            pfds[i].events = POLLIN | (unsent[i] ? POLLOUT : 0);
+        }
+    }
+    _exit(0);
+}
+
+// Управляющий клиент: gid класса control и SCHED_FIFO, одно сообщение
+// в полёте раз в interval_us.
+static void probe_main(const bench_config_t *cfg, shared_result_t *res, uint64_t start, uint64_t end) {
+    if (setgid((gid_t)cfg->gid) == -1) {
+        perror("setgid");
+        _exit(1);
+    }
+    struct sched_param sp = {.sched_priority = PROBE_RT_PRIO};
+    if (sched_setscheduler(0, SCHED_FIFO, &sp) == -1) perror("WARNING: probe SCHED_FIFO");
+
+    int fd = connect_server();
+    if (fd == -1) _exit(1);
+    char msg[PROBE_SIZE], reply[PROBE_SIZE];
+    memset(msg, 'c', sizeof(msg));
+    msg[sizeof(msg) - 1] = '\n';
+
+    uint64_t interval = (uint64_t)cfg->interval_us * 1000;
+    for (uint64_t due = start; due < end; due += interval) {
+        struct timespec ts = {.tv_sec = (time_t)(due / 1000000000ull), .tv_nsec = (long)(due % 1000000000ull)};
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {}
+
+        uint64_t t0 = now_ns();
+        size_t got = 0;
+        if (send(fd, msg, sizeof(msg), MSG_NOSIGNAL) != (ssize_t)sizeof(msg)) {
+            res->probe_errors++;
+            break;
+        }
+        while (got < sizeof(reply)) {
+            ssize_t n = recv(fd, reply + got, sizeof(reply) - got, 0);
+            if (n <= 0) {
+                res->probe_errors++;
+                _exit(1);
+            }
+            got += (size_t)n;
+        }
+        lat_hist_record(&res->probe, now_ns() - t0);
+    }
+    close(fd);
+    _exit(0);
+}
+
+// Может ли дочерний процесс сменить gid (нужны root или CAP_SETGID).
+// Пробуем в отдельном процессе, чтобы не менять gid самого бенчмарка.
+static int can_setgid(gid_t gid) {
+    pid_t pid = fork();
+    if (pid == -1) return -1;
+    if (pid == 0) _exit(setgid(gid) == 0 ? 0 : errno == EPERM ? 2 : 1);
+    int status;
+    if (waitpid(pid, &status, 0) != pid || !WIFEXITED(status)) return -1;
+    return WEXITSTATUS(status) == 0 ? 1 : WEXITSTATUS(status) == 2 ? 0 : -1;
+}
+
+static int wait_child(pid_t pid) {
+    int status;
+    if (pid <= 0 || waitpid(pid, &status, 0) != pid) return -1;
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0 ? 0 : -1;
+}
+
+static int run_phase(const bench_config_t *cfg, const char *name, int bulk, int classes,
+                     shared_result_t *res) {
+    memset(res, 0, sizeof(*res));
+    lat_hist_init(&res->probe);
+
+    pid_t server = spawn_server(cfg, classes);
+    if (server == -1) {
+        fprintf(stderr, "%s: server did not start\n", name);
+        return -1;
+    }
+    uint64_t start = now_ns();
+    uint64_t end = start + (uint64_t)(cfg->duration * 1e9);
+    pid_t bulk_pid = 0;
+    if (bulk && (bulk_pid = fork()) == 0) bulk_main(cfg, res, end);
+    // Замер начинается, когда массовая нагрузка уже разогналась.
+    uint64_t probe_start = start + (end - start) / 5;
+    pid_t probe_pid = fork();
+    if (probe_pid == 0) probe_main(cfg, res, probe_start, end);
+
+    int rc = wait_child(probe_pid);
+    if (bulk && wait_child(bulk_pid) == -1) rc = -1;
+    kill(server, SIGTERM);
+    waitpid(server, NULL, 0);
+
+    const lat_hist_t *h = &res->probe;
+    double secs = (double)(end - start) / 1e9;
+    printf("%-8s %8s %8llu %8.1f %8.1f %8.1f %9.1f %12.0f\n", name, classes ? "yes" : "no",
+           (unsigned long long)h->total, lat_hist_percentile(h, 50) / 1e3, lat_hist_percentile(h, 99) / 1e3,
+           lat_hist_percentile(h, 99.9) / 1e3, (double)h->max / 1e3,
+           (double)atomic_load(&res->bulk_msgs) / secs);
+    if (rc == -1 || res->probe_errors || res->bulk_errors || h->total == 0) {
+        fprintf(stderr, "%s: client errors (probe=%llu bulk=%llu)\n", name,
+                (unsigned long long)res->probe_errors, (unsigned long long)res->bulk_errors);
+        return -1;
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    bench_config_t cfg = {
+        .server = NULL,
+        .loops = 1,
+        .gid = 4242,
+        .conns = 32,
+        .depth = 16,
+        .size = 4096,
+        .duration = 2.0,
+        .interval_us = 1000,
+    };
+
+    int opt;
+    while ((opt = getopt(argc, argv, "x:t:g:c:P:s:d:i:")) != -1) {
+        switch (opt) {
+        case 'x': cfg.server = optarg; break;
+        case 't': cfg.loops = atoi(optarg); break;
+        case 'g': cfg.gid = atol(optarg); break;
+        case 'c': cfg.conns = atoi(optarg); break;
+        case 'P': cfg.depth = atoi(optarg); break;
+        case 's': cfg.size = strtoull(optarg, NULL, 0); break;
+        case 'd': cfg.duration = atof(optarg); break;
+        case 'i': cfg.interval_us = atol(optarg); break;
+        default:
+            goto usage;
+        }
+    }
+    if (!cfg.server || cfg.loops < 1 || cfg.gid < 0 || cfg.conns < 1 || cfg.depth < 1 ||
+        cfg.size < 1 || cfg.duration <= 0 || cfg.interval_us < 1) {
+        goto usage;
+    }
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    signal(SIGPIPE, SIG_IGN);
+
+    // Управляющий клиент отличается от массовых только gid: без права
+    // его сменить сравнивать нечего. SCHED_FIFO, наоборот, необязателен
+    // (только предупреждение в probe_main).
+    int setgid_ok = can_setgid((gid_t)cfg.gid);
+    if (setgid_ok == 0) {
+        fprintf(stderr, "prio_bench skipped: needs root (setgid %ld: %s)\n", cfg.gid, strerror(EPERM));
+        return EXIT_SUCCESS;
+    }
+    if (setgid_ok == -1) {
+        perror("setgid check");
+        return EXIT_FAILURE;
+    }
+
+    shared_result_t *res = mmap(NULL, sizeof(*res), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (res == MAP_FAILED) {
+        perror("mmap");
+        return EXIT_FAILURE;
+    }
+
+    printf("bulk: %d loops, %d connections x %d msgs x %zu bytes; control: gid %ld, every %ld us\n",
+           cfg.loops, cfg.conns, cfg.depth, cfg.size, cfg.gid, cfg.interval_us);
+    printf("%-8s %8s %8s %8s %8s %8s %9s %12s\n", "phase", "classes", "probes", "p50_us", "p99_us",
+           "p99.9_us", "max_us", "bulk_msgs/s");
+    int failures = 0;
+    failures += run_phase(&cfg, "idle", 0, 1, res) != 0;
+    failures += run_phase(&cfg, "shared", 1, 0, res) != 0;
+    failures += run_phase(&cfg, "classes", 1, 1, res) != 0;
+
+    munmap(res, sizeof(*res));
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+
+usage:
+    fprintf(stderr, "usage: %s -x server_binary [-t bulk_loops] [-g gid] [-c connections] [-P depth] "
+                    "[-s size] [-d seconds] [-i interval_us]\n", argv[0]);
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,243 @@
+/*
+ * Цикл событий на epoll (см. reactor.h)
+ *
+ * В epoll_event.data.ptr лежит сам источник. Удалённый во время разбора
+ * источник снимается с epoll сразу, помечается мёртвым и уходит в список
+ * отложенного освобождения: оставшиеся события той же пачки могут
+ * ссылаться на него и просто пропускаются.
+ */
+#define _GNU_SOURCE
+#include "reactor.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+typedef enum { SRC_FD, SRC_TIMER, SRC_SIGNALS, SRC_EVENT } source_kind_t;
+
+struct reactor_source {
+    reactor_t *r;
+    int fd;
+    source_kind_t kind;
+    int dead;
+    reactor_cb_t cb;
+    void *arg;
+    reactor_source_t *prev, *next;  // живые источники; next — и список мёртвых
+};
+
+struct reactor {
+    int epoll_fd;
+    int max_batch;
+    int stop;
+    struct epoll_event *events;
+    reactor_source_t *sources;      // живые (для reactor_destroy)
+    reactor_source_t *dead;         // удалённые, освобождаются после пачки
+    reactor_stats_t stats;
+};
+
+reactor_t *reactor_create(int max_batch) {
+    if (max_batch < 1) {
+        errno = EINVAL;
+        return NULL;
+    }
+    reactor_t *r = calloc(1, sizeof(*r));
+    if (!r) return NULL;
+    r->events = calloc((size_t)max_batch, sizeof(*r->events));
+    r->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (!r->events || r->epoll_fd == -1) {
+        int saved = errno;
+        if (r->epoll_fd != -1) close(r->epoll_fd);
+        free(r->events);
+        free(r);
+        errno = saved;
+        return NULL;
+    }
+    r->max_batch = max_batch;
+    return r;
+}
+
+static void reap_dead(reactor_t *r) {
+    while (r->dead) {
+        reactor_source_t *src = r->dead;
+        r->dead = src->next;
+        if (src->kind != SRC_FD) close(src->fd);
+        free(src);
+    }
+}
+
+void reactor_destroy(reactor_t *r) {
+    if (!r) return;
+    while (r->sources) reactor_remove(r->sources);
+    reap_dead(r);
+    close(r->epoll_fd);
+    free(r->events);
+    free(r);
+}
+
+static reactor_source_t *add_source(reactor_t *r, int fd, source_kind_t kind, uint32_t events,
+                                    reactor_cb_t cb, void *arg) {
+    reactor_source_t *src = calloc(1, sizeof(*src));
+    if (!src) return NULL;
+    src->r = r;
+    src->fd = fd;
+    src->kind = kind;
+    src->cb = cb;
+    src->arg = arg;
+    struct epoll_event ev = {.events = events, .data.ptr = src};
+    if (epoll_ctl(r->epoll_fd, EPOLL_CTL_ADD, fd, &ev) == -1) {
+        free(src);
+        return NULL;
+    }
+    src->next = r->sources;
+    if (r->sources) r->sources->prev = src;
+    r->sources = src;
+    return src;
+}
+
+// Для своих дескрипторов (timer, signals, event): при ошибке закрыть.
+static reactor_source_t *add_owned(reactor_t *r, int fd, source_kind_t kind, reactor_cb_t cb, void *arg) {
+    if (fd == -1) return NULL;
+    reactor_source_t *src = add_source(r, fd, kind, EPOLLIN, cb, arg);
+    if (!src) {
+        int saved = errno;
+        close(fd);
+        errno = saved;
+    }
+    return src;
+}
+
+reactor_source_t *reactor_add_fd(reactor_t *r, int fd, uint32_t events, reactor_cb_t cb, void *arg) {
+    return add_source(r, fd, SRC_FD, events, cb, arg);
+}
+
+reactor_source_t *reactor_add_mq(reactor_t *r, mqd_t mq, reactor_cb_t cb, void *arg) {
+    return add_source(r, (int)mq, SRC_FD, EPOLLIN, cb, arg);
+}
+
+reactor_source_t *reactor_add_timer(reactor_t *r, uint64_t first_ns, uint64_t interval_ns,
+                                    reactor_cb_t cb, void *arg) {
+    int fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (fd == -1) return NULL;
+    // it_value == 0 выключает таймер: первое срабатывание не раньше 1 нс.
+    if (first_ns == 0) first_ns = 1;
+    struct itimerspec its = {
+        .it_value = {.tv_sec = (time_t)(first_ns / 1000000000ull), .tv_nsec = (long)(first_ns % 1000000000ull)},
+        .it_interval = {.tv_sec = (time_t)(interval_ns / 1000000000ull),
+                        .tv_nsec = (long)(interval_ns % 1000000000ull)},
+    };
+    if (timerfd_settime(fd, 0, &its, NULL) == -1) {
+        int saved = errno;
+        close(fd);
+        errno = saved;
+        return NULL;
+    }
+    return add_owned(r, fd, SRC_TIMER, cb, arg);
+}
+
+reactor_source_t *reactor_add_signals(reactor_t *r, const sigset_t *set, reactor_cb_t cb, void *arg) {
+    // Заблокированный сигнал не доставляется обработчику, а ждёт в signalfd.
+    int err = pthread_sigmask(SIG_BLOCK, set, NULL);
+    if (err != 0) {
+        errno = err;
+        return NULL;
+    }
+    return add_owned(r, signalfd(-1, set, SFD_NONBLOCK | SFD_CLOEXEC), SRC_SIGNALS, cb, arg);
+}
+
+reactor_source_t *reactor_add_event(reactor_t *r, reactor_cb_t cb, void *arg) {
+    return add_owned(r, eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC), SRC_EVENT, cb, arg);
+}
+
+int reactor_modify(reactor_source_t *src, uint32_t events) {
+    if (src->kind != SRC_FD || src->dead) {
+        errno = EINVAL;
+        return -1;
+    }
+    struct epoll_event ev = {.events = events, .data.ptr = src};
+    return epoll_ctl(src->r->epoll_fd, EPOLL_CTL_MOD, src->fd, &ev);
+}
+
+int reactor_notify(reactor_source_t *src, uint64_t value) {
+    if (src->kind != SRC_EVENT) {
+        errno = EINVAL;
+        return -1;
+    }
+    return write(src->fd, &value, sizeof(value)) == (ssize_t)sizeof(value) ? 0 : -1;
+}
+
+void reactor_remove(reactor_source_t *src) {
+    if (!src || src->dead) return;
+    reactor_t *r = src->r;
+    epoll_ctl(r->epoll_fd, EPOLL_CTL_DEL, src->fd, NULL);
+    if (src->prev) src->prev->next = src->next;
+    else r->sources = src->next;
+    if (src->next) src->next->prev = src->prev;
+    src->dead = 1;
+    src->next = r->dead;
+    r->dead = src;
+}
+
+int reactor_source_fd(const reactor_source_t *src) {
+    return src->fd;
+}
+
+// Разбор одного события: свои дескрипторы вычитываются здесь.
+static void dispatch(reactor_source_t *src, uint32_t events) {
+    uint64_t value;
+    switch (src->kind) {
+    case SRC_FD:
+        src->cb(src, events, src->arg);
+        break;
+    case SRC_TIMER:
+    case SRC_EVENT:
+        // Счётчик timerfd/eventfd: read сбрасывает его целиком.
+        if (read(src->fd, &value, sizeof(value)) == (ssize_t)sizeof(value)) src->cb(src, value, src->arg);
+        break;
+    case SRC_SIGNALS: {
+        struct signalfd_siginfo si[8];
+        ssize_t n;
+        while (!src->dead && (n = read(src->fd, si, sizeof(si))) > 0) {
+            for (size_t i = 0; i < (size_t)n / sizeof(si[0]) && !src->dead; ++i) {
+                src->cb(src, si[i].ssi_signo, src->arg);
+            }
+        }
+        break;
+    }
+    }
+}
+
+int reactor_run_once(reactor_t *r, int timeout_ms) {
+    int n = epoll_wait(r->epoll_fd, r->events, r->max_batch, timeout_ms);
+    r->stats.waits++;
+    if (n == -1) return errno == EINTR ? 0 : -1;
+    if ((uint64_t)n > r->stats.max_batch_seen) r->stats.max_batch_seen = (uint64_t)n;
+    for (int i = 0; i < n; ++i) {
+        reactor_source_t *src = r->events[i].data.ptr;
+        if (src->dead) continue;
+        dispatch(src, r->events[i].events);
+        r->stats.dispatched++;
+    }
+    reap_dead(r);
+    return n;
+}
+
+int reactor_run(reactor_t *r) {
+    r->stop = 0;
+    while (!r->stop) {
+        if (reactor_run_once(r, -1) == -1) return -1;
+    }
+    return 0;
+}
+
+void reactor_stop(reactor_t *r) {
+    r->stop = 1;
+}
+
+void reactor_get_stats(const reactor_t *r, reactor_stats_t *stats) {
+    *stats = r->stats;
+}
@@ -0,0 +1,75 @@
+#ifndef REACTOR_H
+#define REACTOR_H
+
+/*
+ * Цикл событий (reactor) на epoll: один поток ждёт сразу на очередях
+ * POSIX MQ, сокетах, таймерах, сигналах и межпоточных уведомлениях.
+ *
+ * Всё, что умеет ждать ядро, на Linux — файловые дескрипторы: mqd_t
+ * (mqueue-fs), сокет, timerfd, signalfd, eventfd. Источник регистрируется
+ * один раз с обратным вызовом; reactor_run_once ждёт в epoll_wait и
+ * разбирает пачку до max_batch готовых источников за один системный
+ * вызов. Для таймеров, сигналов и уведомлений reactor сам вычитывает
+ * дескриптор и передаёт в обратный вызов значение:
+ *  - fd/mq: маска событий epoll (EPOLLIN, EPOLLOUT, EPOLLHUP...);
+ *  - timer: число срабатываний с прошлого вызова;
+ *  - signals: номер сигнала (вызов на каждый пришедший сигнал);
+ *  - event: сумма reactor_notify с прошлого вызова.
+ *
+ * Источник можно удалить из любого обратного вызова, в том числе
+ * другой источник той же пачки: память освобождается после разбора.
+ *
+ * Reactor однопоточный, из других потоков можно звать только
+ * reactor_notify. Функции возвращают NULL/-1 и выставляют errno при ошибке.
+ */
+
+#include <mqueue.h>
+#include <signal.h>
+#include <stdint.h>
+
+typedef struct reactor reactor_t;
+typedef struct reactor_source reactor_source_t;
+
+typedef void (*reactor_cb_t)(reactor_source_t *src, uint64_t value, void *arg);
+
+// max_batch — сколько событий забирать одним epoll_wait.
+reactor_t *reactor_create(int max_batch);
+// Закрывает дескрипторы timer/signals/event; fd и mq остаются вызывающему.
+void reactor_destroy(reactor_t *r);
+
+// Произвольный дескриптор (сокет, pipe...) с маской EPOLL*, по уровню.
+reactor_source_t *reactor_add_fd(reactor_t *r, int fd, uint32_t events, reactor_cb_t cb, void *arg);
+// Очередь POSIX MQ: готовность к чтению. Очередь лучше открыть с
+// O_NONBLOCK и вычитывать до EAGAIN.
+reactor_source_t *reactor_add_mq(reactor_t *r, mqd_t mq, reactor_cb_t cb, void *arg);
+// timerfd (CLOCK_MONOTONIC): первое срабатывание через first_ns, затем
+// каждые interval_ns (0 — однократный).
+reactor_source_t *reactor_add_timer(reactor_t *r, uint64_t first_ns, uint64_t interval_ns,
+                                    reactor_cb_t cb, void *arg);
+// signalfd: сигналы из set блокируются в вызывающем потоке (создавайте
+// reactor до остальных потоков, чтобы они унаследовали маску).
+reactor_source_t *reactor_add_signals(reactor_t *r, const sigset_t *set, reactor_cb_t cb, void *arg);
+// eventfd: будить reactor из других потоков через reactor_notify.
+reactor_source_t *reactor_add_event(reactor_t *r, reactor_cb_t cb, void *arg);
+
+int reactor_modify(reactor_source_t *src, uint32_t events);   // только fd
+int reactor_notify(reactor_source_t *src, uint64_t value);    // только event
+void reactor_remove(reactor_source_t *src);
+int reactor_source_fd(const reactor_source_t *src);
+
+// Одна пачка: ждать до timeout_ms (-1 — бесконечно) и разобрать события.
+// Возвращает число разобранных событий (EINTR не считается ошибкой).
+int reactor_run_once(reactor_t *r, int timeout_ms);
+// Крутить пачки, пока не вызван reactor_stop.
+int reactor_run(reactor_t *r);
+void reactor_stop(reactor_t *r);
+
+typedef struct {
+    uint64_t waits;             // вызовов epoll_wait
+    uint64_t dispatched;        // обратных вызовов
+    uint64_t max_batch_seen;    // наибольшая пачка
+} reactor_stats_t;
+
+void reactor_get_stats(const reactor_t *r, reactor_stats_t *stats);
+
+#endif // REACTOR_H
@@ -0,0 +1,207 @@
+/*
+ * Один поток, пять видов источников событий (reactor.h)
+ *
+ * Сценарии демонстраций из task2 (timeout_mq, reptimer_timerfd,
+ * timeout_ppoll), собранные в один цикл событий вместо отдельного
+ * блокирующего вызова на каждый:
+ *  - очередь POSIX MQ: поток-отправитель кладёт сообщения через 100 мс;
+ *  - UNIX-сокет (socketpair): поток-собеседник пишет строку, эхо
+ *    возвращается ему обратно;
+ *  - timerfd: периодический таймер каждые 50 мс;
+ *  - signalfd: SIGUSR1 процессу — обработчика сигнала нет, гонки между
+ *    проверкой флага и ожиданием тоже нет;
+ *  - eventfd: поток-работник сообщает о завершении через reactor_notify.
+ *
+ * Цикл завершается, когда все источники отработали, или по сторожевому
+ * таймеру. Код возврата ненулевой, если что-то не пришло.
+ *
+ * Запуск: ./bin/reactor_demo
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <mqueue.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+#include "reactor.h"
+
+#define QNAME "/reactor_demo_mq"
+#define MQ_MESSAGES 3
+#define TICKS 5
+#define TICK_NS 50000000ull
+#define WATCHDOG_NS 5000000000ull
+
+typedef struct {
+    reactor_t *r;
+    mqd_t mq;
+    int sock[2];
+    reactor_source_t *notify;
+    int mq_received, ticks, signals, notified;
+    _Atomic int echoed;         // пишет поток-собеседник
+    uint64_t start_ns;
+} demo_t;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static double ms_since(const demo_t *d) {
+    return (double)(now_ns() - d->start_ns) / 1e6;
+}
+
+static void check_done(demo_t *d) {
+    if (d->mq_received == MQ_MESSAGES && d->ticks >= TICKS && d->signals && d->notified && d->echoed) {
+        reactor_stop(d->r);
+    }
+}
+
+static void on_mq(reactor_source_t *src, uint64_t events, void *arg) {
+    (void)src;
+    (void)events;
+    demo_t *d = arg;
+    char buf[128];
+    unsigned prio;
+    ssize_t n;
+    while ((n = mq_receive(d->mq, buf, sizeof(buf), &prio)) >= 0) {
+        printf("[%6.1f ms] mq: \"%.*s\" (priority %u)\n", ms_since(d), (int)n, buf, prio);
+        d->mq_received++;
+    }
+    if (errno != EAGAIN) perror("mq_receive");
+    check_done(d);
+}
+
+static void on_socket(reactor_source_t *src, uint64_t events, void *arg) {
+    demo_t *d = arg;
+    char buf[128];
+    ssize_t n = read(d->sock[0], buf, sizeof(buf));
+    if (n <= 0 || (events & (EPOLLHUP | EPOLLERR))) {
+        reactor_remove(src);
+        return;
+    }
+    printf("[%6.1f ms] socket: \"%.*s\", echoing\n", ms_since(d), (int)n, buf);
+    if (write(d->sock[0], buf, (size_t)n) != n) perror("write");
+}
+
+static void on_tick(reactor_source_t *src, uint64_t expirations, void *arg) {
+    demo_t *d = arg;
+    d->ticks += (int)expirations;
+    printf("[%6.1f ms] timer: tick %d (%llu expirations)\n", ms_since(d), d->ticks,
+           (unsigned long long)expirations);
+    if (d->ticks >= TICKS) reactor_remove(src);
+    check_done(d);
+}
+
+static void on_signal(reactor_source_t *src, uint64_t signo, void *arg) {
+    (void)src;
+    demo_t *d = arg;
+    printf("[%6.1f ms] signal: %s\n", ms_since(d), strsignal((int)signo));
+    d->signals++;
+    check_done(d);
+}
+
+static void on_notify(reactor_source_t *src, uint64_t value, void *arg) {
+    (void)src;
+    demo_t *d = arg;
+    printf("[%6.1f ms] eventfd: worker finished (value %llu)\n", ms_since(d), (unsigned long long)value);
+    d->notified++;
+    check_done(d);
+}
+
+static void on_watchdog(reactor_source_t *src, uint64_t expirations, void *arg) {
+    (void)src;
+    (void)expirations;
+    demo_t *d = arg;
+    fprintf(stderr, "watchdog: mq=%d ticks=%d signals=%d notified=%d echoed=%d\n", d->mq_received, d->ticks,
+            d->signals, d->notified, d->echoed);
+    reactor_stop(d->r);
+}
+
+// Поток-отправитель: MQ, затем сигнал процессу.
+static void *sender(void *arg) {
+    demo_t *d = arg;
+    usleep(100 * 1000);
+    const char *msgs[MQ_MESSAGES] = {"ordinary", "urgent", "ordinary again"};
+    unsigned prios[MQ_MESSAGES] = {1, 10, 1};
+    for (int i = 0; i < MQ_MESSAGES; ++i) {
+        if (mq_send(d->mq, msgs[i], strlen(msgs[i]), prios[i]) == -1) perror("mq_send");
+    }
+    usleep(50 * 1000);
+    kill(getpid(), SIGUSR1);
+    return NULL;
+}
+
+// Собеседник на другом конце сокета: строка и ожидание эха.
+static void *peer(void *arg) {
+    demo_t *d = arg;
+    usleep(150 * 1000);
+    const char msg[] = "hello over a socket";
+    char buf[sizeof(msg)];
+    if (write(d->sock[1], msg, sizeof(msg) - 1) == (ssize_t)sizeof(msg) - 1 &&
+        read(d->sock[1], buf, sizeof(buf)) == (ssize_t)sizeof(msg) - 1) {
+        d->echoed = 1;
+    }
+    reactor_notify(d->notify, 1);
+    return NULL;
+}
+
+int main(void) {
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    demo_t d;
+    memset(&d, 0, sizeof(d));
+
+    // Reactor и signalfd — до потоков: они унаследуют заблокированный SIGUSR1.
+    d.r = reactor_create(8);
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, SIGUSR1);
+
+    struct mq_attr attr = {.mq_maxmsg = 10, .mq_msgsize = 128};
+    mq_unlink(QNAME);
+    d.mq = mq_open(QNAME, O_CREAT | O_RDWR | O_NONBLOCK | O_CLOEXEC, 0600, &attr);
+    if (!d.r || d.mq == (mqd_t)-1 || socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, d.sock) == -1) {
+        perror("setup");
+        return EXIT_FAILURE;
+    }
+    if (!reactor_add_signals(d.r, &set, on_signal, &d) || !reactor_add_mq(d.r, d.mq, on_mq, &d) ||
+        !reactor_add_fd(d.r, d.sock[0], EPOLLIN, on_socket, &d) ||
+        !reactor_add_timer(d.r, TICK_NS, TICK_NS, on_tick, &d) ||
+        !(d.notify = reactor_add_event(d.r, on_notify, &d)) ||
+        !reactor_add_timer(d.r, WATCHDOG_NS, 0, on_watchdog, &d)) {
+        perror("reactor_add");
+        return EXIT_FAILURE;
+    }
+
+    d.start_ns = now_ns();
+    pthread_t th_sender, th_peer;
+    pthread_create(&th_sender, NULL, sender, &d);
+    pthread_create(&th_peer, NULL, peer, &d);
+
+    reactor_run(d.r);
+    pthread_join(th_sender, NULL);
+    pthread_join(th_peer, NULL);
+
+    reactor_stats_t st;
+    reactor_get_stats(d.r, &st);
+    printf("one thread: %llu epoll_wait calls, %llu callbacks, largest batch %llu\n",
+           (unsigned long long)st.waits, (unsigned long long)st.dispatched,
+           (unsigned long long)st.max_batch_seen);
+
+    int ok = d.mq_received == MQ_MESSAGES && d.ticks >= TICKS && d.signals == 1 && d.notified && d.echoed;
+    reactor_destroy(d.r);
+    close(d.sock[0]);
+    close(d.sock[1]);
+    mq_close(d.mq);
+    mq_unlink(QNAME);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,301 @@
+/*
+ * Перезапуск epoll_server под нагрузкой: отказы подключений и всплески
+ * задержки (обновление без простоя -U)
+ *
+ * Две фазы по -d секунд, в середине каждой сервер заменяется новым
+ * экземпляром:
+ *  - cold: SIGTERM старому, затем запуск нового — так сервер
+ *          перезапускается без -U;
+ *  - hot:  оба с -U: новый забирает у старого слушающий сокет и
+ *          подключения, старый завершается сам.
+ *
+ * Нагрузка — два дочерних процесса:
+ *  - steady: -c постоянных подключений, на каждом одно 64-байтное
+ *    сообщение в полёте (замкнутый цикл); обрыв подключения считается и
+ *    подключение открывается заново;
+ *  - churn: подключение, сообщение, эхо, закрытие — в цикле; отказ
+ *    connect или обрыв до эха считаются.
+ *
+ * Печатает число сообщений, обрывов, подключений и отказов, перцентили и
+ * максимум задержки постоянных подключений (максимум — это и есть всплеск
+ * на перезапуске). Код возврата ненулевой, если в фазе hot были обрывы
+ * или отказы.
+ *
+ * Запуск: ./bin/restart_bench -x ./bin/epoll_server [-t циклов] [-c подключений]
+ *                             [-d секунд]
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include "lat_hist.h"
+
+#define SOCKET_PATH "/tmp/epoll_server.sock"
+#define MSG_SIZE 64
+#define MAX_CONNS 1024
+
+typedef struct {
+    const char *server;
+    int loops;
+    int conns;
+    double duration;
+} bench_config_t;
+
+// Результаты дочерних процессов — в разделяемой памяти.
+typedef struct {
+    lat_hist_t steady;          // нс
+    uint64_t steady_msgs;
+    uint64_t steady_drops;
+    uint64_t connects;          // churn
+    uint64_t connect_failures;  // churn: отказ connect или обрыв до эха
+} shared_result_t;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static int connect_server(void) {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, SOCKET_PATH, sizeof(addr.sun_path) - 1);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd == -1) return -1;
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == -1) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// wait_ready: дождаться, пока сервер начнёт принимать подключения
+// (при -U сокет уже принимает — ждать нечего).
+static pid_t spawn_server(const bench_config_t *cfg, int upgrade, int wait_ready) {
+    pid_t pid = fork();
+    if (pid == 0) {
+        char loops[16];
+        snprintf(loops, sizeof(loops), "%d", cfg->loops);
+        if (!freopen("/dev/null", "w", stdout)) _exit(127);
+        execl(cfg->server, cfg->server, "-q", "-t", loops, upgrade ? "-U" : (char *)NULL, (char *)NULL);
+        perror("execl");
+        _exit(127);
+    }
+    for (int i = 0; pid > 0 && wait_ready && i < 200; ++i) {
+        int fd = connect_server();
+        if (fd != -1) {
+            close(fd);
+            return pid;
+        }
+        usleep(10000);
+    }
+    if (pid > 0 && wait_ready) {
+        kill(pid, SIGKILL);
+        waitpid(pid, NULL, 0);
+        return -1;
+    }
+    return pid;
+}
+
+// Постоянные подключения: одно сообщение в полёте на каждом.
+static void steady_main(const bench_config_t *cfg, shared_result_t *res, uint64_t end) {
+    struct pollfd pfds[MAX_CONNS];
+    size_t got[MAX_CONNS];
+    uint64_t sent_at[MAX_CONNS];
+    char msg[MSG_SIZE], reply[MSG_SIZE];
+    memset(msg, 's', sizeof(msg));
+    msg[sizeof(msg) - 1] = '\n';
+
+    for (int i = 0; i < cfg->conns; ++i) pfds[i].fd = -1;
+    while (now_ns() < end) {
+        for (int i = 0; i < cfg->conns; ++i) {
+            if (pfds[i].fd != -1) continue;
+            // Новое подключение (или после обрыва): первое сообщение.
+            if ((pfds[i].fd = connect_server()) == -1) continue;
+            pfds[i].events = POLLIN;
+            got[i] = 0;
+            sent_at[i] = now_ns();
+            if (send(pfds[i].fd, msg, sizeof(msg), MSG_NOSIGNAL) != (ssize_t)sizeof(msg)) {
+                close(pfds[i].fd);
+                pfds[i].fd = -1;
+                res->steady_drops++;
+            }
+        }
+        if (poll(pfds, (nfds_t)cfg->conns, 10) <= 0) continue;
+        for (int i = 0; i < cfg->conns; ++i) {
+            if (pfds[i].fd == -1 || !pfds[i].revents) continue;
+            ssize_t n = recv(pfds[i].fd, reply, sizeof(reply) - got[i], MSG_DONTWAIT);
+            if (n == -1 && errno == EAGAIN) continue;
+            if (n <= 0) {
+                close(pfds[i].fd);
+                pfds[i].fd = -1;
+                res->steady_drops++;
+                continue;
+            }
+            if ((got[i] += (size_t)n) < sizeof(reply)) continue;
+            uint64_t t = now_ns();
+            lat_hist_record(&res->steady, t - sent_at[i]);
+            res->steady_msgs++;
+            got[i] = 0;
+            sent_at[i] = t;
+            if (send(pfds[i].fd, msg, sizeof(msg), MSG_NOSIGNAL) != (ssize_t)sizeof(msg)) {
+                close(pfds[i].fd);
+                pfds[i].fd = -1;
+                res->steady_drops++;
+            }
+        }
+    }
+    _exit(0);
+}
+
+// Новые подключения одно за другим.
+static void churn_main(shared_result_t *res, uint64_t end) {
+    char msg[MSG_SIZE], reply[MSG_SIZE];
+    memset(msg, 'n', sizeof(msg));
+    msg[sizeof(msg) - 1] = '\n';
+
+    while (now_ns() < end) {
+        res->connects++;
+        int fd = connect_server();
+        if (fd == -1) {
+            res->connect_failures++;
+            usleep(1000);
+            continue;
+        }
+        size_t got = 0;
+        if (send(fd, msg, sizeof(msg), MSG_NOSIGNAL) == (ssize_t)sizeof(msg)) {
+            ssize_t n;
+            while (got < sizeof(reply) && (n = recv(fd, reply + got, sizeof(reply) - got, 0)) > 0) {
+                got += (size_t)n;
+            }
+        }
+        if (got < sizeof(reply)) res->connect_failures++;
+        close(fd);
+    }
+    _exit(0);
+}
+
+static int wait_child(pid_t pid) {
+    int status;
+    if (pid <= 0 || waitpid(pid, &status, 0) != pid) return -1;
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0 ? 0 : -1;
+}
+
+static int run_phase(const bench_config_t *cfg, const char *name, int hot, shared_result_t *res) {
+    memset(res, 0, sizeof(*res));
+    lat_hist_init(&res->steady);
+
+    pid_t server = spawn_server(cfg, hot, 1);
+    if (server == -1) {
+        fprintf(stderr, "%s: server did not start\n", name);
+        return -1;
+    }
+    uint64_t start = now_ns();
+    uint64_t end = start + (uint64_t)(cfg->duration * 1e9);
+    pid_t steady_pid = fork();
+    if (steady_pid == 0) steady_main(cfg, res, end);
+    pid_t churn_pid = fork();
+    if (churn_pid == 0) churn_main(res, end);
+
+    struct timespec half = {.tv_sec = (time_t)(cfg->duration / 2),
+                            .tv_nsec = (long)((cfg->duration / 2 - (double)(time_t)(cfg->duration / 2)) * 1e9)};
+    nanosleep(&half, NULL);
+
+    int rc = 0;
+    uint64_t t0 = now_ns();
+    if (hot) {
+        // Старый экземпляр завершается сам, когда отдаст подключения.
+        pid_t next = spawn_server(cfg, 1, 0);
+        if (wait_child(server) == -1) {
+            fprintf(stderr, "%s: old server did not exit cleanly\n", name);
+            rc = -1;
+        }
+        server = next;
+    } else {
+        kill(server, SIGTERM);
+        waitpid(server, NULL, 0);
+        server = spawn_server(cfg, 0, 1);
+    }
+    uint64_t restart_ns = now_ns() - t0;
+
+    if (wait_child(steady_pid) == -1 || wait_child(churn_pid) == -1) rc = -1;
+    if (server > 0) {
+        kill(server, SIGTERM);
+        waitpid(server, NULL, 0);
+    }
+
+    const lat_hist_t *h = &res->steady;
+    printf("%-5s %10.1f %9llu %6llu %9llu %7llu %8.1f %8.1f %9.1f\n", name, (double)restart_ns / 1e6,
+           (unsigned long long)res->steady_msgs, (unsigned long long)res->steady_drops,
+           (unsigned long long)res->connects, (unsigned long long)res->connect_failures,
+           lat_hist_percentile(h, 50) / 1e3, lat_hist_percentile(h, 99) / 1e3, (double)h->max / 1e3);
+    if (server == -1) {
+        fprintf(stderr, "%s: new server did not start\n", name);
+        rc = -1;
+    }
+    if (hot && (res->steady_drops || res->connect_failures)) {
+        fprintf(stderr, "%s: clients saw the restart (drops=%llu failed connects=%llu)\n", name,
+                (unsigned long long)res->steady_drops, (unsigned long long)res->connect_failures);
+        rc = -1;
+    }
+    if (h->total == 0) rc = -1;
+    return rc;
+}
+
+int main(int argc, char *argv[]) {
+    bench_config_t cfg = {
+        .server = NULL,
+        .loops = 0,
+        .conns = 32,
+        .duration = 2.0,
+    };
+
+    int opt;
+    while ((opt = getopt(argc, argv, "x:t:c:d:")) != -1) {
+        switch (opt) {
+        case 'x': cfg.server = optarg; break;
+        case 't': cfg.loops = atoi(optarg); break;
+        case 'c': cfg.conns = atoi(optarg); break;
+        case 'd': cfg.duration = atof(optarg); break;
+        default:
+            goto usage;
+        }
+    }
+    if (!cfg.server || cfg.loops < 0 || cfg.conns < 1 || cfg.conns > MAX_CONNS || cfg.duration <= 0) {
+        goto usage;
+    }
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    signal(SIGPIPE, SIG_IGN);
+
+    shared_result_t *res = mmap(NULL, sizeof(*res), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (res == MAP_FAILED) {
+        perror("mmap");
+        return EXIT_FAILURE;
+    }
+
+    printf("server: %d loops; steady: %d connections x 1 msg in flight; churn: connect/echo/close\n",
+           cfg.loops, cfg.conns);
+    printf("%-5s %10s %9s %6s %9s %7s %8s %8s %9s\n", "phase", "restart_ms", "msgs", "drops", "connects",
+           "failed", "p50_us", "p99_us", "max_us");
+    int failures = 0;
+    failures += run_phase(&cfg, "cold", 0, res) != 0;
+    failures += run_phase(&cfg, "hot", 1, res) != 0;
+
+    munmap(res, sizeof(*res));
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+
+usage:
+    fprintf(stderr, "usage: %s -x server_binary [-t loops] [-c connections] [-d seconds]\n", argv[0]);
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,200 @@
+/*
+ * Пул буферов для больших сообщений (см. shm_blob.h)
+ *
+ * Раскладка сегмента:
+ *   [заголовок][заголовки буферов][данные буферов, каждый с границы страницы]
+ *
+ * Свободные буферы — стек Трайбера с тегом против ABA из shm_region.h
+ * (индекс + счётчик в одном 64-битном слове), как пул чанков shm_bus. Поколение буфера чётное,
+ * пока буфер свободен, и нечётное, пока выдан: выдача и освобождение
+ * сдвигают его на единицу через CAS, поэтому двойное освобождение и
+ * освобождение по устаревшему дескриптору не проходят.
+ *
+ * Ожидание свободного буфера — futex на счётчике освобождений,
+ * FUTEX_WAKE только если кто-то ждёт.
+ */
+#define _GNU_SOURCE
+#include "shm_blob.h"
+#include "futex.h"
+#include "shm_region.h"
+
+#include <errno.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#define SHM_BLOB_MAGIC  0x53484d4cu // "SHML"
+
+typedef struct {
+    _Atomic uint32_t generation;
+    _Atomic uint32_t next;      // следующий в стеке свободных
+} blob_buf_t;
+
+typedef struct {
+    shm_region_hdr_t region;
+    uint32_t count;
+    uint64_t buf_size;
+    uint64_t stride;
+    uint64_t bufs_off;
+    uint64_t payload_off;
+    shm_index_stack_t pool;     // свободные буферы
+} blob_header_t;
+
+struct shm_blob {
+    blob_header_t *hdr;
+    size_t size;
+    blob_buf_t *bufs;
+    char *payload;
+};
+
+static void blob_bind(shm_blob_t *pool, void *base, size_t size) {
+    pool->hdr = base;
+    pool->size = size;
+    pool->bufs = (blob_buf_t *)((char *)base + pool->hdr->bufs_off);
+    pool->payload = (char *)base + pool->hdr->payload_off;
+}
+
+static void stack_push(shm_blob_t *pool, uint32_t idx) {
+    shm_index_stack_push(&pool->hdr->pool, &pool->bufs[0].next, sizeof(blob_buf_t), idx);
+}
+
+static uint32_t stack_pop(shm_blob_t *pool) {
+    return shm_index_stack_pop(&pool->hdr->pool, &pool->bufs[0].next, sizeof(blob_buf_t));
+}
+
+// Индекс буфера по дескриптору или SHM_NIL_INDEX (errno = EINVAL).
+static uint32_t desc_index(const shm_blob_t *pool, const shm_blob_desc_t *desc) {
+    const blob_header_t *h = pool->hdr;
+    uint64_t rel = desc->offset - h->payload_off;
+    if (desc->offset < h->payload_off || rel % h->stride != 0 || rel / h->stride >= h->count ||
+        desc->len > h->buf_size) {
+        errno = EINVAL;
+        return SHM_NIL_INDEX;
+    }
+    return (uint32_t)(rel / h->stride);
+}
+
+// --- Создание и открытие ---
+
+shm_blob_t *shm_blob_create(const char *name, size_t buf_size, uint32_t count) {
+    if (buf_size == 0 || count == 0 || count >= SHM_NIL_INDEX / 2) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t stride = align_up(buf_size, page);
+    size_t bufs_off = align_up(sizeof(blob_header_t), 64);
+    size_t payload_off = align_up(bufs_off + (size_t)count * sizeof(blob_buf_t), page);
+    size_t total = payload_off + (size_t)count * stride;
+
+    shm_blob_t *pool = calloc(1, sizeof(*pool));
+    if (!pool) return NULL;
+    void *base = shm_region_create(name, total);
+    if (!base) {
+        free(pool);
+        return NULL;
+    }
+
+    blob_header_t *h = base;
+    h->count = count;
+    h->buf_size = buf_size;
+    h->stride = stride;
+    h->bufs_off = bufs_off;
+    h->payload_off = payload_off;
+    blob_bind(pool, base, total);
+
+    for (uint32_t i = 0; i < count; ++i) {
+        atomic_init(&pool->bufs[i].generation, 0);
+    }
+    shm_index_stack_init(&h->pool, &pool->bufs[0].next, sizeof(blob_buf_t), count);
+    shm_region_publish(base, SHM_BLOB_MAGIC);
+    return pool;
+}
+
+shm_blob_t *shm_blob_open(const char *name) {
+    size_t size;
+    void *base = shm_region_open(name, sizeof(blob_header_t), SHM_BLOB_MAGIC, &size);
+    if (!base) return NULL;
+
+    shm_blob_t *pool = calloc(1, sizeof(*pool));
+    if (!pool) {
+        munmap(base, size);
+        return NULL;
+    }
+    blob_bind(pool, base, size);
+    return pool;
+}
+
+void shm_blob_close(shm_blob_t *pool) {
+    if (!pool) return;
+    munmap(pool->hdr, pool->size);
+    free(pool);
+}
+
+int shm_blob_unlink(const char *name) {
+    return shm_unlink(name);
+}
+
+size_t shm_blob_buf_size(const shm_blob_t *pool) {
+    return pool->hdr->buf_size;
+}
+
+// --- Выдача и освобождение ---
+
+void *shm_blob_alloc(shm_blob_t *pool, shm_blob_desc_t *desc, int timeout_ms) {
+    blob_header_t *h = pool->hdr;
+    struct timespec deadline;
+    if (timeout_ms > 0) futex_deadline(&deadline, timeout_ms);
+
+    uint32_t idx;
+    while ((idx = stack_pop(pool)) == SHM_NIL_INDEX) {
+        if (timeout_ms == 0) {
+            errno = EAGAIN;
+            return NULL;
+        }
+        uint32_t seen = atomic_load(&h->pool.signal);
+        atomic_fetch_add(&h->pool.waiters, 1);
+        if ((idx = stack_pop(pool)) != SHM_NIL_INDEX) {
+            atomic_fetch_sub(&h->pool.waiters, 1);
+            break;
+        }
+        int rc = futex_wait(&h->pool.signal, seen, timeout_ms > 0 ? &deadline : NULL);
+        int saved = errno;
+        atomic_fetch_sub(&h->pool.waiters, 1);
+        if (rc == -1 && saved == ETIMEDOUT) {
+            errno = ETIMEDOUT;
+            return NULL;
+        }
+    }
+
+    desc->offset = h->payload_off + (uint64_t)idx * h->stride;
+    desc->len = 0;
+    desc->generation = atomic_fetch_add(&pool->bufs[idx].generation, 1) + 1;
+    desc->reserved = 0;
+    return (char *)h + desc->offset;
+}
+
+void *shm_blob_get(shm_blob_t *pool, const shm_blob_desc_t *desc) {
+    uint32_t idx = desc_index(pool, desc);
+    if (idx == SHM_NIL_INDEX) return NULL;
+    if (atomic_load(&pool->bufs[idx].generation) != desc->generation || !(desc->generation & 1)) {
+        errno = ESTALE;
+        return NULL;
+    }
+    return (char *)pool->hdr + desc->offset;
+}
+
+int shm_blob_free(shm_blob_t *pool, const shm_blob_desc_t *desc) {
+    uint32_t idx = desc_index(pool, desc);
+    if (idx == SHM_NIL_INDEX) return -1;
+    uint32_t gen = desc->generation;
+    if (!(gen & 1) || !atomic_compare_exchange_strong(&pool->bufs[idx].generation, &gen, gen + 1)) {
+        errno = ESTALE;
+        return -1;
+    }
+    stack_push(pool, idx);
+    return 0;
+}
@@ -0,0 +1,56 @@
+#ifndef SHM_BLOB_H
+#define SHM_BLOB_H
+
+/*
+ * Пул буферов в общей памяти для больших сообщений: данные пишутся прямо
+ * в буфер пула, а по очереди сообщений (mq) идёт только дескриптор
+ * shm_blob_desc_t. Порядок и приоритеты остаются за очередью.
+ *
+ * Буферы одного размера; страницы сегмента выделяются по мере записи,
+ * так что запас по размеру почти ничего не стоит. Владение буфером
+ * переходит вместе с дескриптором: кто получил дескриптор последним, тот
+ * и освобождает буфер (shm_blob_free).
+ *
+ * У каждого буфера есть поколение, оно меняется при выдаче и при
+ * освобождении. Дескриптор со старым поколением (буфер уже освобождён и,
+ * возможно, выдан заново) отвергается с ESTALE — устаревшая ссылка не
+ * может прочитать или освободить чужие данные.
+ *
+ * Функции возвращают NULL/-1 и выставляют errno при ошибке.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct {
+    uint64_t offset;            // смещение буфера в сегменте
+    uint64_t len;               // байт данных
+    uint32_t generation;
+    uint32_t reserved;
+} shm_blob_desc_t;
+
+typedef struct shm_blob shm_blob_t;
+
+// Создание/открытие пула из count буферов по buf_size байт.
+// name — имя объекта shm_open ("/...").
+shm_blob_t *shm_blob_create(const char *name, size_t buf_size, uint32_t count);
+shm_blob_t *shm_blob_open(const char *name);
+void shm_blob_close(shm_blob_t *pool);
+int shm_blob_unlink(const char *name);
+
+size_t shm_blob_buf_size(const shm_blob_t *pool);
+
+// Взять свободный буфер: заполняет offset и generation в desc (len = 0).
+// timeout_ms < 0 — ждать бесконечно, 0 — не ждать (errno = EAGAIN),
+// иначе ETIMEDOUT по истечении.
+void *shm_blob_alloc(shm_blob_t *pool, shm_blob_desc_t *desc, int timeout_ms);
+
+// Данные по дескриптору, полученному от другого процесса. EINVAL, если
+// дескриптор не указывает на буфер пула или len больше буфера, ESTALE,
+// если поколение не совпадает.
+void *shm_blob_get(shm_blob_t *pool, const shm_blob_desc_t *desc);
+
+// Вернуть буфер в пул. Повторное освобождение — ESTALE.
+int shm_blob_free(shm_blob_t *pool, const shm_blob_desc_t *desc);
+
+#endif // SHM_BLOB_H
@@ -0,0 +1,432 @@
+/*
+ * Шина publish/subscribe поверх общей памяти (см. shm_bus.h)
+ *
+ * Раскладка сегмента:
+ *   [заголовок | топики | слоты подписчиков][ячейки очередей][заголовки чанков][данные чанков]
+ *
+ * Все ссылки внутри сегмента — индексы и смещения, а не указатели, так как
+ * каждый процесс отображает сегмент по своему адресу.
+ *
+ * Пул свободных чанков — стек Трайбера с тегом против ABA из shm_region.h
+ * (индекс + счётчик в одном 64-битном слове). Очередь подписчика — ограниченная очередь Вьюкова
+ * (несколько издателей, один читатель). Глубина очереди не меньше числа чанков,
+ * а один чанк попадает в очередь конкретного подписчика не более одного раза,
+ * поэтому очередь не может переполниться: обратное давление возникает
+ * естественно — издатель ждёт в shm_bus_loan, пока подписчики не отпустят чанки.
+ *
+ * Ожидание (пустой пул, пустая очередь) сделано через futex на счётчике
+ * событий; системный вызов FUTEX_WAKE выполняется только если кто-то ждёт.
+ */
+#define _GNU_SOURCE
+#include "shm_bus.h"
+#include "futex.h"
+#include "shm_region.h"
+
+#include <errno.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#define SHM_BUS_MAGIC   0x53484d42u // "SHMB"
+#define CACHE_LINE      64
+
+enum { TOPIC_FREE = 0, TOPIC_READY = 1 };
+
+typedef struct {
+    _Atomic uint32_t state;
+    char name[SHM_BUS_TOPIC_NAME_LEN];
+    _Atomic uint64_t published;
+} bus_topic_t;
+
+// Ячейка очереди Вьюкова: seq указывает, чья сейчас очередь работать с ячейкой.
+typedef struct {
+    _Atomic uint64_t seq;
+    uint32_t chunk;
+} bus_cell_t;
+
+typedef struct {
+    _Atomic int32_t topic;      // -1: слот свободен
+    _Atomic uint32_t pushers;   // издатели внутри enqueue (для безопасной отписки)
+    _Atomic uint32_t signal;    // futex-слово, растёт при каждой доставке
+    _Atomic uint32_t waiters;
+    _Atomic uint64_t enq_pos;
+    char pad[CACHE_LINE - 24];
+    _Atomic uint64_t deq_pos;   // меняет только сам подписчик
+} __attribute__((aligned(CACHE_LINE))) bus_sub_t;
+
+typedef struct {
+    _Atomic uint32_t refs;
+    _Atomic uint32_t next;      // следующий в стеке свободных
+    uint64_t len;
+} bus_chunk_t;
+
+typedef struct {
+    shm_region_hdr_t region;
+    uint32_t chunk_count;
+    uint32_t queue_depth;       // степень двойки >= chunk_count
+    uint64_t chunk_size;
+    uint64_t chunk_stride;
+    uint64_t cells_off;
+    uint64_t chunks_off;
+    uint64_t payload_off;
+    atomic_flag topic_lock;
+    shm_index_stack_t pool;     // свободные чанки
+    bus_topic_t topics[SHM_BUS_MAX_TOPICS];
+    bus_sub_t subs[SHM_BUS_MAX_SUBSCRIBERS];
+} bus_header_t;
+
+struct shm_bus {
+    bus_header_t *hdr;
+    size_t size;
+    bus_cell_t *cells;
+    bus_chunk_t *chunks;
+    char *payload;
+};
+
+static void bus_bind(shm_bus_t *bus, void *base, size_t size) {
+    bus->hdr = base;
+    bus->size = size;
+    bus->cells = (bus_cell_t *)((char *)base + bus->hdr->cells_off);
+    bus->chunks = (bus_chunk_t *)((char *)base + bus->hdr->chunks_off);
+    bus->payload = (char *)base + bus->hdr->payload_off;
+}
+
+// --- Пул чанков ---
+
+static void pool_push(shm_bus_t *bus, uint32_t idx) {
+    shm_index_stack_push(&bus->hdr->pool, &bus->chunks[0].next, sizeof(bus_chunk_t), idx);
+}
+
+static uint32_t pool_pop(shm_bus_t *bus) {
+    return shm_index_stack_pop(&bus->hdr->pool, &bus->chunks[0].next, sizeof(bus_chunk_t));
+}
+
+static void chunk_unref(shm_bus_t *bus, uint32_t idx) {
+    if (atomic_fetch_sub(&bus->chunks[idx].refs, 1) == 1) {
+        pool_push(bus, idx);
+    }
+}
+
+static void *chunk_data(shm_bus_t *bus, uint32_t idx) {
+    return bus->payload + (size_t)idx * bus->hdr->chunk_stride;
+}
+
+static uint32_t chunk_index(shm_bus_t *bus, const void *data) {
+    const char *p = data;
+    if (p < bus->payload) return SHM_NIL_INDEX;
+    size_t off = (size_t)(p - bus->payload);
+    if (off % bus->hdr->chunk_stride != 0) return SHM_NIL_INDEX;
+    size_t idx = off / bus->hdr->chunk_stride;
+    return idx < bus->hdr->chunk_count ? (uint32_t)idx : SHM_NIL_INDEX;
+}
+
+// --- Очередь подписчика ---
+
+static bus_cell_t *sub_cells(shm_bus_t *bus, int sub) {
+    return bus->cells + (size_t)sub * bus->hdr->queue_depth;
+}
+
+static int sub_enqueue(shm_bus_t *bus, int sub, uint32_t chunk) {
+    bus_sub_t *s = &bus->hdr->subs[sub];
+    bus_cell_t *cells = sub_cells(bus, sub);
+    uint64_t mask = bus->hdr->queue_depth - 1;
+    uint64_t pos = atomic_load_explicit(&s->enq_pos, memory_order_relaxed);
+
+    for (;;) {
+        bus_cell_t *cell = &cells[pos & mask];
+        uint64_t seq = atomic_load_explicit(&cell->seq, memory_order_acquire);
+        int64_t diff = (int64_t)seq - (int64_t)pos;
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&s->enq_pos, &pos, pos + 1,
+                                                      memory_order_relaxed,
+                                                      memory_order_relaxed)) {
+                cell->chunk = chunk;
+                atomic_store_explicit(&cell->seq, pos + 1, memory_order_release);
+                return 0;
+            }
+        } else if (diff < 0) {
+            return -1; // очередь полна (при корректном использовании недостижимо)
+        } else {
+            pos = atomic_load_explicit(&s->enq_pos, memory_order_relaxed);
+        }
+    }
+}
+
+static uint32_t sub_dequeue(shm_bus_t *bus, int sub) {
+    bus_sub_t *s = &bus->hdr->subs[sub];
+    uint64_t mask = bus->hdr->queue_depth - 1;
+    uint64_t pos = atomic_load_explicit(&s->deq_pos, memory_order_relaxed);
+    bus_cell_t *cell = &sub_cells(bus, sub)[pos & mask];
+
+    if (atomic_load_explicit(&cell->seq, memory_order_acquire) != pos + 1) {
+        return SHM_NIL_INDEX;
+    }
+    uint32_t chunk = cell->chunk;
+    atomic_store_explicit(&cell->seq, pos + mask + 1, memory_order_release);
+    atomic_store_explicit(&s->deq_pos, pos + 1, memory_order_relaxed);
+    return chunk;
+}
+
+// --- Создание и открытие ---
+
+shm_bus_t *shm_bus_create(const char *name, const shm_bus_config_t *cfg) {
+    if (!cfg || cfg->chunk_size == 0 || cfg->chunk_count == 0 ||
+        cfg->chunk_count >= SHM_NIL_INDEX / 2) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    uint32_t depth = 1;
+    while (depth < cfg->chunk_count) depth <<= 1;
+
+    size_t stride = align_up(cfg->chunk_size, CACHE_LINE);
+    size_t cells_off = align_up(sizeof(bus_header_t), CACHE_LINE);
+    size_t chunks_off = align_up(cells_off + (size_t)SHM_BUS_MAX_SUBSCRIBERS * depth * sizeof(bus_cell_t),
+                                 CACHE_LINE);
+    size_t payload_off = align_up(chunks_off + (size_t)cfg->chunk_count * sizeof(bus_chunk_t),
+                                  (size_t)sysconf(_SC_PAGESIZE));
+    size_t total = payload_off + (size_t)cfg->chunk_count * stride;
+
+    shm_bus_t *bus = calloc(1, sizeof(*bus));
+    if (!bus) return NULL;
+    void *base = shm_region_create(name, total);
+    if (!base) {
+        free(bus);
+        return NULL;
+    }
+
+    bus_header_t *h = base;
+    h->chunk_count = cfg->chunk_count;
+    h->queue_depth = depth;
+    h->chunk_size = cfg->chunk_size;
+    h->chunk_stride = stride;
+    h->cells_off = cells_off;
+    h->chunks_off = chunks_off;
+    h->payload_off = payload_off;
+    atomic_flag_clear(&h->topic_lock);
+    for (int i = 0; i < SHM_BUS_MAX_SUBSCRIBERS; ++i) {
+        atomic_init(&h->subs[i].topic, -1);
+    }
+    bus_bind(bus, base, total);
+
+    for (size_t i = 0; i < (size_t)SHM_BUS_MAX_SUBSCRIBERS * depth; ++i) {
+        atomic_init(&bus->cells[i].seq, i % depth);
+    }
+    shm_index_stack_init(&h->pool, &bus->chunks[0].next, sizeof(bus_chunk_t), cfg->chunk_count);
+    shm_region_publish(base, SHM_BUS_MAGIC);
+    return bus;
+}
+
+shm_bus_t *shm_bus_open(const char *name) {
+    size_t size;
+    void *base = shm_region_open(name, sizeof(bus_header_t), SHM_BUS_MAGIC, &size);
+    if (!base) return NULL;
+
+    shm_bus_t *bus = calloc(1, sizeof(*bus));
+    if (!bus) {
+        munmap(base, size);
+        return NULL;
+    }
+    bus_bind(bus, base, size);
+    return bus;
+}
+
+void shm_bus_close(shm_bus_t *bus) {
+    if (!bus) return;
+    munmap(bus->hdr, bus->size);
+    free(bus);
+}
+
+int shm_bus_unlink(const char *name) {
+    return shm_unlink(name);
+}
+
+size_t shm_bus_chunk_size(const shm_bus_t *bus) {
+    return bus->hdr->chunk_size;
+}
+
+// --- Топики и подписчики ---
+
+int shm_bus_topic(shm_bus_t *bus, const char *name) {
+    bus_header_t *h = bus->hdr;
+    if (strlen(name) >= SHM_BUS_TOPIC_NAME_LEN) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+
+    // Создание топиков — редкая операция, достаточно спин-блокировки.
+    while (atomic_flag_test_and_set(&h->topic_lock)) sched_yield();
+
+    int found = -1, free_slot = -1;
+    for (int i = 0; i < SHM_BUS_MAX_TOPICS; ++i) {
+        if (atomic_load(&h->topics[i].state) == TOPIC_READY) {
+            if (strcmp(h->topics[i].name, name) == 0) {
+                found = i;
+                break;
+            }
+        } else if (free_slot < 0) {
+            free_slot = i;
+        }
+    }
+    if (found < 0 && free_slot >= 0) {
+        strcpy(h->topics[free_slot].name, name);
+        atomic_store(&h->topics[free_slot].published, 0);
+        atomic_store(&h->topics[free_slot].state, TOPIC_READY);
+        found = free_slot;
+    }
+
+    atomic_flag_clear(&h->topic_lock);
+    if (found < 0) errno = ENOSPC;
+    return found;
+}
+
+int shm_bus_subscribe(shm_bus_t *bus, int topic) {
+    if (topic < 0 || topic >= SHM_BUS_MAX_TOPICS ||
+        atomic_load(&bus->hdr->topics[topic].state) != TOPIC_READY) {
+        errno = EINVAL;
+        return -1;
+    }
+    for (int i = 0; i < SHM_BUS_MAX_SUBSCRIBERS; ++i) {
+        int32_t expected = -1;
+        if (atomic_compare_exchange_strong(&bus->hdr->subs[i].topic, &expected, topic)) {
+            return i;
+        }
+    }
+    errno = ENOSPC;
+    return -1;
+}
+
+void shm_bus_unsubscribe(shm_bus_t *bus, int sub) {
+    if (sub < 0 || sub >= SHM_BUS_MAX_SUBSCRIBERS) return;
+    bus_sub_t *s = &bus->hdr->subs[sub];
+
+    // Сначала закрываем слот для новых публикаций, затем дожидаемся
+    // издателей, которые уже внутри enqueue, и только потом вычищаем очередь.
+    atomic_store(&s->topic, -2);
+    while (atomic_load(&s->pushers) > 0) sched_yield();
+
+    uint32_t idx;
+    while ((idx = sub_dequeue(bus, sub)) != SHM_NIL_INDEX) {
+        chunk_unref(bus, idx);
+    }
+    atomic_store(&s->topic, -1);
+}
+
+// --- Публикация и приём ---
+
+void *shm_bus_loan(shm_bus_t *bus, int timeout_ms) {
+    bus_header_t *h = bus->hdr;
+    struct timespec deadline;
+    if (timeout_ms > 0) futex_deadline(&deadline, timeout_ms);
+
+    for (;;) {
+        uint32_t idx = pool_pop(bus);
+        if (idx == SHM_NIL_INDEX) {
+            if (timeout_ms == 0) {
+                errno = EAGAIN;
+                return NULL;
+            }
+            uint32_t seen = atomic_load(&h->pool.signal);
+            atomic_fetch_add(&h->pool.waiters, 1);
+            idx = pool_pop(bus);
+            if (idx == SHM_NIL_INDEX) {
+                int rc = futex_wait(&h->pool.signal, seen, timeout_ms > 0 ? &deadline : NULL);
+                int saved = errno;
+                atomic_fetch_sub(&h->pool.waiters, 1);
+                if (rc == -1 && saved == ETIMEDOUT) {
+                    errno = ETIMEDOUT;
+                    return NULL;
+                }
+                continue;
+            }
+            atomic_fetch_sub(&h->pool.waiters, 1);
+        }
+        atomic_store(&bus->chunks[idx].refs, 1); // ссылка издателя
+        bus->chunks[idx].len = 0;
+        return chunk_data(bus, idx);
+    }
+}
+
+int shm_bus_publish(shm_bus_t *bus, int topic, void *chunk, size_t len) {
+    bus_header_t *h = bus->hdr;
+    uint32_t idx = chunk_index(bus, chunk);
+    if (idx == SHM_NIL_INDEX) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (topic < 0 || topic >= SHM_BUS_MAX_TOPICS || len > h->chunk_size) {
+        chunk_unref(bus, idx); // владение уже у шины: чанк возвращается в пул
+        errno = EINVAL;
+        return -1;
+    }
+    bus->chunks[idx].len = len;
+
+    int delivered = 0;
+    for (int i = 0; i < SHM_BUS_MAX_SUBSCRIBERS; ++i) {
+        bus_sub_t *s = &h->subs[i];
+        if (atomic_load_explicit(&s->topic, memory_order_relaxed) != topic) continue;
+
+        atomic_fetch_add(&s->pushers, 1);
+        if (atomic_load(&s->topic) == topic) {
+            atomic_fetch_add(&bus->chunks[idx].refs, 1);
+            if (sub_enqueue(bus, i, idx) == 0) {
+                delivered++;
+                atomic_fetch_add(&s->signal, 1);
+                if (atomic_load(&s->waiters) > 0) {
+                    futex_wake(&s->signal, 1);
+                }
+            } else {
+                chunk_unref(bus, idx);
+            }
+        }
+        atomic_fetch_sub(&s->pushers, 1);
+    }
+    atomic_fetch_add_explicit(&h->topics[topic].published, 1, memory_order_relaxed);
+
+    chunk_unref(bus, idx); // отпускаем ссылку издателя
+    return delivered;
+}
+
+const void *shm_bus_receive(shm_bus_t *bus, int sub, size_t *len, int timeout_ms) {
+    if (sub < 0 || sub >= SHM_BUS_MAX_SUBSCRIBERS) {
+        errno = EINVAL;
+        return NULL;
+    }
+    bus_sub_t *s = &bus->hdr->subs[sub];
+    struct timespec deadline;
+    if (timeout_ms > 0) futex_deadline(&deadline, timeout_ms);
+
+    for (;;) {
+        uint32_t idx = sub_dequeue(bus, sub);
+        if (idx == SHM_NIL_INDEX) {
+            if (timeout_ms == 0) {
+                errno = EAGAIN;
+                return NULL;
+            }
+            uint32_t seen = atomic_load(&s->signal);
+            atomic_fetch_add(&s->waiters, 1);
+            idx = sub_dequeue(bus, sub);
+            if (idx == SHM_NIL_INDEX) {
+                int rc = futex_wait(&s->signal, seen, timeout_ms > 0 ? &deadline : NULL);
+                int saved = errno;
+                atomic_fetch_sub(&s->waiters, 1);
+                if (rc == -1 && saved == ETIMEDOUT) {
+                    errno = ETIMEDOUT;
+                    return NULL;
+                }
+                continue;
+            }
+            atomic_fetch_sub(&s->waiters, 1);
+        }
+        if (len) *len = bus->chunks[idx].len;
+        return chunk_data(bus, idx);
+    }
+}
+
+void shm_bus_release(shm_bus_t *bus, const void *chunk) {
+    uint32_t idx = chunk_index(bus, chunk);
+    if (idx != SHM_NIL_INDEX) chunk_unref(bus, idx);
+}
@@ -0,0 +1,69 @@
+#ifndef SHM_BUS_H
+#define SHM_BUS_H
+
+/*
+ * Шина publish/subscribe поверх общей памяти без копирования данных.
+ *
+ * Все процессы отображают один сегмент, в котором лежат:
+ *  - пул чанков фиксированного размера (общий для всех топиков);
+ *  - таблица именованных топиков;
+ *  - слоты подписчиков, у каждого своя очередь ссылок на чанки.
+ *
+ * Издатель берёт чанк из пула (shm_bus_loan), пишет данные прямо в него
+ * и публикует ссылку (shm_bus_publish). Каждый подписчик получает индекс
+ * того же чанка в свою очередь; чанк возвращается в пул, когда последний
+ * подписчик вызовет shm_bus_release. Данные не копируются ни разу,
+ * сколько бы подписчиков ни было.
+ *
+ * Функции возвращают NULL/-1 и выставляют errno при ошибке.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define SHM_BUS_MAX_TOPICS      16
+#define SHM_BUS_MAX_SUBSCRIBERS 32
+#define SHM_BUS_TOPIC_NAME_LEN  32
+
+typedef struct {
+    size_t chunk_size;      // полезный размер одного чанка, байт
+    uint32_t chunk_count;   // количество чанков в пуле
+} shm_bus_config_t;
+
+typedef struct shm_bus shm_bus_t;
+
+// Создание/открытие сегмента шины. name — имя объекта shm_open ("/...").
+shm_bus_t *shm_bus_create(const char *name, const shm_bus_config_t *cfg);
+shm_bus_t *shm_bus_open(const char *name);
+void shm_bus_close(shm_bus_t *bus);
+int shm_bus_unlink(const char *name);
+
+size_t shm_bus_chunk_size(const shm_bus_t *bus);
+
+// Найти топик по имени или создать его. Возвращает id топика.
+int shm_bus_topic(shm_bus_t *bus, const char *name);
+
+// Занять слот подписчика на топик. Возвращает id подписчика.
+int shm_bus_subscribe(shm_bus_t *bus, int topic);
+// Освободить слот; непрочитанные чанки возвращаются в пул.
+void shm_bus_unsubscribe(shm_bus_t *bus, int sub);
+
+// Взять свободный чанк из пула. timeout_ms < 0 — ждать бесконечно,
+// 0 — не ждать (errno = EAGAIN), иначе ETIMEDOUT по истечении.
+void *shm_bus_loan(shm_bus_t *bus, int timeout_ms);
+
+// Опубликовать заполненный чанк: ссылка ставится в очередь каждому
+// подписчику топика. Владение чанком переходит к шине (даже если
+// подписчиков нет). Возвращает число подписчиков, получивших ссылку.
+// Неверный топик или len больше размера чанка — -1 и EINVAL, чанк при
+// этом тоже отпускается (обратно в пул); указатель не из пула — EINVAL
+// без изменений.
+int shm_bus_publish(shm_bus_t *bus, int topic, void *chunk, size_t len);
+
+// Получить следующий чанк из очереди подписчика. Таймаут как у loan.
+const void *shm_bus_receive(shm_bus_t *bus, int sub, size_t *len, int timeout_ms);
+
+// Отпустить чанк, полученный через receive (или неопубликованный loan).
+void shm_bus_release(shm_bus_t *bus, const void *chunk);
+
+#endif // SHM_BUS_H
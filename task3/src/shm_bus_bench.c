@@ -0,0 +1,229 @@
+/*
+ * Бенчмарк рассылки 1 -> N через общую память
+ *
+ * Сравниваются два способа доставить один поток сообщений N процессам:
+ *  - bus:  шина shm_bus — издатель пишет сообщение один раз прямо в чанк
+ *          из общего пула, подписчики получают ссылку на тот же чанк;
+ *  - copy: классический вариант как в shm_producer/shm_consumer — у каждого
+ *          потребителя свой сегмент с кольцевым буфером и парой семафоров,
+ *          издатель копирует каждое сообщение в каждый сегмент.
+ *
+ * Каждый потребитель — отдельный процесс, проверяющий порядковый номер
+ * сообщения. Время измеряется от первой публикации до завершения последнего
+ * потребителя.
+ *
+ * Запуск: ./bin/shm_bus_bench [-n сообщений] [-s размер] [-m макс. подписчиков]
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <semaphore.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include "shm_bus.h"
+
+#define BUS_NAME        "/shm_bus_bench"
+#define RING_SLOTS      64
+
+static int total_failures = 0;
+
+typedef struct {
+    sem_t empty;
+    sem_t full;
+    char slots[];
+} copy_ring_t;
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static void fill_message(void *buf, size_t size, uint64_t seq) {
+    memset(buf, (int)(seq & 0xff), size);
+    memcpy(buf, &seq, sizeof(seq));
+}
+
+static int check_message(const void *buf, uint64_t seq) {
+    uint64_t got;
+    memcpy(&got, buf, sizeof(got));
+    return got == seq;
+}
+
+static int wait_children(int count) {
+    int failed = 0;
+    for (int i = 0; i < count; ++i) {
+        int status;
+        if (wait(&status) == -1 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            failed++;
+        }
+    }
+    return failed;
+}
+
+// --- Режим bus ---
+
+static void bus_subscriber(int sub, uint64_t messages) {
+    shm_bus_t *bus = shm_bus_open(BUS_NAME);
+    if (!bus) {
+        perror("shm_bus_open");
+        _exit(1);
+    }
+    int bad = 0;
+    for (uint64_t i = 0; i < messages; ++i) {
+        const void *msg = shm_bus_receive(bus, sub, NULL, -1);
+        if (!msg) {
+            perror("shm_bus_receive");
+            _exit(1);
+        }
+        if (!check_message(msg, i)) bad++;
+        shm_bus_release(bus, msg);
+    }
+    shm_bus_close(bus);
+    _exit(bad ? 1 : 0);
+}
+
+static double run_bus(int subscribers, uint64_t messages, size_t size) {
+    shm_bus_unlink(BUS_NAME);
+    shm_bus_config_t cfg = {.chunk_size = size, .chunk_count = RING_SLOTS};
+    shm_bus_t *bus = shm_bus_create(BUS_NAME, &cfg);
+    if (!bus) {
+        perror("shm_bus_create");
+        exit(EXIT_FAILURE);
+    }
+    int topic = shm_bus_topic(bus, "sensor");
+
+    // Подписываемся до запуска издателя, чтобы никто не пропустил начало потока.
+    for (int i = 0; i < subscribers; ++i) {
+        int sub = shm_bus_subscribe(bus, topic);
+        if (sub < 0) {
+            perror("shm_bus_subscribe");
+            exit(EXIT_FAILURE);
+        }
+        if (fork() == 0) bus_subscriber(sub, messages);
+    }
+
+    double start = now_sec();
+    for (uint64_t i = 0; i < messages; ++i) {
+        void *chunk = shm_bus_loan(bus, -1);
+        if (!chunk) {
+            perror("shm_bus_loan");
+            exit(EXIT_FAILURE);
+        }
+        fill_message(chunk, size, i);
+        shm_bus_publish(bus, topic, chunk, size);
+    }
+    int failed = wait_children(subscribers);
+    double elapsed = now_sec() - start;
+
+    if (failed) fprintf(stderr, "bus: %d subscribers reported errors\n", failed);
+    total_failures += failed;
+    shm_bus_close(bus);
+    shm_bus_unlink(BUS_NAME);
+    return elapsed;
+}
+
+// --- Режим copy ---
+
+static void copy_consumer(copy_ring_t *ring, uint64_t messages, size_t size) {
+    int bad = 0;
+    for (uint64_t i = 0; i < messages; ++i) {
+        while (sem_wait(&ring->full) == -1 && errno == EINTR) {}
+        if (!check_message(ring->slots + (i % RING_SLOTS) * size, i)) bad++;
+        sem_post(&ring->empty);
+    }
+    _exit(bad ? 1 : 0);
+}
+
+static double run_copy(int consumers, uint64_t messages, size_t size) {
+    size_t ring_size = sizeof(copy_ring_t) + RING_SLOTS * size;
+    copy_ring_t **rings = calloc((size_t)consumers, sizeof(*rings));
+    char *msg = malloc(size);
+    if (!rings || !msg) {
+        perror("malloc");
+        exit(EXIT_FAILURE);
+    }
+
+    for (int i = 0; i < consumers; ++i) {
+        rings[i] = mmap(NULL, ring_size, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        if (rings[i] == MAP_FAILED) {
+            perror("mmap");
+            exit(EXIT_FAILURE);
+        }
+        sem_init(&rings[i]->empty, 1, RING_SLOTS);
+        sem_init(&rings[i]->full, 1, 0);
+        if (fork() == 0) copy_consumer(rings[i], messages, size);
+    }
+
+    double start = now_sec();
+    for (uint64_t i = 0; i < messages; ++i) {
+        fill_message(msg, size, i);
+        for (int c = 0; c < consumers; ++c) {
+            while (sem_wait(&rings[c]->empty) == -1 && errno == EINTR) {}
+            memcpy(rings[c]->slots + (i % RING_SLOTS) * size, msg, size);
+            sem_post(&rings[c]->full);
+        }
+    }
+    int failed = wait_children(consumers);
+    double elapsed = now_sec() - start;
+
+    if (failed) fprintf(stderr, "copy: %d consumers reported errors\n", failed);
+    total_failures += failed;
+    for (int i = 0; i < consumers; ++i) {
+        sem_destroy(&rings[i]->empty);
+        sem_destroy(&rings[i]->full);
+        munmap(rings[i], ring_size);
+    }
+    free(rings);
+    free(msg);
+    return elapsed;
+}
+
+static void report(const char *mode, int subs, uint64_t messages, size_t size, double elapsed) {
+    double rate = (double)messages / elapsed;
+    double delivered = (double)messages * (double)size * subs / elapsed / 1e9;
+    printf("%-5s %4d %10llu %8zu %10.1f %12.0f %10.3f\n", mode, subs,
+           (unsigned long long)messages, size, elapsed * 1e3, rate, delivered);
+}
+
+int main(int argc, char *argv[]) {
+    uint64_t messages = 100000;
+    size_t size = 4096;
+    int max_subs = 16;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "n:s:m:")) != -1) {
+        switch (opt) {
+        case 'n': messages = strtoull(optarg, NULL, 0); break;
+        case 's': size = strtoull(optarg, NULL, 0); break;
+        case 'm': max_subs = atoi(optarg); break;
+        default:
+            fprintf(stderr, "usage: %s [-n messages] [-s size] [-m max_subscribers]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (size < sizeof(uint64_t)) size = sizeof(uint64_t);
+    if (max_subs > SHM_BUS_MAX_SUBSCRIBERS) max_subs = SHM_BUS_MAX_SUBSCRIBERS;
+
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    printf("%-5s %4s %10s %8s %10s %12s %10s\n",
+           "mode", "subs", "messages", "size", "time_ms", "msg/s", "GB/s");
+    for (int subs = 1; subs <= max_subs; subs *= 2) {
+        report("bus", subs, messages, size, run_bus(subs, messages, size));
+        report("copy", subs, messages, size, run_copy(subs, messages, size));
+    }
+    return total_failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+/*
+ * Ожидаемый результат: в режиме copy время издателя растёт линейно с числом
+ * потребителей (N memcpy на сообщение), в режиме bus стоимость публикации
+ * почти не зависит от N — добавляется только постановка индекса в очередь.
+ * Колонка GB/s — суммарный объём, доставленный всем потребителям.
+ */
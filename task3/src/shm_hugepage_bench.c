@@ -0,0 +1,215 @@
+/*
+ * Бенчмарк большого кольца в общей памяти: 4K против огромных страниц
+ *
+ * Для каждой конфигурации сегмента (см. shm_seg.h):
+ *  1. Производитель создаёт анонимный memfd-сегмент и один раз записывает
+ *     всё кольцо (первое касание страниц).
+ *  2. Передаёт дескриптор потребителю (отдельный процесс) через SCM_RIGHTS.
+ *  3. Потребитель отображает сегмент, последовательно читает кольцо и
+ *     делает серию случайных чтений (чувствительны к промахам TLB).
+ *
+ * На каждом этапе считаются minor faults (getrusage) и время. С MAP_POPULATE
+ * отказы переносятся на этап создания/отображения, с огромными страницами
+ * их становится в 512 раз меньше, а случайный доступ ускоряется за счёт TLB.
+ *
+ * Огромные страницы нужно заранее зарезервировать, например:
+ *   echo 256 > /proc/sys/vm/nr_hugepages
+ *
+ * Запуск: ./bin/shm_hugepage_bench [-s размер_МиБ] [-r случайных_чтений]
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include "shm_seg.h"
+
+typedef struct {
+    const char *name;
+    int flags;
+} seg_config_t;
+
+static const seg_config_t configs[] = {
+    {"4k",                 0},
+    {"4k+populate",        SHM_SEG_POPULATE},
+    {"4k+populate+lock",   SHM_SEG_POPULATE | SHM_SEG_LOCK},
+    {"huge",               SHM_SEG_HUGE},
+    {"huge+populate+lock", SHM_SEG_HUGE | SHM_SEG_POPULATE | SHM_SEG_LOCK},
+};
+
+// Результаты потребителя, передаются родителю через сокет.
+typedef struct {
+    int ok;
+    int locked;
+    long map_faults;
+    double map_ms;
+    long read_faults;
+    double read_ms;
+    double random_ns;
+    uint64_t checksum;
+} consumer_result_t;
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e3 + (double)ts.tv_nsec / 1e6;
+}
+
+static long minor_faults(void) {
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return ru.ru_minflt;
+}
+
+static void consumer(int sock, int flags, long random_reads) {
+    consumer_result_t res = {0};
+    long f0 = minor_faults();
+    double t0 = now_ms();
+    int fd = shm_seg_recv_fd(sock);
+    shm_seg_t seg;
+    if (fd == -1 || shm_seg_map_fd(&seg, fd, flags) == -1) {
+        perror("consumer: map");
+        if (write(sock, &res, sizeof(res)) < 0) {}
+        _exit(1);
+    }
+    res.map_ms = now_ms() - t0;
+    res.map_faults = minor_faults() - f0;
+    res.locked = seg.locked;
+
+    // Последовательное чтение всего кольца.
+    const uint64_t *words = seg.addr;
+    size_t count = seg.size / sizeof(uint64_t);
+    uint64_t sum = 0;
+    f0 = minor_faults();
+    t0 = now_ms();
+    for (size_t i = 0; i < count; ++i) sum += words[i];
+    res.read_ms = now_ms() - t0;
+    res.read_faults = minor_faults() - f0;
+
+    // Случайные чтения по кэш-линиям: почти каждое — промах TLB на 4K-страницах.
+    uint64_t x = 88172645463325252ull;
+    size_t lines = seg.size / 64;
+    t0 = now_ms();
+    for (long i = 0; i < random_reads; ++i) {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        sum += words[(x % lines) * 8];
+    }
+    res.random_ns = (now_ms() - t0) * 1e6 / (double)random_reads;
+    res.checksum = sum;
+    res.ok = 1;
+
+    if (write(sock, &res, sizeof(res)) != sizeof(res)) _exit(1);
+    shm_seg_close(&seg);
+    _exit(0);
+}
+
+static int run_config(const seg_config_t *cfg, size_t size, long random_reads) {
+    shm_seg_t seg;
+    long f0 = minor_faults();
+    double t0 = now_ms();
+    if (shm_seg_create(&seg, NULL, size, cfg->flags) == -1) {
+        fprintf(stderr, "%-20s skipped: %s%s\n", cfg->name, strerror(errno),
+                (cfg->flags & SHM_SEG_HUGE) ? " (reserve pages via /proc/sys/vm/nr_hugepages)" : "");
+        return 0;
+    }
+    double setup_ms = now_ms() - t0;
+    long setup_faults = minor_faults() - f0;
+
+    // Первое касание: запись всего кольца производителем.
+    uint64_t *words = seg.addr;
+    size_t count = seg.size / sizeof(uint64_t);
+    f0 = minor_faults();
+    t0 = now_ms();
+    for (size_t i = 0; i < count; ++i) words[i] = i;
+    double write_ms = now_ms() - t0;
+    long write_faults = minor_faults() - f0;
+
+    int sv[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) == -1) {
+        perror("socketpair");
+        return -1;
+    }
+    pid_t pid = fork();
+    if (pid == -1) {
+        perror("fork");
+        return -1;
+    }
+    if (pid == 0) {
+        close(sv[0]);
+        consumer(sv[1], cfg->flags, random_reads);
+    }
+    close(sv[1]);
+
+    consumer_result_t res = {0};
+    int rc = 0;
+    if (shm_seg_send_fd(sv[0], &seg) == -1 ||
+        read(sv[0], &res, sizeof(res)) != sizeof(res) || !res.ok) {
+        fprintf(stderr, "%-20s consumer failed\n", cfg->name);
+        rc = -1;
+    }
+    close(sv[0]);
+    waitpid(pid, NULL, 0);
+
+    if (rc == 0) {
+        double gb = (double)seg.size / 1e9;
+        printf("%-20s %6zu %5d %9.1f %8ld %9.1f %8ld %7.2f %9.1f %8ld %9.1f %8ld %7.2f %8.1f\n",
+               cfg->name, seg.page_size / 1024, seg.locked && res.locked,
+               setup_ms, setup_faults, write_ms, write_faults, gb / (write_ms / 1e3),
+               res.map_ms, res.map_faults, res.read_ms, res.read_faults,
+               gb / (res.read_ms / 1e3), res.random_ns);
+    }
+    shm_seg_close(&seg);
+    return rc;
+}
+
+int main(int argc, char *argv[]) {
+    size_t size_mb = 256;
+    long random_reads = 4 * 1000 * 1000;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "s:r:")) != -1) {
+        switch (opt) {
+        case 's': size_mb = strtoull(optarg, NULL, 0); break;
+        case 'r': random_reads = strtol(optarg, NULL, 0); break;
+        default:
+            fprintf(stderr, "usage: %s [-s size_MiB] [-r random_reads]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (size_mb == 0 || random_reads <= 0) {
+        fprintf(stderr, "size and random_reads must be positive\n");
+        return EXIT_FAILURE;
+    }
+
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    printf("Ring size: %zu MiB, huge page size: %zu KiB\n\n", size_mb,
+           shm_seg_huge_page_size() / 1024);
+    printf("%-20s %6s %5s %9s %8s %9s %8s %7s %9s %8s %9s %8s %7s %8s\n",
+           "config", "pageKB", "lock", "setup_ms", "faults", "write_ms", "faults", "GB/s",
+           "map_ms", "faults", "read_ms", "faults", "GB/s", "rand_ns");
+
+    int failures = 0;
+    for (size_t i = 0; i < sizeof(configs) / sizeof(configs[0]); ++i) {
+        if (run_config(&configs[i], size_mb << 20, random_reads) == -1) failures++;
+    }
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+/*
+ * Как читать результаты:
+ * - 4k: setup почти бесплатен, зато запись производителя и чтение
+ *   потребителя платят по отказу страницы на каждые 4 КиБ — в каждом
+ *   процессе отдельно (таблицы страниц у процессов свои).
+ * - populate: отказы переезжают в setup/map, рабочие проходы идут без них.
+ *   mlock дополнительно гарантирует, что страницы не будут вытеснены.
+ * - huge: отказов в 512 раз меньше (страница 2 МиБ), а rand_ns заметно
+ *   ниже, так как TLB покрывает намного больший объём памяти.
+ */
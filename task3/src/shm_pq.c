@@ -0,0 +1,345 @@
+/*
+ * Очередь сообщений с приоритетами в общей памяти (см. shm_pq.h)
+ *
+ * Раскладка сегмента:
+ *   [заголовок | кольца приоритетов][ячейки колец][заголовки слотов][данные слотов]
+ *
+ * Сообщение лежит в слоте из общего пула (стек Трайбера с тегом против ABA
+ * из shm_region.h), а в кольцо своего приоритета кладётся только индекс
+ * слота. Кольцо — ограниченная очередь Вьюкова (много отправителей, много
+ * получателей); глубина не меньше числа слотов, поэтому кольцо не
+ * переполняется, а «очередь полна» означает пустой пул.
+ *
+ * Маска непустых уровней: приоритет p — бит (SHM_PQ_MAX_PRIO - 1 - p),
+ * так что ffs даёт самый срочный уровень. Отправитель ставит бит после
+ * того, как индекс опубликован в кольце. Получатель, найдя кольцо пустым,
+ * снимает бит и проверяет кольцо ещё раз: сообщение, успевшее появиться
+ * между проверкой и снятием, вернёт бит обратно. Бит может быть лишним
+ * (кольцо уже пусто), но не может отсутствовать у непустого кольца.
+ */
+#define _GNU_SOURCE
+#include "shm_pq.h"
+#include "futex.h"
+#include "shm_region.h"
+
+#include <errno.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#define SHM_PQ_MAGIC    0x53485051u // "SHPQ"
+#define CACHE_LINE      64
+
+// Ячейка очереди Вьюкова: seq указывает, чья сейчас очередь работать с ячейкой.
+typedef struct {
+    _Atomic uint64_t seq;
+    uint32_t slot;
+} pq_cell_t;
+
+typedef struct {
+    _Atomic uint64_t enq_pos;
+    char pad[CACHE_LINE - 8];
+    _Atomic uint64_t deq_pos;
+} __attribute__((aligned(CACHE_LINE))) pq_ring_t;
+
+typedef struct {
+    _Atomic uint32_t next;      // следующий в стеке свободных
+    uint32_t len;
+} pq_slot_t;
+
+typedef struct {
+    shm_region_hdr_t region;
+    uint32_t maxmsg;
+    uint32_t msgsize;
+    uint32_t prios;
+    uint32_t depth;             // степень двойки >= maxmsg
+    uint32_t reserved;
+    uint64_t stride;
+    uint64_t cells_off;
+    uint64_t slots_off;
+    uint64_t payload_off;
+    shm_index_stack_t pool;         // свободные слоты
+    _Atomic uint64_t bitmap __attribute__((aligned(CACHE_LINE)));
+    _Atomic uint32_t msg_signal;    // futex-слово: отправлено сообщение
+    _Atomic uint32_t msg_waiters;
+    pq_ring_t rings[SHM_PQ_MAX_PRIO];
+} pq_header_t;
+
+struct shm_pq {
+    pq_header_t *hdr;
+    size_t size;
+    pq_cell_t *cells;
+    pq_slot_t *slots;
+    char *payload;
+};
+
+static uint64_t prio_bit(unsigned prio) {
+    return 1ull << (SHM_PQ_MAX_PRIO - 1 - prio);
+}
+
+static void pq_bind(shm_pq_t *q, void *base, size_t size) {
+    q->hdr = base;
+    q->size = size;
+    q->cells = (pq_cell_t *)((char *)base + q->hdr->cells_off);
+    q->slots = (pq_slot_t *)((char *)base + q->hdr->slots_off);
+    q->payload = (char *)base + q->hdr->payload_off;
+}
+
+// --- Пул слотов ---
+
+static void pool_push(shm_pq_t *q, uint32_t idx) {
+    shm_index_stack_push(&q->hdr->pool, &q->slots[0].next, sizeof(pq_slot_t), idx);
+}
+
+static uint32_t pool_pop(shm_pq_t *q) {
+    return shm_index_stack_pop(&q->hdr->pool, &q->slots[0].next, sizeof(pq_slot_t));
+}
+
+static char *slot_data(shm_pq_t *q, uint32_t idx) {
+    return q->payload + (size_t)idx * q->hdr->stride;
+}
+
+// --- Кольца приоритетов ---
+
+static pq_cell_t *ring_cells(shm_pq_t *q, unsigned prio) {
+    return q->cells + (size_t)prio * q->hdr->depth;
+}
+
+static void ring_enqueue(shm_pq_t *q, unsigned prio, uint32_t slot) {
+    pq_ring_t *r = &q->hdr->rings[prio];
+    pq_cell_t *cells = ring_cells(q, prio);
+    uint64_t mask = q->hdr->depth - 1;
+    uint64_t pos = atomic_load_explicit(&r->enq_pos, memory_order_relaxed);
+
+    // Слотов не больше глубины кольца: свободная ячейка всегда найдётся.
+    for (;;) {
+        pq_cell_t *cell = &cells[pos & mask];
+        uint64_t seq = atomic_load_explicit(&cell->seq, memory_order_acquire);
+        int64_t diff = (int64_t)seq - (int64_t)pos;
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&r->enq_pos, &pos, pos + 1,
+                                                      memory_order_relaxed,
+                                                      memory_order_relaxed)) {
+                cell->slot = slot;
+                atomic_store_explicit(&cell->seq, pos + 1, memory_order_release);
+                return;
+            }
+        } else {
+            pos = atomic_load_explicit(&r->enq_pos, memory_order_relaxed);
+        }
+    }
+}
+
+static uint32_t ring_dequeue(shm_pq_t *q, unsigned prio) {
+    pq_ring_t *r = &q->hdr->rings[prio];
+    pq_cell_t *cells = ring_cells(q, prio);
+    uint64_t mask = q->hdr->depth - 1;
+    uint64_t pos = atomic_load_explicit(&r->deq_pos, memory_order_relaxed);
+
+    for (;;) {
+        pq_cell_t *cell = &cells[pos & mask];
+        uint64_t seq = atomic_load_explicit(&cell->seq, memory_order_acquire);
+        int64_t diff = (int64_t)seq - (int64_t)(pos + 1);
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&r->deq_pos, &pos, pos + 1,
+                                                      memory_order_relaxed,
+                                                      memory_order_relaxed)) {
+                uint32_t slot = cell->slot;
+                atomic_store_explicit(&cell->seq, pos + mask + 1, memory_order_release);
+                return slot;
+            }
+        } else if (diff < 0) {
+            return SHM_NIL_INDEX; // пусто (или отправитель ещё не дописал ячейку)
+        } else {
+            pos = atomic_load_explicit(&r->deq_pos, memory_order_relaxed);
+        }
+    }
+}
+
+static int ring_ready(shm_pq_t *q, unsigned prio) {
+    uint64_t pos = atomic_load(&q->hdr->rings[prio].deq_pos);
+    pq_cell_t *cell = &ring_cells(q, prio)[pos & (q->hdr->depth - 1)];
+    return atomic_load_explicit(&cell->seq, memory_order_acquire) == pos + 1;
+}
+
+// Самое срочное сообщение или SHM_NIL_INDEX, если все кольца пусты.
+static uint32_t take_top(shm_pq_t *q, unsigned *prio) {
+    pq_header_t *h = q->hdr;
+    uint64_t bm = atomic_load(&h->bitmap);
+    while (bm) {
+        unsigned p = SHM_PQ_MAX_PRIO - (unsigned)__builtin_ffsll((long long)bm);
+        uint32_t slot = ring_dequeue(q, p);
+        if (slot != SHM_NIL_INDEX) {
+            *prio = p;
+            return slot;
+        }
+        atomic_fetch_and(&h->bitmap, ~prio_bit(p));
+        if (ring_ready(q, p)) atomic_fetch_or(&h->bitmap, prio_bit(p));
+        bm = atomic_load(&h->bitmap);
+    }
+    return SHM_NIL_INDEX;
+}
+
+// --- Создание и открытие ---
+
+shm_pq_t *shm_pq_create(const char *name, const shm_pq_attr_t *attr) {
+    if (!attr || attr->maxmsg == 0 || attr->maxmsg >= SHM_NIL_INDEX / 2 || attr->msgsize == 0 ||
+        attr->prios == 0 || attr->prios > SHM_PQ_MAX_PRIO) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    uint32_t depth = 1;
+    while (depth < attr->maxmsg) depth <<= 1;
+
+    size_t stride = align_up(attr->msgsize, CACHE_LINE);
+    size_t cells_off = align_up(sizeof(pq_header_t), CACHE_LINE);
+    size_t slots_off = align_up(cells_off + (size_t)attr->prios * depth * sizeof(pq_cell_t), CACHE_LINE);
+    size_t payload_off = align_up(slots_off + (size_t)attr->maxmsg * sizeof(pq_slot_t),
+                                  (size_t)sysconf(_SC_PAGESIZE));
+    size_t total = payload_off + (size_t)attr->maxmsg * stride;
+
+    shm_pq_t *q = calloc(1, sizeof(*q));
+    if (!q) return NULL;
+    void *base = shm_region_create(name, total);
+    if (!base) {
+        free(q);
+        return NULL;
+    }
+
+    pq_header_t *h = base;
+    h->maxmsg = attr->maxmsg;
+    h->msgsize = attr->msgsize;
+    h->prios = attr->prios;
+    h->depth = depth;
+    h->stride = stride;
+    h->cells_off = cells_off;
+    h->slots_off = slots_off;
+    h->payload_off = payload_off;
+    pq_bind(q, base, total);
+
+    for (size_t i = 0; i < (size_t)attr->prios * depth; ++i) {
+        atomic_init(&q->cells[i].seq, i % depth);
+    }
+    shm_index_stack_init(&h->pool, &q->slots[0].next, sizeof(pq_slot_t), attr->maxmsg);
+    shm_region_publish(base, SHM_PQ_MAGIC);
+    return q;
+}
+
+shm_pq_t *shm_pq_open(const char *name) {
+    size_t size;
+    void *base = shm_region_open(name, sizeof(pq_header_t), SHM_PQ_MAGIC, &size);
+    if (!base) return NULL;
+
+    shm_pq_t *q = calloc(1, sizeof(*q));
+    if (!q) {
+        munmap(base, size);
+        return NULL;
+    }
+    pq_bind(q, base, size);
+    return q;
+}
+
+void shm_pq_close(shm_pq_t *q) {
+    if (!q) return;
+    munmap(q->hdr, q->size);
+    free(q);
+}
+
+int shm_pq_unlink(const char *name) {
+    return shm_unlink(name);
+}
+
+void shm_pq_getattr(const shm_pq_t *q, shm_pq_attr_t *attr) {
+    attr->maxmsg = q->hdr->maxmsg;
+    attr->msgsize = q->hdr->msgsize;
+    attr->prios = q->hdr->prios;
+}
+
+// --- Отправка и приём ---
+
+int shm_pq_send(shm_pq_t *q, const void *msg, size_t len, unsigned prio, int timeout_ms) {
+    pq_header_t *h = q->hdr;
+    if (prio >= h->prios) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (len > h->msgsize) {
+        errno = EMSGSIZE;
+        return -1;
+    }
+    struct timespec deadline;
+    if (timeout_ms > 0) futex_deadline(&deadline, timeout_ms);
+
+    uint32_t idx;
+    while ((idx = pool_pop(q)) == SHM_NIL_INDEX) {
+        if (timeout_ms == 0) {
+            errno = EAGAIN;
+            return -1;
+        }
+        uint32_t seen = atomic_load(&h->pool.signal);
+        atomic_fetch_add(&h->pool.waiters, 1);
+        if ((idx = pool_pop(q)) != SHM_NIL_INDEX) {
+            atomic_fetch_sub(&h->pool.waiters, 1);
+            break;
+        }
+        int rc = futex_wait(&h->pool.signal, seen, timeout_ms > 0 ? &deadline : NULL);
+        int saved = errno;
+        atomic_fetch_sub(&h->pool.waiters, 1);
+        if (rc == -1 && saved == ETIMEDOUT) {
+            errno = ETIMEDOUT;
+            return -1;
+        }
+    }
+
+    memcpy(slot_data(q, idx), msg, len);
+    q->slots[idx].len = (uint32_t)len;
+    ring_enqueue(q, prio, idx);
+    atomic_fetch_or(&h->bitmap, prio_bit(prio));
+
+    atomic_fetch_add(&h->msg_signal, 1);
+    if (atomic_load(&h->msg_waiters) > 0) {
+        futex_wake(&h->msg_signal, 1);
+    }
+    return 0;
+}
+
+ssize_t shm_pq_receive(shm_pq_t *q, void *buf, size_t len, unsigned *prio, int timeout_ms) {
+    pq_header_t *h = q->hdr;
+    if (len < h->msgsize) {
+        errno = EMSGSIZE;
+        return -1;
+    }
+    struct timespec deadline;
+    if (timeout_ms > 0) futex_deadline(&deadline, timeout_ms);
+
+    unsigned p;
+    uint32_t idx;
+    while ((idx = take_top(q, &p)) == SHM_NIL_INDEX) {
+        if (timeout_ms == 0) {
+            errno = EAGAIN;
+            return -1;
+        }
+        uint32_t seen = atomic_load(&h->msg_signal);
+        atomic_fetch_add(&h->msg_waiters, 1);
+        if (atomic_load(&h->bitmap) != 0) {
+            atomic_fetch_sub(&h->msg_waiters, 1);
+            continue;
+        }
+        int rc = futex_wait(&h->msg_signal, seen, timeout_ms > 0 ? &deadline : NULL);
+        int saved = errno;
+        atomic_fetch_sub(&h->msg_waiters, 1);
+        if (rc == -1 && saved == ETIMEDOUT) {
+            errno = ETIMEDOUT;
+            return -1;
+        }
+    }
+
+    size_t n = q->slots[idx].len;
+    memcpy(buf, slot_data(q, idx), n);
+    pool_push(q, idx);
+    if (prio) *prio = p;
+    return (ssize_t)n;
+}
@@ -0,0 +1,54 @@
+#ifndef SHM_PQ_H
+#define SHM_PQ_H
+
+/*
+ * Очередь сообщений с приоритетами в общей памяти — замена POSIX MQ без
+ * системных вызовов в быстром пути.
+ *
+ * Интерфейс повторяет mq_send/mq_receive: сообщение копируется в очередь
+ * и из неё, больший приоритет извлекается первым, внутри приоритета —
+ * FIFO. В отличие от mq, размер и число сообщений задаются при создании
+ * и не ограничены /proc/sys/fs/mqueue, а приоритетов не больше
+ * SHM_PQ_MAX_PRIO.
+ *
+ * Внутри: у каждого приоритета своё неблокирующее кольцо, непустые
+ * уровни отмечены в 64-битной маске, и самый срочный уровень находится
+ * одной инструкцией (ffs). Ожидание (очередь пуста или полна) — futex с
+ * таймаутом, FUTEX_WAKE только если кто-то ждёт.
+ *
+ * Функции возвращают NULL/-1 и выставляют errno при ошибке.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#define SHM_PQ_MAX_PRIO 64
+
+typedef struct {
+    uint32_t maxmsg;        // сообщений в очереди (как mq_maxmsg)
+    uint32_t msgsize;       // наибольший размер сообщения (как mq_msgsize)
+    uint32_t prios;         // число приоритетов, 1..SHM_PQ_MAX_PRIO
+} shm_pq_attr_t;
+
+typedef struct shm_pq shm_pq_t;
+
+// Создание/открытие очереди. name — имя объекта shm_open ("/...").
+shm_pq_t *shm_pq_create(const char *name, const shm_pq_attr_t *attr);
+shm_pq_t *shm_pq_open(const char *name);
+void shm_pq_close(shm_pq_t *q);
+int shm_pq_unlink(const char *name);
+
+void shm_pq_getattr(const shm_pq_t *q, shm_pq_attr_t *attr);
+
+// Отправить сообщение с приоритетом prio (< attr.prios). Если очередь
+// полна: timeout_ms < 0 — ждать бесконечно, 0 — не ждать (errno = EAGAIN),
+// иначе ETIMEDOUT по истечении. EMSGSIZE, если len > msgsize.
+int shm_pq_send(shm_pq_t *q, const void *msg, size_t len, unsigned prio, int timeout_ms);
+
+// Получить самое срочное сообщение в buf (не меньше msgsize, иначе
+// EMSGSIZE). Возвращает длину, приоритет — в *prio (если не NULL).
+// Таймаут пустой очереди как у send.
+ssize_t shm_pq_receive(shm_pq_t *q, void *buf, size_t len, unsigned *prio, int timeout_ms);
+
+#endif // SHM_PQ_H
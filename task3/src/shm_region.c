@@ -0,0 +1,112 @@
+/*
+ * Создание и открытие сегментов, стек свободных индексов (см. shm_region.h)
+ */
+#define _GNU_SOURCE
+#include "shm_region.h"
+#include "futex.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+void *shm_region_create(const char *name, size_t size) {
+    int fd = shm_open(name, O_CREAT | O_RDWR | O_TRUNC, 0666);
+    if (fd == -1) return NULL;
+    if (ftruncate(fd, (off_t)size) == -1) {
+        int saved = errno;
+        close(fd);
+        shm_unlink(name);
+        errno = saved;
+        return NULL;
+    }
+    void *base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        int saved = errno;
+        shm_unlink(name);
+        errno = saved;
+        return NULL;
+    }
+    ((shm_region_hdr_t *)base)->total_size = size;
+    return base;
+}
+
+void shm_region_publish(void *base, uint32_t magic) {
+    // Магическое число пишется последним: открывающие процессы видят
+    // либо полностью инициализированный сегмент, либо ошибку.
+    atomic_thread_fence(memory_order_release);
+    ((shm_region_hdr_t *)base)->magic = magic;
+}
+
+void *shm_region_open(const char *name, size_t min_size, uint32_t magic, size_t *size) {
+    int fd = shm_open(name, O_RDWR, 0666);
+    if (fd == -1) return NULL;
+
+    struct stat st;
+    if (fstat(fd, &st) == -1) {
+        close(fd);
+        return NULL;
+    }
+    if ((size_t)st.st_size < min_size || (size_t)st.st_size < sizeof(shm_region_hdr_t)) {
+        close(fd);
+        errno = EINVAL;
+        return NULL;
+    }
+    void *base = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) return NULL;
+
+    shm_region_hdr_t *h = base;
+    atomic_thread_fence(memory_order_acquire);
+    if (h->magic != magic || h->total_size != (uint64_t)st.st_size) {
+        munmap(base, (size_t)st.st_size);
+        errno = EINVAL;
+        return NULL;
+    }
+    *size = (size_t)st.st_size;
+    return base;
+}
+
+// --- Стек свободных индексов ---
+
+static _Atomic uint32_t *link_of(_Atomic uint32_t *next0, size_t stride, uint32_t idx) {
+    return (_Atomic uint32_t *)((char *)next0 + (size_t)idx * stride);
+}
+
+void shm_index_stack_init(shm_index_stack_t *s, _Atomic uint32_t *next0, size_t stride, uint32_t count) {
+    atomic_init(&s->head, SHM_NIL_INDEX);
+    for (uint32_t i = count; i-- > 0;) {
+        atomic_init(link_of(next0, stride, i), (uint32_t)atomic_load(&s->head));
+        atomic_init(&s->head, i);
+    }
+    atomic_init(&s->signal, 0);
+    atomic_init(&s->waiters, 0);
+}
+
+void shm_index_stack_push(shm_index_stack_t *s, _Atomic uint32_t *next0, size_t stride, uint32_t idx) {
+    uint64_t old = atomic_load(&s->head);
+    uint64_t new;
+    do {
+        atomic_store_explicit(link_of(next0, stride, idx), (uint32_t)old, memory_order_relaxed);
+        new = (((old >> 32) + 1) << 32) | idx;
+    } while (!atomic_compare_exchange_weak(&s->head, &old, new));
+
+    atomic_fetch_add(&s->signal, 1);
+    if (atomic_load(&s->waiters) > 0) {
+        futex_wake(&s->signal, 1);
+    }
+}
+
+uint32_t shm_index_stack_pop(shm_index_stack_t *s, _Atomic uint32_t *next0, size_t stride) {
+    uint64_t old = atomic_load(&s->head);
+    uint64_t new;
+    do {
+        uint32_t idx = (uint32_t)old;
+        if (idx == SHM_NIL_INDEX) return SHM_NIL_INDEX;
+        uint32_t next = atomic_load_explicit(link_of(next0, stride, idx), memory_order_relaxed);
+        new = (((old >> 32) + 1) << 32) | next;
+    } while (!atomic_compare_exchange_weak(&s->head, &old, new));
+    return (uint32_t)old;
+}
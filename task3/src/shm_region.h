@@ -0,0 +1,57 @@
+#ifndef SHM_REGION_H
+#define SHM_REGION_H
+
+/*
+ * Общие части сегментов общей памяти shm_bus, shm_pq и shm_blob.
+ *
+ * Сегмент начинается с shm_region_hdr_t. Создатель заполняет сегмент и
+ * последним пишет магическое число (shm_region_publish); открывающий
+ * процесс проверяет магическое число и размер, так что видит либо
+ * полностью инициализированный сегмент, либо ошибку.
+ *
+ * Свободные элементы пула — стек Трайбера с тегом против ABA: индекс
+ * вершины и счётчик изменений в одном 64-битном слове. Ссылка на
+ * следующий свободный элемент лежит в самом элементе: next0 — поле next
+ * элемента 0, stride — размер элемента в массиве. Каждое освобождение
+ * увеличивает futex-слово signal; FUTEX_WAKE выполняется, только если
+ * waiters > 0, ожидание пишет сам пул.
+ */
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define SHM_NIL_INDEX   UINT32_MAX
+
+typedef struct {
+    uint32_t magic;
+    uint32_t reserved;
+    uint64_t total_size;
+} shm_region_hdr_t;
+
+typedef struct {
+    _Atomic uint64_t head;      // (тег << 32) | индекс
+    _Atomic uint32_t signal;    // futex-слово: освобождён элемент
+    _Atomic uint32_t waiters;
+} shm_index_stack_t;
+
+static inline size_t align_up(size_t v, size_t a) {
+    return (v + a - 1) & ~(a - 1);
+}
+
+// Создаёт сегмент name размером size (O_TRUNC) и отображает его; total_size
+// заполнен, magic ноль. При ошибке сегмент удаляется; NULL и errno.
+void *shm_region_create(const char *name, size_t size);
+// Пишет магическое число после всех остальных полей сегмента.
+void shm_region_publish(void *base, uint32_t magic);
+// Отображает сегмент name; в *size — его размер. NULL и errno: EINVAL,
+// если сегмент меньше min_size, не инициализирован или чужой.
+void *shm_region_open(const char *name, size_t min_size, uint32_t magic, size_t *size);
+
+// Стек из элементов 0..count-1, 0 на вершине.
+void shm_index_stack_init(shm_index_stack_t *s, _Atomic uint32_t *next0, size_t stride, uint32_t count);
+void shm_index_stack_push(shm_index_stack_t *s, _Atomic uint32_t *next0, size_t stride, uint32_t idx);
+// Индекс с вершины или SHM_NIL_INDEX, если стек пуст.
+uint32_t shm_index_stack_pop(shm_index_stack_t *s, _Atomic uint32_t *next0, size_t stride);
+
+#endif // SHM_REGION_H
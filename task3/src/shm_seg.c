@@ -0,0 +1,305 @@
+/*
+ * Сегменты общей памяти на огромных страницах (см. shm_seg.h)
+ */
+#define _GNU_SOURCE
+#include "shm_seg.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/statfs.h>
+#include <unistd.h>
+
+#ifndef HUGETLBFS_MAGIC
+#define HUGETLBFS_MAGIC 0x958458f6
+#endif
+
+// Печати, без которых получатель не доверяет сегменту.
+#define SEALS_REQUIRED (F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE)
+
+size_t shm_seg_huge_page_size(void) {
+    FILE *f = fopen("/proc/meminfo", "r");
+    if (!f) return 0;
+    char line[128];
+    size_t kb = 0;
+    while (fgets(line, sizeof(line), f)) {
+        if (sscanf(line, "Hugepagesize: %zu kB", &kb) == 1) break;
+    }
+    fclose(f);
+    return kb * 1024;
+}
+
+// Путь к файлу name на первой смонтированной hugetlbfs.
+static int hugetlbfs_path(const char *name, char *path, size_t len) {
+    FILE *f = fopen("/proc/mounts", "r");
+    if (!f) return -1;
+    char dev[256], dir[PATH_MAX], type[64];
+    int found = 0;
+    while (fscanf(f, "%255s %4095s %63s %*[^\n]", dev, dir, type) == 3) {
+        if (strcmp(type, "hugetlbfs") == 0) {
+            found = 1;
+            break;
+        }
+    }
+    fclose(f);
+    if (!found) {
+        errno = ENOENT;
+        return -1;
+    }
+    int n = snprintf(path, len, "%s/%s", dir, name[0] == '/' ? name + 1 : name);
+    if (n < 0 || (size_t)n >= len) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    return 0;
+}
+
+static size_t round_up(size_t v, size_t a) {
+    return (v + a - 1) / a * a;
+}
+
+static int seg_map(shm_seg_t *seg, int flags) {
+    // Запечатанный от записи сегмент ядро не даст отобразить для записи,
+    // а до 6.7 — и разделяемо вообще (MAP_SHARED с F_SEAL_WRITE — EPERM
+    // даже при PROT_READ). Содержимое уже не меняется, поэтому частное
+    // отображение только для чтения видит те же страницы.
+    int map_flags = seg->sealed ? MAP_PRIVATE : MAP_SHARED;
+    if (flags & SHM_SEG_POPULATE) map_flags |= MAP_POPULATE;
+    int prot = seg->sealed ? PROT_READ : PROT_READ | PROT_WRITE;
+
+    seg->addr = mmap(NULL, seg->size, prot, map_flags, seg->fd, 0);
+    if (seg->addr == MAP_FAILED) {
+        seg->addr = NULL;
+        return -1;
+    }
+    seg->flags = flags & (SHM_SEG_POPULATE | SHM_SEG_LOCK | SHM_SEG_SEALED);
+    if (seg->page_size > (size_t)sysconf(_SC_PAGESIZE)) seg->flags |= SHM_SEG_HUGE;
+
+    // Без CAP_IPC_LOCK mlock ограничен RLIMIT_MEMLOCK — это не ошибка
+    // отображения, вызывающий может проверить seg->locked.
+    seg->locked = 0;
+    if (flags & SHM_SEG_LOCK) {
+        if (mlock(seg->addr, seg->size) == 0) {
+            seg->locked = 1;
+        } else {
+            seg->flags &= ~SHM_SEG_LOCK;
+        }
+    }
+    return 0;
+}
+
+static int seg_create_huge(shm_seg_t *seg, const char *name, size_t size, int flags) {
+    size_t hp = shm_seg_huge_page_size();
+    if (hp == 0) {
+        errno = ENOTSUP;
+        return -1;
+    }
+
+    char path[PATH_MAX];
+    if (name) {
+        if (hugetlbfs_path(name, path, sizeof(path)) == -1) return -1;
+        seg->fd = open(path, O_CREAT | O_RDWR | O_TRUNC | O_CLOEXEC, 0666);
+    } else {
+        unsigned mfd = MFD_HUGETLB | MFD_CLOEXEC;
+        if (flags & SHM_SEG_SEALED) mfd |= MFD_ALLOW_SEALING;
+        seg->fd = memfd_create("shm_seg", mfd);
+    }
+    if (seg->fd == -1) return -1;
+
+    seg->size = round_up(size, hp);
+    seg->page_size = hp;
+    // Огромные страницы резервируются при mmap: если в пуле
+    // (/proc/sys/vm/nr_hugepages) их не хватает, mmap вернёт ENOMEM.
+    if (ftruncate(seg->fd, (off_t)seg->size) == -1 || seg_map(seg, flags) == -1) {
+        int saved = errno;
+        close(seg->fd);
+        seg->fd = -1;
+        if (name) unlink(path);
+        errno = saved;
+        return -1;
+    }
+    return 0;
+}
+
+int shm_seg_create(shm_seg_t *seg, const char *name, size_t size, int flags) {
+    memset(seg, 0, sizeof(*seg));
+    seg->fd = -1;
+    // Печати есть только у анонимного memfd.
+    if (size == 0 || (name && (flags & SHM_SEG_SEALED))) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (flags & SHM_SEG_HUGE) {
+        if (seg_create_huge(seg, name, size, flags) == 0) return 0;
+        if (!(flags & SHM_SEG_FALLBACK)) return -1;
+    }
+
+    if (name) {
+        seg->fd = shm_open(name, O_CREAT | O_RDWR | O_TRUNC, 0666);
+    } else {
+        seg->fd = memfd_create("shm_seg", MFD_CLOEXEC | (flags & SHM_SEG_SEALED ? MFD_ALLOW_SEALING : 0));
+    }
+    if (seg->fd == -1) return -1;
+
+    seg->page_size = (size_t)sysconf(_SC_PAGESIZE);
+    seg->size = round_up(size, seg->page_size);
+    if (ftruncate(seg->fd, (off_t)seg->size) == -1 || seg_map(seg, flags) == -1) {
+        int saved = errno;
+        close(seg->fd);
+        seg->fd = -1;
+        if (name) shm_unlink(name);
+        errno = saved;
+        return -1;
+    }
+    return 0;
+}
+
+int shm_seg_map_fd(shm_seg_t *seg, int fd, int flags) {
+    memset(seg, 0, sizeof(*seg));
+    seg->fd = fd;
+
+    struct stat st;
+    struct statfs sfs;
+    if (fstat(fd, &st) == -1 || fstatfs(fd, &sfs) == -1) return -1;
+    seg->size = (size_t)st.st_size;
+    seg->page_size = (size_t)sysconf(_SC_PAGESIZE);
+    if ((unsigned long)sfs.f_type == HUGETLBFS_MAGIC) seg->page_size = (size_t)sfs.f_bsize;
+    if (seg->size == 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (flags & SHM_SEG_SEALED) {
+        int seals = fcntl(fd, F_GET_SEALS);
+        if (seals == -1) return -1;
+        if ((seals & SEALS_REQUIRED) != SEALS_REQUIRED) {
+            errno = EPERM;
+            return -1;
+        }
+        seg->sealed = 1;
+    }
+    return seg_map(seg, flags);
+}
+
+int shm_seg_seal(shm_seg_t *seg) {
+    // F_SEAL_WRITE не ставится, пока есть разделяемое отображение для записи.
+    if (seg->addr) {
+        if (seg->locked) munlock(seg->addr, seg->size);
+        munmap(seg->addr, seg->size);
+        seg->addr = NULL;
+        seg->locked = 0;
+    }
+    if (fcntl(seg->fd, F_ADD_SEALS, SEALS_REQUIRED | F_SEAL_SEAL) == -1) return -1;
+    seg->sealed = 1;
+    return 0;
+}
+
+int shm_seg_open(shm_seg_t *seg, const char *name, int flags) {
+    int fd = -1;
+    if (flags & SHM_SEG_HUGE) {
+        char path[PATH_MAX];
+        if (hugetlbfs_path(name, path, sizeof(path)) == 0) {
+            fd = open(path, O_RDWR | O_CLOEXEC);
+        }
+        if (fd == -1 && !(flags & SHM_SEG_FALLBACK)) return -1;
+    }
+    if (fd == -1) fd = shm_open(name, O_RDWR, 0666);
+    if (fd == -1) return -1;
+
+    if (shm_seg_map_fd(seg, fd, flags) == -1) {
+        int saved = errno;
+        close(fd);
+        seg->fd = -1;
+        errno = saved;
+        return -1;
+    }
+    return 0;
+}
+
+void shm_seg_close(shm_seg_t *seg) {
+    if (seg->addr) {
+        if (seg->locked) munlock(seg->addr, seg->size);
+        munmap(seg->addr, seg->size);
+    }
+    if (seg->fd != -1) close(seg->fd);
+    seg->addr = NULL;
+    seg->fd = -1;
+}
+
+int shm_seg_unlink(const char *name, int flags) {
+    int rc = -1;
+    if (flags & SHM_SEG_HUGE) {
+        char path[PATH_MAX];
+        if (hugetlbfs_path(name, path, sizeof(path)) == 0 && unlink(path) == 0) rc = 0;
+    }
+    if (shm_unlink(name) == 0) rc = 0;
+    return rc;
+}
+
+// --- Передача дескриптора (SCM_RIGHTS) ---
+
+int shm_seg_send_fd(int sock, const shm_seg_t *seg) {
+    char byte = 'S';
+    struct iovec iov = {.iov_base = &byte, .iov_len = 1};
+    union {
+        struct cmsghdr align;
+        char buf[CMSG_SPACE(sizeof(int))];
+    } ctrl;
+    memset(&ctrl, 0, sizeof(ctrl));
+
+    struct msghdr msg = {
+        .msg_iov = &iov,
+        .msg_iovlen = 1,
+        .msg_control = ctrl.buf,
+        .msg_controllen = sizeof(ctrl.buf),
+    };
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(cmsg), &seg->fd, sizeof(int));
+
+    ssize_t n;
+    do {
+        n = sendmsg(sock, &msg, 0);
+    } while (n == -1 && errno == EINTR);
+    return n == 1 ? 0 : -1;
+}
+
+int shm_seg_recv_fd(int sock) {
+    char byte;
+    struct iovec iov = {.iov_base = &byte, .iov_len = 1};
+    union {
+        struct cmsghdr align;
+        char buf[CMSG_SPACE(sizeof(int))];
+    } ctrl;
+
+    struct msghdr msg = {
+        .msg_iov = &iov,
+        .msg_iovlen = 1,
+        .msg_control = ctrl.buf,
+        .msg_controllen = sizeof(ctrl.buf),
+    };
+    ssize_t n;
+    do {
+        n = recvmsg(sock, &msg, MSG_CMSG_CLOEXEC);
+    } while (n == -1 && errno == EINTR);
+    if (n <= 0) {
+        if (n == 0) errno = ECONNRESET;
+        return -1;
+    }
+
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    if (!cmsg || cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS) {
+        errno = EPROTO;
+        return -1;
+    }
+    int fd;
+    memcpy(&fd, CMSG_DATA(cmsg), sizeof(int));
+    return fd;
+}
@@ -0,0 +1,77 @@
+#ifndef SHM_SEG_H
+#define SHM_SEG_H
+
+/*
+ * Сегменты общей памяти большого размера: огромные страницы,
+ * предварительное отображение страниц и блокировка в RAM.
+ *
+ * shm_producer/shm_consumer отображают сегмент через shm_open + mmap,
+ * и каждая 4K-страница подгружается по первому обращению (minor fault)
+ * отдельно в каждом процессе. Для колец в сотни мегабайт это тысячи
+ * отказов страниц и постоянные промахи TLB. Здесь сегмент можно:
+ *  - разместить на огромных страницах (memfd_create(MFD_HUGETLB) или файл
+ *    на смонтированной hugetlbfs);
+ *  - отобразить с MAP_POPULATE, чтобы все отказы произошли при создании;
+ *  - заблокировать в памяти через mlock.
+ *
+ * Разделить сегмент между процессами можно по имени (shm_open или файл
+ * на hugetlbfs) либо передав дескриптор через UNIX-сокет (SCM_RIGHTS) —
+ * единственный способ для анонимного memfd.
+ *
+ * Запечатанный memfd (SHM_SEG_SEALED) передаёт полезную нагрузку без
+ * копирования: отправитель заполняет сегмент, запечатывает его
+ * (shm_seg_seal: размер и содержимое больше не меняются) и передаёт fd,
+ * получатель проверяет печати и отображает сегмент только для чтения —
+ * отправитель уже не может изменить данные у него «под ногами».
+ *
+ * Функции возвращают 0/-1 и выставляют errno.
+ */
+
+#include <stddef.h>
+
+// Флаги создания/отображения
+#define SHM_SEG_HUGE        0x1 // огромные страницы (hugetlb)
+#define SHM_SEG_FALLBACK    0x2 // при нехватке огромных страниц использовать 4K
+#define SHM_SEG_POPULATE    0x4 // MAP_POPULATE: все отказы страниц сразу
+#define SHM_SEG_LOCK        0x8 // mlock всего сегмента
+#define SHM_SEG_SEALED      0x10 // create: memfd с печатями; map_fd: только запечатанный, только чтение
+
+typedef struct {
+    void *addr;
+    size_t size;        // округлён до размера страницы
+    size_t page_size;   // фактический размер страницы (4K или 2M/1G)
+    int fd;
+    int flags;          // фактически применённые флаги
+    int locked;         // mlock удался
+    int sealed;         // запечатан (отображается только для чтения)
+} shm_seg_t;
+
+// Создать сегмент. name == NULL — анонимный memfd (делится только через fd),
+// иначе объект shm_open или, при SHM_SEG_HUGE, файл на hugetlbfs.
+int shm_seg_create(shm_seg_t *seg, const char *name, size_t size, int flags);
+
+// Открыть существующий именованный сегмент.
+int shm_seg_open(shm_seg_t *seg, const char *name, int flags);
+
+// Отобразить сегмент по дескриптору, полученному от другого процесса.
+// Размер и тип страниц определяются по самому дескриптору, из flags
+// учитываются только POPULATE и LOCK. При успехе дескриптор переходит
+// во владение seg, при ошибке его закрывает вызывающий.
+int shm_seg_map_fd(shm_seg_t *seg, int fd, int flags);
+
+// Запечатать сегмент SHM_SEG_SEALED от записи и изменения размера.
+// Отображение для записи при этом снимается (seg->addr == NULL), fd
+// остаётся для передачи.
+int shm_seg_seal(shm_seg_t *seg);
+
+void shm_seg_close(shm_seg_t *seg);
+int shm_seg_unlink(const char *name, int flags);
+
+// Передача дескриптора сегмента через UNIX-сокет (SCM_RIGHTS).
+int shm_seg_send_fd(int sock, const shm_seg_t *seg);
+int shm_seg_recv_fd(int sock); // возвращает дескриптор
+
+// Размер огромной страницы по умолчанию (из /proc/meminfo), 0 если нет.
+size_t shm_seg_huge_page_size(void);
+
+#endif // SHM_SEG_H
@@ -0,0 +1,156 @@
+/*
+ * Иерархическое колесо таймеров (см. timer_wheel.h)
+ */
+#include "timer_wheel.h"
+
+#include <stddef.h>
+
+#define TW_MASK (TW_SLOTS - 1)
+#define TW_MAX_DELTA ((1ull << (TW_SLOT_BITS * TW_LEVELS)) - 1)
+
+static void list_init(tw_timer_t *head) {
+    head->next = head->prev = head;
+}
+
+static void list_append(tw_timer_t *head, tw_timer_t *t) {
+    t->prev = head->prev;
+    t->next = head;
+    head->prev->next = t;
+    head->prev = t;
+}
+
+static void list_unlink(tw_timer_t *t) {
+    t->prev->next = t->next;
+    t->next->prev = t->prev;
+    t->next = t->prev = NULL;
+}
+
+void tw_init(timer_wheel_t *tw, uint64_t tick_ns, uint64_t now_ns) {
+    tw->now = 0;
+    tw->tick_ns = tick_ns ? tick_ns : 1;
+    tw->origin_ns = now_ns;
+    tw->pending = 0;
+    tw->firing = 0;
+    for (int l = 0; l < TW_LEVELS; ++l) {
+        for (unsigned s = 0; s < TW_SLOTS; ++s) list_init(&tw->slots[l][s]);
+    }
+}
+
+// Ячейка для таймера: младший уровень, чей диапазон покрывает задержку.
+static void tw_insert(timer_wheel_t *tw, tw_timer_t *t) {
+    uint64_t expires = t->expires;
+    // Во время обратных вызовов ячейка тика now уже отцеплена: таймер,
+    // положенный в неё, сработал бы только через полный круг.
+    uint64_t first = tw->now + (tw->firing ? 1 : 0);
+    if (expires < first) expires = first;
+    uint64_t delta = expires - tw->now;
+    // Дальше горизонта колеса — кладём на горизонт, при осыпании
+    // таймер переедет по настоящему expires.
+    if (delta > TW_MAX_DELTA) {
+        delta = TW_MAX_DELTA;
+        expires = tw->now + delta;
+    }
+
+    int level = 0;
+    while (level < TW_LEVELS - 1 && delta >= (1ull << (TW_SLOT_BITS * (level + 1)))) level++;
+    unsigned slot = (unsigned)(expires >> (TW_SLOT_BITS * level)) & TW_MASK;
+    list_append(&tw->slots[level][slot], t);
+}
+
+void tw_add(timer_wheel_t *tw, tw_timer_t *t, uint64_t expires) {
+    if (t->next) {
+        list_unlink(t);
+    } else {
+        tw->pending++;
+    }
+    t->expires = expires;
+    tw_insert(tw, t);
+}
+
+void tw_cancel(timer_wheel_t *tw, tw_timer_t *t) {
+    if (!t->next) return;
+    list_unlink(t);
+    tw->pending--;
+}
+
+// Переложить ячейку старшего уровня на младшие.
+static void tw_cascade(timer_wheel_t *tw, int level, unsigned slot) {
+    tw_timer_t *head = &tw->slots[level][slot];
+    tw_timer_t list;
+    if (head->next == head) return;
+
+    // Сначала отцепляем весь список: tw_insert может вернуть таймер
+    // в эту же ячейку (при expires дальше горизонта).
+    list.next = head->next;
+    list.prev = head->prev;
+    list.next->prev = &list;
+    list.prev->next = &list;
+    list_init(head);
+
+    while (list.next != &list) {
+        tw_timer_t *t = list.next;
+        list_unlink(t);
+        tw_insert(tw, t);
+    }
+}
+
+unsigned tw_advance(timer_wheel_t *tw, uint64_t now_ns, tw_callback_t cb, void *arg) {
+    uint64_t target = now_ns < tw->origin_ns ? 0 : (now_ns - tw->origin_ns) / tw->tick_ns;
+    unsigned fired = 0;
+
+    while (tw->now <= target) {
+        if (tw->pending == 0) {
+            // Пустое колесо можно сразу перевести на текущий тик.
+            tw->now = target + 1;
+            break;
+        }
+
+        unsigned idx = (unsigned)tw->now & TW_MASK;
+        // Младший уровень прошёл полный круг — осыпаем следующий, и так
+        // далее, пока индекс очередного уровня тоже не нулевой.
+        for (int l = 1; idx == 0 && l < TW_LEVELS; ++l) {
+            idx = (unsigned)(tw->now >> (TW_SLOT_BITS * l)) & TW_MASK;
+            tw_cascade(tw, l, idx);
+        }
+
+        tw_timer_t *head = &tw->slots[0][tw->now & TW_MASK];
+        tw_timer_t list;
+        if (head->next != head) {
+            list.next = head->next;
+            list.prev = head->prev;
+            list.next->prev = &list;
+            list.prev->next = &list;
+            list_init(head);
+
+            tw->firing = 1;
+            while (list.next != &list) {
+                tw_timer_t *t = list.next;
+                list_unlink(t);
+                tw->pending--;
+                fired++;
+                cb(t, arg);
+            }
+            tw->firing = 0;
+        }
+        tw->now++;
+    }
+    return fired;
+}
+
+uint64_t tw_next_expiry(const timer_wheel_t *tw) {
+    if (tw->pending == 0) return 0;
+    // Начало круга ещё не обработано: осыпание старших уровней может
+    // положить таймеры прямо на этот тик.
+    if ((tw->now & TW_MASK) == 0) return tw_tick_time(tw, tw->now);
+
+    // Ближайшая непустая ячейка младшего уровня до конца текущего круга.
+    uint64_t tick = tw->now;
+    do {
+        const tw_timer_t *head = &tw->slots[0][tick & TW_MASK];
+        if (head->next != head) return tw_tick_time(tw, tick);
+        tick++;
+    } while ((tick & TW_MASK) != 0);
+
+    // Иначе — начало следующего круга, где осыпается старший уровень.
+    return tw_tick_time(tw, tick);
+}
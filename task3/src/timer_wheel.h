@@ -0,0 +1,85 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+/*
+ * Иерархическое колесо таймеров (Varghese & Lauck, как timer_list в
+ * старых ядрах Linux).
+ *
+ * Время дискретно: тик задаётся при инициализации. Колесо состоит из
+ * TW_LEVELS уровней по TW_SLOTS ячеек; уровень k покрывает интервалы
+ * до TW_SLOTS^(k+1) тиков. Таймер кладётся в ячейку по времени
+ * срабатывания, а при переходе младшего уровня через ноль ячейка
+ * старшего уровня «осыпается» (cascade) на уровни ниже. Поэтому:
+ *  - постановка, отмена и перестановка — O(1) (двусвязный список ячейки);
+ *  - продвижение на тик — O(1) плюс сработавшие таймеры, осыпание
+ *    амортизированно O(1) на таймер на уровень.
+ *
+ * Таймеры интрузивные: tw_timer_t встраивается в объект пользователя,
+ * по сработавшему таймеру объект находится через offsetof.
+ *
+ * Колесо однопоточное. Сколько ждать до следующего срабатывания, говорит
+ * tw_next_expiry — по нему один timerfd на всё колесо.
+ */
+
+#include <stdint.h>
+
+#define TW_SLOT_BITS 6
+#define TW_SLOTS (1u << TW_SLOT_BITS)
+#define TW_LEVELS 5         // 2^30 тиков: ~12 суток при тике 1 мс
+
+typedef struct tw_timer {
+    struct tw_timer *next;  // NULL — таймер не поставлен
+    struct tw_timer *prev;
+    uint64_t expires;       // тик срабатывания
+} tw_timer_t;
+
+typedef struct {
+    uint64_t now;           // следующий необработанный тик
+    uint64_t tick_ns;
+    uint64_t origin_ns;     // время тика 0
+    uint64_t pending;       // поставленных таймеров
+    int firing;             // идут обратные вызовы тика now
+    tw_timer_t slots[TW_LEVELS][TW_SLOTS]; // головы кольцевых списков
+} timer_wheel_t;
+
+typedef void (*tw_callback_t)(tw_timer_t *timer, void *arg);
+
+// Тик длиной tick_ns, тик 0 начинается в now_ns.
+void tw_init(timer_wheel_t *tw, uint64_t tick_ns, uint64_t now_ns);
+
+static inline void tw_timer_init(tw_timer_t *t) {
+    t->next = t->prev = 0;
+    t->expires = 0;
+}
+
+static inline int tw_timer_pending(const tw_timer_t *t) {
+    return t->next != 0;
+}
+
+// Перевод времени в тики: срабатывание не раньше заданного момента.
+static inline uint64_t tw_ticks_ceil(const timer_wheel_t *tw, uint64_t at_ns) {
+    if (at_ns <= tw->origin_ns) return 0;
+    return (at_ns - tw->origin_ns + tw->tick_ns - 1) / tw->tick_ns;
+}
+
+static inline uint64_t tw_tick_time(const timer_wheel_t *tw, uint64_t tick) {
+    return tw->origin_ns + tick * tw->tick_ns;
+}
+
+// Поставить таймер на тик expires (уже поставленный — переставить).
+// Прошедший тик означает «на ближайшем продвижении»; из обратного вызова
+// (ячейка тика now уже разобрана) — на тике now + 1.
+void tw_add(timer_wheel_t *tw, tw_timer_t *t, uint64_t expires);
+void tw_cancel(timer_wheel_t *tw, tw_timer_t *t);
+
+// Обработать все тики до момента now_ns включительно, вызывая cb для
+// сработавших таймеров. В cb можно ставить и отменять любые таймеры.
+// Возвращает число сработавших.
+unsigned tw_advance(timer_wheel_t *tw, uint64_t now_ns, tw_callback_t cb, void *arg);
+
+// Момент (нс), к которому нужно вызвать tw_advance в следующий раз, или
+// 0, если таймеров нет. Может быть раньше ближайшего таймера (граница
+// осыпания старшего уровня), но никогда не позже.
+uint64_t tw_next_expiry(const timer_wheel_t *tw);
+
+#endif // TIMER_WHEEL_H
@@ -0,0 +1,317 @@
+/*
+ * Бенчмарк колеса таймеров (timer_wheel.h)
+ *
+ * 1. Операции в виртуальном времени на -n таймерах (по умолчанию 100 000,
+ *    сроки равномерно в 1..-r тиков): постановка, перестановка (refresh —
+ *    то, что делает сервер при активности клиента), отмена и продвижение
+ *    времени со срабатыванием всех таймеров. Каждый таймер обязан
+ *    сработать ровно на своём тике — это проверка корректности осыпания.
+ *    Для сравнения — цена timerfd_settime, то есть «свой timerfd на
+ *    подключение» (-k дескрипторов).
+ * 2. Точность в реальном времени: -a таймеров со сроками до -d мс, колесо
+ *    с тиком -t мкс ведётся одним timerfd через epoll, как в epoll_server.
+ *    Печатаются перцентили опоздания срабатывания относительно заданного
+ *    момента; раньше срока не должен сработать ни один таймер.
+ * 3. Перестановка из обратного вызова: таймер, переставленный на текущий
+ *    (или прошедший) тик прямо в своём обратном вызове, обязан сработать
+ *    на следующем тике — в том числе на границе круга младшего уровня.
+ *
+ * Запуск: ./bin/timer_wheel_bench [-n таймеров] [-r тиков] [-k timerfd]
+ *                                 [-a таймеров] [-d мс] [-t мкс]
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <time.h>
+#include <unistd.h>
+#include "lat_hist.h"
+#include "timer_wheel.h"
+
+typedef struct {
+    tw_timer_t timer;
+    uint64_t due;       // тик (часть 1) или момент в нс (часть 2)
+    int fired;
+} bench_timer_t;
+
+typedef struct {
+    timer_wheel_t *tw;
+    uint64_t fired;
+    uint64_t wrong;     // сработали не на своём тике
+} virt_ctx_t;
+
+typedef struct {
+    lat_hist_t late;
+    uint64_t fired;
+    uint64_t early;
+} real_ctx_t;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static uint64_t rng_state = 0x9E3779B97F4A7C15ull;
+
+static uint64_t rng_next(void) {
+    uint64_t x = rng_state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    return rng_state = x;
+}
+
+static bench_timer_t *to_bench(tw_timer_t *t) {
+    return (bench_timer_t *)(void *)((char *)t - offsetof(bench_timer_t, timer));
+}
+
+static void on_virtual(tw_timer_t *t, void *arg) {
+    virt_ctx_t *ctx = arg;
+    bench_timer_t *b = to_bench(t);
+    // Во время обратного вызова tw->now — обрабатываемый тик.
+    if (b->due != ctx->tw->now || b->fired) ctx->wrong++;
+    b->fired = 1;
+    ctx->fired++;
+}
+
+static void on_real(tw_timer_t *t, void *arg) {
+    real_ctx_t *ctx = arg;
+    bench_timer_t *b = to_bench(t);
+    uint64_t now = now_ns();
+    if (now < b->due) {
+        ctx->early++;
+    } else {
+        lat_hist_record(&ctx->late, now - b->due);
+    }
+    b->fired = 1;
+    ctx->fired++;
+}
+
+static void report(const char *what, uint64_t ops, uint64_t ns) {
+    printf("  %-28s %10llu ops  %8.1f Mops/s  %6.1f ns/op\n", what, (unsigned long long)ops,
+           ns ? (double)ops * 1e3 / (double)ns : 0.0, ops ? (double)ns / (double)ops : 0.0);
+}
+
+// Часть 1: операции в виртуальном времени. Возвращает число ошибок.
+static int bench_ops(long n, uint64_t range) {
+    timer_wheel_t *tw = malloc(sizeof(*tw));
+    bench_timer_t *timers = calloc((size_t)n, sizeof(*timers));
+    if (!tw || !timers) {
+        perror("malloc");
+        return 1;
+    }
+    tw_init(tw, 1, 0);
+    virt_ctx_t ctx = {tw, 0, 0};
+    printf("virtual time, %ld timers, deadlines 1..%llu ticks:\n", n, (unsigned long long)range);
+
+    uint64_t t0 = now_ns();
+    for (long i = 0; i < n; ++i) {
+        tw_timer_init(&timers[i].timer);
+        timers[i].due = 1 + rng_next() % range;
+        tw_add(tw, &timers[i].timer, timers[i].due);
+    }
+    report("arm", (uint64_t)n, now_ns() - t0);
+
+    // Перестановка случайных таймеров на новый срок.
+    long refreshes = n * 10;
+    t0 = now_ns();
+    for (long i = 0; i < refreshes; ++i) {
+        bench_timer_t *b = &timers[rng_next() % (uint64_t)n];
+        b->due = 1 + rng_next() % range;
+        tw_add(tw, &b->timer, b->due);
+    }
+    report("refresh (re-arm)", (uint64_t)refreshes, now_ns() - t0);
+
+    t0 = now_ns();
+    for (long i = 0; i < n; ++i) tw_cancel(tw, &timers[i].timer);
+    report("cancel", (uint64_t)n, now_ns() - t0);
+
+    for (long i = 0; i < n; ++i) {
+        timers[i].due = 1 + rng_next() % range;
+        tw_add(tw, &timers[i].timer, timers[i].due);
+    }
+    t0 = now_ns();
+    tw_advance(tw, range, on_virtual, &ctx);
+    uint64_t ns = now_ns() - t0;
+    report("expire (advance + cascade)", ctx.fired, ns);
+    printf("  advanced %llu ticks in %.2f ms, %llu timers fired on a wrong tick, %llu left\n",
+           (unsigned long long)range, (double)ns / 1e6, (unsigned long long)ctx.wrong,
+           (unsigned long long)tw->pending);
+
+    int errors = ctx.fired != (uint64_t)n || ctx.wrong != 0 || tw->pending != 0;
+    free(timers);
+    free(tw);
+    return errors;
+}
+
+typedef struct {
+    timer_wheel_t *tw;
+    uint64_t last;      // тик предыдущего срабатывания
+    int left;           // сколько раз ещё переставить
+    int wrong;
+} rearm_ctx_t;
+
+static void on_rearm(tw_timer_t *t, void *arg) {
+    rearm_ctx_t *ctx = arg;
+    if (ctx->last != UINT64_MAX && ctx->tw->now != ctx->last + 1) ctx->wrong++;
+    ctx->last = ctx->tw->now;
+    if (ctx->left-- > 0) tw_add(ctx->tw, t, ctx->left % 2 ? ctx->tw->now : 0);
+}
+
+// Часть 3: перестановка на текущий и прошедший тик из обратного вызова.
+static int check_rearm(void) {
+    static timer_wheel_t tw;
+    tw_timer_t timer;
+    int errors = 0;
+    // Старт внутри круга и прямо перед его границей (осыпание на тике 64).
+    const uint64_t starts[] = {5, TW_SLOTS - 2};
+    for (size_t i = 0; i < sizeof(starts) / sizeof(starts[0]); ++i) {
+        tw_init(&tw, 1, 0);
+        tw_timer_init(&timer);
+        rearm_ctx_t ctx = {&tw, UINT64_MAX, 4, 0};
+        tw_add(&tw, &timer, starts[i]);
+        // По тику за вызов: каждое срабатывание — на следующем продвижении.
+        unsigned fired = 0;
+        for (uint64_t tick = 0; tick <= starts[i] + 4; ++tick) fired += tw_advance(&tw, tick, on_rearm, &ctx);
+        if (fired != 5 || ctx.wrong || tw.pending) {
+            fprintf(stderr, "re-arm from callback, start %llu: fired %u of 5, %d on a wrong tick, %llu left\n",
+                    (unsigned long long)starts[i], fired, ctx.wrong, (unsigned long long)tw.pending);
+            errors++;
+        }
+    }
+    printf("re-arm from callback at the current tick: %s\n", errors ? "FAILED" : "ok");
+    return errors;
+}
+
+// Для сравнения: перевзвод отдельного timerfd на каждое подключение.
+static void bench_timerfd(int k) {
+    int *fds = malloc((size_t)k * sizeof(*fds));
+    if (!fds) return;
+    int created = 0;
+    for (; created < k; ++created) {
+        if ((fds[created] = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK)) == -1) {
+            perror("timerfd_create");
+            break;
+        }
+    }
+    if (created > 0) {
+        long ops = (long)created * 100;
+        struct itimerspec its;
+        memset(&its, 0, sizeof(its));
+        uint64_t t0 = now_ns();
+        for (long i = 0; i < ops; ++i) {
+            its.it_value.tv_sec = 60 + (time_t)(i % 60);
+            timerfd_settime(fds[i % created], 0, &its, NULL);
+        }
+        char what[64];
+        snprintf(what, sizeof(what), "timerfd_settime (%d fds)", created);
+        report(what, (uint64_t)ops, now_ns() - t0);
+    }
+    for (int i = 0; i < created; ++i) close(fds[i]);
+    free(fds);
+}
+
+// Часть 2: точность срабатывания с одним timerfd. Возвращает число ошибок.
+static int bench_accuracy(long n, long max_ms, long tick_us) {
+    timer_wheel_t *tw = malloc(sizeof(*tw));
+    bench_timer_t *timers = calloc((size_t)n, sizeof(*timers));
+    real_ctx_t *ctx = malloc(sizeof(*ctx));
+    int tfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+    int epfd = epoll_create1(0);
+    if (!tw || !timers || !ctx || tfd == -1 || epfd == -1) {
+        perror("setup");
+        return 1;
+    }
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.u64 = 0;
+    epoll_ctl(epfd, EPOLL_CTL_ADD, tfd, &ev);
+
+    lat_hist_init(&ctx->late);
+    ctx->fired = ctx->early = 0;
+    uint64_t start = now_ns();
+    tw_init(tw, (uint64_t)tick_us * 1000, start);
+    for (long i = 0; i < n; ++i) {
+        tw_timer_init(&timers[i].timer);
+        timers[i].due = start + 1000000ull + rng_next() % ((uint64_t)max_ms * 1000000ull);
+        tw_add(tw, &timers[i].timer, tw_ticks_ceil(tw, timers[i].due));
+    }
+
+    uint64_t armed = 0, wakeups = 0;
+    uint64_t give_up = start + (uint64_t)max_ms * 1000000ull + 2000000000ull;
+    while (tw->pending && now_ns() < give_up) {
+        uint64_t next = tw_next_expiry(tw);
+        if (next != armed) {
+            struct itimerspec its;
+            memset(&its, 0, sizeof(its));
+            its.it_value.tv_sec = (time_t)(next / 1000000000ull);
+            its.it_value.tv_nsec = (long)(next % 1000000000ull);
+            timerfd_settime(tfd, TFD_TIMER_ABSTIME, &its, NULL);
+            armed = next;
+        }
+        if (epoll_wait(epfd, &ev, 1, 100) <= 0) continue;
+        uint64_t expirations;
+        if (read(tfd, &expirations, sizeof(expirations)) == -1 && errno != EAGAIN) perror("read");
+        armed = 0;
+        wakeups++;
+        tw_advance(tw, now_ns(), on_real, ctx);
+    }
+
+    printf("real time, %ld timers over %ld ms, tick %ld us, one timerfd (%llu wakeups):\n",
+           n, max_ms, tick_us, (unsigned long long)wakeups);
+    printf("  lateness p50=%.1f us p99=%.1f us p99.9=%.1f us max=%.1f us, early=%llu, missed=%llu\n",
+           (double)lat_hist_percentile(&ctx->late, 50) / 1e3,
+           (double)lat_hist_percentile(&ctx->late, 99) / 1e3,
+           (double)lat_hist_percentile(&ctx->late, 99.9) / 1e3, (double)ctx->late.max / 1e3,
+           (unsigned long long)ctx->early, (unsigned long long)tw->pending);
+
+    int errors = ctx->early != 0 || ctx->fired != (uint64_t)n;
+    close(epfd);
+    close(tfd);
+    free(ctx);
+    free(timers);
+    free(tw);
+    return errors;
+}
+
+int main(int argc, char *argv[]) {
+    long n = 100000;
+    uint64_t range = 1u << 20;
+    int k = 1000;
+    long accuracy_n = 10000;
+    long max_ms = 1000;
+    long tick_us = 1000;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "n:r:k:a:d:t:")) != -1) {
+        switch (opt) {
+        case 'n': n = atol(optarg); break;
+        case 'r': range = strtoull(optarg, NULL, 0); break;
+        case 'k': k = atoi(optarg); break;
+        case 'a': accuracy_n = atol(optarg); break;
+        case 'd': max_ms = atol(optarg); break;
+        case 't': tick_us = atol(optarg); break;
+        default:
+            fprintf(stderr, "usage: %s [-n timers] [-r range-ticks] [-k timerfds] "
+                            "[-a timers] [-d max-ms] [-t tick-us]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (n < 1 || range < 1 || accuracy_n < 1 || max_ms < 1 || tick_us < 1) {
+        fprintf(stderr, "all parameters must be positive\n");
+        return EXIT_FAILURE;
+    }
+
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    int errors = bench_ops(n, range);
+    if (k > 0) bench_timerfd(k);
+    errors += bench_accuracy(accuracy_n, max_ms, tick_us);
+    errors += check_rearm();
+    return errors ? EXIT_FAILURE : EXIT_SUCCESS;
+}
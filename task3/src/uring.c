@@ -0,0 +1,180 @@
+/*
+ * io_uring на голых системных вызовах (см. uring.h)
+ */
+#define _GNU_SOURCE
+#include "uring.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+static int sys_io_uring_setup(unsigned entries, struct io_uring_params *p) {
+    return (int)syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int sys_io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags) {
+    return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, NULL, 0);
+}
+
+static int sys_io_uring_register(int fd, unsigned op, void *arg, unsigned nr) {
+    return (int)syscall(__NR_io_uring_register, fd, op, arg, nr);
+}
+
+static int ring_setup(unsigned entries, unsigned cq_entries, unsigned flags,
+                      struct io_uring_params *p) {
+    memset(p, 0, sizeof(*p));
+    p->flags = flags | IORING_SETUP_CQSIZE;
+    p->cq_entries = cq_entries;
+    return sys_io_uring_setup(entries, p);
+}
+
+int uring_init(uring_t *r, unsigned entries, unsigned cq_factor) {
+    memset(r, 0, sizeof(*r));
+    r->fd = -1;
+
+    // SINGLE_ISSUER и COOP_TASKRUN убирают межпроцессорные прерывания
+    // для доставки завершений; на старых ядрах их нет — пробуем без них.
+    struct io_uring_params p;
+    unsigned cq_entries = entries * (cq_factor ? cq_factor : 1);
+    r->fd = ring_setup(entries, cq_entries,
+                       IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_COOP_TASKRUN, &p);
+    if (r->fd == -1 && errno == EINVAL) r->fd = ring_setup(entries, cq_entries, 0, &p);
+    if (r->fd == -1) return -1;
+    r->features = p.features;
+
+    r->sq_ring_len = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    r->cq_ring_len = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        if (r->cq_ring_len > r->sq_ring_len) r->sq_ring_len = r->cq_ring_len;
+        r->cq_ring_len = r->sq_ring_len;
+    }
+
+    r->sq_ring = mmap(NULL, r->sq_ring_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      r->fd, IORING_OFF_SQ_RING);
+    if (r->sq_ring == MAP_FAILED) goto fail;
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        r->cq_ring = r->sq_ring;
+    } else {
+        r->cq_ring = mmap(NULL, r->cq_ring_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                          r->fd, IORING_OFF_CQ_RING);
+        if (r->cq_ring == MAP_FAILED) goto fail;
+    }
+    r->sqes_len = p.sq_entries * sizeof(struct io_uring_sqe);
+    r->sqes = mmap(NULL, r->sqes_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                   r->fd, IORING_OFF_SQES);
+    if (r->sqes == MAP_FAILED) goto fail;
+
+    char *sq = r->sq_ring;
+    r->sq_head = (unsigned *)(sq + p.sq_off.head);
+    r->sq_tail = (unsigned *)(sq + p.sq_off.tail);
+    r->sq_array = (unsigned *)(sq + p.sq_off.array);
+    r->sq_mask = *(unsigned *)(sq + p.sq_off.ring_mask);
+    r->sq_entries = p.sq_entries;
+    r->sq_local_tail = *r->sq_tail;
+
+    char *cq = r->cq_ring;
+    r->cq_head = (unsigned *)(cq + p.cq_off.head);
+    r->cq_tail = (unsigned *)(cq + p.cq_off.tail);
+    r->cq_mask = *(unsigned *)(cq + p.cq_off.ring_mask);
+    r->cqes = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+
+    // Индексы SQE совпадают с позициями в массиве — заполним его один раз.
+    for (unsigned i = 0; i < r->sq_entries; ++i) r->sq_array[i] = i;
+    return 0;
+
+fail:;
+    int saved = errno;
+    if (r->sq_ring == MAP_FAILED) r->sq_ring = NULL;
+    if (r->cq_ring == MAP_FAILED) r->cq_ring = NULL;
+    if (r->sqes == MAP_FAILED) r->sqes = NULL;
+    uring_exit(r);
+    errno = saved;
+    return -1;
+}
+
+void uring_exit(uring_t *r) {
+    if (r->sqes) munmap(r->sqes, r->sqes_len);
+    if (r->cq_ring && r->cq_ring != r->sq_ring) munmap(r->cq_ring, r->cq_ring_len);
+    if (r->sq_ring) munmap(r->sq_ring, r->sq_ring_len);
+    if (r->fd != -1) close(r->fd);
+    memset(r, 0, sizeof(*r));
+    r->fd = -1;
+}
+
+struct io_uring_sqe *uring_get_sqe(uring_t *r) {
+    unsigned head = __atomic_load_n(r->sq_head, __ATOMIC_ACQUIRE);
+    if (r->sq_local_tail - head >= r->sq_entries) return NULL;
+    struct io_uring_sqe *sqe = &r->sqes[r->sq_local_tail & r->sq_mask];
+    r->sq_local_tail++;
+    memset(sqe, 0, sizeof(*sqe));
+    return sqe;
+}
+
+int uring_submit(uring_t *r, unsigned wait_nr) {
+    unsigned to_submit = r->sq_local_tail - *r->sq_tail;
+    if (to_submit) __atomic_store_n(r->sq_tail, r->sq_local_tail, __ATOMIC_RELEASE);
+    if (to_submit == 0 && wait_nr == 0) return 0;
+
+    r->enters++;
+    int ret = sys_io_uring_enter(r->fd, to_submit, wait_nr, wait_nr ? IORING_ENTER_GETEVENTS : 0);
+    return ret;
+}
+
+int uring_buf_ring_setup(uring_t *r, uring_buf_ring_t *br, uint16_t bgid,
+                         unsigned count, unsigned size) {
+    memset(br, 0, sizeof(*br));
+    if (count == 0 || (count & (count - 1)) != 0 || count > 32768) {
+        errno = EINVAL;
+        return -1;
+    }
+    br->count = count;
+    br->size = size;
+    br->bgid = bgid;
+    br->ring_len = count * sizeof(struct io_uring_buf);
+
+    br->ring = mmap(NULL, br->ring_len, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+    if (br->ring == MAP_FAILED) {
+        br->ring = NULL;
+        return -1;
+    }
+    br->bufs = mmap(NULL, (size_t)count * size, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (br->bufs == MAP_FAILED) {
+        br->bufs = NULL;
+        uring_buf_ring_free(r, br);
+        return -1;
+    }
+
+    struct io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = (uint64_t)(uintptr_t)br->ring;
+    reg.ring_entries = count;
+    reg.bgid = bgid;
+    if (sys_io_uring_register(r->fd, IORING_REGISTER_PBUF_RING, &reg, 1) == -1) {
+        int saved = errno;
+        munmap(br->bufs, (size_t)count * size);
+        munmap(br->ring, br->ring_len);
+        memset(br, 0, sizeof(*br));
+        errno = saved;
+        return -1;
+    }
+
+    for (unsigned i = 0; i < count; ++i) uring_buf_ring_add(br, i);
+    uring_buf_ring_commit(br);
+    return 0;
+}
+
+void uring_buf_ring_free(uring_t *r, uring_buf_ring_t *br) {
+    if (br->ring && r->fd != -1) {
+        struct io_uring_buf_reg reg;
+        memset(&reg, 0, sizeof(reg));
+        reg.bgid = br->bgid;
+        sys_io_uring_register(r->fd, IORING_UNREGISTER_PBUF_RING, &reg, 1);
+    }
+    if (br->bufs) munmap(br->bufs, (size_t)br->count * br->size);
+    if (br->ring) munmap(br->ring, br->ring_len);
+    memset(br, 0, sizeof(*br));
+}
@@ -0,0 +1,121 @@
+#ifndef URING_H
+#define URING_H
+
+/*
+ * Минимальная обёртка над io_uring на голых системных вызовах
+ * (io_uring_setup / io_uring_enter / io_uring_register), без liburing.
+ *
+ * Кольцо отправки (SQ) и кольцо завершений (CQ) отображаются в память
+ * процесса, поэтому заявки ставятся и результаты забираются без системных
+ * вызовов; io_uring_enter нужен только чтобы отдать пачку заявок ядру
+ * и/или дождаться завершений. Число таких вызовов считается в enters.
+ *
+ * Кольцо предоставленных буферов (provided buffer ring, IORING_REGISTER_PBUF_RING)
+ * — общий пул буферов, из которого ядро само выбирает буфер для recv
+ * (IOSQE_BUFFER_SELECT); номер буфера приходит в cqe->flags. После
+ * обработки буфер возвращается в кольцо тоже без системного вызова.
+ *
+ * Кольцо не потокобезопасно: им пользуется один поток (SINGLE_ISSUER).
+ * Функции возвращают 0/-1 и выставляют errno.
+ */
+
+#include <linux/io_uring.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+typedef struct {
+    int fd;
+    unsigned features;
+
+    // Кольцо отправки
+    unsigned *sq_head;
+    unsigned *sq_tail;
+    unsigned *sq_array;
+    unsigned sq_mask;
+    unsigned sq_entries;
+    unsigned sq_local_tail;     // заполненные, но ещё не опубликованные заявки
+    struct io_uring_sqe *sqes;
+
+    // Кольцо завершений
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned cq_mask;
+    struct io_uring_cqe *cqes;
+
+    void *sq_ring;
+    size_t sq_ring_len;
+    void *cq_ring;
+    size_t cq_ring_len;
+    size_t sqes_len;
+
+    uint64_t enters;            // вызовов io_uring_enter
+} uring_t;
+
+// Кольцо предоставленных буферов: count буферов по size байт, группа bgid.
+typedef struct {
+    struct io_uring_buf_ring *ring;
+    char *bufs;
+    unsigned count;             // степень двойки
+    unsigned size;
+    uint16_t bgid;
+    uint16_t tail;
+    size_t ring_len;
+} uring_buf_ring_t;
+
+// entries — размер SQ (степень двойки), CQ в cq_factor раз больше:
+// многоразовые (multishot) заявки дают много завершений на одну заявку.
+int uring_init(uring_t *r, unsigned entries, unsigned cq_factor);
+void uring_exit(uring_t *r);
+
+// Следующая свободная заявка (обнулённая) или NULL, если SQ заполнено —
+// тогда нужно вызвать uring_submit.
+struct io_uring_sqe *uring_get_sqe(uring_t *r);
+
+// Отдать ядру накопленные заявки одним io_uring_enter и, если wait_nr > 0,
+// дождаться стольких завершений. Возвращает число принятых заявок.
+int uring_submit(uring_t *r, unsigned wait_nr);
+
+// Следующее завершение или NULL; после обработки — uring_cqe_seen.
+static inline struct io_uring_cqe *uring_peek_cqe(uring_t *r) {
+    unsigned head = *r->cq_head;
+    if (head == __atomic_load_n(r->cq_tail, __ATOMIC_ACQUIRE)) return NULL;
+    return &r->cqes[head & r->cq_mask];
+}
+
+static inline void uring_cqe_seen(uring_t *r) {
+    __atomic_store_n(r->cq_head, *r->cq_head + 1, __ATOMIC_RELEASE);
+}
+
+// Заполнить заявку: код операции, дескриптор, адрес/длина и user_data.
+static inline void uring_prep(struct io_uring_sqe *sqe, uint8_t op, int fd,
+                              const void *addr, unsigned len, uint64_t user_data) {
+    sqe->opcode = op;
+    sqe->fd = fd;
+    sqe->addr = (uint64_t)(uintptr_t)addr;
+    sqe->len = len;
+    sqe->user_data = user_data;
+}
+
+int uring_buf_ring_setup(uring_t *r, uring_buf_ring_t *br, uint16_t bgid,
+                         unsigned count, unsigned size);
+void uring_buf_ring_free(uring_t *r, uring_buf_ring_t *br);
+
+static inline char *uring_buf(const uring_buf_ring_t *br, unsigned bid) {
+    return br->bufs + (size_t)bid * br->size;
+}
+
+// Вернуть буфер bid в кольцо. Ядро увидит его после uring_buf_ring_commit.
+static inline void uring_buf_ring_add(uring_buf_ring_t *br, unsigned bid) {
+    struct io_uring_buf *b = &br->ring->bufs[br->tail & (br->count - 1)];
+    b->addr = (uint64_t)(uintptr_t)uring_buf(br, bid);
+    b->len = br->size;
+    b->bid = (uint16_t)bid;
+    br->tail++;
+}
+
+static inline void uring_buf_ring_commit(uring_buf_ring_t *br) {
+    __atomic_store_n(&br->ring->tail, br->tail, __ATOMIC_RELEASE);
+}
+
+#endif // URING_H
@@ -0,0 +1,393 @@
+/*
+ * Бенчмарк передачи больших сообщений без копирования
+ *
+ * Две части, для размеров сообщения от -s min до max КиБ (×4):
+ *
+ *  1. Эхо через epoll_server (-x сервер): сервер запускается обычным
+ *     (read/writev: ядро -> блоки -> ядро) и с -z (splice сокет -> канал
+ *     -> сокет, данные не покидают ядро). Клиент один и тот же, поэтому
+ *     разница — в процессорном времени сервера на гигабайт.
+ *
+ *  2. Передача между процессами по UNIX-сокету (отправитель — дочерний
+ *     процесс, получатель читает сообщение целиком и считает сумму):
+ *      - copy:     write -> read, два копирования;
+ *      - vmsplice: отправитель отдаёт свои страницы в канал (vmsplice) и
+ *                  переносит их в сокет (splice), копирует только read
+ *                  получателя. Страницы нельзя менять, пока получатель
+ *                  их не прочитал, — отсюда подтверждения ниже;
+ *      - memfd:    отправитель пишет сообщение прямо в новый memfd,
+ *                  запечатывает его (shm_seg_seal) и передаёт fd через
+ *                  SCM_RIGHTS; получатель проверяет печати и отображает
+ *                  сегмент только для чтения — ни одного копирования, но
+ *                  на каждое сообщение новые страницы и mmap/munmap.
+ *     Во всех режимах отправитель готовит сообщение заново (заполняет
+ *     номером сообщения, получатель сверяет сумму) и держит не больше
+ *     двух неподтверждённых сообщений.
+ *
+ * Печатает ГБ/с и миллисекунды процессорного времени на ГБ (rusage).
+ * Код возврата ненулевой при ошибке или неверных данных.
+ *
+ * Запуск: ./bin/zcopy_bench [-x сервер] [-s мин:макс КиБ] [-v МиБ на точку]
+ *   ./bin/zcopy_bench -x ./bin/epoll_server -s 64:65536
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include "shm_seg.h"
+
+#define SERVER_SOCKET "/tmp/epoll_server.sock"
+#define RECV_CHUNK (1024 * 1024)
+#define PIPE_SIZE (1024 * 1024)
+#define WINDOW 2                        // неподтверждённых сообщений (handoff)
+
+enum { MODE_COPY, MODE_VMSPLICE, MODE_MEMFD, MODE_COUNT };
+static const char *mode_names[MODE_COUNT] = {"copy", "vmsplice", "memfd"};
+
+static double now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static double rusage_cpu_s(const struct rusage *ru) {
+    return (double)ru->ru_utime.tv_sec + (double)ru->ru_utime.tv_usec / 1e6 +
+           (double)ru->ru_stime.tv_sec + (double)ru->ru_stime.tv_usec / 1e6;
+}
+
+static double self_cpu_s(void) {
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return rusage_cpu_s(&ru);
+}
+
+static int write_full(int fd, const char *buf, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, buf, len);
+        if (n == -1) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        buf += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+static int read_full(int fd, char *buf, size_t len) {
+    while (len > 0) {
+        ssize_t n = read(fd, buf, len);
+        if (n == 0) errno = ECONNRESET;
+        if (n <= 0) {
+            if (n == -1 && errno == EINTR) continue;
+            return -1;
+        }
+        buf += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+// Сообщение номер i: все байты равны (uint8_t)(i + 1).
+static void fill_message(char *buf, size_t size, size_t i) {
+    memset(buf, (int)(uint8_t)(i + 1), size);
+}
+
+// Получатель «потребляет» сообщение: сумма по 8-байтовым словам.
+static int check_message(const char *buf, size_t size, size_t i) {
+    uint64_t pattern = 0x0101010101010101ull * (uint8_t)(i + 1);
+    uint64_t sum = 0;
+    const uint64_t *w = (const uint64_t *)(const void *)buf;
+    for (size_t k = 0; k < size / 8; ++k) sum += w[k];
+    return sum == pattern * (size / 8) ? 0 : -1;
+}
+
+// --- Часть 1: эхо через epoll_server ---
+
+static pid_t spawn_server(const char *server, int zero_copy) {
+    pid_t pid = fork();
+    if (pid == 0) {
+        int null = open("/dev/null", O_WRONLY);
+        if (null != -1) dup2(null, STDOUT_FILENO);
+        execl(server, server, "-q", "-t", "0", zero_copy ? "-z" : (char *)NULL, (char *)NULL);
+        perror("execl");
+        _exit(127);
+    }
+    return pid;
+}
+
+static int connect_server(void) {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, SERVER_SOCKET, sizeof(addr.sun_path) - 1);
+    for (int i = 0; i < 200; ++i) {
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd == -1) return -1;
+        if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0) return fd;
+        close(fd);
+        usleep(10000);
+    }
+    return -1;
+}
+
+// Отправить msgs сообщений и принять всё эхо: запись и чтение идут
+// одновременно, иначе сервер упрётся в свой порог и встанет.
+static int echo_run(int fd, const char *msg, char *buf, size_t size, size_t msgs) {
+    size_t total = size * msgs, sent = 0, received = 0;
+    if (fcntl(fd, F_SETFL, O_NONBLOCK) == -1) return -1;
+    while (received < total) {
+        struct pollfd pfd = {.fd = fd, .events = POLLIN | (sent < total ? POLLOUT : 0)};
+        if (poll(&pfd, 1, 5000) <= 0) {
+            fprintf(stderr, "echo: timeout\n");
+            return -1;
+        }
+        if (sent < total && (pfd.revents & POLLOUT)) {
+            size_t off = sent % size;
+            ssize_t n = write(fd, msg + off, size - off);
+            if (n > 0) sent += (size_t)n;
+            else if (errno != EAGAIN && errno != EINTR) return -1;
+        }
+        if (pfd.revents & (POLLIN | POLLHUP | POLLERR)) {
+            size_t want = total - received < RECV_CHUNK ? total - received : RECV_CHUNK;
+            ssize_t n = read(fd, buf, want);
+            if (n == 0) return -1;
+            if (n > 0) received += (size_t)n;
+            else if (errno != EAGAIN && errno != EINTR) return -1;
+        }
+    }
+    return 0;
+}
+
+static int bench_echo(const char *server, size_t size, size_t msgs, const char *msg, char *buf) {
+    int failures = 0;
+    for (int zc = 0; zc <= 1; ++zc) {
+        pid_t pid = spawn_server(server, zc);
+        int fd = pid > 0 ? connect_server() : -1;
+        double t0 = now_s(), cpu0 = self_cpu_s();
+        int rc = fd == -1 ? -1 : echo_run(fd, msg, buf, size, msgs);
+        double secs = now_s() - t0, cli_cpu = self_cpu_s() - cpu0;
+        if (fd != -1) close(fd);
+
+        double srv_cpu = 0;
+        if (pid > 0) {
+            struct rusage ru;
+            kill(pid, SIGTERM);
+            if (wait4(pid, NULL, 0, &ru) == pid) srv_cpu = rusage_cpu_s(&ru);
+        }
+        double gb = (double)(size * msgs) / 1e9;
+        if (rc == -1) {
+            printf("%-9zu %-9s %8s\n", size >> 10, zc ? "splice" : "copy", "FAILED");
+            failures++;
+            continue;
+        }
+        printf("%-9zu %-9s %8.2f %12.1f %12.1f\n", size >> 10, zc ? "splice" : "copy",
+               gb / secs, srv_cpu * 1e3 / gb, cli_cpu * 1e3 / gb);
+    }
+    return failures;
+}
+
+// --- Часть 2: передача между процессами ---
+
+static int wait_ack(int sock) {
+    char ack;
+    return read_full(sock, &ack, 1);
+}
+
+static int send_vmsplice(int sock, int pipe_fds[2], size_t pipe_size, char *msg, size_t size) {
+    size_t off = 0;
+    while (off < size) {
+        size_t chunk = size - off < pipe_size ? size - off : pipe_size;
+        struct iovec iov = {.iov_base = msg + off, .iov_len = chunk};
+        ssize_t n = vmsplice(pipe_fds[1], &iov, 1, 0);
+        if (n == -1) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        for (ssize_t left = n; left > 0;) {
+            ssize_t m = splice(pipe_fds[0], NULL, sock, NULL, (size_t)left, SPLICE_F_MOVE);
+            if (m == -1) {
+                if (errno == EINTR) continue;
+                return -1;
+            }
+            left -= m;
+        }
+        off += (size_t)n;
+    }
+    return 0;
+}
+
+static void sender(int sock, int mode, size_t size, size_t msgs) {
+    char *slots[WINDOW] = {NULL};
+    int pipe_fds[2] = {-1, -1};
+    size_t pipe_size = 0;
+
+    if (mode != MODE_MEMFD) {
+        for (int s = 0; s < WINDOW; ++s) {
+            if (!(slots[s] = aligned_alloc(4096, size))) _exit(1);
+        }
+    }
+    if (mode == MODE_VMSPLICE) {
+        if (pipe(pipe_fds) == -1) _exit(1);
+        int sz = fcntl(pipe_fds[1], F_SETPIPE_SZ, PIPE_SIZE);
+        if (sz == -1) sz = fcntl(pipe_fds[1], F_GETPIPE_SZ);
+        pipe_size = (size_t)sz;
+    }
+
+    for (size_t i = 0; i < msgs; ++i) {
+        // Слот (или память memfd) сообщения i - WINDOW освобождается только
+        // после того, как получатель его прочитал.
+        if (i >= WINDOW && wait_ack(sock) == -1) _exit(1);
+        int rc;
+        if (mode == MODE_MEMFD) {
+            shm_seg_t seg;
+            if (shm_seg_create(&seg, NULL, size, SHM_SEG_SEALED) == -1) _exit(1);
+            fill_message(seg.addr, size, i);
+            rc = shm_seg_seal(&seg) == -1 ? -1 : shm_seg_send_fd(sock, &seg);
+            shm_seg_close(&seg); // копия fd уже в сокете
+        } else {
+            char *msg = slots[i % WINDOW];
+            fill_message(msg, size, i);
+            rc = mode == MODE_COPY ? write_full(sock, msg, size)
+                                   : send_vmsplice(sock, pipe_fds, pipe_size, msg, size);
+        }
+        if (rc == -1) {
+            perror(mode_names[mode]);
+            _exit(1);
+        }
+    }
+    for (size_t i = msgs > WINDOW ? msgs - WINDOW : 0; i < msgs; ++i) {
+        if (wait_ack(sock) == -1) _exit(1);
+    }
+    _exit(0);
+}
+
+static int receive(int sock, int mode, char *buf, size_t size, size_t msgs) {
+    for (size_t i = 0; i < msgs; ++i) {
+        if (mode == MODE_MEMFD) {
+            int fd = shm_seg_recv_fd(sock);
+            shm_seg_t seg;
+            if (fd == -1) return -1;
+            if (shm_seg_map_fd(&seg, fd, SHM_SEG_SEALED) == -1) {
+                perror("shm_seg_map_fd");
+                close(fd);
+                return -1;
+            }
+            // Сегмент мог оказаться больше (округление до страницы).
+            int rc = seg.size < size ? -1 : check_message(seg.addr, size, i);
+            shm_seg_close(&seg);
+            if (rc == -1) return -1;
+        } else {
+            if (read_full(sock, buf, size) == -1 || check_message(buf, size, i) == -1) return -1;
+        }
+        if (write_full(sock, "A", 1) == -1) return -1;
+    }
+    return 0;
+}
+
+static int bench_handoff(size_t size, size_t msgs, char *buf) {
+    int failures = 0;
+    for (int mode = 0; mode < MODE_COUNT; ++mode) {
+        int sv[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) == -1) {
+            perror("socketpair");
+            return 1;
+        }
+        double t0 = now_s(), cpu0 = self_cpu_s();
+        pid_t pid = fork();
+        if (pid == 0) {
+            close(sv[0]);
+            sender(sv[1], mode, size, msgs);
+        }
+        close(sv[1]);
+        int rc = pid == -1 ? -1 : receive(sv[0], mode, buf, size, msgs);
+        close(sv[0]);
+
+        struct rusage ru;
+        int status = 1;
+        double snd_cpu = 0;
+        if (pid > 0 && wait4(pid, &status, 0, &ru) == pid) snd_cpu = rusage_cpu_s(&ru);
+        double secs = now_s() - t0, cpu = self_cpu_s() - cpu0 + snd_cpu;
+        double gb = (double)(size * msgs) / 1e9;
+        if (rc == -1 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            printf("%-9zu %-9s %8s\n", size >> 10, mode_names[mode], "FAILED");
+            failures++;
+            continue;
+        }
+        printf("%-9zu %-9s %8.2f %12.1f\n", size >> 10, mode_names[mode], gb / secs, cpu * 1e3 / gb);
+    }
+    return failures;
+}
+
+int main(int argc, char *argv[]) {
+    const char *server = NULL;
+    size_t min_kib = 64, max_kib = 64 * 1024;
+    size_t volume_mib = 256;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "x:s:v:")) != -1) {
+        switch (opt) {
+        case 'x': server = optarg; break;
+        case 's':
+            min_kib = max_kib = strtoull(optarg, NULL, 0);
+            if (strchr(optarg, ':')) max_kib = strtoull(strchr(optarg, ':') + 1, NULL, 0);
+            break;
+        case 'v': volume_mib = strtoull(optarg, NULL, 0); break;
+        default:
+            fprintf(stderr, "usage: %s [-x server_binary] [-s min_kib[:max_kib]] [-v mib_per_point]\n",
+                    argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (min_kib < 4 || max_kib < min_kib || volume_mib < 1) {
+        fprintf(stderr, "invalid sizes (min 4 KiB)\n");
+        return EXIT_FAILURE;
+    }
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    signal(SIGPIPE, SIG_IGN);
+
+    size_t max_size = max_kib << 10;
+    char *msg = aligned_alloc(4096, max_size);
+    char *buf = aligned_alloc(4096, max_size);
+    if (!msg || !buf) {
+        perror("aligned_alloc");
+        return EXIT_FAILURE;
+    }
+    memset(msg, 'x', max_size);
+
+    int failures = 0;
+    if (server) {
+        printf("echo through %s, %zu MiB per point\n", server, volume_mib);
+        printf("%-9s %-9s %8s %12s %12s\n", "size_KiB", "path", "GB/s", "srv_ms/GB", "cli_ms/GB");
+        for (size_t kib = min_kib; kib <= max_kib; kib *= 4) {
+            size_t size = kib << 10;
+            size_t msgs = (volume_mib << 20) / size;
+            failures += bench_echo(server, size, msgs < 4 ? 4 : msgs, msg, buf);
+        }
+        printf("\n");
+    }
+
+    printf("handoff between processes, %zu MiB per point (cpu: sender + receiver)\n", volume_mib);
+    printf("%-9s %-9s %8s %12s\n", "size_KiB", "path", "GB/s", "cpu_ms/GB");
+    for (size_t kib = min_kib; kib <= max_kib; kib *= 4) {
+        size_t size = kib << 10;
+        size_t msgs = (volume_mib << 20) / size;
+        failures += bench_handoff(size, msgs < 4 ? 4 : msgs, buf);
+    }
+
+    free(msg);
+    free(buf);
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,256 @@
+#!/bin/sh
+
+set -eu
+
+
+ROOT_DIR=$(CDPATH= cd -- "$(dirname -- "$0")/.." && pwd)
+
+BIN_DIR="$ROOT_DIR/bin"
+
+
+printf "[tests] building...\n"
+
+make -C "$ROOT_DIR" all >/dev/null
+
+
+fail() { printf "[tests] FAIL: %s\n" "$1"; exit 1; }
+
+pass() { printf "[tests] PASS: %s\n" "$1"; }
+
+
+# iov: writev/readv round trip
+
+"$BIN_DIR/iov_demo" | grep -q "Check passed" || fail "iov_demo"
+
+pass "iov_demo"
+
+
+# shm_bus: fan-out to several subscriber processes without errors
+
+"$BIN_DIR/shm_bus_bench" -n 2000 -s 256 -m 4 >/dev/null 2>&1 || fail "shm_bus_bench"
+
+pass "shm_bus fan-out"
+
+
+# ipc_bench: every mechanism completes ping-pong and streaming
+
+"$BIN_DIR/ipc_bench" -s 64 -n 200 -p same >/dev/null 2>&1 || fail "ipc_bench"
+
+pass "ipc_bench"
+
+
+# shm_seg: segment handed to another process via SCM_RIGHTS
+
+"$BIN_DIR/shm_hugepage_bench" -s 8 -r 10000 >/dev/null 2>&1 || fail "shm_hugepage_bench"
+
+pass "shm_seg fd passing"
+
+
+# epoll_server: echo through the single-threaded and multi-loop modes
+
+"$BIN_DIR/epoll_bench" -x "$BIN_DIR/epoll_server" -t 0,2 -T 2 -c 8 -d 0.3 >/dev/null 2>&1 \
+    || fail "epoll_bench"
+
+pass "epoll_server loops"
+
+
+# epoll_server: pipelined requests larger than one read, with output backpressure
+
+"$BIN_DIR/epoll_bench" -x "$BIN_DIR/epoll_server" -t 0 -T 2 -c 4 -s 65536 -P 16 -d 0.3 >/dev/null 2>&1 \
+    || fail "epoll_bench pipelined"
+
+pass "epoll_server pipelining"
+
+
+# epoll_server: io_uring backend (multishot accept/recv, provided buffers)
+
+"$BIN_DIR/epoll_bench" -x "$BIN_DIR/epoll_server" -b uring -t 0,2 -T 2 -c 8 -d 0.3 >/dev/null 2>&1 \
+    || fail "epoll_bench io_uring"
+"$BIN_DIR/epoll_bench" -x "$BIN_DIR/epoll_server" -b uring -t 0 -T 2 -c 4 -s 65536 -P 16 -m msg -d 0.3 \
+    >/dev/null 2>&1 || fail "epoll_bench io_uring pipelined"
+
+pass "epoll_server io_uring backend"
+
+
+# epoll_server: many idle connections, echo on a few active ones
+
+for backend in epoll uring; do
+    "$BIN_DIR/epoll_idle_bench" -x "$BIN_DIR/epoll_server" -b "$backend" -n 2000 -a 10 -d 0.2 \
+        >/dev/null 2>&1 || fail "epoll_idle_bench $backend"
+done
+
+pass "epoll_server idle connections"
+
+
+# timer wheel: exact expiry in virtual time, no early firing with one timerfd
+
+"$BIN_DIR/timer_wheel_bench" -n 20000 -r 100000 -k 100 -a 2000 -d 200 >/dev/null 2>&1 \
+    || fail "timer_wheel_bench"
+
+# epoll_server: idle timeout closes idle connections, keeps active ones
+
+for loops in 0 2; do
+    "$BIN_DIR/epoll_idle_bench" -x "$BIN_DIR/epoll_server" -t "$loops" -n 1000 -a 10 -d 0.4 -I 150 \
+        >/dev/null 2>&1 || fail "epoll_idle_bench idle timeout, $loops loops"
+done
+
+pass "epoll_server timeouts"
+
+
+# MPSC task queue: no lost or reordered items, mutex baseline for comparison
+
+"$BIN_DIR/mpsc_bench" -p 1,3 -n 200000 >/dev/null 2>&1 || fail "mpsc_bench"
+
+pass "mpsc task queue"
+
+
+# loadgen: closed loop with pipelining and open loop at a fixed rate
+
+"$BIN_DIR/epoll_server" -q >/dev/null 2>&1 &
+server_pid=$!
+sleep 0.3
+"$BIN_DIR/loadgen" -c 8 -T 2 -P 4 -d 0.3 >/dev/null 2>&1 \
+    || { kill "$server_pid"; fail "loadgen closed loop"; }
+"$BIN_DIR/loadgen" -c 8 -R 5000 -s 512 -d 0.3 >/dev/null 2>&1 \
+    || { kill "$server_pid"; fail "loadgen open loop"; }
+kill "$server_pid"
+wait "$server_pid" 2>/dev/null || true
+
+pass "loadgen"
+
+
+# framing: pipelined small frames and frames spanning several read blocks
+
+"$BIN_DIR/epoll_bench" -x "$BIN_DIR/epoll_server" -F -t 0,2 -T 2 -c 4 -s 16 -P 32 -m msg -d 0.3 \
+    >/dev/null 2>&1 || fail "epoll_bench framed"
+"$BIN_DIR/epoll_server" -q -f >/dev/null 2>&1 &
+server_pid=$!
+sleep 0.3
+"$BIN_DIR/loadgen" -F -c 4 -s 10000 -P 4 -d 0.3 >/dev/null 2>&1 \
+    || { kill "$server_pid"; fail "loadgen framed"; }
+kill "$server_pid"
+wait "$server_pid" 2>/dev/null || true
+
+pass "epoll_server frames"
+
+
+# zero-copy: splice echo through epoll_server, vmsplice and sealed memfd handoff
+
+"$BIN_DIR/zcopy_bench" -x "$BIN_DIR/epoll_server" -s 64:4096 -v 16 >/dev/null 2>&1 \
+    || fail "zcopy_bench"
+
+pass "zero-copy large messages"
+
+
+# priority classes: control client in its own SCHED_FIFO loop under bulk load
+
+"$BIN_DIR/prio_bench" -x "$BIN_DIR/epoll_server" -c 8 -d 0.5 >/dev/null 2>&1 || fail "prio_bench"
+
+pass "epoll_server priority classes"
+
+
+# read budgets: light clients next to heavy senders, budget and token bucket phases
+
+"$BIN_DIR/fair_bench" -x "$BIN_DIR/epoll_server" -H 2 -l 4 -d 0.5 >/dev/null 2>&1 || fail "fair_bench"
+
+pass "epoll_server read budgets"
+
+
+# hot restart: the new -U instance takes over the listening socket and clients
+
+"$BIN_DIR/restart_bench" -x "$BIN_DIR/epoll_server" -c 8 -d 1 >/dev/null 2>&1 || fail "restart_bench"
+"$BIN_DIR/restart_bench" -x "$BIN_DIR/epoll_server" -t 2 -c 8 -d 1 >/dev/null 2>&1 \
+    || fail "restart_bench -t 2"
+
+pass "epoll_server hot restart"
+
+
+# posix_mq_server: many clients, cached reply queues (LRU with evictions at -C 2)
+
+"$BIN_DIR/mq_bench" -x "$BIN_DIR/posix_mq_server" -c 1,8 -d 0.3 >/dev/null 2>&1 || fail "mq_bench"
+"$BIN_DIR/mq_bench" -x "$BIN_DIR/posix_mq_server" -c 4 -C 2 -d 0.3 >/dev/null 2>&1 || fail "mq_bench -C 2"
+
+pass "posix_mq reply queue cache"
+
+
+# posix_mq_server worker pool: urgent requests under a normal-priority flood, reply priority preserved
+
+"$BIN_DIR/mq_prio_bench" -x "$BIN_DIR/posix_mq_server" -f 4 -w 2 -d 0.3 >/dev/null 2>&1 || fail "mq_prio_bench"
+
+pass "posix_mq priority worker pool"
+
+
+# shm_pq: priority order, FIFO within a priority, request/reply against mq
+
+"$BIN_DIR/pq_bench" -c 1,8 -d 0.3 >/dev/null 2>&1 || fail "pq_bench"
+"$BIN_DIR/pq_bench" -c 4 -m 64 -d 0.3 >/dev/null 2>&1 || fail "pq_bench -m 64"
+
+pass "shm_pq priority queue"
+
+
+# posix_mq large messages: payload in the server's shared-memory pool, descriptor via mq
+
+"$BIN_DIR/blob_bench" -x "$BIN_DIR/posix_mq_server" -s 256,64K,4M -d 0.2 >/dev/null 2>&1 || fail "blob_bench"
+
+pass "posix_mq shared-memory payloads"
+
+
+# reactor: mq, socket, timerfd, signalfd and eventfd served by one thread
+
+"$BIN_DIR/reactor_demo" >/dev/null 2>&1 || fail "reactor_demo"
+
+pass "reactor event loop"
+
+
+# ascii: scalar/SSE2/AVX2 kernels agree with each other and with libc
+
+"$BIN_DIR/ascii_bench" -s 16,100,4K -d 0.01 >/dev/null 2>&1 || fail "ascii_bench"
+
+pass "ascii vector kernels"
+
+
+# iov_msg: batches via writev, parsed into slots via readv; IOV_MAX splits a large batch
+
+"$BIN_DIR/iov_bench" -s 16,4K -b 16 -d 0.1 >/dev/null 2>&1 || fail "iov_bench"
+"$BIN_DIR/iov_bench" -s 16 -b 1024 -d 0.1 >/dev/null 2>&1 || fail "iov_bench -b 1024"
+
+pass "iov_msg batched framing"
+
+
+# mmsg: sendmmsg/recvmmsg batches (full and deadline-flushed) against send/recv and mq
+
+"$BIN_DIR/mmsg_bench" -r 20000 -d 0.1 >/dev/null 2>&1 || fail "mmsg_bench"
+"$BIN_DIR/mmsg_bench" -t dgram -b 8 -s 256 -d 0.1 >/dev/null 2>&1 || fail "mmsg_bench -t dgram"
+
+pass "mmsg batched datagrams"
+
+
+# mmsg: EAGAIN on a non-blocking socket keeps the unsent tail queued for the next flush
+
+"$BIN_DIR/mmsg_bench" -s 256 -b 8 -d 0.05 2>/dev/null | grep -q "non-blocking backpressure: .*: ok" \
+    || fail "mmsg backpressure"
+"$BIN_DIR/mmsg_bench" -t dgram -b 64 -d 0.05 2>/dev/null | grep -q "non-blocking backpressure: .*: ok" \
+    || fail "mmsg backpressure -t dgram"
+
+pass "mmsg non-blocking backpressure"
+
+
+# lat_hist: percentiles within the precision bound, Welford stats and merges match an exact sorted sample
+
+JSON_OUT=$(mktemp)
+"$BIN_DIR/lat_hist_bench" -n 200000 -j "$JSON_OUT" >/dev/null 2>&1 || fail "lat_hist_bench"
+grep -q '"count":200000,' "$JSON_OUT" || fail "lat_hist_bench json"
+rm -f "$JSON_OUT"
+
+pass "lat_hist statistics"
+
+
+# timer_wheel: a timer re-armed at the current tick from its own callback fires on the next tick
+
+"$BIN_DIR/timer_wheel_bench" -n 100 -r 100 -k 0 -a 10 -d 5 2>/dev/null \
+    | grep -q "re-arm from callback at the current tick: ok" || fail "timer_wheel re-arm from callback"
+
+pass "timer_wheel re-arm from callback"
+
+
+printf "[tests] all tests passed\n"
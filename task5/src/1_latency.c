@@ -3,6 +3,7 @@
 #include <unistd.h>
 #include <time.h>
 #include <sys/resource.h>
+#include "lat_hist.h"
 
 #define ARRAY_SIZE (512 * 1024 * 1024) // 512 MB
 #define PAGE_SIZE 4096
@@ -25,6 +26,10 @@ int main() {
     struct timespec start_time, end_time;
     struct rusage usage_before, usage_after;
 
+    // Сводка по всем итерациям — гистограмма задержек из task3
+    lat_hist_t hist;
+    lat_hist_init(&hist);
+
     printf("Iter\tLatency (ns)\tMinor Faults\tMajor Faults\n");
 
     for (int i = 0; i < NUM_ITERATIONS; ++i) {
@@ -46,12 +51,18 @@ int main() {
         getrusage(RUSAGE_SELF, &usage_after);
 
         long long latency = timespec_diff_ns(start_time, end_time);
+        lat_hist_record(&hist, latency > 0 ? (uint64_t)latency : 0);
         long minor_faults = usage_after.ru_minflt - usage_before.ru_minflt;
         long major_faults = usage_after.ru_majflt - usage_before.ru_majflt;
 
         printf("%d\t%lld\t\t%ld\t\t%ld\n", i, latency, minor_faults, major_faults);
     }
 
+    printf("Latency over %d iterations: min %llu, p50 %llu, p99 %llu, max %llu ns, avg %.1f ns (stddev %.1f)\n",
+           NUM_ITERATIONS, (unsigned long long)hist.min, (unsigned long long)lat_hist_percentile(&hist, 50),
+           (unsigned long long)lat_hist_percentile(&hist, 99), (unsigned long long)hist.max,
+           lat_hist_mean(&hist), lat_hist_stddev(&hist));
+
     free(array);
     return 0;
 }
\ No newline at end of file
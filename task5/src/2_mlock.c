@@ -4,6 +4,7 @@
 #include <time.h>
 #include <sys/resource.h>
 #include <sys/mman.h>
+#include "lat_hist.h"
 
 #define ARRAY_SIZE (512 * 1024 * 1024) // 512 MB
 #define PAGE_SIZE 4096
@@ -38,6 +39,10 @@ int main() {
     struct timespec start_time, end_time;
     struct rusage usage_before, usage_after;
 
+    // Сводка по всем итерациям — гистограмма задержек из task3
+    lat_hist_t hist;
+    lat_hist_init(&hist);
+
     printf("Iter\tLatency (ns)\tMinor Faults\tMajor Faults\n");
 
     // Сбрасываем статистику перед основным циклом
@@ -52,6 +57,7 @@ int main() {
         clock_gettime(CLOCK_MONOTONIC, &end_time);
 
         long long latency = timespec_diff_ns(start_time, end_time);
+        lat_hist_record(&hist, latency > 0 ? (uint64_t)latency : 0);
 
         // Замеряем общее количество отказов после цикла
         // В идеале, оно не должно меняться внутри цикла
@@ -63,6 +69,11 @@ int main() {
         usage_before = usage_after; // Обновляем для следующей итерации
     }
 
+    printf("Latency over %d iterations: min %llu, p50 %llu, p99 %llu, max %llu ns, avg %.1f ns (stddev %.1f)\n",
+           NUM_ITERATIONS, (unsigned long long)hist.min, (unsigned long long)lat_hist_percentile(&hist, 50),
+           (unsigned long long)lat_hist_percentile(&hist, 99), (unsigned long long)hist.max,
+           lat_hist_mean(&hist), lat_hist_stddev(&hist));
+
     free(array);
     // munlockall() вызывается неявно при завершении процесса
     return 0;
@@ -1,7 +1,9 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <time.h>
+#include <sys/mman.h>
 #include "mempool.h"
+#include "lat_hist.h"
 
 #define BENCH_ITERATIONS 1000000
 #define BLOCK_SIZE 128
@@ -10,32 +12,44 @@ long long timespec_diff_ns(struct timespec start, struct timespec end) {
     return (end.tv_sec - start.tv_sec) * 1000000000LL + (end.tv_nsec - start.tv_nsec);
 }
 
+// Не только максимум: хвост виден по перцентилям (гистограмма из task3)
+static void print_latency(const char *label, const lat_hist_t *h) {
+    printf("%s latency: min %llu, p50 %llu, p99 %llu, p99.9 %llu, max %llu ns, avg %.1f ns\n", label,
+           (unsigned long long)h->min, (unsigned long long)lat_hist_percentile(h, 50),
+           (unsigned long long)lat_hist_percentile(h, 99), (unsigned long long)lat_hist_percentile(h, 99.9),
+           (unsigned long long)h->max, lat_hist_mean(h));
+}
+
 void benchmark_malloc() {
     printf("Benchmarking malloc/free...\n");
     struct timespec start, end;
-    long long max_latency = 0;
-    void* ptrs[BENCH_ITERATIONS];
+    static lat_hist_t hist;
+    static void* ptrs[BENCH_ITERATIONS];
+
+    lat_hist_init(&hist);
 
     for (int i = 0; i < BENCH_ITERATIONS; ++i) {
         clock_gettime(CLOCK_MONOTONIC, &start);
         ptrs[i] = malloc(BLOCK_SIZE);
         clock_gettime(CLOCK_MONOTONIC, &end);
         long long latency = timespec_diff_ns(start, end);
-        if (latency > max_latency) max_latency = latency;
+        lat_hist_record(&hist, latency > 0 ? (uint64_t)latency : 0);
     }
 
     for (int i = 0; i < BENCH_ITERATIONS; ++i) {
         free(ptrs[i]);
     }
 
-    printf("malloc/free max latency: %lld ns\n", max_latency);
+    print_latency("malloc", &hist);
 }
 
 void benchmark_mempool() {
     printf("Benchmarking memory pool...\n");
     struct timespec start, end;
-    long long max_latency = 0;
-    void* ptrs[BENCH_ITERATIONS];
+    static lat_hist_t hist;
+    static void* ptrs[BENCH_ITERATIONS];
+
+    lat_hist_init(&hist);
 
     // Создать пул с достаточным количеством блоков
     MemoryPool* pool = pool_create(BLOCK_SIZE, BENCH_ITERATIONS);
@@ -50,7 +64,7 @@ void benchmark_mempool() {
         ptrs[i] = pool_alloc(pool);
         clock_gettime(CLOCK_MONOTONIC, &end);
         long long latency = timespec_diff_ns(start, end);
-        if (latency > max_latency) max_latency = latency;
+        lat_hist_record(&hist, latency > 0 ? (uint64_t)latency : 0);
     }
 
     // Освободить блоки
@@ -58,7 +72,7 @@ void benchmark_mempool() {
         pool_free(pool, ptrs[i]);
     }
 
-    printf("pool_alloc max latency: %lld ns\n", max_latency);
+    print_latency("pool_alloc", &hist);
 
     // Уничтожить пул
     pool_destroy(pool);